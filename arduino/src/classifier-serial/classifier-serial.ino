@@ -25,7 +25,7 @@ const float accelerationMultiplier = 16384; // Value to divide by to get an acce
 int ax, ay, az;         // Accelerometer values
 float readingsBuffer[50] = {0.0f}; 
 int readingsIndex = 0;
-float normalisedReadings[numInputNodes];
+float *normalisedReadings;    // The network's input nodes, so that no separate array is needed
 
 Network_A *network;
 
@@ -54,6 +54,7 @@ void setup() {
   
   /* Initialise Network */
   network = new Network_A();
+  normalisedReadings = network->getInputNodes();
 
   /* Initialise pseudorandom number generator */
   randomSeed(analogRead(0));
@@ -0,0 +1,79 @@
+#!/usr/bin/python
+
+# noinspection PyUnresolvedReferences
+import os, sys, subprocess
+
+# Compile script for the Network_A benchmark, will recompile all dependencies
+#
+# Network_A is built for one config, given as the only argument, or
+# ../network/config/config_final.h by default, which finds the headers it includes in
+# ../network/src/ as it would in the sketch folder. It is built with ARDUINO defined, against the
+# emulated avr/pgmspace.h in ../network/host/
+#
+# This script should be run from linux/
+
+#
+# Main Program
+#
+
+
+# Check for being in linux/
+_, cwd = os.path.split(os.getcwd())
+if not cwd == "linux":
+    print("Please run from the project/linux/ folder, not %s/" % cwd)
+    sys.exit(1)
+
+
+# Parse arguments
+# noinspection PyUnresolvedReferences
+if len(sys.argv) > 2:
+    print("Too many arguments given; try again.")
+    sys.exit(1)
+
+config = os.path.abspath(sys.argv[1] if len(sys.argv) == 2 else "../network/config/config_final.h")
+if not os.path.isfile(config):
+    print("Could not find %s" % config)
+    sys.exit(1)
+arduino_flags = ["-DARDUINO", "-I../network/host", "-I../network/src", "-DNETWORK_A_CONFIG=\"%s\"" % config]
+
+
+# Compile the various source files
+print("Compiling against %s..." % config)
+a = subprocess.Popen(["g++", "-c", "-std=c++11", "-O2", "../network/src/network-linux.cpp"])
+b = subprocess.Popen(["g++", "-c", "-std=c++11", "-O2", "../network/src/network-saveload-linux.cpp"])
+k = subprocess.Popen(["g++", "-c", "-std=c++11", "-O2", "../network/src/network-kernels.cpp"])
+c = subprocess.Popen(["g++", "-c", "-std=c++11", "-O2", "src/training-set.cpp"])
+n = subprocess.Popen(["g++", "-c", "-std=c++11", "-O2"] + arduino_flags
+                     + ["../network/src/network-arduino.cpp", "-o", "network-arduino-host.o"])
+d = subprocess.Popen(["g++", "-c", "-std=c++11", "-O2"] + arduino_flags + ["src/benchmark-arduino.cpp"])
+
+a.wait()
+if a.returncode == 1:
+    sys.exit(1)
+b.wait()
+if b.returncode == 1:
+    sys.exit(1)
+k.wait()
+if k.returncode == 1:
+    sys.exit(1)
+c.wait()
+if c.returncode == 1:
+    sys.exit(1)
+n.wait()
+if n.returncode == 1:
+    sys.exit(1)
+d.wait()
+if d.returncode == 1:
+    sys.exit(1)
+
+
+# Link the object files together into an executable
+print("Linking...")
+o = subprocess.Popen(["g++", "benchmark-arduino.o", "network-arduino-host.o", "training-set.o", "network-linux.o",
+                      "network-saveload-linux.o", "network-kernels.o", "-o", "benchmark-arduino", "-std=c++11",
+                      "-pthread"])
+o.wait()
+if o.returncode == 1:
+    sys.exit(1)
+
+sys.exit(0)
@@ -29,9 +29,10 @@ if len(sys.argv) > 1:
 
 # Compile the various source files
 print("Compiling...")
-a = subprocess.Popen(["g++", "-c", "-std=c++11", "../network/src/network-linux.cpp"])
-b = subprocess.Popen(["g++", "-c", "-std=c++11", "../network/src/network-saveload-linux.cpp"])
-c = subprocess.Popen(["g++", "-c", "-std=c++11", "src/new-network.cpp"])
+a = subprocess.Popen(["g++", "-c", "-std=c++11", "-O2", "../network/src/network-linux.cpp"])
+b = subprocess.Popen(["g++", "-c", "-std=c++11", "-O2", "../network/src/network-saveload-linux.cpp"])
+k = subprocess.Popen(["g++", "-c", "-std=c++11", "-O2", "../network/src/network-kernels.cpp"])
+c = subprocess.Popen(["g++", "-c", "-std=c++11", "-O2", "src/new-network.cpp"])
 
 a.wait()
 if a.returncode == 1:
@@ -39,6 +40,9 @@ if a.returncode == 1:
 b.wait()
 if b.returncode == 1:
     sys.exit(1)
+k.wait()
+if k.returncode == 1:
+    sys.exit(1)
 c.wait()
 if c.returncode == 1:
     sys.exit(1)
@@ -46,7 +50,7 @@ if c.returncode == 1:
 
 # Link the object files together into an executable
 print("Linking...")
-o = subprocess.Popen(["g++", "new-network.o", "../network/network-linux.o", "../network/network-saveload-linux.o", "-o", "new-network", "-std=c++11"])
+o = subprocess.Popen(["g++", "new-network.o", "../network/network-linux.o", "../network/network-saveload-linux.o", "../network/network-kernels.o", "-o", "new-network", "-std=c++11"])
 o.wait()
 if o.returncode == 1:
     sys.exit(1)
@@ -17,14 +17,14 @@ n_flag = False          # Whether or not the -n 'recompile network' flag is set
 def run_tests():
     # Compile core tests
     print("Compiling tests...")
-    a = subprocess.Popen(["g++", "-c", "-std=c++11", "test/training-io-tests.cpp"])
+    a = subprocess.Popen(["g++", "-c", "-std=c++11", "-O2", "test/training-io-tests.cpp"])
     a.wait()
     if a.returncode == 1:
         sys.exit(1) 
 
     # Link the various bits together into an executable
     print("Linking...")
-    b = subprocess.Popen(["g++", "../catch-main.o", "training-io-tests.o", "training-set.o", "../network/network-linux.o", "-o", ".catch.exe", "-std=c++11"])
+    b = subprocess.Popen(["g++", "../catch-main.o", "training-io-tests.o", "training-set.o", "../network/network-linux.o", "../network/network-kernels.o", "-o", ".catch.exe", "-std=c++11"])
     b.wait()
     if b.returncode == 1:
         sys.exit(1)
@@ -66,7 +66,7 @@ if len(sys.argv) > 2:
 # If the main test object file doesn't exist, compile it
 if not (os.path.isfile("../catch-main.o")):
     print("Compiling main...")
-    m = subprocess.Popen(["g++", "-c", "-std=c++11", "../catch-main.cpp", "-o", "../catch-main.o"])
+    m = subprocess.Popen(["g++", "-c", "-std=c++11", "-O2", "../catch-main.cpp", "-o", "../catch-main.o"])
     m.wait()
     if m.returncode == 1:
         sys.exit(1) 
@@ -75,14 +75,18 @@ if not (os.path.isfile("../catch-main.o")):
 # If the network code doesn't exist, or the -n flag is set, compile it
 if not (os.path.isfile("../network/network-linux.o")) or n_flag:
     print("Compiling network")
-    n = subprocess.Popen(["g++", "-c", "-std=c++11", "../network/src/network-linux.cpp"])
+    n = subprocess.Popen(["g++", "-c", "-std=c++11", "-O2", "../network/src/network-linux.cpp"])
     n.wait()
     if n.returncode == 1:
             sys.exit(1)  
+    k = subprocess.Popen(["g++", "-c", "-std=c++11", "-O2", "../network/src/network-kernels.cpp"])
+    k.wait()
+    if k.returncode == 1:
+            sys.exit(1)
 
 # Compile training code
 print("Compiling training code")
-t = subprocess.Popen(["g++", "-c", "-std=c++11", "src/training-set.cpp", "src/train.cpp"])
+t = subprocess.Popen(["g++", "-c", "-std=c++11", "-O2", "src/training-set.cpp", "src/train.cpp"])
 t.wait()
 if t.returncode == 1:
     sys.exit(1)
@@ -0,0 +1,203 @@
+/*
+ * Benchmark of Network_A on the host, against Network_L for the same config.
+ *
+ * Run from command line as follows:
+ *
+ * benchmark-arduino [-c] [-n classifications] [log_filename]
+ *
+ * Built by compile-benchmark-arduino.py against one float config for Network_A, by default
+ * ../network/config/config_final.h. ARDUINO is defined and avr/pgmspace.h is emulated (see
+ * network/host/avr/pgmspace.h), so Network_A runs the code the board runs, reading its weights
+ * from flash through memcpy_P. Network_L is loaded from the same config.
+ *
+ * Both networks classify the inputs of the patterns in log_filename, or random inputs without one,
+ * and every output of Network_A must agree with Network_L's, within the sigmoid lookup table's
+ * error if the config has one. Then both are timed over the given number of classifications,
+ * 10000 by default.
+ *
+ * -c counts cycles instead: the median cycles of one classification by each network, from the
+ *    time stamp counter on x86 (or nanoseconds elsewhere), and the bytes Network_A reads from
+ *    flash for each. These are host figures, not the board's, but are steady enough to compare
+ *    changes to Network_A in CI before flashing anything.
+ *
+ * Exits with 1 if the outputs disagree.
+ *
+ * Must be run from the linux/ directory
+ */
+
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "../../network/src/network-linux.hpp"
+#include "../../network/src/network-saveload-linux.hpp"
+#include "../../network/src/network-arduino.hpp"
+#include "training-set.hpp"
+
+#ifndef NETWORK_A_CONFIG
+#error "Build with compile-benchmark-arduino.py, which gives the config to benchmark"
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+const std::string cycleUnit = "cycles";
+
+unsigned long long readCycles() {
+    return __rdtsc();
+}
+#else
+const std::string cycleUnit = "ns";
+
+unsigned long long readCycles() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+#endif
+
+#ifdef SIGMOID_TABLE
+// Each sigmoid is within the table's error, which the layers above can spread a little further
+const float tolerance = 0.001f;
+#else
+const float tolerance = 0.00001f;
+#endif
+
+/*
+ * The median cycles of one call of classify on each of the patterns in turn, repeated until there
+ * have been at least the given number of calls
+ */
+template<typename F>
+unsigned long long medianCycles(const std::vector<std::vector<float>> &patterns, int classifications, F classify) {
+    std::vector<unsigned long long> cycles;
+    for (int n = 0; n < classifications; n++) {
+        const std::vector<float> &inputs = patterns[n % patterns.size()];
+        unsigned long long start = readCycles();
+        classify(inputs);
+        cycles.push_back(readCycles() - start);
+    }
+    std::nth_element(cycles.begin(), cycles.begin() + cycles.size() / 2, cycles.end());
+    return cycles[cycles.size() / 2];
+}
+
+/*
+ * The seconds taken to call classify the given number of times, cycling through the patterns
+ */
+template<typename F>
+double timeClassifications(const std::vector<std::vector<float>> &patterns, int classifications, F classify) {
+    auto start = std::chrono::steady_clock::now();
+    for (int n = 0; n < classifications; n++) {
+        classify(patterns[n % patterns.size()]);
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char * argv[]) {
+    // Parse options, leaving the positional arguments in args
+    bool countCycles = false;
+    int classifications = 10000;
+    std::vector<char *> args;
+    args.push_back(argv[0]);
+    for (int i = 1; i < argc; i++) {
+        if (std::string(argv[i]) == "-c") {
+            countCycles = true;
+        } else if (std::string(argv[i]) == "-n" && i + 1 < argc) {
+            classifications = atoi(argv[++i]);
+        } else {
+            args.push_back(argv[i]);
+        }
+    }
+    argc = args.size();
+    argv = args.data();
+
+    // Parse arguments
+    if (argc > 2) {
+        std::cout << "Too many arguments supplied\n";
+        return 1;
+    }
+    if (classifications < 1) {
+        std::cout << "Must time at least 1 classification\n";
+        return 1;
+    }
+
+    std::cout << "Benchmarking " << NETWORK_A_CONFIG << "\n";
+    Network_L *reference = loadNetwork(NETWORK_A_CONFIG);
+    if (reference == nullptr) {
+        std::cout << "Could not load the config into Network_L\n";
+        return 1;
+    }
+    Network_A network;
+
+    std::vector<std::vector<float>> patterns;
+    if (argc == 2) {
+        TrainingSet *set = loadTrainingSet(argv[1]);
+        patterns = set->inputs;
+        delete set;
+    } else {
+        std::mt19937 generator(1);
+        std::uniform_real_distribution<float> distribution(0.0f, 2.0f);
+        patterns.resize(100, std::vector<float>(numInputNodes));
+        for (std::vector<float> &inputs : patterns) {
+            for (float &input : inputs) {
+                input = distribution(generator);
+            }
+        }
+    }
+    for (const std::vector<float> &inputs : patterns) {
+        if (inputs.size() != numInputNodes) {
+            std::cout << "Found a pattern of " << inputs.size() << " inputs, but the network has "
+                      << numInputNodes << ", exiting\n";
+            return 1;
+        }
+    }
+    if (patterns.empty()) {
+        std::cout << "No patterns found, exiting\n";
+        return 1;
+    }
+
+    // Check the outputs agree before timing anything
+    std::vector<float> inputs(numInputNodes);
+    double worstDeviation = 0.0;
+    for (const std::vector<float> &pattern : patterns) {
+        std::vector<float> expected = reference->classify(pattern);
+        inputs = pattern;
+        float *outputs = network.classify(inputs.data());
+        for (int i = 0; i < numOutputNodes; i++) {
+            worstDeviation = std::max(worstDeviation, double(std::fabs(outputs[i] - expected[i])));
+        }
+    }
+    std::cout << "Largest output deviation from Network_L over " << patterns.size() << " patterns: "
+              << worstDeviation << "\n";
+    if (!(worstDeviation <= tolerance)) {
+        std::cout << "Network_A disagrees with Network_L by more than " << tolerance << "\n";
+        return 1;
+    }
+
+    auto classifyArduino = [&](const std::vector<float> &pattern) {
+        std::copy(pattern.begin(), pattern.end(), inputs.begin());
+        network.classify(inputs.data());
+    };
+    auto classifyLinux = [&](const std::vector<float> &pattern) {
+        reference->classify(pattern);
+    };
+
+    if (countCycles) {
+        unsigned long before = pgmspaceBytesRead();
+        classifyArduino(patterns[0]);
+        std::cout << "Network_A reads " << pgmspaceBytesRead() - before << " bytes from flash a classification\n";
+        std::cout << "Network_A: " << medianCycles(patterns, classifications, classifyArduino) << " " << cycleUnit
+                  << " a classification\n";
+        std::cout << "Network_L: " << medianCycles(patterns, classifications, classifyLinux) << " " << cycleUnit
+                  << " a classification\n";
+    } else {
+        double arduinoSeconds = timeClassifications(patterns, classifications, classifyArduino);
+        double linuxSeconds = timeClassifications(patterns, classifications, classifyLinux);
+        std::cout << "Network_A: " << 1e6 * arduinoSeconds / classifications << " us a classification\n";
+        std::cout << "Network_L: " << 1e6 * linuxSeconds / classifications << " us a classification\n";
+        std::cout << "Network_A takes " << arduinoSeconds / linuxSeconds << " times as long\n";
+    }
+    return 0;
+}
@@ -3,10 +3,15 @@
  *
  * Run from command line as follows:
  *
- * train config_filename validationdir threshold
+ * evaluate [-f] config_filename validationdir threshold
  *
  * Will validate the network on the contents of validationdir
  *
+ * config_filename may be a config or a binary model file (see saveModel), and is saved back as the
+ * same
+ *
+ * -f uses the fast approximate Sigmoid/SoftMax activations rather than libm exp
+ *
  * Threshold is the number above which a target is counted
  *
  * For example, with a threshold of 0.5,  [0.6, 0.3, 0.1] would return 0, while [0.4, 0.1, 0.1] would return 3
@@ -29,6 +34,7 @@
 std::string config_file_location;
 std::string validationdir;
 float classificationThreshold = 0.5; // Default value
+bool fastActivations = false;
 
 // Validation data
 std::vector<std::vector<float>> validationTargets;
@@ -57,11 +63,28 @@ void validateSet(std::string filename, Network_L *network) {
     } else {
 
         TrainingSet *set = loadTrainingSet(filename);
+        int nin = network->getNumInputNodes();
+        int non = network->getNumOutputNodes();
+        int count = set->inputs.size();
+
+        // Pack the whole set into one contiguous block and score it in a single call
+        std::vector<float> inputs(count * nin);
+        std::vector<float> outputs(count * non);
+        for (int i = 0; i < count; i++) {
+            if (set->inputs[i].size() != nin) {
+                std::cout << filename << " has an example of the wrong size, skipping.\n";
+                return;
+            }
+            std::copy(set->inputs[i].begin(), set->inputs[i].end(), inputs.begin() + i * nin);
+        }
+        network->classifyBatch(inputs.data(), count, outputs.data());
 
-        for (int i = 0; i < set->inputs.size(); i++) {
-            validationOutputs.push_back(network->classify(set->inputs[i]));
-            validationTargets.push_back(set->targets[i]);
+        validationOutputs.reserve(validationOutputs.size() + count);
+        validationTargets.reserve(validationTargets.size() + count);
 
+        for (int i = 0; i < count; i++) {
+            validationOutputs.push_back(std::vector<float>(outputs.begin() + i * non, outputs.begin() + (i + 1) * non));
+            validationTargets.push_back(set->targets[i]);
         }
     }
 }
@@ -86,6 +109,19 @@ void validateDir(std::string dirname, Network_L *network) {
 }
 
 int main(int argc, char * argv[]) {
+    // Parse options, leaving the positional arguments in args
+    std::vector<char *> args;
+    args.push_back(argv[0]);
+    for (int i = 1; i < argc; i++) {
+        if (std::string(argv[i]) == "-f") {
+            fastActivations = true;
+        } else {
+            args.push_back(argv[i]);
+        }
+    }
+    argc = args.size();
+    argv = args.data();
+
     // Parse arguments
     if (argc < 4) {
         std::cout << "Too few arguments supplied\n";
@@ -116,6 +152,14 @@ int main(int argc, char * argv[]) {
         network = loadNetwork(config_file_location);
     }
 
+    if (network == nullptr) {
+        return 1;
+    }
+
+    if (fastActivations) {
+        network->setActivationPrecision(ActivationPrecision::Fast);
+    }
+
     std::cout << "Validating...\n";
     validateDir(validationdir, network);
 
@@ -229,6 +273,10 @@ int main(int argc, char * argv[]) {
     std::cout << "Error rate: " << 100 * wrong/float(correct + wrong) << "%\n";
     std::cout << "Unweighted Average Recall: " << uar * 100 << "%\n";
 
-    saveNetwork(config_file_location, network);
+    if (isModelFilename(config_file_location)) {
+        saveModel(config_file_location, network);
+    } else {
+        saveNetwork(config_file_location, network);
+    }
 }
 
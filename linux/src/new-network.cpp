@@ -7,15 +7,18 @@
  *
  * filename is the path from project/linux/ to the desired file.
  * It is recommended to place the file under ../network/config
+ * A filename ending in .model is saved as a binary model file (see saveModel), and any other as a
+ * config for Network_A
  * Will overwrite any existing network config
  *
  * nin = numInputNeurons
- * nhn = numHiddenNeurons
+ * nhn = numHiddenNeurons. For more than one hidden layer, give the width of each
+ *       layer in order, separated by commas, e.g. 16,8
  * non = numOutputNeurons
  * lr  = learningRate
  * m   = momentum
  * iwm = initialWeightMax
- * haf = hiddenActivationFunction
+ * haf = hiddenActivationFunction, used by every hidden layer
  * oaf = outputActivationFunction
  * ef = errorFunction
  *
@@ -26,6 +29,7 @@
 #include <iostream>
 #include <fstream>
 #include <dirent.h>
+#include <sstream>
 
 #include "../../network/src/network-linux.hpp"
 #include "../../network/src/network-saveload-linux.hpp"
@@ -33,7 +37,7 @@
 std::string config_file_path =  "";
 
 int nin;
-int nhn;
+std::vector<int> nhn;
 int non;
 
 float lr;
@@ -56,7 +60,11 @@ int main(int argc, char * argv[]) {
 
     config_file_path = argv[1];
     nin = atoi(argv[2]);
-    nhn = atoi(argv[3]);
+    std::istringstream hiddenWidths(argv[3]);
+    std::string width;
+    while (std::getline(hiddenWidths, width, ',')) {
+        nhn.push_back(atoi(width.c_str()));
+    }
     non = atoi(argv[4]);
 
     lr = atof(argv[5]);
@@ -71,13 +79,20 @@ int main(int argc, char * argv[]) {
     std::ifstream check_config(config_file_path);
     if (!check_config.is_open()) {
         std::cout << "not found, creating new network.\n";
-        Network_L *network = new Network_L(nin, nhn, non, lr, m, iwm, 0);
+        std::vector<int> layerSizes(1, nin);
+        layerSizes.insert(layerSizes.end(), nhn.begin(), nhn.end());
+        layerSizes.push_back(non);
+        Network_L *network = new Network_L(layerSizes, lr, m, iwm, 0);
 
         network->setHiddenActivationFunction(haf);
         network->setOutputActivationFunction(oaf);
         network->setErrorFunction(ef);
 
-        saveNetwork(config_file_path, network);
+        if (isModelFilename(config_file_path)) {
+            saveModel(config_file_path, network);
+        } else {
+            saveNetwork(config_file_path, network);
+        }
         std::cout << "Network created.\n";
     } else {
         check_config.close();
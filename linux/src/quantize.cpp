@@ -0,0 +1,184 @@
+/*
+ * Program to export a trained network with int8 or fixed-point weights for Network_A.
+ *
+ * Run from command line as follows:
+ *
+ * quantize [-f] [-d board] [-m max_bytes] [-r max_ms] config_filename dirname|log_filename quantized_config_filename
+ *
+ * The inputs in dirname (or log_filename) are used to calibrate the range of each layer's inputs
+ * (see quantizeNetwork), so they should be representative of what the device will see; the
+ * training set is a good choice. The int8 network is then compared with the float network on the
+ * same inputs, and the config is written to quantized_config_filename for the Arduino build.
+ *
+ * With -f the network is converted to fixed point instead (see convertToFixedPoint), for boards
+ * without an FPU. That needs no calibration, so the inputs are only used to compare it with the
+ * float network, and a validation set is the better choice.
+ *
+ * -d selects the board Network_A's cost is estimated for (see estimateDeviceCost): AVR, Curie
+ * (the default) or CortexM0. The network is rejected if it would not fit in the board's flash or
+ * SRAM, and the estimate is saved with it and reported either way. With -m the network is rejected
+ * if its activations would need more than max_bytes of SRAM in Network_A (see
+ * planActivationMemory) instead, and with -r if its classifications are estimated to take more
+ * than max_ms on the board.
+ *
+ * Must be run from the linux/ directory
+ */
+
+#include <iostream>
+#include <fstream>
+#include <dirent.h>
+#include <algorithm>
+#include <cmath>
+
+#include "../../network/src/network-linux.hpp"
+#include "../../network/src/network-saveload-linux.hpp"
+#include "training-set.hpp"
+
+std::vector<std::vector<float>> calibrationInputs;
+
+void loadCalibrationSet(std::string filename) {
+    // Check the log file exists, and if it doesn't, skip it
+    std::ifstream check_logfile(filename);
+    if (!check_logfile.good() || filename.find("_normalised") == std::string::npos) {
+        check_logfile.close();
+        std::cout << filename << " is an invalid log file, skipping.\n";
+    } else {
+        TrainingSet *set = loadTrainingSet(filename);
+        calibrationInputs.insert(calibrationInputs.end(), set->inputs.begin(), set->inputs.end());
+        delete set;
+    }
+}
+
+void loadCalibrationDir(std::string dirname) {
+    DIR *dir;
+    struct dirent *ent;
+    if ((dir = opendir (dirname.c_str())) != NULL) {
+        while ((ent = readdir (dir)) != NULL) {
+            if (ent->d_type == DT_REG &&
+                std::string(ent->d_name).find("_normalised") != std::string::npos) {
+                loadCalibrationSet(dirname + std::string(ent->d_name));
+            }else if (ent->d_type == DT_DIR &&
+                      std::string(ent->d_name).find(".") == std::string::npos) {
+                loadCalibrationDir(dirname + std::string(ent->d_name) + "/");
+            }
+        }
+        closedir (dir);
+    } else {
+        std::cout << "Could not open directory " << dirname << "\n";
+    }
+}
+
+int main(int argc, char * argv[]) {
+    // Parse options, leaving the positional arguments in args
+    bool fixedPoint = false;
+    DeviceBudget deviceBudget = defaultDeviceBudget;
+    std::vector<char *> args;
+    args.push_back(argv[0]);
+    for (int i = 1; i < argc; i++) {
+        if (std::string(argv[i]) == "-f") {
+            fixedPoint = true;
+        } else if (std::string(argv[i]) == "-m" && i + 1 < argc) {
+            deviceBudget.sramBytes = atoi(argv[++i]);
+        } else if (std::string(argv[i]) == "-d" && i + 1 < argc) {
+            deviceBudget.board = stringToBoard(argv[++i]);
+        } else if (std::string(argv[i]) == "-r" && i + 1 < argc) {
+            deviceBudget.milliseconds = std::stod(argv[++i]);
+        } else {
+            args.push_back(argv[i]);
+        }
+    }
+    argc = args.size();
+    argv = args.data();
+
+    // Parse arguments
+    if (argc < 4) {
+        std::cout << "Too few arguments supplied\n";
+        return 1;
+    } else if (argc > 4) {
+        std::cout << "Too many arguments supplied\n";
+        return 1;
+    }
+
+    std::cout << "Checking network config file...";
+    std::ifstream check_config(argv[1]);
+    if (!check_config.is_open()) {
+        std::cout << "not found, exiting\n";
+        return 1;
+    }
+    std::cout << "found, loading network\n";
+    Network_L *network = loadNetwork(argv[1]);
+    if (network == nullptr) {
+        return 1;
+    }
+    int sigmoidTableSize = needsSigmoidTable(network) ? buildSigmoidTable(defaultSigmoidTableError).entries.size() : 0;
+    DeviceCost deviceCost = estimateDeviceCost(network, fixedPoint ? ExportFormat::FixedPoint : ExportFormat::Int8,
+                                               deviceBudget.board, sigmoidTableSize);
+    DeviceCost floatCost = estimateDeviceCost(network, ExportFormat::Float, deviceBudget.board, sigmoidTableSize);
+    if (!withinDeviceBudget(deviceCost, deviceBudget)) {
+        return 1;
+    }
+
+    DIR *d;
+    if ((d = opendir (argv[2])) != NULL) {
+        closedir(d);
+        loadCalibrationDir(argv[2]);
+    } else {
+        loadCalibrationSet(argv[2]);
+    }
+    if (calibrationInputs.empty()) {
+        std::cout << "No calibration patterns found, exiting\n";
+        return 1;
+    }
+    for (const std::vector<float> &inputs : calibrationInputs) {
+        if (inputs.size() != network->getNumInputNodes()) {
+            std::cout << "Found a pattern of " << inputs.size() << " inputs, but the network has "
+                      << network->getNumInputNodes() << ", exiting\n";
+            return 1;
+        }
+    }
+    std::cout << (fixedPoint ? "Validating on " : "Calibrating on ") << calibrationInputs.size() << " patterns\n";
+
+    // Compare the integer network with the float network on the same patterns
+    QuantizedNetwork quantized;
+    FixedPointNetwork converted;
+    if (fixedPoint) {
+        converted = convertToFixedPoint(network);
+    } else {
+        quantized = quantizeNetwork(network, calibrationInputs);
+    }
+    double worstDeviation = 0.0;
+    double summedDeviation = 0.0;
+    int agreements = 0;
+    for (const std::vector<float> &inputs : calibrationInputs) {
+        std::vector<float> expected = network->classify(inputs);
+        std::vector<float> outputs = fixedPoint ? converted.classify(inputs) : quantized.classify(inputs);
+        for (int i = 0; i < outputs.size(); i++) {
+            double deviation = std::fabs(outputs[i] - expected[i]);
+            worstDeviation = std::max(worstDeviation, deviation);
+            summedDeviation += deviation;
+        }
+        if (std::max_element(outputs.begin(), outputs.end()) - outputs.begin()
+                == std::max_element(expected.begin(), expected.end()) - expected.begin()) {
+            agreements++;
+        }
+    }
+    std::cout << "Largest output deviation: " << worstDeviation << "\n";
+    std::cout << "Mean output deviation: "
+              << summedDeviation / (calibrationInputs.size() * network->getNumOutputNodes()) << "\n";
+    std::cout << "Same top output as the float network: "
+              << 100.0 * agreements / calibrationInputs.size() << "%\n";
+    std::cout << "Estimated cost on " << boardToString(deviceBudget.board) << ", against float weights:\n";
+    std::cout << "  Flash: " << deviceCost.flashBytes << " bytes, against " << floatCost.flashBytes << "\n";
+    std::cout << "  SRAM for activations: " << deviceCost.sramBytes << " bytes, against " << floatCost.sramBytes << "\n";
+    std::cout << "  Classification: " << deviceCost.milliseconds << " ms, against " << floatCost.milliseconds << "\n";
+
+    int saved = fixedPoint ? saveFixedPointNetwork(argv[3], network, deviceBudget)
+                           : saveQuantizedNetwork(argv[3], network, calibrationInputs, defaultSigmoidTableError,
+                                                  deviceBudget);
+    if (saved != 0) {
+        std::cout << "Could not write " << argv[3] << "\n";
+        return 1;
+    }
+    std::cout << "Saved to " << argv[3] << "\n";
+    return 0;
+}
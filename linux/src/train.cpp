@@ -3,7 +3,43 @@
  *
  * Run from command line as follows:
  *
- * train config_filename dirname|log_filename [suffix]
+ * train [-b batch_size] [-t threads [-a]] [-f] [-o optimizer] [-s] [-w precision] [-l max_error] [-d board] [-m max_bytes] [-r max_ms] [-x export_filename] config_filename dirname|log_filename [suffix]
+ *
+ * -b trains on mini-batches of batch_size examples at a time, with one averaged weight update
+ *    per batch. Defaults to 1, which trains on each example individually.
+ * -t trains data-parallel on the given number of threads. Each batch is split into one shard
+ *    per thread, every thread computes the gradients of its shard, and the gradients are summed
+ *    in thread order before a single update, so a run is repeatable for a given shuffle and
+ *    thread count. The batch size is raised to the thread count if it is smaller.
+ * -a with -t, trains Hogwild style instead: each thread trains on its own share of the examples
+ *    in batches of batch_size, updating the shared weights without any locking. Fastest, but
+ *    updates from different threads can interleave, so runs are not repeatable.
+ * -f uses the fast approximate Sigmoid/SoftMax activations rather than libm exp.
+ * -o selects the weight update rule: Momentum (the default), Nesterov, RMSProp or Adam. The
+ *    optimizer state starts from zero each run, as it is not saved with the network.
+ * -s keeps only the non-zero inputs of each example in memory, for mostly zero input patterns.
+ *    Trained one example at a time, the first layer then only visits the non-zero inputs, and
+ *    with Momentum only their weights are updated (see Network_L::trainNetwork). Batches are
+ *    expanded back to dense rows as they are gathered.
+ * -w stores the weights and their momentum as Float32 (the default), BFloat16 or Float16 while
+ *    training, rounding each update stochastically. Only one example at a time on one thread with
+ *    the Momentum optimizer and dense inputs. The saved network is always Float32.
+ * -l sets the largest error of the sigmoid lookup table saved for Network_A (see
+ *    buildSigmoidTable), 0.0001 by default, and below 0.5. 0 saves no table, and Network_A then
+ *    uses exp. No table is saved for a network with no sigmoid layers.
+ * -d selects the board Network_A's cost is estimated for (see estimateDeviceCost): AVR, Curie
+ *    (the default) or CortexM0. A network that would not fit in the board's flash or SRAM is
+ *    rejected before training it, and the estimate is saved with it and reported either way.
+ * -m rejects a network whose activations would need more than max_bytes of SRAM in Network_A
+ *    (see planActivationMemory), rather than all the board has.
+ * -r rejects a network whose classifications are estimated to take more than max_ms on the board.
+ * -x exports the trained network as a config for Network_A to export_filename, when config_filename
+ *    is a binary model file (see saveModel). A model file is saved back as one, so without -x
+ *    nothing is exported for Network_A, and the table and board options are not used. Any other
+ *    config_filename is a config, saved back as the export.
+ *
+ * With more than one thread, the single-thread speed is measured on a copy of the network before
+ * training, and the speedup and scaling efficiency are reported at the end.
  *
  * Must be run from the linux/ directory
  */
@@ -13,14 +49,21 @@
 #include <dirent.h>
 #include <random>
 #include <algorithm>
+#include <numeric>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
 
 #include "../../network/src/network-linux.hpp"
 #include "../../network/src/network-saveload-linux.hpp"
+#include "../../network/src/network-kernels.hpp"
 #include "training-set.hpp"
 
 bool directory = false;
 
 std::vector<std::vector<float>> trainingInputs;
+std::vector<SparseInputs> sparseTrainingInputs;
 std::vector<std::vector<float>> trainingTargets;
 std::vector<std::vector<float>> trainingOutputs;
 
@@ -29,12 +72,32 @@ std::string suffix = "";
 long examplesTrainedOn = 0;
 float latestErrorRate = 0;
 
+int batchSize = 1;
+int numThreads = 1;
+bool hogwild = false;
+bool fastActivations = false;
+Optimizer optimizer = Optimizer::Momentum;
+bool sparse = false;
+WeightPrecision weightPrecision = WeightPrecision::Float32;
+float sigmoidTableError = defaultSigmoidTableError;
+DeviceBudget deviceBudget = defaultDeviceBudget;
+std::string exportFilename = "";
+
 void loadTrainingSets(std::string filename, Network_L *network) {
     // Check the training file exists, and if it doesn't, exit
     std::ifstream check_logfile(filename);
     if (!check_logfile.good() || filename.find(suffix) == std::string::npos) {
         check_logfile.close();
         std::cout << filename << " is an invalid log file, skipping.\n";
+    } else if (sparse) {
+
+        SparseTrainingSet *set = loadSparseTrainingSet(filename);
+
+        for (int i = 0; i < set->inputs.size(); i++) {
+            sparseTrainingInputs.push_back(set->inputs[i]);
+            trainingTargets.push_back(set->targets[i]);
+        }
+        delete set;
     } else {
 
         TrainingSet *set = loadTrainingSet(filename);
@@ -65,7 +128,239 @@ void loadDir(std::string dirname, Network_L *network) {
     }
 }
 
+/*
+ * Copy count examples, starting at position first in indexes, into contiguous rows of inputs and
+ * targets. Sparse examples are expanded into dense rows of numInputs values.
+ */
+void packExamples(const std::vector<int> &indexes, int first, int count, int numInputs, float *inputs, float *targets) {
+    for (int r = 0; r < count; r++) {
+        int currentIndex = indexes[first + r];
+        if (sparse) {
+            const SparseInputs &row = sparseTrainingInputs[currentIndex];
+            std::fill(inputs + r * numInputs, inputs + (r + 1) * numInputs, 0.0f);
+            for (int k = 0; k < row.indexes.size(); k++) {
+                inputs[r * numInputs + row.indexes[k]] = row.values[k];
+            }
+        } else {
+            std::copy(trainingInputs[currentIndex].begin(), trainingInputs[currentIndex].end(),
+                      inputs + r * trainingInputs[currentIndex].size());
+        }
+        std::copy(trainingTargets[currentIndex].begin(), trainingTargets[currentIndex].end(),
+                  targets + r * trainingTargets[currentIndex].size());
+    }
+}
+
+/*
+ * Print progress whenever another hundred examples have been trained on
+ */
+void reportProgress(int examples) {
+    long previousHundreds = examplesTrainedOn / 100;
+    examplesTrainedOn += examples;
+    if (examplesTrainedOn / 100 != previousHundreds) {
+        std::cout << "Trained " << examplesTrainedOn << " examples. Error rate is " << latestErrorRate << "\n";
+    }
+}
+
+/*
+ * Blocks each thread that calls wait() until all numThreads threads have called it
+ */
+class Barrier {
+public:
+    Barrier(int numThreads): numThreads(numThreads), waiting(0), generation(0) {}
+
+    void wait() {
+        std::unique_lock<std::mutex> lock(mutex);
+        long arrivedIn = generation;
+        if (++waiting == numThreads) {
+            waiting = 0;
+            generation++;
+            released.notify_all();
+        } else {
+            released.wait(lock, [&] { return generation != arrivedIn; });
+        }
+    }
+
+private:
+    std::mutex mutex;
+    std::condition_variable released;
+    const int numThreads;
+    int waiting;
+    long generation;
+};
+
+/*
+ * Train on the examples in the given order, one batch at a time, on this thread.
+ * Returns the number of examples trained on per second.
+ */
+double trainSerial(Network_L *network, const std::vector<int> &indexes, int count, bool report) {
+    int nin = network->getNumInputNodes();
+    int non = network->getNumOutputNodes();
+    std::vector<float> batchInputs(batchSize * nin);
+    std::vector<float> batchTargets(batchSize * non);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < count; i += batchSize) {
+        int currentBatchSize = std::min(batchSize, count - i);
+        packExamples(indexes, i, currentBatchSize, nin, batchInputs.data(), batchTargets.data());
+        float errorRate = network->trainBatch(batchInputs.data(), batchTargets.data(), currentBatchSize);
+        if (report) {
+            latestErrorRate = errorRate;
+            reportProgress(currentBatchSize);
+        }
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return count / elapsed.count();
+}
+
+/*
+ * Train data-parallel on numThreads threads. Every batch is split into one contiguous shard per
+ * thread. Each thread computes the gradients of its shard, then each sums and applies its own
+ * slice of the weights, so the reduction is spread over all threads but always adds the shards
+ * in thread order.
+ */
+void trainDataParallel(Network_L *network, const std::vector<int> &indexes) {
+    int nin = network->getNumInputNodes();
+    int non = network->getNumOutputNodes();
+    int numExamples = indexes.size();
+
+    std::vector<Gradients> gradients(numThreads, Gradients(network->getLayerSizes()));
+    Gradients total(network->getLayerSizes());
+    Barrier barrier(numThreads);
+
+    auto worker = [&](int t) {
+        int shardCapacity = (batchSize + numThreads - 1) / numThreads;
+        std::vector<float> shardInputs(shardCapacity * nin);
+        std::vector<float> shardTargets(shardCapacity * non);
+
+        for (int first = 0; first < numExamples; first += batchSize) {
+            int currentBatchSize = std::min(batchSize, numExamples - first);
+            int begin = first + currentBatchSize * t / numThreads;
+            int end = first + currentBatchSize * (t + 1) / numThreads;
+
+            packExamples(indexes, begin, end - begin, nin, shardInputs.data(), shardTargets.data());
+            network->computeGradients(shardInputs.data(), shardTargets.data(), end - begin, gradients[t]);
+            barrier.wait();
+
+            total.sum(gradients, t, numThreads);
+            barrier.wait();
+
+            network->applyGradients(total, t, numThreads);
+            barrier.wait();
+
+            // Only once every slice is applied, as applying reads the optimizer step count
+            if (t == 0) {
+                network->recordTraining(total);
+                latestErrorRate = network->getErrorRate();
+                reportProgress(currentBatchSize);
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < numThreads; t++) {
+        threads.push_back(std::thread(worker, t));
+    }
+    for (int t = 0; t < numThreads; t++) {
+        threads[t].join();
+    }
+}
+
+/*
+ * Train Hogwild style on numThreads threads. Each thread trains on its own contiguous share of
+ * the shuffled examples in batches of batchSize, reading and updating the shared weights without
+ * locking. Only the training cycle, error rate and progress report are serialised.
+ */
+void trainHogwild(Network_L *network, const std::vector<int> &indexes) {
+    int nin = network->getNumInputNodes();
+    int non = network->getNumOutputNodes();
+    int numExamples = indexes.size();
+
+    std::mutex progressMutex;
+
+    auto worker = [&](int t) {
+        Gradients gradients(network->getLayerSizes());
+        std::vector<float> batchInputs(batchSize * nin);
+        std::vector<float> batchTargets(batchSize * non);
+
+        int shardBegin = long(numExamples) * t / numThreads;
+        int shardEnd = long(numExamples) * (t + 1) / numThreads;
+        for (int first = shardBegin; first < shardEnd; first += batchSize) {
+            int currentBatchSize = std::min(batchSize, shardEnd - first);
+            packExamples(indexes, first, currentBatchSize, nin, batchInputs.data(), batchTargets.data());
+            network->computeGradients(batchInputs.data(), batchTargets.data(), currentBatchSize, gradients);
+            network->applyGradients(gradients);
+
+            std::lock_guard<std::mutex> lock(progressMutex);
+            network->recordTraining(gradients);
+            latestErrorRate = network->getErrorRate();
+            reportProgress(currentBatchSize);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < numThreads; t++) {
+        threads.push_back(std::thread(worker, t));
+    }
+    for (int t = 0; t < numThreads; t++) {
+        threads[t].join();
+    }
+}
+
 int main(int argc, char * argv[]) {
+    // Parse options, leaving the positional arguments in args
+    std::vector<char *> args;
+    args.push_back(argv[0]);
+    for (int i = 1; i < argc; i++) {
+        if (std::string(argv[i]) == "-b" && i + 1 < argc) {
+            batchSize = atoi(argv[++i]);
+        } else if (std::string(argv[i]) == "-t" && i + 1 < argc) {
+            numThreads = atoi(argv[++i]);
+        } else if (std::string(argv[i]) == "-a") {
+            hogwild = true;
+        } else if (std::string(argv[i]) == "-f") {
+            fastActivations = true;
+        } else if (std::string(argv[i]) == "-o" && i + 1 < argc) {
+            optimizer = stringToOptimizer(argv[++i]);
+        } else if (std::string(argv[i]) == "-s") {
+            sparse = true;
+        } else if (std::string(argv[i]) == "-w" && i + 1 < argc) {
+            weightPrecision = stringToWeightPrecision(argv[++i]);
+        } else if (std::string(argv[i]) == "-l" && i + 1 < argc) {
+            sigmoidTableError = std::stof(argv[++i]);
+        } else if (std::string(argv[i]) == "-m" && i + 1 < argc) {
+            deviceBudget.sramBytes = atoi(argv[++i]);
+        } else if (std::string(argv[i]) == "-d" && i + 1 < argc) {
+            deviceBudget.board = stringToBoard(argv[++i]);
+        } else if (std::string(argv[i]) == "-r" && i + 1 < argc) {
+            deviceBudget.milliseconds = std::stod(argv[++i]);
+        } else if (std::string(argv[i]) == "-x" && i + 1 < argc) {
+            exportFilename = argv[++i];
+        } else {
+            args.push_back(argv[i]);
+        }
+    }
+    argc = args.size();
+    argv = args.data();
+
+    if (batchSize < 1) {
+        std::cout << "Batch size must be at least 1\n";
+        return 1;
+    }
+    if (numThreads < 1) {
+        std::cout << "Thread count must be at least 1\n";
+        return 1;
+    }
+    if (numThreads > 1 && !hogwild && batchSize < numThreads) {
+        std::cout << "Raising batch size to " << numThreads << " so every thread has an example\n";
+        batchSize = numThreads;
+    }
+    if (weightPrecision != WeightPrecision::Float32
+            && (batchSize > 1 || numThreads > 1 || sparse || optimizer != Optimizer::Momentum)) {
+        std::cout << "Reduced precision weights need a batch size of 1, one thread, dense inputs "
+                  << "and the Momentum optimizer\n";
+        return 1;
+    }
+
     // Parse arguments
     if (argc < 3) {
         std::cout << "Too few arguments supplied\n";
@@ -78,6 +373,9 @@ int main(int argc, char * argv[]) {
     if (argc == 4) {
         suffix = argv[3];
     }
+    if (!isModelFilename(argv[1])) {
+        exportFilename = argv[1];
+    }
 
     Network_L *network;
 
@@ -93,6 +391,22 @@ int main(int argc, char * argv[]) {
         network = loadNetwork(argv[1]);
     }
 
+    if (network == nullptr) {
+        return 1;
+    }
+
+    // Check the sigmoid lookup table can be saved, and the network fits the board's budget, before
+    // training rather than after
+    SigmoidTable sigmoidTable = {};
+    if (!buildSavedSigmoidTable(network, sigmoidTableError, sigmoidTable)) {
+        return 1;
+    }
+    DeviceCost deviceCost = estimateDeviceCost(network, ExportFormat::Float, deviceBudget.board,
+                                               sigmoidTable.entries.size());
+    if (!exportFilename.empty() && !withinDeviceBudget(deviceCost, deviceBudget)) {
+        return 1;
+    }
+
     //determine if filename is a directory or not
     DIR *d;
     if ((d = opendir (argv[2])) != NULL) {
@@ -106,13 +420,22 @@ int main(int argc, char * argv[]) {
         loadTrainingSets(argv[2], network);
     }
 
+    std::cout << "Using " << kernelIsaToString(getKernelIsa()) << " kernels\n";
+    if (fastActivations) {
+        network->setActivationPrecision(ActivationPrecision::Fast);
+    }
+    network->setOptimizer(optimizer);
+    std::cout << "Using the " << optimizerToString(optimizer) << " optimizer\n";
+    network->setWeightPrecision(weightPrecision);
+    std::cout << "Using " << weightPrecisionToString(weightPrecision) << " weights\n";
+
     // Save for later
     float lr = network->getLearningRate();
     float m  = network->getMomentum();
 
     // Now train the network on these files
     // Create a vector of indexes and shuffle it
-    std::vector<int> indexes(trainingInputs.size());
+    std::vector<int> indexes(trainingTargets.size());
     std::iota (std::begin(indexes), std::end(indexes), 0);
 
     std::random_device rd;
@@ -121,14 +444,43 @@ int main(int argc, char * argv[]) {
 
     // Now train the network in this random order
     int currentIndex;
-    for (int i = 0; i < indexes.size(); i++) {
-        currentIndex = indexes[i];
-        latestErrorRate = network->trainNetwork(trainingInputs[currentIndex], trainingTargets[currentIndex]);
-        examplesTrainedOn++;
+    if (numThreads > 1) {
+        // Time single-threaded training on a copy of the network to compare against
+        Network_L reference = *network;
+        int calibrationExamples = std::min(int(indexes.size()), std::max(1000, 10 * batchSize));
+        double serialRate = trainSerial(&reference, indexes, calibrationExamples, false);
 
-        if (examplesTrainedOn % 100 == 0) {
-            std::cout << "Trained " << examplesTrainedOn << " examples. Error rate is " << latestErrorRate << "\n";
+        std::cout << "Training on " << numThreads << " threads"
+                  << (hogwild ? ", Hogwild" : "") << "\n";
+        auto start = std::chrono::steady_clock::now();
+        if (hogwild) {
+            trainHogwild(network, indexes);
+        } else {
+            trainDataParallel(network, indexes);
         }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        double parallelRate = indexes.size() / elapsed.count();
+
+        std::cout << "Trained at " << long(parallelRate) << " examples/s on " << numThreads << " threads, against "
+                  << long(serialRate) << " examples/s on one. Speedup " << parallelRate / serialRate
+                  << ", scaling efficiency " << int(100.0 * parallelRate / (serialRate * numThreads)) << "%\n";
+    } else if (batchSize == 1) {
+        for (int i = 0; i < indexes.size(); i++) {
+            currentIndex = indexes[i];
+            if (sparse) {
+                latestErrorRate = network->trainNetwork(sparseTrainingInputs[currentIndex], trainingTargets[currentIndex]);
+            } else {
+                latestErrorRate = network->trainNetwork(trainingInputs[currentIndex], trainingTargets[currentIndex]);
+            }
+            examplesTrainedOn++;
+
+            if (examplesTrainedOn % 100 == 0) {
+                std::cout << "Trained " << examplesTrainedOn << " examples. Error rate is " << latestErrorRate << "\n";
+            }
+        }
+    } else {
+        // Gather each batch into contiguous matrices in shuffled order
+        trainSerial(network, indexes, indexes.size(), true);
     }
     std::cout << "Finished training after " << examplesTrainedOn << " examples. Error rate is " << latestErrorRate << "\n";
     std::cout << "\n";
@@ -137,6 +489,23 @@ int main(int argc, char * argv[]) {
     network->setLearningRate(lr);
     network->setMomentum(m);
 
-    saveNetwork(argv[1], network);
+    if (isModelFilename(argv[1]) && saveModel(argv[1], network) != 0) {
+        std::cout << "Could not write " << argv[1] << "\n";
+        return 1;
+    }
+    if (exportFilename.empty()) {
+        return 0;
+    }
+    if (saveNetwork(exportFilename, network, sigmoidTableError, deviceBudget) != 0) {
+        std::cout << "Could not write " << exportFilename << "\n";
+        return 1;
+    }
+    if (!sigmoidTable.entries.empty()) {
+        std::cout << "Saved a sigmoid lookup table of " << sigmoidTable.entries.size() << " entries ("
+                  << 2 * sigmoidTable.entries.size() << " bytes), within " << sigmoidTable.maxError << " of exp\n";
+    }
+    std::cout << "Network_A needs " << deviceCost.flashBytes << " bytes of flash and " << deviceCost.sramBytes
+              << " bytes of SRAM for activations, and takes an estimated " << deviceCost.milliseconds
+              << " ms a classification on " << boardToString(deviceBudget.board) << "\n";
 }
 
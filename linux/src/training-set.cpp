@@ -2,6 +2,8 @@
 
 TrainingSet::TrainingSet() {}
 
+SparseTrainingSet::SparseTrainingSet(): numInputs(0) {}
+
 TrainingSet *loadTrainingSet(std::string filename) {
     TrainingSet* set = new TrainingSet();
 
@@ -43,3 +45,18 @@ TrainingSet *loadTrainingSet(std::string filename) {
 
     return set;
 }
+
+SparseTrainingSet *loadSparseTrainingSet(std::string filename) {
+    SparseTrainingSet* set = new SparseTrainingSet();
+
+    // Load the file densely, then keep only the non-zero inputs
+    TrainingSet *dense = loadTrainingSet(filename);
+    for (int i = 0; i < dense->inputs.size(); i++) {
+        set->numInputs = dense->inputs[i].size();
+        set->inputs.push_back(toSparseInputs(dense->inputs[i]));
+        set->targets.push_back(dense->targets[i]);
+    }
+    delete dense;
+
+    return set;
+}
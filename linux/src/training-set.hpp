@@ -9,6 +9,8 @@
 #include <vector>
 using std::vector;
 
+#include "../../network/src/network-linux.hpp"
+
 class TrainingSet {
     public:
         vector<vector<float>> inputs;
@@ -16,6 +18,19 @@ class TrainingSet {
         TrainingSet();
 };
 
+/*
+ * A training set whose inputs keep only their non-zero values, for input patterns that are
+ * mostly zeros. Each row takes roughly twice the memory of one non-zero value.
+ */
+class SparseTrainingSet {
+    public:
+        vector<SparseInputs> inputs;
+        vector<vector<float>> targets;
+        int numInputs;                  // Length of the dense patterns
+        SparseTrainingSet();
+};
+
 TrainingSet *loadTrainingSet(std::string filename);
+SparseTrainingSet *loadSparseTrainingSet(std::string filename);
 
 #endif // TRAINING_SET_H
@@ -110,4 +110,50 @@ TEST_CASE("Loading training sets from files works correctly") {
             REQUIRE(set.targets[2].size() == 1);
         }
     }
+
+    GIVEN("A log file of mostly zero inputs") {
+
+        std::string filename = "test/test_sparse_log_file.txt";
+
+        std::ofstream log_file (filename);
+        log_file << "Repetition start\n";
+        log_file << "0\n";
+        log_file << "0.5\n";
+        log_file << "0\n";
+        log_file << "0\n";
+        log_file << "Repetition end\n";
+        log_file << "1\n";
+        log_file << "Repetition start\n";
+        log_file << "0\n";
+        log_file << "0\n";
+        log_file << "0\n";
+        log_file << "-0.25\n";
+        log_file << "Repetition end\n";
+        log_file << "0\n";
+        log_file.close();
+
+        SparseTrainingSet set = *loadSparseTrainingSet(filename);
+
+        THEN("Only the non-zero inputs are recorded") {
+            REQUIRE(set.numInputs == 4);
+            REQUIRE(set.inputs.size() == 2);
+            REQUIRE(set.inputs[0].indexes == std::vector<int>{1});
+            REQUIRE(set.inputs[0].values == std::vector<float>{0.5f});
+            REQUIRE(set.inputs[1].indexes == std::vector<int>{3});
+            REQUIRE(set.inputs[1].values == std::vector<float>{-0.25f});
+        }
+
+        THEN("They expand back to the dense inputs") {
+            TrainingSet dense = *loadTrainingSet(filename);
+            for (int i = 0; i < 2; i++) {
+                REQUIRE(toDenseInputs(set.inputs[i], set.numInputs) == dense.inputs[i]);
+            }
+        }
+
+        THEN("All the targets are recorded") {
+            REQUIRE(set.targets.size() == 2);
+            REQUIRE(set.targets[0][0] == 1.0f);
+            REQUIRE(set.targets[1][0] == 0.0f);
+        }
+    }
 }
\ No newline at end of file
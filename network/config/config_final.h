@@ -11,68 +11,70 @@ const float momentum = 0.100000;
 const float initialWeightMax = 0.700000;
 
 // TrainingCycle (not needed on Arduino): 2111
-// hiddenActivationFunction (not needed on Arduino): Sigmoid
-// outputActivationFunction (not needed on Arduino): Sigmoid
+#define HIDDEN_ACTIVATION_FUNCTION Sigmoid
+#define OUTPUT_ACTIVATION_FUNCTION Sigmoid
 // ErrorFunction (not needed on Arduino): CrossEntropy
 
-const float hiddenWeights[numInputNodes +1][numHiddenNodes] PROGMEM = {
-    { 0.508813, -0.636922, -0.456600, 0.200452, 1.725262, -0.549171, -0.561549, -0.558580, -0.765760, 0.429938, 0.388884, 0.829594, -0.597363, 1.274156, -0.529276, 1.210035, -0.069655, 1.626983, -1.963727, 0.043204 }, 
-    { 0.033946, -0.331684, -0.894915, -0.486757, 1.421265, -0.199243, -0.544280, 0.167150, 0.194568, 0.465364, 0.232950, -0.241350, -0.736659, 1.074452, 0.055636, 1.345800, -0.492823, 1.184482, -1.664113, 0.566566 }, 
-    { 0.546074, -0.415192, 0.366183, -0.580071, 0.910423, 0.099345, -0.719014, -0.469600, -0.898470, 0.653405, 0.022248, -0.298466, -0.312871, 1.132367, 0.135148, 1.278974, 0.309082, 1.022978, -0.520292, 0.702164 }, 
-    { -0.383855, -0.119195, 0.114092, 0.451198, -0.000456, -0.281385, -0.045698, 0.521758, -0.686689, 0.029689, -0.084155, -0.528853, 0.439647, 0.296608, 0.204638, -0.085024, -0.345468, -0.433034, 0.176622, 0.844925 }, 
-    { -0.305164, -0.118249, -0.711906, -0.471195, 0.023219, 0.142500, -0.003674, 0.399544, 0.171759, 0.170918, 0.137701, 0.245158, -0.105433, 0.186768, 0.169889, -1.191549, -0.527867, -0.788694, 0.295441, 0.958546 }, 
-    { -0.621558, -0.169906, 0.274435, -0.494934, 0.154845, 0.649690, -0.042690, -0.177294, 0.195000, -0.011503, -0.367071, 0.155756, -0.559590, 0.585113, 0.374503, -1.391019, -0.219673, -0.932850, 0.927445, 0.080310 }, 
-    { -0.388789, 0.477573, -0.035488, 0.041012, -1.302521, 0.696600, -0.284470, -0.162340, -0.284856, -0.998516, 0.004369, -0.675941, -0.058374, 0.329241, -0.236874, -1.882556, 0.371093, -0.944646, 1.237477, 0.680430 }, 
-    { -0.468596, -0.308899, -0.499310, -0.181535, -1.349988, -0.176417, -0.276723, -0.223936, -0.771510, -0.986658, -1.120584, -0.294617, 0.039811, 0.686290, -0.852921, -1.052062, -0.781645, -0.875504, 1.224855, -0.108053 }, 
-    { -0.000577, 0.164615, -0.691108, 0.345989, -1.192514, -0.439445, 0.047320, 0.356323, -0.558947, -0.247588, -0.483749, 0.276829, -0.098813, 0.194950, -0.422311, -2.450027, -0.131836, -1.522098, 0.741752, 1.199746 }, 
-    { 0.348226, -0.489255, -0.264897, -0.983892, -1.309706, 0.725770, -0.807452, -0.496195, -0.323618, -1.316314, -1.453836, -0.533722, -0.302630, 0.192656, -0.118175, -2.568775, 0.171472, -0.719403, 0.485714, 0.288445 }, 
-    { -0.677607, -0.201270, 0.162558, -0.693443, -0.548829, 0.413687, 0.454908, -0.320775, 0.056332, -0.768684, -0.879931, -0.426772, -0.831201, -0.263922, -0.587627, -1.966933, 0.311041, -1.312334, 1.428327, -0.128884 }, 
-    { 0.010147, -0.216851, -0.059189, -0.431728, -1.290905, -0.264333, -0.796960, 0.606344, 0.321437, -0.584822, -0.435765, -0.279150, -0.231897, -0.812330, -0.318850, -2.060146, 0.057733, -0.765229, 0.436468, -0.064377 }, 
-    { 0.317555, 0.547738, 0.292025, -0.652302, -1.164132, 0.612840, 0.264407, -0.588157, 0.504414, 0.007352, 0.028022, 0.005408, 0.233262, -0.542193, 0.458996, -1.849438, 0.290730, -1.393516, 0.366635, 0.235609 }, 
-    { -0.031119, -0.015421, 0.548534, 0.047972, 0.029327, 0.616502, 0.492154, -0.506751, 0.136926, 0.222120, 0.530942, -0.699760, 0.258598, -0.606995, 0.444403, -0.784311, -0.603361, 0.090722, 1.039042, 0.008161 }, 
-    { 0.018072, 0.387045, -0.422710, -0.472211, -0.284624, -0.424296, -0.472117, -0.385942, -0.064632, 0.435988, -0.034515, 0.027247, 0.031243, -1.288541, 0.598115, -0.267610, -0.403111, -0.046065, -0.022634, -0.125262 }, 
-    { -0.031392, -0.594588, -0.551239, -0.044329, -0.132266, -0.406564, 0.590047, 0.068857, 0.212332, 0.052301, 1.030012, -0.458232, 0.366232, -0.393469, 0.623141, 0.253590, -0.245739, -0.055840, -0.064703, -0.317089 }, 
-    { 0.434240, 0.151288, 0.063786, 0.577412, -0.130715, 0.324866, -0.464748, -0.606989, 0.013596, 0.593575, 0.775376, 0.143822, 0.681122, -1.071227, -0.529571, 0.548349, 0.142790, 0.576148, 0.158319, -1.691108 }, 
-    { 0.011570, 0.349404, -0.205142, 0.344752, -1.128767, -0.873290, -0.134741, -0.124930, 0.573704, -0.165154, 0.489343, 0.566004, 0.284610, -1.481918, -0.501859, 0.483034, -0.495734, 0.283982, 0.474125, -0.590454 }, 
-    { 0.202069, 0.157795, 0.484264, 0.768499, -0.881366, -0.315678, 0.691772, -0.181739, 0.725321, -0.038201, 0.930288, -0.428010, -0.636373, -1.773956, -0.482226, -0.099260, 0.567268, 0.585877, -0.087693, -1.864577 }, 
-    { -0.113402, -0.449782, -0.443408, 0.876416, -1.004097, -0.521044, 0.071636, -0.650285, -0.081004, 0.124854, 1.218848, -0.446952, 0.622169, -1.108334, -0.338544, 0.479077, 0.216379, 0.398129, 0.932321, -0.828964 }, 
-    { 0.431403, 0.082599, -0.366624, 0.838767, 0.079753, 0.340265, -0.148964, -0.620960, 0.265160, 0.994467, 0.904738, -0.137462, 0.139105, -1.779178, 0.227439, -0.325953, 0.714241, 1.242506, 0.795708, -1.162379 }, 
-    { -0.644973, -0.436332, 0.742319, -0.126527, -0.892952, -0.006039, 0.998132, -0.118930, -0.532086, 0.679832, 0.973544, -0.311102, -0.270265, -1.811724, 0.674141, -0.426648, -0.157084, 1.232786, 1.015713, -1.471343 }, 
-    { -0.679062, -0.171680, 0.686505, 0.805571, -0.873478, -0.190728, 0.824683, 0.306967, 0.086585, -0.311702, -0.102452, 0.557746, -0.072654, -0.776633, 0.686989, -0.334676, 0.488228, 0.799630, 0.817152, -0.984547 }, 
-    { -0.402862, 0.157164, 0.129711, 0.371831, -0.045603, 0.082255, -0.067003, 0.129366, -0.376296, -0.367876, -0.560976, -0.322656, -0.040335, 0.359509, 0.333978, -0.598163, 0.519619, 0.289180, 0.378284, 0.090088 }, 
-    { -0.680022, -0.059836, -0.574987, -0.604618, 0.031181, -0.320358, 0.035346, -0.255842, -0.044581, -0.318124, -0.503065, 0.191797, -0.558395, 0.264115, -0.559477, 0.004336, -0.145414, -0.178102, 0.198460, 0.429978 }, 
-    { -0.032090, 0.038352, -0.658826, -0.094174, -0.037626, -0.637945, -0.038256, 0.006669, 0.008177, -0.994376, -1.050938, 0.268918, -0.162472, 0.342945, 0.292119, -1.270405, -0.166130, -0.902538, -0.646447, 1.094264 }, 
-    { -0.445040, -0.422478, -0.071735, 0.183391, 1.067109, -0.229185, -0.773557, -0.315071, -0.324565, -0.677132, -1.274653, 0.164564, 0.299641, 0.957927, -0.778126, -0.859094, -0.760547, -0.630350, -0.399794, 0.853077 }, 
-    { 0.578549, -0.189507, -0.159420, -0.750453, 1.610786, 0.491182, -0.713841, -0.554395, -0.914192, 0.725655, -0.257655, -0.386006, -0.384749, 0.272444, -0.786982, 0.527177, -0.230706, -0.231764, -1.337748, 1.315830 }, 
-    { -0.492412, -0.484106, -0.769874, -0.768840, 0.972751, 0.159532, 0.052436, -0.077616, -1.019825, 0.265680, -0.066520, 0.455644, -0.494066, 0.832367, -0.439648, 0.701827, -0.589508, -0.293912, -2.021275, 1.175187 }, 
-    { -0.375509, 0.008663, -0.311799, -0.442851, 1.878561, -0.501478, -0.089134, 0.154031, -0.850277, 0.559505, -0.373557, -0.110464, -0.189044, 1.838052, -0.734984, 1.987992, -0.184379, 0.101220, -2.100183, 0.031619 }, 
-    { -0.312669, 0.178678, -0.498118, 0.154662, 1.865008, 0.263226, -0.493609, 0.443493, 0.395833, 0.868455, 0.266513, 0.487506, -0.695076, 1.542049, 0.309348, 2.021583, -0.383692, 1.447156, -1.139996, -0.093750 }, 
-    { -0.153985, 0.243316, -0.033669, -0.761929, 1.421464, -0.667317, -0.380695, 0.494337, 0.335660, 0.148993, 0.149657, 0.522634, 0.208184, 1.607090, 0.064861, 2.520534, -0.343209, 1.133274, -1.767192, 0.176897 }, 
-    { 0.821235, -0.311203, 0.909753, 0.433459, 0.370689, -0.357040, 0.039265, -0.121809, 0.610140, 0.646801, 0.701808, 0.427065, 0.505053, 0.192589, 0.063916, 1.462347, 0.295601, 1.684935, -0.982994, -0.572840 }, 
+// Each node's bias and then its input weights, in the order Network_A reads them
+#define NODE_MAJOR_WEIGHTS
+
+const float hiddenWeights[numHiddenNodes][numInputNodes +1] PROGMEM = {
+    { 0.821235, 0.508813, 0.033946, 0.546074, -0.383855, -0.305164, -0.621558, -0.388789, -0.468596, -0.000577, 0.348226, -0.677607, 0.010147, 0.317555, -0.031119, 0.018072, -0.031392, 0.434240, 0.011570, 0.202069, -0.113402, 0.431403, -0.644973, -0.679062, -0.402862, -0.680022, -0.032090, -0.445040, 0.578549, -0.492412, -0.375509, -0.312669, -0.153985 }, 
+    { -0.311203, -0.636922, -0.331684, -0.415192, -0.119195, -0.118249, -0.169906, 0.477573, -0.308899, 0.164615, -0.489255, -0.201270, -0.216851, 0.547738, -0.015421, 0.387045, -0.594588, 0.151288, 0.349404, 0.157795, -0.449782, 0.082599, -0.436332, -0.171680, 0.157164, -0.059836, 0.038352, -0.422478, -0.189507, -0.484106, 0.008663, 0.178678, 0.243316 }, 
+    { 0.909753, -0.456600, -0.894915, 0.366183, 0.114092, -0.711906, 0.274435, -0.035488, -0.499310, -0.691108, -0.264897, 0.162558, -0.059189, 0.292025, 0.548534, -0.422710, -0.551239, 0.063786, -0.205142, 0.484264, -0.443408, -0.366624, 0.742319, 0.686505, 0.129711, -0.574987, -0.658826, -0.071735, -0.159420, -0.769874, -0.311799, -0.498118, -0.033669 }, 
+    { 0.433459, 0.200452, -0.486757, -0.580071, 0.451198, -0.471195, -0.494934, 0.041012, -0.181535, 0.345989, -0.983892, -0.693443, -0.431728, -0.652302, 0.047972, -0.472211, -0.044329, 0.577412, 0.344752, 0.768499, 0.876416, 0.838767, -0.126527, 0.805571, 0.371831, -0.604618, -0.094174, 0.183391, -0.750453, -0.768840, -0.442851, 0.154662, -0.761929 }, 
+    { 0.370689, 1.725262, 1.421265, 0.910423, -0.000456, 0.023219, 0.154845, -1.302521, -1.349988, -1.192514, -1.309706, -0.548829, -1.290905, -1.164132, 0.029327, -0.284624, -0.132266, -0.130715, -1.128767, -0.881366, -1.004097, 0.079753, -0.892952, -0.873478, -0.045603, 0.031181, -0.037626, 1.067109, 1.610786, 0.972751, 1.878561, 1.865008, 1.421464 }, 
+    { -0.357040, -0.549171, -0.199243, 0.099345, -0.281385, 0.142500, 0.649690, 0.696600, -0.176417, -0.439445, 0.725770, 0.413687, -0.264333, 0.612840, 0.616502, -0.424296, -0.406564, 0.324866, -0.873290, -0.315678, -0.521044, 0.340265, -0.006039, -0.190728, 0.082255, -0.320358, -0.637945, -0.229185, 0.491182, 0.159532, -0.501478, 0.263226, -0.667317 }, 
+    { 0.039265, -0.561549, -0.544280, -0.719014, -0.045698, -0.003674, -0.042690, -0.284470, -0.276723, 0.047320, -0.807452, 0.454908, -0.796960, 0.264407, 0.492154, -0.472117, 0.590047, -0.464748, -0.134741, 0.691772, 0.071636, -0.148964, 0.998132, 0.824683, -0.067003, 0.035346, -0.038256, -0.773557, -0.713841, 0.052436, -0.089134, -0.493609, -0.380695 }, 
+    { -0.121809, -0.558580, 0.167150, -0.469600, 0.521758, 0.399544, -0.177294, -0.162340, -0.223936, 0.356323, -0.496195, -0.320775, 0.606344, -0.588157, -0.506751, -0.385942, 0.068857, -0.606989, -0.124930, -0.181739, -0.650285, -0.620960, -0.118930, 0.306967, 0.129366, -0.255842, 0.006669, -0.315071, -0.554395, -0.077616, 0.154031, 0.443493, 0.494337 }, 
+    { 0.610140, -0.765760, 0.194568, -0.898470, -0.686689, 0.171759, 0.195000, -0.284856, -0.771510, -0.558947, -0.323618, 0.056332, 0.321437, 0.504414, 0.136926, -0.064632, 0.212332, 0.013596, 0.573704, 0.725321, -0.081004, 0.265160, -0.532086, 0.086585, -0.376296, -0.044581, 0.008177, -0.324565, -0.914192, -1.019825, -0.850277, 0.395833, 0.335660 }, 
+    { 0.646801, 0.429938, 0.465364, 0.653405, 0.029689, 0.170918, -0.011503, -0.998516, -0.986658, -0.247588, -1.316314, -0.768684, -0.584822, 0.007352, 0.222120, 0.435988, 0.052301, 0.593575, -0.165154, -0.038201, 0.124854, 0.994467, 0.679832, -0.311702, -0.367876, -0.318124, -0.994376, -0.677132, 0.725655, 0.265680, 0.559505, 0.868455, 0.148993 }, 
+    { 0.701808, 0.388884, 0.232950, 0.022248, -0.084155, 0.137701, -0.367071, 0.004369, -1.120584, -0.483749, -1.453836, -0.879931, -0.435765, 0.028022, 0.530942, -0.034515, 1.030012, 0.775376, 0.489343, 0.930288, 1.218848, 0.904738, 0.973544, -0.102452, -0.560976, -0.503065, -1.050938, -1.274653, -0.257655, -0.066520, -0.373557, 0.266513, 0.149657 }, 
+    { 0.427065, 0.829594, -0.241350, -0.298466, -0.528853, 0.245158, 0.155756, -0.675941, -0.294617, 0.276829, -0.533722, -0.426772, -0.279150, 0.005408, -0.699760, 0.027247, -0.458232, 0.143822, 0.566004, -0.428010, -0.446952, -0.137462, -0.311102, 0.557746, -0.322656, 0.191797, 0.268918, 0.164564, -0.386006, 0.455644, -0.110464, 0.487506, 0.522634 }, 
+    { 0.505053, -0.597363, -0.736659, -0.312871, 0.439647, -0.105433, -0.559590, -0.058374, 0.039811, -0.098813, -0.302630, -0.831201, -0.231897, 0.233262, 0.258598, 0.031243, 0.366232, 0.681122, 0.284610, -0.636373, 0.622169, 0.139105, -0.270265, -0.072654, -0.040335, -0.558395, -0.162472, 0.299641, -0.384749, -0.494066, -0.189044, -0.695076, 0.208184 }, 
+    { 0.192589, 1.274156, 1.074452, 1.132367, 0.296608, 0.186768, 0.585113, 0.329241, 0.686290, 0.194950, 0.192656, -0.263922, -0.812330, -0.542193, -0.606995, -1.288541, -0.393469, -1.071227, -1.481918, -1.773956, -1.108334, -1.779178, -1.811724, -0.776633, 0.359509, 0.264115, 0.342945, 0.957927, 0.272444, 0.832367, 1.838052, 1.542049, 1.607090 }, 
+    { 0.063916, -0.529276, 0.055636, 0.135148, 0.204638, 0.169889, 0.374503, -0.236874, -0.852921, -0.422311, -0.118175, -0.587627, -0.318850, 0.458996, 0.444403, 0.598115, 0.623141, -0.529571, -0.501859, -0.482226, -0.338544, 0.227439, 0.674141, 0.686989, 0.333978, -0.559477, 0.292119, -0.778126, -0.786982, -0.439648, -0.734984, 0.309348, 0.064861 }, 
+    { 1.462347, 1.210035, 1.345800, 1.278974, -0.085024, -1.191549, -1.391019, -1.882556, -1.052062, -2.450027, -2.568775, -1.966933, -2.060146, -1.849438, -0.784311, -0.267610, 0.253590, 0.548349, 0.483034, -0.099260, 0.479077, -0.325953, -0.426648, -0.334676, -0.598163, 0.004336, -1.270405, -0.859094, 0.527177, 0.701827, 1.987992, 2.021583, 2.520534 }, 
+    { 0.295601, -0.069655, -0.492823, 0.309082, -0.345468, -0.527867, -0.219673, 0.371093, -0.781645, -0.131836, 0.171472, 0.311041, 0.057733, 0.290730, -0.603361, -0.403111, -0.245739, 0.142790, -0.495734, 0.567268, 0.216379, 0.714241, -0.157084, 0.488228, 0.519619, -0.145414, -0.166130, -0.760547, -0.230706, -0.589508, -0.184379, -0.383692, -0.343209 }, 
+    { 1.684935, 1.626983, 1.184482, 1.022978, -0.433034, -0.788694, -0.932850, -0.944646, -0.875504, -1.522098, -0.719403, -1.312334, -0.765229, -1.393516, 0.090722, -0.046065, -0.055840, 0.576148, 0.283982, 0.585877, 0.398129, 1.242506, 1.232786, 0.799630, 0.289180, -0.178102, -0.902538, -0.630350, -0.231764, -0.293912, 0.101220, 1.447156, 1.133274 }, 
+    { -0.982994, -1.963727, -1.664113, -0.520292, 0.176622, 0.295441, 0.927445, 1.237477, 1.224855, 0.741752, 0.485714, 1.428327, 0.436468, 0.366635, 1.039042, -0.022634, -0.064703, 0.158319, 0.474125, -0.087693, 0.932321, 0.795708, 1.015713, 0.817152, 0.378284, 0.198460, -0.646447, -0.399794, -1.337748, -2.021275, -2.100183, -1.139996, -1.767192 }, 
+    { -0.572840, 0.043204, 0.566566, 0.702164, 0.844925, 0.958546, 0.080310, 0.680430, -0.108053, 1.199746, 0.288445, -0.128884, -0.064377, 0.235609, 0.008161, -0.125262, -0.317089, -1.691108, -0.590454, -1.864577, -0.828964, -1.162379, -1.471343, -0.984547, 0.090088, 0.429978, 1.094264, 0.853077, 1.315830, 1.175187, 0.031619, -0.093750, 0.176897 }, 
+};
+
+const float outputWeights[numOutputNodes][numHiddenNodes +1] PROGMEM = {
+    { 0.890304, -1.069335, -0.538497, -0.036430, -0.452006, -2.003771, -0.084653, -0.088697, -0.503925, -0.418217, -1.194355, -1.073177, -1.074709, -0.510840, -1.418673, -0.657468, -2.576453, -0.564688, -1.746384, 1.168034, -0.398042 }, 
+    { -1.624799, -0.210024, 0.121637, -0.494636, -0.901733, 1.521404, -0.171775, -0.887186, -0.407831, -0.845972, 0.302819, -0.554419, 0.279393, -0.688151, 0.893531, -0.592248, 1.158072, -0.379466, 0.370482, -1.895666, 0.674067 }, 
+    { -1.653250, 0.673240, 0.307943, 1.376518, 0.609195, -0.699326, -0.415173, 0.749801, 0.188352, 0.765381, 0.598619, 1.041236, 0.028720, 0.537506, -2.077342, 0.308228, 1.135272, 0.831229, 1.331933, -0.323493, -1.725451 }, 
 };
 
-const float outputWeights[numHiddenNodes +1][numOutputNodes] PROGMEM = {
-    { -1.069335, -0.210024, 0.673240 }, 
-    { -0.538497, 0.121637, 0.307943 }, 
-    { -0.036430, -0.494636, 1.376518 }, 
-    { -0.452006, -0.901733, 0.609195 }, 
-    { -2.003771, 1.521404, -0.699326 }, 
-    { -0.084653, -0.171775, -0.415173 }, 
-    { -0.088697, -0.887186, 0.749801 }, 
-    { -0.503925, -0.407831, 0.188352 }, 
-    { -0.418217, -0.845972, 0.765381 }, 
-    { -1.194355, 0.302819, 0.598619 }, 
-    { -1.073177, -0.554419, 1.041236 }, 
-    { -1.074709, 0.279393, 0.028720 }, 
-    { -0.510840, -0.688151, 0.537506 }, 
-    { -1.418673, 0.893531, -2.077342 }, 
-    { -0.657468, -0.592248, 0.308228 }, 
-    { -2.576453, 1.158072, 1.135272 }, 
-    { -0.564688, -0.379466, 0.831229 }, 
-    { -1.746384, 0.370482, 1.331933 }, 
-    { 1.168034, -1.895666, -0.323493 }, 
-    { -0.398042, 0.674067, -1.725451 }, 
-    { 0.890304, -1.624799, -1.653250 }, 
+// Activation arena (see planActivationMemory), with alternate layers' nodes at either end.
+// Network_A needs 272 bytes of SRAM for activations
+#define ACTIVATION_ARENA
+const int activationArenaSize = 52;
+const int layerOffsets[] = { 0, 32, 0 };
+
+// Sigmoid lookup table (see sigmoid-table.hpp), within 7.75615e-05 of the exact function
+#include "sigmoid-table.hpp"
+#define SIGMOID_TABLE
+const int sigmoidTableSize = 124;
+const float sigmoidTableScale = 12.4199295;
+const uint16_t sigmoidTable[sigmoidTableSize] PROGMEM = {
+    0, 2637, 5265, 7877, 10463, 13016, 15529, 17994, 
+    20406, 22757, 25044, 27262, 29407, 31475, 33466, 35376, 
+    37204, 38952, 40617, 42202, 43706, 45132, 46481, 47755, 
+    48956, 50088, 51152, 52151, 53088, 53966, 54787, 55555, 
+    56273, 56942, 57567, 58148, 58690, 59194, 59662, 60098, 
+    60502, 60878, 61226, 61549, 61849, 62127, 62384, 62622, 
+    62843, 63047, 63237, 63411, 63573, 63723, 63861, 63989, 
+    64108, 64217, 64318, 64411, 64497, 64577, 64651, 64719, 
+    64782, 64839, 64893, 64942, 64988, 65030, 65069, 65105, 
+    65138, 65169, 65197, 65223, 65247, 65269, 65290, 65309, 
+    65326, 65342, 65357, 65371, 65384, 65395, 65406, 65416, 
+    65425, 65434, 65442, 65449, 65456, 65462, 65467, 65473, 
+    65477, 65482, 65486, 65490, 65493, 65496, 65499, 65502, 
+    65505, 65507, 65509, 65511, 65513, 65515, 65516, 65518, 
+    65519, 65520, 65521, 65523, 65523, 65524, 65525, 65526, 
+    65527, 65527, 65528, 65528, 
 };
 
 #endif // ARDUINO_CONFIG_H
\ No newline at end of file
@@ -0,0 +1,65 @@
+/*
+ * Host stand-in for avr-libc's <avr/pgmspace.h>, so that Network_A and the configs saved for it
+ * build on Linux with ARDUINO defined, and read their weights through the same calls as on the
+ * board (see flash-memory.hpp). Flash is ordinary memory here, and PROGMEM does nothing.
+ *
+ * Every byte read from flash is counted in pgmspaceBytesRead, so the benchmark can report how
+ * much each classification reads.
+ *
+ * Only for host builds: put network/host on the include path, never in an Arduino build.
+ */
+
+#ifndef HOST_PGMSPACE_H
+#define HOST_PGMSPACE_H
+
+#include <stdint.h>
+#include <string.h>
+
+#define PROGMEM
+#define PGM_P const char *
+#define PSTR(s) (s)
+
+/*
+ * The number of bytes read from flash so far
+ */
+inline unsigned long &pgmspaceBytesRead() {
+    static unsigned long bytesRead = 0;
+    return bytesRead;
+}
+
+inline void *memcpy_P(void *destination, const void *source, size_t n) {
+    pgmspaceBytesRead() += n;
+    return memcpy(destination, source, n);
+}
+
+/*
+ * Read one value of type T from flash, as the pgm_read_* functions do
+ */
+template<typename T>
+inline T readProgramMemory(const void *address) {
+    T value;
+    memcpy_P(&value, address, sizeof(T));
+    return value;
+}
+
+inline uint8_t pgm_read_byte(const void *address) {
+    return readProgramMemory<uint8_t>(address);
+}
+
+inline uint16_t pgm_read_word(const void *address) {
+    return readProgramMemory<uint16_t>(address);
+}
+
+inline uint32_t pgm_read_dword(const void *address) {
+    return readProgramMemory<uint32_t>(address);
+}
+
+inline float pgm_read_float(const void *address) {
+    return readProgramMemory<float>(address);
+}
+
+inline const void *pgm_read_ptr(const void *address) {
+    return readProgramMemory<const void *>(address);
+}
+
+#endif // HOST_PGMSPACE_H
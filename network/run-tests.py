@@ -18,21 +18,35 @@ a_flag = False          # Whether or not the -a 'all' flag is set
 def run_quick_tests():
     # Compile core Linux tests
     print("Compiling core Linux tests...")
-    t = subprocess.Popen(["g++", "-c", "-std=c++11", "test/network-linux-core-tests.cpp"])
+    t = subprocess.Popen(["g++", "-c", "-std=c++11", "-O2", "test/network-linux-core-tests.cpp"])
     t.wait()
     if t.returncode == 1:
         sys.exit(1)
 
     # Compile core Arduino tests
     print("Compiling core Arduino tests...")
-    t = subprocess.Popen(["g++", "-c", "-std=c++11", "test/network-arduino-core-tests.cpp"])
+    t = subprocess.Popen(["g++", "-c", "-std=c++11", "-O2", "test/network-arduino-core-tests.cpp"])
     t.wait()
     if t.returncode == 1:
         sys.exit(1)
 
     # Compile IO tests
     print("Compiling IO tests...")
-    t = subprocess.Popen(["g++", "-c", "-std=c++11", "test/network-saveload-linux-tests.cpp"])
+    t = subprocess.Popen(["g++", "-c", "-std=c++11", "-O2", "test/network-saveload-linux-tests.cpp"])
+    t.wait()
+    if t.returncode == 1:
+        sys.exit(1)
+
+    # Compile kernel tests
+    print("Compiling kernel tests...")
+    t = subprocess.Popen(["g++", "-c", "-std=c++11", "-O2", "test/network-kernels-tests.cpp"])
+    t.wait()
+    if t.returncode == 1:
+        sys.exit(1)
+
+    # Compile compile-time network tests
+    print("Compiling compile-time network tests...")
+    t = subprocess.Popen(["g++", "-c", "-std=c++11", "-O2", "test/network-static-tests.cpp"])
     t.wait()
     if t.returncode == 1:
         sys.exit(1)
@@ -44,12 +58,16 @@ def run_quick_tests():
                           "network-linux-core-tests.o",
                           "network-arduino-core-tests.o",
                           "network-saveload-linux-tests.o",
+                          "network-kernels-tests.o",
+                          "network-static-tests.o",
                           "network-linux.o",
+                          "network-kernels.o",
                           "network-arduino.o",
                           "network-saveload-linux.o",
                           "-o",
                           ".catch.exe",
-                          "-std=c++11"])
+                          "-std=c++11",
+                          "-pthread"])
     o.wait()
     if o.returncode == 1:
         sys.exit(1)
@@ -65,7 +83,7 @@ def run_quick_tests():
 def run_slow_tests():
     # Compile core tests
     print("Compiling legacy tests...")
-    t = subprocess.Popen(["g++", "-c", "-std=c++11", "test/network-linux-legacy-tests.cpp"])
+    t = subprocess.Popen(["g++", "-c", "-std=c++11", "-O2", "test/network-linux-legacy-tests.cpp"])
     t.wait()
     if t.returncode == 1:
         sys.exit(1) 
@@ -76,10 +94,12 @@ def run_slow_tests():
                           "../catch-main.o",
                           "network-linux-legacy-tests.o",
                           "network-linux.o",
+                          "network-kernels.o",
                           "network-saveload-linux.o",
                           "-o",
                           ".catch.exe",
-                          "-std=c++11"])
+                          "-std=c++11",
+                          "-pthread"])
     o.wait()
     if o.returncode == 1:
         sys.exit(1)
@@ -95,28 +115,42 @@ def run_slow_tests():
 def run_all_tests():
     # Compile core tests
     print("Compiling core Linux tests...")
-    t = subprocess.Popen(["g++", "-c", "-std=c++11", "test/network-linux-core-tests.cpp"])
+    t = subprocess.Popen(["g++", "-c", "-std=c++11", "-O2", "test/network-linux-core-tests.cpp"])
     t.wait()
     if t.returncode == 1:
         sys.exit(1)
 
     # Compile core Arduino tests
     print("Compiling core Arduino tests...")
-    t = subprocess.Popen(["g++", "-c", "-std=c++11", "test/network-arduino-core-tests.cpp"])
+    t = subprocess.Popen(["g++", "-c", "-std=c++11", "-O2", "test/network-arduino-core-tests.cpp"])
     t.wait()
     if t.returncode == 1:
         sys.exit(1)
 
     # Compile IO tests
     print("Compiling IO tests...")
-    t = subprocess.Popen(["g++", "-c", "-std=c++11", "test/network-saveload-linux-tests.cpp"])
+    t = subprocess.Popen(["g++", "-c", "-std=c++11", "-O2", "test/network-saveload-linux-tests.cpp"])
+    t.wait()
+    if t.returncode == 1:
+        sys.exit(1)
+
+    # Compile kernel tests
+    print("Compiling kernel tests...")
+    t = subprocess.Popen(["g++", "-c", "-std=c++11", "-O2", "test/network-kernels-tests.cpp"])
+    t.wait()
+    if t.returncode == 1:
+        sys.exit(1)
+
+    # Compile compile-time network tests
+    print("Compiling compile-time network tests...")
+    t = subprocess.Popen(["g++", "-c", "-std=c++11", "-O2", "test/network-static-tests.cpp"])
     t.wait()
     if t.returncode == 1:
         sys.exit(1)
 
     # Compile legacy/regression tests
     print("Compiling legacy tests...")
-    t = subprocess.Popen(["g++", "-c", "-std=c++11", "test/network-linux-legacy-tests.cpp"])
+    t = subprocess.Popen(["g++", "-c", "-std=c++11", "-O2", "test/network-linux-legacy-tests.cpp"])
     t.wait()
     if t.returncode == 1:
         sys.exit(1) 
@@ -128,13 +162,17 @@ def run_all_tests():
                           "network-linux-core-tests.o",
                           "network-arduino-core-tests.o",
                           "network-saveload-linux-tests.o",
+                          "network-kernels-tests.o",
+                          "network-static-tests.o",
                           "network-linux-legacy-tests.o",
                           "network-linux.o",
+                          "network-kernels.o",
                           "network-saveload-linux.o",
                           "network-arduino.o",
                           "-o",
                           ".catch.exe",
-                          "-std=c++11"])
+                          "-std=c++11",
+                          "-pthread"])
     o.wait()
     if o.returncode == 1:
         sys.exit(1)
@@ -176,7 +214,7 @@ if len(sys.argv) > 2:
 
 if not (os.path.isfile("../catch-main.o")):
     print("Compiling main...")
-    m = subprocess.Popen(["g++", "-c", "-std=c++11", "../catch-main.cpp", "-o", "../catch-main.o"])
+    m = subprocess.Popen(["g++", "-c", "-std=c++11", "-O2", "../catch-main.cpp", "-o", "../catch-main.o"])
     m.wait()
     if m.returncode == 1:
         sys.exit(1) 
@@ -184,18 +222,22 @@ if not (os.path.isfile("../catch-main.o")):
 
 # Compile the Linux network code
 print("Compiling network-linux")
-n = subprocess.Popen(["g++", "-c", "-std=c++11", "src/network-linux.cpp"])
+n = subprocess.Popen(["g++", "-c", "-std=c++11", "-O2", "src/network-linux.cpp"])
 n.wait()
 if n.returncode == 1:
         sys.exit(1)
-i = subprocess.Popen(["g++", "-c", "-std=c++11", "src/network-saveload-linux.cpp"])
+k = subprocess.Popen(["g++", "-c", "-std=c++11", "-O2", "src/network-kernels.cpp"])
+k.wait()
+if k.returncode == 1:
+    sys.exit(1)
+i = subprocess.Popen(["g++", "-c", "-std=c++11", "-O2", "src/network-saveload-linux.cpp"])
 i.wait()
 if i.returncode == 1:
     sys.exit(1)
 
 # Compile the Arduino network code
 print("Compiling network-arduino")
-n = subprocess.Popen(["g++", "-c", "-std=c++11", "src/network-arduino.cpp"])
+n = subprocess.Popen(["g++", "-c", "-std=c++11", "-O2", "src/network-arduino.cpp"])
 n.wait()
 if n.returncode == 1:
     sys.exit(1)
@@ -0,0 +1,12 @@
+/*
+ * The activation functions a layer can use, shared by the Linux and Arduino networks.
+ *
+ * Kept free of the standard library so that it compiles on Arduino.
+ */
+
+#ifndef ACTIVATION_FUNCTION_H
+#define ACTIVATION_FUNCTION_H
+
+enum class ActivationFunction {Sigmoid, ReLu, SoftMax};
+
+#endif // ACTIVATION_FUNCTION_H
@@ -0,0 +1,67 @@
+/*
+ * Minimal aligned allocator so that std::vector storage can start on a cache line boundary.
+ *
+ * WILL NOT COMPILE ON ARDUINO
+ */
+
+#ifndef ALIGNED_ALLOCATOR_H
+#define ALIGNED_ALLOCATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+const std::size_t cacheLineBytes = 64;
+
+template <typename T, std::size_t Alignment = cacheLineBytes>
+class AlignedAllocator {
+public:
+    typedef T value_type;
+
+    template <typename U>
+    struct rebind {
+        typedef AlignedAllocator<U, Alignment> other;
+    };
+
+    AlignedAllocator() {}
+
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment> &) {}
+
+    T *allocate(std::size_t n) {
+        void *memory = nullptr;
+        if (posix_memalign(&memory, Alignment, n * sizeof(T)) != 0) {
+            throw std::bad_alloc();
+        }
+        return static_cast<T *>(memory);
+    }
+
+    void deallocate(T *memory, std::size_t) {
+        free(memory);
+    }
+};
+
+template <typename T, typename U, std::size_t Alignment>
+bool operator==(const AlignedAllocator<T, Alignment> &, const AlignedAllocator<U, Alignment> &) {
+    return true;
+}
+
+template <typename T, typename U, std::size_t Alignment>
+bool operator!=(const AlignedAllocator<T, Alignment> &, const AlignedAllocator<U, Alignment> &) {
+    return false;
+}
+
+typedef std::vector<float, AlignedAllocator<float>> AlignedVector;
+typedef std::vector<uint16_t, AlignedAllocator<uint16_t>> AlignedHalfVector;
+
+/*
+ * Round a row length up so that every row of a flat weight matrix starts on a cache line
+ */
+inline int paddedStride(int length) {
+    const int floatsPerLine = cacheLineBytes / sizeof(float);
+    return ((length + floatsPerLine - 1) / floatsPerLine) * floatsPerLine;
+}
+
+#endif // ALIGNED_ALLOCATOR_H
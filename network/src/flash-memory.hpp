@@ -0,0 +1,65 @@
+/*
+ * Reading the constants that saved configs put in flash with PROGMEM.
+ *
+ * On AVR, flash is a separate address space, and a PROGMEM array cannot be read through an
+ * ordinary pointer: it must be copied out with memcpy_P or the pgm_read_* functions. Other
+ * Arduino cores provide the same functions as ordinary reads, and on Linux the constants are
+ * ordinary memory. Network_A and the integer kernels read every PROGMEM array through these
+ * functions, and copy weights a block at a time into a small SRAM buffer, so that each node's
+ * weights are read sequentially.
+ *
+ * Kept free of the standard library so that it compiles on Arduino.
+ */
+
+#ifndef FLASH_MEMORY_H
+#define FLASH_MEMORY_H
+
+#include <stdint.h>
+#include <string.h>
+
+#ifdef ARDUINO
+#include <avr/pgmspace.h>
+#endif
+
+// Bytes of SRAM used to buffer the weights read from flash
+const int flashBlockBytes = 64;
+
+/*
+ * Copy n bytes from flash to SRAM
+ */
+inline void copyFromFlash(void *destination, const void *source, size_t n) {
+#ifdef ARDUINO
+    memcpy_P(destination, source, n);
+#else
+    memcpy(destination, source, n);
+#endif
+}
+
+/*
+ * Read one value from flash
+ */
+template<typename T>
+inline T readFromFlash(const T *address) {
+    T value;
+    copyFromFlash(&value, address, sizeof(T));
+    return value;
+}
+
+/*
+ * Call consume(j, values[j]) for each of the n values in flash in order, copying them into SRAM a
+ * block at a time
+ */
+template<typename T, typename F>
+inline void streamFromFlash(const T *values, int n, F consume) {
+    const int blockSize = flashBlockBytes / sizeof(T);
+    T block[blockSize];
+    for (int first = 0; first < n; first += blockSize) {
+        int count = n - first < blockSize ? n - first : blockSize;
+        copyFromFlash(block, values + first, count * sizeof(T));
+        for (int k = 0; k < count; k++) {
+            consume(first + k, block[k]);
+        }
+    }
+}
+
+#endif // FLASH_MEMORY_H
@@ -4,43 +4,168 @@
  *
  * Network_A is the lightweight version that will run on an Arduino.
  * It lacks functions for training the network and will rely on Flash memory rather than RAM.
+ *
+ * A config written by saveQuantizedNetwork defines QUANTIZED_WEIGHTS, and then every layer
+ * uses int8 weights and int32 sums (see network-quantized.hpp) instead of float multiply-adds.
+ * One written by saveFixedPointNetwork defines FIXED_POINT_WEIGHTS, and then the whole network
+ * runs in fixed point (see network-fixed-point.hpp), with float only for the inputs and outputs.
+ * Otherwise a config with a sigmoid lookup table (see sigmoid-table.hpp) defines SIGMOID_TABLE,
+ * and the table is used instead of exp.
+ *
+ * Each layer uses the activation function the config defines for it, Sigmoid, ReLu or SoftMax,
+ * as the network was trained with. They are constants, so the compiler picks each layer's
+ * activation loop at compile time rather than branching for each node.
+ *
+ * Every layer's nodes live in one activation arena, with alternate layers at either end, so the
+ * SRAM for activations is only the largest pair of adjacent layers (see network-arduino.hpp).
  */
 
 #include <random>
 #include <iostream>
 #include "network-arduino.hpp"
 
+#ifdef STATIC_NETWORK
+Network_A::Network_A(): network(hiddenWeights, outputWeights) {
+#else
 Network_A::Network_A() {
+#endif
 
     accumulatedInput = 0.0f;
 }
 
+
 /*
- * Compute the activations of the hidden layer nodes from the given inputs
+ * Where the given layer's nodes start in the activation arena, counting the inputs as layer 0.
+ * Even layers are at the start and odd layers at the end.
  */
-void Network_A::computeHiddenLayerActivations(float inputs[]) {
-    for(int i = 0 ; i < numHiddenNodes; i++ ) {
-        accumulatedInput = hiddenWeights[numInputNodes][i];
-        for(int j = 0 ; j < numInputNodes; j++ ) {
-            accumulatedInput += inputs[j] * hiddenWeights[j][i] ;
+int Network_A::layerOffset(int layer) {
+#ifdef ACTIVATION_ARENA
+    return layerOffsets[layer];
+#else
+    return layer % 2 == 0 ? 0 : activationArenaSize - layerSizes[layer];
+#endif
+}
+
+#ifdef FIXED_POINT_WEIGHTS
+/*
+ * Compute the Q7.8 activations of the nodes of the given layer from its Q7.8 inputs, which are
+ * either the network inputs or the nodes of the layer below.
+ */
+void Network_A::computeLayerActivations(int layer, const int16_t inputs[], int16_t nodes[]) {
+    const FixedPointLayer &fixedPoint = fixedPointLayers[layer];
+    accumulateFixedPointLayer(fixedPoint, inputs, nodes);
+    if (layerActivationFunctions[layer] == ActivationFunction::ReLu) {
+        for(int i = 0 ; i < fixedPoint.numNodes; i++ ) {
+            nodes[i] = fixedPointReLu(nodes[i]);
+        }
+    } else if (layerActivationFunctions[layer] == ActivationFunction::SoftMax) {
+        fixedPointSoftMax(nodes, fixedPoint.numNodes);
+    } else {
+        for(int i = 0 ; i < fixedPoint.numNodes; i++ ) {
+            nodes[i] = fixedPointSigmoid(nodes[i]);
         }
-        hiddenNodes[i] = float(1.0/(1.0 + exp(-accumulatedInput))) ;
+    }
+}
+#else
+/*
+ * Replace a layer's n accumulated inputs with their activations, matching Network_L's exact
+ * activations (or the sigmoid lookup table)
+ */
+template<ActivationFunction AF>
+static inline void activateLayer(float nodes[], int n);
+
+template<>
+inline void activateLayer<ActivationFunction::Sigmoid>(float nodes[], int n) {
+    for(int i = 0 ; i < n; i++ ) {
+        nodes[i] = ConfigSigmoid::apply(nodes[i]);
+    }
+}
+
+template<>
+inline void activateLayer<ActivationFunction::ReLu>(float nodes[], int n) {
+    for(int i = 0 ; i < n; i++ ) {
+        nodes[i] = nodes[i] > 0.0f ? nodes[i] : 0.0f;
+    }
+}
+
+template<>
+inline void activateLayer<ActivationFunction::SoftMax>(float nodes[], int n) {
+    // The largest input is subtracted first, which keeps exp from overflowing
+    float largest = nodes[0];
+    for(int i = 1 ; i < n; i++ ) {
+        largest = nodes[i] > largest ? nodes[i] : largest;
+    }
+    float sum = 0.0f;
+    for(int i = 0 ; i < n; i++ ) {
+        nodes[i] = exp(nodes[i] - largest);
+        sum += nodes[i];
+    }
+    for(int i = 0 ; i < n; i++ ) {
+        nodes[i] = nodes[i] / sum;
     }
 }
 
 
 /*
- * Compute the activations of the hidden layer nodes from the current state of the hidden nodes.
+ * Apply the given layer's activation function to its n accumulated inputs
  */
-void Network_A::computeOutputLayerActivations() {
-    for(int i = 0 ; i < numOutputNodes ; i++ ) {
-        accumulatedInput = outputWeights[numHiddenNodes][i] ;
-        for(int j = 0 ; j < numHiddenNodes ; j++ ) {
-            accumulatedInput += hiddenNodes[j] * outputWeights[j][i] ;
+static inline void activateLayer(int layer, float nodes[], int n) {
+    switch (layerActivationFunctions[layer]) {
+    case ActivationFunction::ReLu:
+        activateLayer<ActivationFunction::ReLu>(nodes, n);
+        break;
+    case ActivationFunction::SoftMax:
+        activateLayer<ActivationFunction::SoftMax>(nodes, n);
+        break;
+    default:
+        activateLayer<ActivationFunction::Sigmoid>(nodes, n);
+    }
+}
+
+
+/*
+ * Compute the activations of the nodes of the given layer from its inputs, which are either the
+ * network inputs or the nodes of the layer below.
+ * Float weights saved by saveNetwork are node-major, each node's bias and then its input weights,
+ * and are streamed from flash a block at a time. Older configs have them in the original code's
+ * [input][node] layout, with the biases as the final row. int8 weights are node-major, with their
+ * biases held separately.
+ */
+void Network_A::computeLayerActivations(int layer, const float inputs[], float nodes[]) {
+#ifdef QUANTIZED_WEIGHTS
+    const QuantizedLayer &quantized = quantizedLayers[layer];
+    quantizeInputs(quantized, inputs, quantizedInputs);
+    accumulateQuantizedLayer(quantized, quantizedInputs, nodes);
+    accumulatedInput = nodes[quantized.numNodes - 1];
+    activateLayer(layer, nodes, quantized.numNodes);
+#elif defined(NODE_MAJOR_WEIGHTS)
+    const int numInputs = layerSizes[layer];
+    const int numNodes = layerSizes[layer + 1];
+    const float *nodeWeights = layerWeights[layer];
+    for(int i = 0 ; i < numNodes; i++ ) {
+        accumulatedInput = readFromFlash(nodeWeights);
+        streamFromFlash(nodeWeights + 1, numInputs, [&](int j, float weight) {
+            accumulatedInput += inputs[j] * weight;
+        });
+        nodes[i] = accumulatedInput;
+        nodeWeights += numInputs + 1;
+    }
+    activateLayer(layer, nodes, numNodes);
+#else
+    const int numInputs = layerSizes[layer];
+    const int numNodes = layerSizes[layer + 1];
+    const float *weights = layerWeights[layer];
+    for(int i = 0 ; i < numNodes; i++ ) {
+        accumulatedInput = readFromFlash(&weights[numInputs * numNodes + i]);
+        for(int j = 0 ; j < numInputs; j++ ) {
+            accumulatedInput += inputs[j] * readFromFlash(&weights[j * numNodes + i]) ;
         }
-        outputNodes[i] = float(1.0/(1.0 + exp(-accumulatedInput))) ;
+        nodes[i] = accumulatedInput;
     }
+    activateLayer(layer, nodes, numNodes);
+#endif
 }
+#endif
 
 
 /*
@@ -49,8 +174,30 @@ void Network_A::computeOutputLayerActivations() {
  * The desired output for the function must be passed in.
  */
 float * Network_A::classify(float inputs[]) {
-    computeHiddenLayerActivations(inputs);
-    computeOutputLayerActivations();
+#if defined(FIXED_POINT_WEIGHTS)
+    for (int j = 0; j < numInputNodes; j++) {
+        activationArena[j] = toFixedPoint(inputs[j]);
+    }
+    for (int l = 0; l <= NUM_HIDDEN_LAYERS; l++) {
+        computeLayerActivations(l, activationArena + layerOffset(l), activationArena + layerOffset(l + 1));
+    }
+    const int16_t *fixedPointOutputs = activationArena + layerOffset(NUM_HIDDEN_LAYERS + 1);
+    for (int i = 0; i < numOutputNodes; i++) {
+        outputNodes[i] = fromFixedPoint(fixedPointOutputs[i]);
+    }
+#elif defined(STATIC_NETWORK)
+    float *outputNodes = activationArena + layerOffset(2);
+    accumulatedInput = network.classify(inputs, activationArena + layerOffset(1), outputNodes);
+#else
+    // The inputs are read where they are, whether or not they are in the arena
+    const float *layerInputs = inputs;
+    for (int l = 0; l <= NUM_HIDDEN_LAYERS; l++) {
+        float *layerNodes = activationArena + layerOffset(l + 1);
+        computeLayerActivations(l, layerInputs, layerNodes);
+        layerInputs = layerNodes;
+    }
+    float *outputNodes = activationArena + layerOffset(NUM_HIDDEN_LAYERS + 1);
+#endif
     float * classification= outputNodes;
     return classification;
 }
@@ -66,6 +213,11 @@ int Network_A::getNumHiddenNodes() const {
 }
 
 
+int Network_A::getNumHiddenLayers() const {
+    return NUM_HIDDEN_LAYERS;
+}
+
+
 int Network_A::getNumOutputNodes() const {
     return numOutputNodes;
 }
@@ -92,11 +244,37 @@ float Network_A::getAccumulatedInput() const {
 }
 
 
+/*
+ * Space for the inputs of the next classification, which the caller can fill and pass to classify
+ * instead of keeping an array of its own. Without fixed-point weights it is the start of the
+ * activation arena, so classify overwrites it.
+ */
+float * Network_A::getInputNodes() {
+#ifdef FIXED_POINT_WEIGHTS
+    return inputNodes;
+#else
+    return activationArena + layerOffset(0);
+#endif
+}
+
+
+/*
+ * The last hidden layer's activations from the latest classification, as the arena only keeps the
+ * layer below the outputs. Null with fixed-point weights, which keep no float activations.
+ */
 const float * Network_A::getHiddenNodes() const {
-    return hiddenNodes;
+#ifdef FIXED_POINT_WEIGHTS
+    return nullptr;
+#else
+    return activationArena + layerOffset(NUM_HIDDEN_LAYERS);
+#endif
 }
 
 
 const float * Network_A::getOutputNodes() const {
+#ifdef FIXED_POINT_WEIGHTS
     return outputNodes;
+#else
+    return activationArena + layerOffset(NUM_HIDDEN_LAYERS + 1);
+#endif
 }
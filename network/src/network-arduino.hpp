@@ -4,17 +4,130 @@
 #include <vector>
 #include <random>
 
+#include "activation-function.hpp"
+
+// The host benchmark builds Network_A against another config (see linux/src/benchmark-arduino.cpp)
+#ifdef NETWORK_A_CONFIG
+#include NETWORK_A_CONFIG
+#else
 #include "arduino_config.h"
+#endif
+#include "network-static.hpp"
+#include "sigmoid-table.hpp"
+#include "flash-memory.hpp"
+
+// Configs saved before Network_A used the activation functions only recorded them in comments,
+// and were run with the sigmoid throughout
+#ifndef HIDDEN_ACTIVATION_FUNCTION
+#define HIDDEN_ACTIVATION_FUNCTION Sigmoid
+#define OUTPUT_ACTIVATION_FUNCTION Sigmoid
+#endif
+
+// Configs saved from networks with more than one hidden layer list their own layers.
+// Otherwise there is the original code's single hidden layer.
+#ifndef NUM_HIDDEN_LAYERS
+#define NUM_HIDDEN_LAYERS 1
+const int totalHiddenNodes = numHiddenNodes;
+const int layerSizes[NUM_HIDDEN_LAYERS + 2] = { numInputNodes, numHiddenNodes, numOutputNodes };
+const float * const layerWeights[NUM_HIDDEN_LAYERS + 1] = { hiddenWeights[0], outputWeights[0] };
+#define LAYER_ACTIVATION_FUNCTIONS \
+    ActivationFunction::HIDDEN_ACTIVATION_FUNCTION, ActivationFunction::OUTPUT_ACTIVATION_FUNCTION
+#endif
+
+// Older configs with more than one hidden layer list no activation functions, and the layers
+// left out of the list are Sigmoid, the first ActivationFunction
+#ifndef LAYER_ACTIVATION_FUNCTIONS
+#define LAYER_ACTIVATION_FUNCTIONS ActivationFunction::Sigmoid
+#endif
+const ActivationFunction layerActivationFunctions[NUM_HIDDEN_LAYERS + 1] = { LAYER_ACTIVATION_FUNCTIONS };
+
+constexpr int larger(int a, int b) {
+    return a > b ? a : b;
+}
+
+/*
+ * The most nodes in any layer from layer k up to the given last layer, counting the inputs as
+ * layer 0
+ */
+constexpr int largestLayer(int k, int last) {
+    return k > last ? 0 : larger(layerSizes[k], largestLayer(k + 1, last));
+}
+
+/*
+ * The most nodes in any two adjacent layers from layer k up, counting the inputs as layer 0
+ */
+constexpr int largestAdjacentLayers(int k) {
+    return k > NUM_HIDDEN_LAYERS ? 0 : larger(layerSizes[k] + layerSizes[k + 1], largestAdjacentLayers(k + 1));
+}
+
+// Every layer's nodes, the inputs first, share one arena, with alternate layers at either end, as
+// only the layer being read and the one being written are ever needed at once. Configs saved with
+// the arena planned (see planActivationMemory in network-saveload-linux.hpp) give its layout, and
+// older ones are laid out the same way here.
+#ifndef ACTIVATION_ARENA
+const int activationArenaSize = largestAdjacentLayers(0);
+#endif
+
+// int8 weights quantize each layer's inputs in turn, so need space for the largest
+const int largestLayerInputs = largestLayer(0, NUM_HIDDEN_LAYERS);
+
+/*
+ * The sigmoid of the config, from its lookup table if it has one
+ */
+struct ConfigSigmoid {
+    static float apply(float x) {
+#ifdef SIGMOID_TABLE
+        return lookUpSigmoid(x, sigmoidTable, sigmoidTableSize, sigmoidTableScale);
+#else
+        return float(1.0/(1.0 + exp(-x)));
+#endif
+    }
+};
+
+// The unrolled network is used for the original code's single hidden layer with float weights.
+// Node-major weights are streamed from flash as the runtime loop streams them. Older configs'
+// [input][node] weights are read directly, so not on AVR, where PROGMEM must be read from flash.
+#if NUM_HIDDEN_LAYERS == 1 && !defined(QUANTIZED_WEIGHTS) && !defined(FIXED_POINT_WEIGHTS) && \
+    (defined(NODE_MAJOR_WEIGHTS) || !defined(__AVR__))
+#define STATIC_NETWORK
+#ifdef NODE_MAJOR_WEIGHTS
+const WeightLayout configWeightLayout = WeightLayout::NodeMajor;
+#else
+const WeightLayout configWeightLayout = WeightLayout::InputMajor;
+#endif
+#endif
 
 class Network_A {
 private:
     float accumulatedInput;                     // AKA 'Accum' in the original code
 
-    float hiddenNodes[numHiddenNodes];        // AKA 'Hidden' in the original code
-    float outputNodes[numOutputNodes];        // AKA 'Output' in the original code
+#ifdef FIXED_POINT_WEIGHTS
+    // Every layer's nodes in Q7.8, with the float inputs and outputs that classify converts
+    int16_t activationArena[activationArenaSize];
+    float inputNodes[numInputNodes];
+    float outputNodes[numOutputNodes];
+#else
+    // Every layer's nodes. Replaces 'Hidden' and 'Output' in the original code
+    float activationArena[activationArenaSize];
+#endif
+
+#ifdef QUANTIZED_WEIGHTS
+    // Each layer's inputs in turn, quantized
+    int8_t quantizedInputs[largestLayerInputs];
+#elif defined(STATIC_NETWORK)
+    // The original code's shape is known at compile time, so use the unrolled forward pass
+    Network<numInputNodes, numHiddenNodes, numOutputNodes,
+            ActivationFunction::HIDDEN_ACTIVATION_FUNCTION, ActivationFunction::OUTPUT_ACTIVATION_FUNCTION,
+            configWeightLayout, ConfigSigmoid> network;
+#endif
+
+    static int layerOffset(int layer);
 
-    void computeHiddenLayerActivations(float inputs[]);
-    void computeOutputLayerActivations();
+#ifdef FIXED_POINT_WEIGHTS
+    void computeLayerActivations(int layer, const int16_t inputs[], int16_t nodes[]);
+#else
+    void computeLayerActivations(int layer, const float inputs[], float nodes[]);
+#endif
 
 public:
     Network_A();
@@ -23,11 +136,13 @@ public:
 
     int getNumInputNodes() const;
     int getNumHiddenNodes() const;
+    int getNumHiddenLayers() const;
     int getNumOutputNodes() const;
     float getLearningRate() const;
     float getMomentum() const;
     float getInitialWeightMax() const;
     float getAccumulatedInput() const;
+    float * getInputNodes();
     const float * getHiddenNodes() const;
     const float * getOutputNodes() const;
 };
@@ -0,0 +1,162 @@
+/*
+ * Fixed-point inference for a network converted by convertToFixedPoint (see
+ * network-saveload-linux.hpp), for boards without an FPU.
+ *
+ * Activations are Q7.8: an int16 holding value * 256, so -128 to just under 128 in steps of
+ * 1/256. Each layer's weights are int16 with weightFractionBits fractional bits, which is Q1.14
+ * unless the layer has a weight of magnitude 2 or more, when it gives up fractional bits until its
+ * largest weight fits. A node sums Q7.8 x weight products into an int32, which then has
+ * 8 + weightFractionBits fractional bits, as does its bias:
+ *
+ *     input ~= q / 256
+ *     weight ~= w / 2^weightFractionBits
+ *     accumulatedInput ~= (biases[node] + sum q * w) / 2^(8 + weightFractionBits)
+ *
+ * The sums saturate rather than wrap, and are rounded back to Q7.8 for the activation functions,
+ * which are integer too: nothing between the inputs and outputs uses float or exp. The weights
+ * and biases are in flash on Arduino, with each node's weights together (see flash-memory.hpp).
+ *
+ * Kept free of the standard library so that it compiles on Arduino.
+ */
+
+#ifndef NETWORK_FIXED_POINT_H
+#define NETWORK_FIXED_POINT_H
+
+#include <stdint.h>
+
+#include "flash-memory.hpp"
+
+const int activationFractionBits = 8;       // Q7.8
+const int fixedPointOne = 1 << activationFractionBits;
+
+struct FixedPointLayer {
+    int numInputs;
+    int numNodes;
+    const int16_t *weights;         // [node][input], without the biases
+    const int32_t *biases;          // One per node, with 8 + weightFractionBits fractional bits
+    int weightFractionBits;
+};
+
+/*
+ * Round a float to the nearest Q7.8 value, saturating at either end. Only used at the network's
+ * inputs.
+ */
+inline int16_t toFixedPoint(float value) {
+    float steps = value * fixedPointOne;
+    if (steps <= -32768.0f) {
+        return -32768;
+    } else if (steps >= 32767.0f) {
+        return 32767;
+    }
+    return int16_t(steps < 0.0f ? steps - 0.5f : steps + 0.5f);
+}
+
+/*
+ * The float value of a Q7.8 value
+ */
+inline float fromFixedPoint(int16_t value) {
+    return float(value) / fixedPointOne;
+}
+
+/*
+ * Add two int32s, giving the nearest int32 rather than wrapping when the sum is out of range
+ */
+inline int32_t saturatingAdd(int32_t a, int32_t b) {
+    int32_t sum = int32_t(uint32_t(a) + uint32_t(b));
+    // Only same-signed operands can overflow, and then the sum has the other sign
+    if (((a ^ sum) & (b ^ sum)) < 0) {
+        return a < 0 ? INT32_MIN : INT32_MAX;
+    }
+    return sum;
+}
+
+/*
+ * Round a value with the given number of fractional bits to Q7.8, saturating at either end
+ */
+inline int16_t roundToFixedPoint(int32_t value, int fractionBits) {
+    int shift = fractionBits - activationFractionBits;
+    if (shift > 0) {
+        value = saturatingAdd(value, int32_t(1) << (shift - 1)) >> shift;
+    }
+    if (value < -32768) {
+        return -32768;
+    } else if (value > 32767) {
+        return 32767;
+    }
+    return int16_t(value);
+}
+
+/*
+ * Compute the accumulated input of each of a layer's nodes from its Q7.8 inputs, in Q7.8
+ */
+inline void accumulateFixedPointLayer(const FixedPointLayer &layer, const int16_t inputs[], int16_t nodes[]) {
+    for (int i = 0; i < layer.numNodes; i++) {
+        int32_t accumulated = readFromFlash(&layer.biases[i]);
+        streamFromFlash(layer.weights + i * layer.numInputs, layer.numInputs, [&](int j, int16_t weight) {
+            accumulated = saturatingAdd(accumulated, int32_t(inputs[j]) * weight);
+        });
+        nodes[i] = roundToFixedPoint(accumulated, activationFractionBits + layer.weightFractionBits);
+    }
+}
+
+/*
+ * e^x for a Q7.8 x <= 0, as an unsigned Q0.15 value in (0, 32768].
+ *
+ * x is rescaled to -(k + f) in base 2, so that e^x = 2^-f / 2^k. 2^-f for f in [0, 1) comes from
+ * a least squares cubic, which is within 0.0002 of it, and dividing by 2^k is a shift.
+ */
+inline uint16_t fixedPointExpOfNegative(int16_t x) {
+    // -x * log2(e) in Q8, with log2(e) in Q14
+    int32_t exponent = (-int32_t(x) * 23638 + 8192) >> 14;
+    int k = int(exponent >> activationFractionBits);
+    int32_t f = exponent & (fixedPointOne - 1);
+    if (k >= 16) {
+        return 0;
+    }
+    int32_t power = -1324;
+    power = ((power * f) >> 8) + 7606;
+    power = ((power * f) >> 8) - 22670;
+    power = ((power * f) >> 8) + 32768;
+    return uint16_t(power >> k);
+}
+
+/*
+ * Sigmoid of a Q7.8 value, in Q7.8. Computed as e^-|x| / (1 + e^-|x|) for the negative half,
+ * and mirrored for the positive half, so only e^x <= 1 is ever needed.
+ */
+inline int16_t fixedPointSigmoid(int16_t x) {
+    int32_t exponential = fixedPointExpOfNegative(x < 0 ? x : int16_t(-x));
+    int32_t denominator = 32768 + exponential;
+    int16_t lower = int16_t(((exponential << activationFractionBits) + denominator / 2) / denominator);
+    return x < 0 ? lower : int16_t(fixedPointOne - lower);
+}
+
+/*
+ * ReLu of a Q7.8 value, in Q7.8
+ */
+inline int16_t fixedPointReLu(int16_t x) {
+    return x > 0 ? x : 0;
+}
+
+/*
+ * Replace a layer's n Q7.8 accumulated inputs with their SoftMax activations, in Q7.8. The
+ * largest is subtracted first, so that every exponential is at most 1, and the exponentials are
+ * held in Q1.14 until they are normalised.
+ */
+inline void fixedPointSoftMax(int16_t nodes[], int n) {
+    int16_t largest = nodes[0];
+    for (int i = 1; i < n; i++) {
+        largest = nodes[i] > largest ? nodes[i] : largest;
+    }
+    int32_t sum = 0;
+    for (int i = 0; i < n; i++) {
+        int32_t shifted = int32_t(nodes[i]) - largest;
+        nodes[i] = int16_t(fixedPointExpOfNegative(shifted < -32768 ? -32768 : int16_t(shifted)) >> 1);
+        sum += nodes[i];
+    }
+    for (int i = 0; i < n; i++) {
+        nodes[i] = int16_t(((int32_t(nodes[i]) << activationFractionBits) + sum / 2) / sum);
+    }
+}
+
+#endif // NETWORK_FIXED_POINT_H
@@ -0,0 +1,2051 @@
+/*
+ * Dense linear algebra kernels used by Network_L.
+ *
+ * The matrix products are blocked so that each row of weights is loaded once per tile of examples
+ * rather than once per example, which is what turns mini-batch training from memory bound to
+ * compute bound.
+ *
+ * The innermost loops are provided in scalar, SSE2, AVX2 and AVX-512 flavours. The x86 versions
+ * are compiled with per-function target attributes rather than global -m flags, so they only run
+ * when CPUID reports support for them. The scalar versions are the reference implementation.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define KERNELS_X86
+#include <immintrin.h>
+#endif
+
+#include "network-kernels.hpp"
+
+// Number of columns of the shared dimension processed per block, sized to keep the tiles in L1
+const int kBlock = 256;
+
+// Register tile dimensions for multiplyABt
+const int rowTile = 4;
+const int colTile = 4;
+
+// Constants for the fast exp approximation (Cephes expf)
+const float expMaxInput = 88.3762626647949f;
+const float expMinInput = -87.3365478515625f;
+const float log2e = 1.44269504088896341f;
+const float ln2Hi = 0.693359375f;
+const float ln2Lo = -2.12194440e-4f;
+const float expC7 = 1.9875691500e-4f;
+const float expC6 = 1.3981999507e-3f;
+const float expC5 = 8.3334519073e-3f;
+const float expC4 = 4.1665795894e-2f;
+const float expC3 = 1.6666665459e-1f;
+const float expC2 = 5.0000001201e-1f;
+
+
+/*
+ * Scalar reference kernels
+ */
+
+static float dotProductScalar(const float *a, const float *b, int n) {
+    float sum = 0.0f;
+    for (int i = 0; i < n; i++) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+
+static void axpyScalar(float alpha, const float *x, float *y, int n) {
+    for (int i = 0; i < n; i++) {
+        y[i] += alpha * x[i];
+    }
+}
+
+
+static void momentumUpdateScalar(float *weights, float *changes, const float *gradients,
+                                 float rate, float momentum, int n) {
+    for (int i = 0; i < n; i++) {
+        changes[i] = rate * gradients[i] + momentum * changes[i];
+        weights[i] += changes[i];
+    }
+}
+
+
+static void backpropagateMomentumUpdateScalar(float *weights, float *changes, const float *inputs, float *lowerDeltas,
+                                              float delta, float rate, float momentum, int n) {
+    for (int i = 0; i < n; i++) {
+        lowerDeltas[i] += delta * weights[i];
+        changes[i] = rate * inputs[i] + momentum * changes[i];
+        weights[i] += changes[i];
+    }
+}
+
+
+static void nesterovUpdateScalar(float *weights, float *changes, const float *gradients,
+                                 float rate, float momentum, int n) {
+    for (int i = 0; i < n; i++) {
+        float step = rate * gradients[i];
+        changes[i] = step + momentum * changes[i];
+        weights[i] += momentum * changes[i] + step;
+    }
+}
+
+
+static void rmsPropUpdateScalar(float *weights, float *meanSquares, const float *gradients,
+                                float rate, float decay, float epsilon, int n) {
+    for (int i = 0; i < n; i++) {
+        float g = gradients[i];
+        meanSquares[i] = decay * meanSquares[i] + (1.0f - decay) * g * g;
+        weights[i] += rate * g / (std::sqrt(meanSquares[i]) + epsilon);
+    }
+}
+
+
+static void adamUpdateScalar(float *weights, float *firstMoments, float *secondMoments, const float *gradients,
+                             float rate, float beta1, float beta2, float epsilon, int n) {
+    for (int i = 0; i < n; i++) {
+        float g = gradients[i];
+        firstMoments[i] = beta1 * firstMoments[i] + (1.0f - beta1) * g;
+        secondMoments[i] = beta2 * secondMoments[i] + (1.0f - beta2) * g * g;
+        weights[i] += rate * firstMoments[i] / (std::sqrt(secondMoments[i]) + epsilon);
+    }
+}
+
+
+/*
+ * Reduced-precision conversions. Float16 is converted in software exactly as F16C does it.
+ */
+
+static inline uint32_t floatBits(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+
+static inline float bitsFloat(uint32_t bits) {
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+
+/*
+ * Random bits for stochastic rounding come from a xorshift generator, started from a hash
+ * (lowbias32) of the seed and a stream number so that every SIMD lane has its own stream. Each
+ * step gives the bits for one element: the change is rounded with the word, and the weight with
+ * the word rotated by 16 bits, so that the top bits used for each are independent.
+ */
+static inline uint32_t roundingStream(uint32_t seed, uint32_t stream) {
+    uint32_t x = seed + stream * 0x9E3779B9u;
+    x ^= x >> 16;
+    x *= 0x7FEB352Du;
+    x ^= x >> 15;
+    x *= 0x846CA68Bu;
+    x ^= x >> 16;
+    return x | 1;
+}
+
+
+static inline uint32_t nextRoundingBits(uint32_t &state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+
+template<HalfFormat F>
+static inline float halfToFloat(uint16_t half);
+
+template<>
+inline float halfToFloat<HalfFormat::BFloat16>(uint16_t half) {
+    return bitsFloat(uint32_t(half) << 16);
+}
+
+template<>
+inline float halfToFloat<HalfFormat::Float16>(uint16_t half) {
+    uint32_t sign = uint32_t(half & 0x8000) << 16;
+    uint32_t exponent = (half >> 10) & 0x1F;
+    uint32_t mantissa = half & 0x3FF;
+    if (exponent == 0) {
+        // Subnormal, exactly mantissa * 2^-24
+        return bitsFloat(sign | floatBits(mantissa * (1.0f / 16777216.0f)));
+    } else if (exponent == 31) {
+        return bitsFloat(sign | 0x7F800000 | (mantissa << 13));
+    }
+    return bitsFloat(sign | ((exponent + 112) << 23) | (mantissa << 13));
+}
+
+
+/*
+ * Round a float's magnitude to Float16 toward zero, as F16C does for NaN, infinity and overflow
+ */
+static inline uint16_t float16TowardZero(uint32_t bits) {
+    uint16_t sign = (bits >> 16) & 0x8000;
+    uint32_t magnitude = bits & 0x7FFFFFFF;
+    if (magnitude > 0x7F800000) {
+        return sign | 0x7E00 | ((magnitude >> 13) & 0x3FF);
+    } else if (magnitude == 0x7F800000) {
+        return sign | 0x7C00;
+    } else if (magnitude >= 0x47800000) {
+        return sign | 0x7BFF;
+    } else if (magnitude >= 0x38800000) {
+        return sign | uint16_t((magnitude - 0x38000000) >> 13);
+    }
+    return sign | uint16_t(bitsFloat(magnitude) * 16777216.0f);
+}
+
+
+template<HalfFormat F>
+static inline uint16_t roundHalfToNearest(float value);
+
+template<>
+inline uint16_t roundHalfToNearest<HalfFormat::BFloat16>(float value) {
+    uint32_t bits = floatBits(value);
+    return uint16_t((bits + 0x7FFF + ((bits >> 16) & 1)) >> 16);
+}
+
+template<>
+inline uint16_t roundHalfToNearest<HalfFormat::Float16>(float value) {
+    uint32_t bits = floatBits(value);
+    uint16_t sign = (bits >> 16) & 0x8000;
+    uint32_t magnitude = bits & 0x7FFFFFFF;
+    if (magnitude > 0x7F800000) {
+        return sign | 0x7E00 | ((magnitude >> 13) & 0x3FF);
+    } else if (magnitude >= 0x47800000) {
+        return sign | 0x7C00;
+    } else if (magnitude >= 0x38800000) {
+        uint32_t rebased = magnitude - 0x38000000;
+        return sign | uint16_t((rebased + 0xFFF + ((rebased >> 13) & 1)) >> 13);
+    }
+    return sign | uint16_t(std::nearbyint(bitsFloat(magnitude) * 16777216.0f));
+}
+
+
+/*
+ * Add random bits below the last kept bit, then truncate
+ */
+template<HalfFormat F>
+static inline uint16_t roundHalfStochastically(float value, uint32_t random);
+
+template<>
+inline uint16_t roundHalfStochastically<HalfFormat::BFloat16>(float value, uint32_t random) {
+    return uint16_t((floatBits(value) + (random >> 16)) >> 16);
+}
+
+template<>
+inline uint16_t roundHalfStochastically<HalfFormat::Float16>(float value, uint32_t random) {
+    uint32_t bits = floatBits(value);
+    uint32_t magnitude = bits & 0x7FFFFFFF;
+    if (magnitude < 0x47800000) {
+        // 13 bits are dropped from normal values, and one more for each binade below 2^-14
+        int exponent = magnitude >> 23;
+        int dropped = std::min(13 + std::max(0, 113 - exponent), 23);
+        magnitude += random >> (32 - dropped);
+    }
+    return float16TowardZero((bits & 0x80000000) | magnitude);
+}
+
+
+template<HalfFormat F>
+static void roundToHalfScalar(const float *values, uint16_t *halves, int n) {
+    for (int i = 0; i < n; i++) {
+        halves[i] = roundHalfToNearest<F>(values[i]);
+    }
+}
+
+
+template<HalfFormat F>
+static void expandHalfScalar(const uint16_t *halves, float *values, int n) {
+    for (int i = 0; i < n; i++) {
+        values[i] = halfToFloat<F>(halves[i]);
+    }
+}
+
+
+template<HalfFormat F>
+static float dotProductHalfScalar(const float *a, const uint16_t *b, int n) {
+    float sum = 0.0f;
+    for (int i = 0; i < n; i++) {
+        sum += a[i] * halfToFloat<F>(b[i]);
+    }
+    return sum;
+}
+
+
+template<HalfFormat F>
+static void momentumUpdateHalfScalar(uint16_t *weights, uint16_t *changes, const float *gradients,
+                                     float rate, float momentum, uint32_t seed, int n) {
+    uint32_t state = roundingStream(seed, 0);
+    for (int i = 0; i < n; i++) {
+        uint32_t random = nextRoundingBits(state);
+        float change = rate * gradients[i] + momentum * halfToFloat<F>(changes[i]);
+        changes[i] = roundHalfStochastically<F>(change, random);
+        weights[i] = roundHalfStochastically<F>(halfToFloat<F>(weights[i]) + change, (random << 16) | (random >> 16));
+    }
+}
+
+
+template<HalfFormat F>
+static void backpropagateMomentumUpdateHalfScalar(uint16_t *weights, uint16_t *changes, const float *inputs,
+                                                  float *lowerDeltas, float delta, float rate, float momentum,
+                                                  uint32_t seed, int n) {
+    uint32_t state = roundingStream(seed, 0);
+    for (int i = 0; i < n; i++) {
+        uint32_t random = nextRoundingBits(state);
+        float weight = halfToFloat<F>(weights[i]);
+        lowerDeltas[i] += delta * weight;
+        float change = rate * inputs[i] + momentum * halfToFloat<F>(changes[i]);
+        changes[i] = roundHalfStochastically<F>(change, random);
+        weights[i] = roundHalfStochastically<F>(weight + change, (random << 16) | (random >> 16));
+    }
+}
+
+
+/*
+ * The table holds one entry per kernel, so pick the format inside it
+ */
+static void roundToHalfScalar(const float *values, uint16_t *halves, int n, HalfFormat format) {
+    if (format == HalfFormat::BFloat16) {
+        roundToHalfScalar<HalfFormat::BFloat16>(values, halves, n);
+    } else {
+        roundToHalfScalar<HalfFormat::Float16>(values, halves, n);
+    }
+}
+
+
+static void expandHalfScalar(const uint16_t *halves, float *values, int n, HalfFormat format) {
+    if (format == HalfFormat::BFloat16) {
+        expandHalfScalar<HalfFormat::BFloat16>(halves, values, n);
+    } else {
+        expandHalfScalar<HalfFormat::Float16>(halves, values, n);
+    }
+}
+
+
+static float dotProductHalfScalar(const float *a, const uint16_t *b, int n, HalfFormat format) {
+    if (format == HalfFormat::BFloat16) {
+        return dotProductHalfScalar<HalfFormat::BFloat16>(a, b, n);
+    }
+    return dotProductHalfScalar<HalfFormat::Float16>(a, b, n);
+}
+
+
+static void momentumUpdateHalfScalar(uint16_t *weights, uint16_t *changes, const float *gradients,
+                                     float rate, float momentum, uint32_t seed, int n, HalfFormat format) {
+    if (format == HalfFormat::BFloat16) {
+        momentumUpdateHalfScalar<HalfFormat::BFloat16>(weights, changes, gradients, rate, momentum, seed, n);
+    } else {
+        momentumUpdateHalfScalar<HalfFormat::Float16>(weights, changes, gradients, rate, momentum, seed, n);
+    }
+}
+
+
+static void backpropagateMomentumUpdateHalfScalar(uint16_t *weights, uint16_t *changes, const float *inputs,
+                                                  float *lowerDeltas, float delta, float rate, float momentum,
+                                                  uint32_t seed, int n, HalfFormat format) {
+    if (format == HalfFormat::BFloat16) {
+        backpropagateMomentumUpdateHalfScalar<HalfFormat::BFloat16>(weights, changes, inputs, lowerDeltas,
+                                                                    delta, rate, momentum, seed, n);
+    } else {
+        backpropagateMomentumUpdateHalfScalar<HalfFormat::Float16>(weights, changes, inputs, lowerDeltas,
+                                                                   delta, rate, momentum, seed, n);
+    }
+}
+
+
+static inline float fastExpScalar(float x) {
+    x = std::min(std::max(x, expMinInput), expMaxInput);
+    float n = std::floor(x * log2e + 0.5f);
+    float r = x - n * ln2Hi - n * ln2Lo;
+    float p = expC7;
+    p = p * r + expC6;
+    p = p * r + expC5;
+    p = p * r + expC4;
+    p = p * r + expC3;
+    p = p * r + expC2;
+    p = p * r * r + r + 1.0f;
+    int32_t bits = (int32_t(n) + 127) << 23;
+    float scale;
+    std::memcpy(&scale, &bits, sizeof(scale));
+    return p * scale;
+}
+
+
+static void expLayerScalar(float *values, int n) {
+    for (int i = 0; i < n; i++) {
+        values[i] = fastExpScalar(values[i]);
+    }
+}
+
+
+static void sigmoidLayerScalar(float *values, int n) {
+    for (int i = 0; i < n; i++) {
+        values[i] = 1.0f / (1.0f + fastExpScalar(-values[i]));
+    }
+}
+
+
+/*
+ * The three passes of softMaxCrossEntropyLayer, also used for the tails of the vector versions:
+ * the largest value, then the shifted exponentials and the sums the loss needs, then the
+ * probabilities and deltas
+ */
+static inline float maxScalar(const float *values, int n, float max) {
+    for (int i = 0; i < n; i++) {
+        max = std::max(max, values[i]);
+    }
+    return max;
+}
+
+
+static inline void shiftedExpScalar(float *values, const float *targets, int n, float max,
+                                    float &expSum, float &targetSum, float &weightedSum) {
+    for (int i = 0; i < n; i++) {
+        float shifted = values[i] - max;
+        values[i] = fastExpScalar(shifted);
+        expSum += values[i];
+        targetSum += targets[i];
+        weightedSum += targets[i] * shifted;
+    }
+}
+
+
+static inline void normaliseScalar(float *values, const float *targets, float *deltas, int n,
+                                   float scale, float targetSum) {
+    for (int i = 0; i < n; i++) {
+        values[i] *= scale;
+        deltas[i] = targets[i] - values[i] * targetSum;
+    }
+}
+
+
+static float softMaxCrossEntropyLayerScalar(float *values, const float *targets, float *deltas, int n) {
+    float max = maxScalar(values, n, values[0]);
+    float expSum = 0.0f;
+    float targetSum = 0.0f;
+    float weightedSum = 0.0f;
+    shiftedExpScalar(values, targets, n, max, expSum, targetSum, weightedSum);
+    normaliseScalar(values, targets, deltas, n, 1.0f / expSum, targetSum);
+    return targetSum * std::log(expSum) - weightedSum;
+}
+
+
+/*
+ * Compute a rowTile x colTile tile of a * b^T over the shared range [k0, k1) and add it to c
+ */
+static void tileABtScalar(const float *a, int lda, const float *b, int ldb,
+                          float *c, int ldc, int k0, int k1) {
+    float acc[rowTile][colTile] = {};
+    const float *a0 = a;
+    const float *a1 = a + lda;
+    const float *a2 = a + 2 * lda;
+    const float *a3 = a + 3 * lda;
+    const float *b0 = b;
+    const float *b1 = b + ldb;
+    const float *b2 = b + 2 * ldb;
+    const float *b3 = b + 3 * ldb;
+    for (int p = k0; p < k1; p++) {
+        float av[rowTile] = { a0[p], a1[p], a2[p], a3[p] };
+        float bv[colTile] = { b0[p], b1[p], b2[p], b3[p] };
+        for (int r = 0; r < rowTile; r++) {
+            for (int s = 0; s < colTile; s++) {
+                acc[r][s] += av[r] * bv[s];
+            }
+        }
+    }
+    for (int r = 0; r < rowTile; r++) {
+        for (int s = 0; s < colTile; s++) {
+            c[r * ldc + s] += acc[r][s];
+        }
+    }
+}
+
+
+#ifdef KERNELS_X86
+
+/*
+ * SSE2 kernels, four floats per register, no FMA
+ */
+
+__attribute__((target("sse2")))
+static inline float horizontalSumSse2(__m128 v) {
+    __m128 shuffled = _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1));
+    __m128 sums = _mm_add_ps(v, shuffled);
+    shuffled = _mm_movehl_ps(shuffled, sums);
+    sums = _mm_add_ss(sums, shuffled);
+    return _mm_cvtss_f32(sums);
+}
+
+
+__attribute__((target("sse2")))
+static float dotProductSse2(const float *a, const float *b, int n) {
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+    }
+    float sum = horizontalSumSse2(_mm_add_ps(acc0, acc1));
+    for (; i < n; i++) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+
+__attribute__((target("sse2")))
+static void axpySse2(float alpha, const float *x, float *y, int n) {
+    __m128 va = _mm_set1_ps(alpha);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm_storeu_ps(y + i, _mm_add_ps(_mm_loadu_ps(y + i), _mm_mul_ps(va, _mm_loadu_ps(x + i))));
+    }
+    for (; i < n; i++) {
+        y[i] += alpha * x[i];
+    }
+}
+
+
+__attribute__((target("sse2")))
+static void momentumUpdateSse2(float *weights, float *changes, const float *gradients,
+                               float rate, float momentum, int n) {
+    __m128 vr = _mm_set1_ps(rate);
+    __m128 vm = _mm_set1_ps(momentum);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 change = _mm_add_ps(_mm_mul_ps(vr, _mm_loadu_ps(gradients + i)),
+                                   _mm_mul_ps(vm, _mm_loadu_ps(changes + i)));
+        _mm_storeu_ps(changes + i, change);
+        _mm_storeu_ps(weights + i, _mm_add_ps(_mm_loadu_ps(weights + i), change));
+    }
+    for (; i < n; i++) {
+        changes[i] = rate * gradients[i] + momentum * changes[i];
+        weights[i] += changes[i];
+    }
+}
+
+
+__attribute__((target("sse2")))
+static void backpropagateMomentumUpdateSse2(float *weights, float *changes, const float *inputs, float *lowerDeltas,
+                                            float delta, float rate, float momentum, int n) {
+    __m128 vd = _mm_set1_ps(delta);
+    __m128 vr = _mm_set1_ps(rate);
+    __m128 vm = _mm_set1_ps(momentum);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 weight = _mm_loadu_ps(weights + i);
+        _mm_storeu_ps(lowerDeltas + i, _mm_add_ps(_mm_loadu_ps(lowerDeltas + i), _mm_mul_ps(vd, weight)));
+        __m128 change = _mm_add_ps(_mm_mul_ps(vr, _mm_loadu_ps(inputs + i)),
+                                   _mm_mul_ps(vm, _mm_loadu_ps(changes + i)));
+        _mm_storeu_ps(changes + i, change);
+        _mm_storeu_ps(weights + i, _mm_add_ps(weight, change));
+    }
+    backpropagateMomentumUpdateScalar(weights + i, changes + i, inputs + i, lowerDeltas + i,
+                                      delta, rate, momentum, n - i);
+}
+
+
+__attribute__((target("sse2")))
+static void nesterovUpdateSse2(float *weights, float *changes, const float *gradients,
+                               float rate, float momentum, int n) {
+    __m128 vr = _mm_set1_ps(rate);
+    __m128 vm = _mm_set1_ps(momentum);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 step = _mm_mul_ps(vr, _mm_loadu_ps(gradients + i));
+        __m128 change = _mm_add_ps(step, _mm_mul_ps(vm, _mm_loadu_ps(changes + i)));
+        _mm_storeu_ps(changes + i, change);
+        _mm_storeu_ps(weights + i, _mm_add_ps(_mm_loadu_ps(weights + i), _mm_add_ps(_mm_mul_ps(vm, change), step)));
+    }
+    nesterovUpdateScalar(weights + i, changes + i, gradients + i, rate, momentum, n - i);
+}
+
+
+__attribute__((target("sse2")))
+static void rmsPropUpdateSse2(float *weights, float *meanSquares, const float *gradients,
+                              float rate, float decay, float epsilon, int n) {
+    __m128 vr = _mm_set1_ps(rate);
+    __m128 vd = _mm_set1_ps(decay);
+    __m128 vd1 = _mm_set1_ps(1.0f - decay);
+    __m128 ve = _mm_set1_ps(epsilon);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 g = _mm_loadu_ps(gradients + i);
+        __m128 s = _mm_add_ps(_mm_mul_ps(vd, _mm_loadu_ps(meanSquares + i)), _mm_mul_ps(vd1, _mm_mul_ps(g, g)));
+        _mm_storeu_ps(meanSquares + i, s);
+        __m128 step = _mm_div_ps(_mm_mul_ps(vr, g), _mm_add_ps(_mm_sqrt_ps(s), ve));
+        _mm_storeu_ps(weights + i, _mm_add_ps(_mm_loadu_ps(weights + i), step));
+    }
+    rmsPropUpdateScalar(weights + i, meanSquares + i, gradients + i, rate, decay, epsilon, n - i);
+}
+
+
+__attribute__((target("sse2")))
+static void adamUpdateSse2(float *weights, float *firstMoments, float *secondMoments, const float *gradients,
+                           float rate, float beta1, float beta2, float epsilon, int n) {
+    __m128 vr = _mm_set1_ps(rate);
+    __m128 vb1 = _mm_set1_ps(beta1);
+    __m128 vb11 = _mm_set1_ps(1.0f - beta1);
+    __m128 vb2 = _mm_set1_ps(beta2);
+    __m128 vb21 = _mm_set1_ps(1.0f - beta2);
+    __m128 ve = _mm_set1_ps(epsilon);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 g = _mm_loadu_ps(gradients + i);
+        __m128 m = _mm_add_ps(_mm_mul_ps(vb1, _mm_loadu_ps(firstMoments + i)), _mm_mul_ps(vb11, g));
+        __m128 v = _mm_add_ps(_mm_mul_ps(vb2, _mm_loadu_ps(secondMoments + i)), _mm_mul_ps(vb21, _mm_mul_ps(g, g)));
+        _mm_storeu_ps(firstMoments + i, m);
+        _mm_storeu_ps(secondMoments + i, v);
+        __m128 step = _mm_div_ps(_mm_mul_ps(vr, m), _mm_add_ps(_mm_sqrt_ps(v), ve));
+        _mm_storeu_ps(weights + i, _mm_add_ps(_mm_loadu_ps(weights + i), step));
+    }
+    adamUpdateScalar(weights + i, firstMoments + i, secondMoments + i, gradients + i,
+                     rate, beta1, beta2, epsilon, n - i);
+}
+
+
+__attribute__((target("sse2")))
+static inline __m128 fastExpSse2(__m128 x) {
+    x = _mm_min_ps(_mm_max_ps(x, _mm_set1_ps(expMinInput)), _mm_set1_ps(expMaxInput));
+    __m128i ni = _mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(log2e)));
+    __m128 n = _mm_cvtepi32_ps(ni);
+    __m128 r = _mm_sub_ps(_mm_sub_ps(x, _mm_mul_ps(n, _mm_set1_ps(ln2Hi))), _mm_mul_ps(n, _mm_set1_ps(ln2Lo)));
+    __m128 p = _mm_set1_ps(expC7);
+    p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(expC6));
+    p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(expC5));
+    p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(expC4));
+    p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(expC3));
+    p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(expC2));
+    p = _mm_add_ps(_mm_add_ps(_mm_mul_ps(p, _mm_mul_ps(r, r)), r), _mm_set1_ps(1.0f));
+    __m128 scale = _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(ni, _mm_set1_epi32(127)), 23));
+    return _mm_mul_ps(p, scale);
+}
+
+
+__attribute__((target("sse2")))
+static void expLayerSse2(float *values, int n) {
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm_storeu_ps(values + i, fastExpSse2(_mm_loadu_ps(values + i)));
+    }
+    for (; i < n; i++) {
+        values[i] = fastExpScalar(values[i]);
+    }
+}
+
+
+__attribute__((target("sse2")))
+static void sigmoidLayerSse2(float *values, int n) {
+    const __m128 one = _mm_set1_ps(1.0f);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 e = fastExpSse2(_mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(values + i)));
+        _mm_storeu_ps(values + i, _mm_div_ps(one, _mm_add_ps(one, e)));
+    }
+    for (; i < n; i++) {
+        values[i] = 1.0f / (1.0f + fastExpScalar(-values[i]));
+    }
+}
+
+
+__attribute__((target("sse2")))
+static float softMaxCrossEntropyLayerSse2(float *values, const float *targets, float *deltas, int n) {
+    __m128 maxes = _mm_set1_ps(values[0]);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        maxes = _mm_max_ps(maxes, _mm_loadu_ps(values + i));
+    }
+    alignas(16) float lanes[4];
+    _mm_store_ps(lanes, maxes);
+    float max = maxScalar(values + i, n - i, maxScalar(lanes, 4, lanes[0]));
+
+    __m128 vmax = _mm_set1_ps(max);
+    __m128 expSums = _mm_setzero_ps();
+    __m128 targetSums = _mm_setzero_ps();
+    __m128 weightedSums = _mm_setzero_ps();
+    for (i = 0; i + 4 <= n; i += 4) {
+        __m128 shifted = _mm_sub_ps(_mm_loadu_ps(values + i), vmax);
+        __m128 t = _mm_loadu_ps(targets + i);
+        __m128 e = fastExpSse2(shifted);
+        _mm_storeu_ps(values + i, e);
+        expSums = _mm_add_ps(expSums, e);
+        targetSums = _mm_add_ps(targetSums, t);
+        weightedSums = _mm_add_ps(weightedSums, _mm_mul_ps(t, shifted));
+    }
+    float expSum = horizontalSumSse2(expSums);
+    float targetSum = horizontalSumSse2(targetSums);
+    float weightedSum = horizontalSumSse2(weightedSums);
+    shiftedExpScalar(values + i, targets + i, n - i, max, expSum, targetSum, weightedSum);
+
+    float scale = 1.0f / expSum;
+    __m128 vscale = _mm_set1_ps(scale);
+    __m128 vtargetSum = _mm_set1_ps(targetSum);
+    for (i = 0; i + 4 <= n; i += 4) {
+        __m128 p = _mm_mul_ps(_mm_loadu_ps(values + i), vscale);
+        _mm_storeu_ps(values + i, p);
+        _mm_storeu_ps(deltas + i, _mm_sub_ps(_mm_loadu_ps(targets + i), _mm_mul_ps(p, vtargetSum)));
+    }
+    normaliseScalar(values + i, targets + i, deltas + i, n - i, scale, targetSum);
+    return targetSum * std::log(expSum) - weightedSum;
+}
+
+
+__attribute__((target("sse2")))
+static void tileABtSse2(const float *a, int lda, const float *b, int ldb,
+                        float *c, int ldc, int k0, int k1) {
+    const float *a0 = a;
+    const float *a1 = a + lda;
+    const float *a2 = a + 2 * lda;
+    const float *a3 = a + 3 * lda;
+    // Two columns of the tile at a time keeps the accumulators within the 16 xmm registers
+    for (int s = 0; s < colTile; s += 2) {
+        const float *b0 = b + s * ldb;
+        const float *b1 = b0 + ldb;
+        __m128 c00 = _mm_setzero_ps(), c01 = _mm_setzero_ps();
+        __m128 c10 = _mm_setzero_ps(), c11 = _mm_setzero_ps();
+        __m128 c20 = _mm_setzero_ps(), c21 = _mm_setzero_ps();
+        __m128 c30 = _mm_setzero_ps(), c31 = _mm_setzero_ps();
+        int p = k0;
+        for (; p + 4 <= k1; p += 4) {
+            __m128 bv0 = _mm_loadu_ps(b0 + p);
+            __m128 bv1 = _mm_loadu_ps(b1 + p);
+            __m128 av = _mm_loadu_ps(a0 + p);
+            c00 = _mm_add_ps(c00, _mm_mul_ps(av, bv0));
+            c01 = _mm_add_ps(c01, _mm_mul_ps(av, bv1));
+            av = _mm_loadu_ps(a1 + p);
+            c10 = _mm_add_ps(c10, _mm_mul_ps(av, bv0));
+            c11 = _mm_add_ps(c11, _mm_mul_ps(av, bv1));
+            av = _mm_loadu_ps(a2 + p);
+            c20 = _mm_add_ps(c20, _mm_mul_ps(av, bv0));
+            c21 = _mm_add_ps(c21, _mm_mul_ps(av, bv1));
+            av = _mm_loadu_ps(a3 + p);
+            c30 = _mm_add_ps(c30, _mm_mul_ps(av, bv0));
+            c31 = _mm_add_ps(c31, _mm_mul_ps(av, bv1));
+        }
+        float sums[rowTile][2] = {
+            { horizontalSumSse2(c00), horizontalSumSse2(c01) },
+            { horizontalSumSse2(c10), horizontalSumSse2(c11) },
+            { horizontalSumSse2(c20), horizontalSumSse2(c21) },
+            { horizontalSumSse2(c30), horizontalSumSse2(c31) },
+        };
+        for (int r = 0; r < rowTile; r++) {
+            const float *ar = a + r * lda;
+            for (int q = p; q < k1; q++) {
+                sums[r][0] += ar[q] * b0[q];
+                sums[r][1] += ar[q] * b1[q];
+            }
+            c[r * ldc + s] += sums[r][0];
+            c[r * ldc + s + 1] += sums[r][1];
+        }
+    }
+}
+
+
+/*
+ * AVX2 kernels, eight floats per register with fused multiply-add
+ */
+
+__attribute__((target("avx2,fma")))
+static inline float horizontalSumAvx2(__m256 v) {
+    __m128 sums = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    __m128 shuffled = _mm_movehdup_ps(sums);
+    sums = _mm_add_ps(sums, shuffled);
+    shuffled = _mm_movehl_ps(shuffled, sums);
+    sums = _mm_add_ss(sums, shuffled);
+    return _mm_cvtss_f32(sums);
+}
+
+
+__attribute__((target("avx2,fma")))
+static float dotProductAvx2(const float *a, const float *b, int n) {
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), acc1);
+    }
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+    }
+    float sum = horizontalSumAvx2(_mm256_add_ps(acc0, acc1));
+    for (; i < n; i++) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+
+__attribute__((target("avx2,fma")))
+static void axpyAvx2(float alpha, const float *x, float *y, int n) {
+    __m256 va = _mm256_set1_ps(alpha);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps(y + i, _mm256_fmadd_ps(va, _mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i)));
+    }
+    for (; i < n; i++) {
+        y[i] += alpha * x[i];
+    }
+}
+
+
+__attribute__((target("avx2,fma")))
+static void momentumUpdateAvx2(float *weights, float *changes, const float *gradients,
+                               float rate, float momentum, int n) {
+    __m256 vr = _mm256_set1_ps(rate);
+    __m256 vm = _mm256_set1_ps(momentum);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 change = _mm256_fmadd_ps(vr, _mm256_loadu_ps(gradients + i),
+                                        _mm256_mul_ps(vm, _mm256_loadu_ps(changes + i)));
+        _mm256_storeu_ps(changes + i, change);
+        _mm256_storeu_ps(weights + i, _mm256_add_ps(_mm256_loadu_ps(weights + i), change));
+    }
+    for (; i < n; i++) {
+        changes[i] = rate * gradients[i] + momentum * changes[i];
+        weights[i] += changes[i];
+    }
+}
+
+
+__attribute__((target("avx2,fma")))
+static void backpropagateMomentumUpdateAvx2(float *weights, float *changes, const float *inputs, float *lowerDeltas,
+                                            float delta, float rate, float momentum, int n) {
+    __m256 vd = _mm256_set1_ps(delta);
+    __m256 vr = _mm256_set1_ps(rate);
+    __m256 vm = _mm256_set1_ps(momentum);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 weight = _mm256_loadu_ps(weights + i);
+        _mm256_storeu_ps(lowerDeltas + i, _mm256_fmadd_ps(vd, weight, _mm256_loadu_ps(lowerDeltas + i)));
+        __m256 change = _mm256_fmadd_ps(vr, _mm256_loadu_ps(inputs + i),
+                                        _mm256_mul_ps(vm, _mm256_loadu_ps(changes + i)));
+        _mm256_storeu_ps(changes + i, change);
+        _mm256_storeu_ps(weights + i, _mm256_add_ps(weight, change));
+    }
+    backpropagateMomentumUpdateScalar(weights + i, changes + i, inputs + i, lowerDeltas + i,
+                                      delta, rate, momentum, n - i);
+}
+
+
+__attribute__((target("avx2,fma")))
+static void nesterovUpdateAvx2(float *weights, float *changes, const float *gradients,
+                               float rate, float momentum, int n) {
+    __m256 vr = _mm256_set1_ps(rate);
+    __m256 vm = _mm256_set1_ps(momentum);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 step = _mm256_mul_ps(vr, _mm256_loadu_ps(gradients + i));
+        __m256 change = _mm256_fmadd_ps(vm, _mm256_loadu_ps(changes + i), step);
+        _mm256_storeu_ps(changes + i, change);
+        _mm256_storeu_ps(weights + i, _mm256_add_ps(_mm256_loadu_ps(weights + i), _mm256_fmadd_ps(vm, change, step)));
+    }
+    nesterovUpdateScalar(weights + i, changes + i, gradients + i, rate, momentum, n - i);
+}
+
+
+__attribute__((target("avx2,fma")))
+static void rmsPropUpdateAvx2(float *weights, float *meanSquares, const float *gradients,
+                              float rate, float decay, float epsilon, int n) {
+    __m256 vr = _mm256_set1_ps(rate);
+    __m256 vd = _mm256_set1_ps(decay);
+    __m256 vd1 = _mm256_set1_ps(1.0f - decay);
+    __m256 ve = _mm256_set1_ps(epsilon);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 g = _mm256_loadu_ps(gradients + i);
+        __m256 s = _mm256_fmadd_ps(vd, _mm256_loadu_ps(meanSquares + i), _mm256_mul_ps(vd1, _mm256_mul_ps(g, g)));
+        _mm256_storeu_ps(meanSquares + i, s);
+        __m256 step = _mm256_div_ps(_mm256_mul_ps(vr, g), _mm256_add_ps(_mm256_sqrt_ps(s), ve));
+        _mm256_storeu_ps(weights + i, _mm256_add_ps(_mm256_loadu_ps(weights + i), step));
+    }
+    rmsPropUpdateScalar(weights + i, meanSquares + i, gradients + i, rate, decay, epsilon, n - i);
+}
+
+
+__attribute__((target("avx2,fma")))
+static void adamUpdateAvx2(float *weights, float *firstMoments, float *secondMoments, const float *gradients,
+                           float rate, float beta1, float beta2, float epsilon, int n) {
+    __m256 vr = _mm256_set1_ps(rate);
+    __m256 vb1 = _mm256_set1_ps(beta1);
+    __m256 vb11 = _mm256_set1_ps(1.0f - beta1);
+    __m256 vb2 = _mm256_set1_ps(beta2);
+    __m256 vb21 = _mm256_set1_ps(1.0f - beta2);
+    __m256 ve = _mm256_set1_ps(epsilon);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 g = _mm256_loadu_ps(gradients + i);
+        __m256 m = _mm256_fmadd_ps(vb1, _mm256_loadu_ps(firstMoments + i), _mm256_mul_ps(vb11, g));
+        __m256 v = _mm256_fmadd_ps(vb2, _mm256_loadu_ps(secondMoments + i), _mm256_mul_ps(vb21, _mm256_mul_ps(g, g)));
+        _mm256_storeu_ps(firstMoments + i, m);
+        _mm256_storeu_ps(secondMoments + i, v);
+        __m256 step = _mm256_div_ps(_mm256_mul_ps(vr, m), _mm256_add_ps(_mm256_sqrt_ps(v), ve));
+        _mm256_storeu_ps(weights + i, _mm256_add_ps(_mm256_loadu_ps(weights + i), step));
+    }
+    adamUpdateScalar(weights + i, firstMoments + i, secondMoments + i, gradients + i,
+                     rate, beta1, beta2, epsilon, n - i);
+}
+
+
+__attribute__((target("avx2,fma")))
+static inline __m256 fastExpAvx2(__m256 x) {
+    x = _mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(expMinInput)), _mm256_set1_ps(expMaxInput));
+    __m256 n = _mm256_round_ps(_mm256_mul_ps(x, _mm256_set1_ps(log2e)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m256 r = _mm256_fnmadd_ps(n, _mm256_set1_ps(ln2Lo), _mm256_fnmadd_ps(n, _mm256_set1_ps(ln2Hi), x));
+    __m256 p = _mm256_set1_ps(expC7);
+    p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(expC6));
+    p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(expC5));
+    p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(expC4));
+    p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(expC3));
+    p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(expC2));
+    p = _mm256_add_ps(_mm256_fmadd_ps(p, _mm256_mul_ps(r, r), r), _mm256_set1_ps(1.0f));
+    __m256i ni = _mm256_cvtps_epi32(n);
+    __m256 scale = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_add_epi32(ni, _mm256_set1_epi32(127)), 23));
+    return _mm256_mul_ps(p, scale);
+}
+
+
+__attribute__((target("avx2,fma")))
+static void expLayerAvx2(float *values, int n) {
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps(values + i, fastExpAvx2(_mm256_loadu_ps(values + i)));
+    }
+    for (; i < n; i++) {
+        values[i] = fastExpScalar(values[i]);
+    }
+}
+
+
+__attribute__((target("avx2,fma")))
+static void sigmoidLayerAvx2(float *values, int n) {
+    const __m256 one = _mm256_set1_ps(1.0f);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 e = fastExpAvx2(_mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(values + i)));
+        _mm256_storeu_ps(values + i, _mm256_div_ps(one, _mm256_add_ps(one, e)));
+    }
+    for (; i < n; i++) {
+        values[i] = 1.0f / (1.0f + fastExpScalar(-values[i]));
+    }
+}
+
+
+__attribute__((target("avx2,fma")))
+static float softMaxCrossEntropyLayerAvx2(float *values, const float *targets, float *deltas, int n) {
+    __m256 maxes = _mm256_set1_ps(values[0]);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        maxes = _mm256_max_ps(maxes, _mm256_loadu_ps(values + i));
+    }
+    alignas(32) float lanes[8];
+    _mm256_store_ps(lanes, maxes);
+    float max = maxScalar(values + i, n - i, maxScalar(lanes, 8, lanes[0]));
+
+    __m256 vmax = _mm256_set1_ps(max);
+    __m256 expSums = _mm256_setzero_ps();
+    __m256 targetSums = _mm256_setzero_ps();
+    __m256 weightedSums = _mm256_setzero_ps();
+    for (i = 0; i + 8 <= n; i += 8) {
+        __m256 shifted = _mm256_sub_ps(_mm256_loadu_ps(values + i), vmax);
+        __m256 t = _mm256_loadu_ps(targets + i);
+        __m256 e = fastExpAvx2(shifted);
+        _mm256_storeu_ps(values + i, e);
+        expSums = _mm256_add_ps(expSums, e);
+        targetSums = _mm256_add_ps(targetSums, t);
+        weightedSums = _mm256_fmadd_ps(t, shifted, weightedSums);
+    }
+    float expSum = horizontalSumAvx2(expSums);
+    float targetSum = horizontalSumAvx2(targetSums);
+    float weightedSum = horizontalSumAvx2(weightedSums);
+    shiftedExpScalar(values + i, targets + i, n - i, max, expSum, targetSum, weightedSum);
+
+    float scale = 1.0f / expSum;
+    __m256 vscale = _mm256_set1_ps(scale);
+    __m256 vtargetSum = _mm256_set1_ps(targetSum);
+    for (i = 0; i + 8 <= n; i += 8) {
+        __m256 p = _mm256_mul_ps(_mm256_loadu_ps(values + i), vscale);
+        _mm256_storeu_ps(values + i, p);
+        _mm256_storeu_ps(deltas + i, _mm256_fnmadd_ps(p, vtargetSum, _mm256_loadu_ps(targets + i)));
+    }
+    normaliseScalar(values + i, targets + i, deltas + i, n - i, scale, targetSum);
+    return targetSum * std::log(expSum) - weightedSum;
+}
+
+
+__attribute__((target("avx2,fma")))
+static void tileABtAvx2(const float *a, int lda, const float *b, int ldb,
+                        float *c, int ldc, int k0, int k1) {
+    const float *a0 = a;
+    const float *a1 = a + lda;
+    const float *a2 = a + 2 * lda;
+    const float *a3 = a + 3 * lda;
+    // Two columns of the tile at a time keeps the accumulators within the 16 ymm registers
+    for (int s = 0; s < colTile; s += 2) {
+        const float *b0 = b + s * ldb;
+        const float *b1 = b0 + ldb;
+        __m256 c00 = _mm256_setzero_ps(), c01 = _mm256_setzero_ps();
+        __m256 c10 = _mm256_setzero_ps(), c11 = _mm256_setzero_ps();
+        __m256 c20 = _mm256_setzero_ps(), c21 = _mm256_setzero_ps();
+        __m256 c30 = _mm256_setzero_ps(), c31 = _mm256_setzero_ps();
+        int p = k0;
+        for (; p + 8 <= k1; p += 8) {
+            __m256 bv0 = _mm256_loadu_ps(b0 + p);
+            __m256 bv1 = _mm256_loadu_ps(b1 + p);
+            __m256 av = _mm256_loadu_ps(a0 + p);
+            c00 = _mm256_fmadd_ps(av, bv0, c00);
+            c01 = _mm256_fmadd_ps(av, bv1, c01);
+            av = _mm256_loadu_ps(a1 + p);
+            c10 = _mm256_fmadd_ps(av, bv0, c10);
+            c11 = _mm256_fmadd_ps(av, bv1, c11);
+            av = _mm256_loadu_ps(a2 + p);
+            c20 = _mm256_fmadd_ps(av, bv0, c20);
+            c21 = _mm256_fmadd_ps(av, bv1, c21);
+            av = _mm256_loadu_ps(a3 + p);
+            c30 = _mm256_fmadd_ps(av, bv0, c30);
+            c31 = _mm256_fmadd_ps(av, bv1, c31);
+        }
+        float sums[rowTile][2] = {
+            { horizontalSumAvx2(c00), horizontalSumAvx2(c01) },
+            { horizontalSumAvx2(c10), horizontalSumAvx2(c11) },
+            { horizontalSumAvx2(c20), horizontalSumAvx2(c21) },
+            { horizontalSumAvx2(c30), horizontalSumAvx2(c31) },
+        };
+        for (int r = 0; r < rowTile; r++) {
+            const float *ar = a + r * lda;
+            for (int q = p; q < k1; q++) {
+                sums[r][0] += ar[q] * b0[q];
+                sums[r][1] += ar[q] * b1[q];
+            }
+            c[r * ldc + s] += sums[r][0];
+            c[r * ldc + s + 1] += sums[r][1];
+        }
+    }
+}
+
+
+/*
+ * AVX2 reduced-precision kernels, converting Float16 with F16C
+ */
+
+/*
+ * Start one rounding stream per lane, numbered from 1 as the scalar tail uses stream 0
+ */
+__attribute__((target("avx2,fma,f16c")))
+static inline __m256i roundingStreamsAvx2(uint32_t seed) {
+    alignas(32) uint32_t states[8];
+    for (int lane = 0; lane < 8; lane++) {
+        states[lane] = roundingStream(seed, lane + 1);
+    }
+    return _mm256_load_si256(reinterpret_cast<const __m256i *>(states));
+}
+
+
+__attribute__((target("avx2,fma,f16c")))
+static inline __m256i nextRoundingBitsAvx2(__m256i &state) {
+    state = _mm256_xor_si256(state, _mm256_slli_epi32(state, 13));
+    state = _mm256_xor_si256(state, _mm256_srli_epi32(state, 17));
+    state = _mm256_xor_si256(state, _mm256_slli_epi32(state, 5));
+    return state;
+}
+
+
+__attribute__((target("avx2,fma,f16c")))
+static inline __m256i rotateHalvesAvx2(__m256i random) {
+    return _mm256_or_si256(_mm256_slli_epi32(random, 16), _mm256_srli_epi32(random, 16));
+}
+
+
+/*
+ * Store the low 16 bits of each 32 bit lane, all of which must be below 0x10000
+ */
+__attribute__((target("avx2,fma,f16c")))
+static inline void storeLowHalvesAvx2(uint16_t *halves, __m256i values) {
+    __m128i packed = _mm_packus_epi32(_mm256_castsi256_si128(values), _mm256_extracti128_si256(values, 1));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(halves), packed);
+}
+
+
+template<HalfFormat F>
+static inline __m256 loadHalfAvx2(const uint16_t *halves);
+
+template<>
+__attribute__((target("avx2,fma,f16c")))
+inline __m256 loadHalfAvx2<HalfFormat::BFloat16>(const uint16_t *halves) {
+    __m256i widened = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(halves)));
+    return _mm256_castsi256_ps(_mm256_slli_epi32(widened, 16));
+}
+
+template<>
+__attribute__((target("avx2,fma,f16c")))
+inline __m256 loadHalfAvx2<HalfFormat::Float16>(const uint16_t *halves) {
+    return _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(halves)));
+}
+
+
+template<HalfFormat F>
+static inline void storeHalfToNearestAvx2(uint16_t *halves, __m256 values);
+
+template<>
+__attribute__((target("avx2,fma,f16c")))
+inline void storeHalfToNearestAvx2<HalfFormat::BFloat16>(uint16_t *halves, __m256 values) {
+    __m256i bits = _mm256_castps_si256(values);
+    __m256i lowestKept = _mm256_and_si256(_mm256_srli_epi32(bits, 16), _mm256_set1_epi32(1));
+    bits = _mm256_add_epi32(bits, _mm256_add_epi32(_mm256_set1_epi32(0x7FFF), lowestKept));
+    storeLowHalvesAvx2(halves, _mm256_srli_epi32(bits, 16));
+}
+
+template<>
+__attribute__((target("avx2,fma,f16c")))
+inline void storeHalfToNearestAvx2<HalfFormat::Float16>(uint16_t *halves, __m256 values) {
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(halves), _mm256_cvtps_ph(values, _MM_FROUND_TO_NEAREST_INT));
+}
+
+
+template<HalfFormat F>
+static inline void storeHalfStochasticallyAvx2(uint16_t *halves, __m256 values, __m256i random);
+
+template<>
+__attribute__((target("avx2,fma,f16c")))
+inline void storeHalfStochasticallyAvx2<HalfFormat::BFloat16>(uint16_t *halves, __m256 values, __m256i random) {
+    __m256i bits = _mm256_add_epi32(_mm256_castps_si256(values), _mm256_srli_epi32(random, 16));
+    storeLowHalvesAvx2(halves, _mm256_srli_epi32(bits, 16));
+}
+
+template<>
+__attribute__((target("avx2,fma,f16c")))
+inline void storeHalfStochasticallyAvx2<HalfFormat::Float16>(uint16_t *halves, __m256 values, __m256i random) {
+    __m256i bits = _mm256_castps_si256(values);
+    __m256i magnitude = _mm256_and_si256(bits, _mm256_set1_epi32(0x7FFFFFFF));
+    __m256i exponent = _mm256_srli_epi32(magnitude, 23);
+    __m256i dropped = _mm256_max_epi32(_mm256_sub_epi32(_mm256_set1_epi32(113), exponent), _mm256_setzero_si256());
+    dropped = _mm256_min_epi32(_mm256_add_epi32(dropped, _mm256_set1_epi32(13)), _mm256_set1_epi32(23));
+    __m256i below = _mm256_srlv_epi32(random, _mm256_sub_epi32(_mm256_set1_epi32(32), dropped));
+    __m256i inRange = _mm256_cmpgt_epi32(_mm256_set1_epi32(0x47800000), magnitude);
+    magnitude = _mm256_add_epi32(magnitude, _mm256_and_si256(below, inRange));
+    bits = _mm256_or_si256(magnitude, _mm256_andnot_si256(_mm256_set1_epi32(0x7FFFFFFF), bits));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(halves),
+                     _mm256_cvtps_ph(_mm256_castsi256_ps(bits), _MM_FROUND_TO_ZERO));
+}
+
+
+template<HalfFormat F>
+__attribute__((target("avx2,fma,f16c")))
+static void roundToHalfAvx2(const float *values, uint16_t *halves, int n) {
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        storeHalfToNearestAvx2<F>(halves + i, _mm256_loadu_ps(values + i));
+    }
+    roundToHalfScalar<F>(values + i, halves + i, n - i);
+}
+
+
+template<HalfFormat F>
+__attribute__((target("avx2,fma,f16c")))
+static void expandHalfAvx2(const uint16_t *halves, float *values, int n) {
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps(values + i, loadHalfAvx2<F>(halves + i));
+    }
+    expandHalfScalar<F>(halves + i, values + i, n - i);
+}
+
+
+template<HalfFormat F>
+__attribute__((target("avx2,fma,f16c")))
+static float dotProductHalfAvx2(const float *a, const uint16_t *b, int n) {
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), loadHalfAvx2<F>(b + i), acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), loadHalfAvx2<F>(b + i + 8), acc1);
+    }
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), loadHalfAvx2<F>(b + i), acc0);
+    }
+    return horizontalSumAvx2(_mm256_add_ps(acc0, acc1)) + dotProductHalfScalar<F>(a + i, b + i, n - i);
+}
+
+
+template<HalfFormat F>
+__attribute__((target("avx2,fma,f16c")))
+static void momentumUpdateHalfAvx2(uint16_t *weights, uint16_t *changes, const float *gradients,
+                                   float rate, float momentum, uint32_t seed, int n) {
+    __m256 vr = _mm256_set1_ps(rate);
+    __m256 vm = _mm256_set1_ps(momentum);
+    __m256i state = roundingStreamsAvx2(seed);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i random = nextRoundingBitsAvx2(state);
+        __m256 change = _mm256_fmadd_ps(vr, _mm256_loadu_ps(gradients + i),
+                                        _mm256_mul_ps(vm, loadHalfAvx2<F>(changes + i)));
+        __m256 weight = _mm256_add_ps(loadHalfAvx2<F>(weights + i), change);
+        storeHalfStochasticallyAvx2<F>(changes + i, change, random);
+        storeHalfStochasticallyAvx2<F>(weights + i, weight, rotateHalvesAvx2(random));
+    }
+    momentumUpdateHalfScalar<F>(weights + i, changes + i, gradients + i, rate, momentum, seed, n - i);
+}
+
+
+template<HalfFormat F>
+__attribute__((target("avx2,fma,f16c")))
+static void backpropagateMomentumUpdateHalfAvx2(uint16_t *weights, uint16_t *changes, const float *inputs,
+                                                float *lowerDeltas, float delta, float rate, float momentum,
+                                                uint32_t seed, int n) {
+    __m256 vd = _mm256_set1_ps(delta);
+    __m256 vr = _mm256_set1_ps(rate);
+    __m256 vm = _mm256_set1_ps(momentum);
+    __m256i state = roundingStreamsAvx2(seed);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i random = nextRoundingBitsAvx2(state);
+        __m256 weight = loadHalfAvx2<F>(weights + i);
+        _mm256_storeu_ps(lowerDeltas + i, _mm256_fmadd_ps(vd, weight, _mm256_loadu_ps(lowerDeltas + i)));
+        __m256 change = _mm256_fmadd_ps(vr, _mm256_loadu_ps(inputs + i),
+                                        _mm256_mul_ps(vm, loadHalfAvx2<F>(changes + i)));
+        storeHalfStochasticallyAvx2<F>(changes + i, change, random);
+        storeHalfStochasticallyAvx2<F>(weights + i, _mm256_add_ps(weight, change), rotateHalvesAvx2(random));
+    }
+    backpropagateMomentumUpdateHalfScalar<F>(weights + i, changes + i, inputs + i, lowerDeltas + i,
+                                             delta, rate, momentum, seed, n - i);
+}
+
+
+static void roundToHalfAvx2(const float *values, uint16_t *halves, int n, HalfFormat format) {
+    if (format == HalfFormat::BFloat16) {
+        roundToHalfAvx2<HalfFormat::BFloat16>(values, halves, n);
+    } else {
+        roundToHalfAvx2<HalfFormat::Float16>(values, halves, n);
+    }
+}
+
+
+static void expandHalfAvx2(const uint16_t *halves, float *values, int n, HalfFormat format) {
+    if (format == HalfFormat::BFloat16) {
+        expandHalfAvx2<HalfFormat::BFloat16>(halves, values, n);
+    } else {
+        expandHalfAvx2<HalfFormat::Float16>(halves, values, n);
+    }
+}
+
+
+static float dotProductHalfAvx2(const float *a, const uint16_t *b, int n, HalfFormat format) {
+    if (format == HalfFormat::BFloat16) {
+        return dotProductHalfAvx2<HalfFormat::BFloat16>(a, b, n);
+    }
+    return dotProductHalfAvx2<HalfFormat::Float16>(a, b, n);
+}
+
+
+static void momentumUpdateHalfAvx2(uint16_t *weights, uint16_t *changes, const float *gradients,
+                                   float rate, float momentum, uint32_t seed, int n, HalfFormat format) {
+    if (format == HalfFormat::BFloat16) {
+        momentumUpdateHalfAvx2<HalfFormat::BFloat16>(weights, changes, gradients, rate, momentum, seed, n);
+    } else {
+        momentumUpdateHalfAvx2<HalfFormat::Float16>(weights, changes, gradients, rate, momentum, seed, n);
+    }
+}
+
+
+static void backpropagateMomentumUpdateHalfAvx2(uint16_t *weights, uint16_t *changes, const float *inputs,
+                                                float *lowerDeltas, float delta, float rate, float momentum,
+                                                uint32_t seed, int n, HalfFormat format) {
+    if (format == HalfFormat::BFloat16) {
+        backpropagateMomentumUpdateHalfAvx2<HalfFormat::BFloat16>(weights, changes, inputs, lowerDeltas,
+                                                                  delta, rate, momentum, seed, n);
+    } else {
+        backpropagateMomentumUpdateHalfAvx2<HalfFormat::Float16>(weights, changes, inputs, lowerDeltas,
+                                                                 delta, rate, momentum, seed, n);
+    }
+}
+
+
+/*
+ * AVX-512 kernels, sixteen floats per register with fused multiply-add
+ */
+
+__attribute__((target("avx512f")))
+static float dotProductAvx512(const float *a, const float *b, int n) {
+    __m512 acc0 = _mm512_setzero_ps();
+    __m512 acc1 = _mm512_setzero_ps();
+    int i = 0;
+    for (; i + 32 <= n; i += 32) {
+        acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), acc0);
+        acc1 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i + 16), _mm512_loadu_ps(b + i + 16), acc1);
+    }
+    for (; i + 16 <= n; i += 16) {
+        acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), acc0);
+    }
+    // Masked loads handle the tail without a scalar loop
+    if (i < n) {
+        __mmask16 mask = __mmask16((1u << (n - i)) - 1);
+        acc1 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, a + i), _mm512_maskz_loadu_ps(mask, b + i), acc1);
+    }
+    return _mm512_reduce_add_ps(_mm512_add_ps(acc0, acc1));
+}
+
+
+__attribute__((target("avx512f")))
+static void axpyAvx512(float alpha, const float *x, float *y, int n) {
+    __m512 va = _mm512_set1_ps(alpha);
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        _mm512_storeu_ps(y + i, _mm512_fmadd_ps(va, _mm512_loadu_ps(x + i), _mm512_loadu_ps(y + i)));
+    }
+    if (i < n) {
+        __mmask16 mask = __mmask16((1u << (n - i)) - 1);
+        __m512 result = _mm512_fmadd_ps(va, _mm512_maskz_loadu_ps(mask, x + i), _mm512_maskz_loadu_ps(mask, y + i));
+        _mm512_mask_storeu_ps(y + i, mask, result);
+    }
+}
+
+
+__attribute__((target("avx512f")))
+static void momentumUpdateAvx512(float *weights, float *changes, const float *gradients,
+                                 float rate, float momentum, int n) {
+    __m512 vr = _mm512_set1_ps(rate);
+    __m512 vm = _mm512_set1_ps(momentum);
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512 change = _mm512_fmadd_ps(vr, _mm512_loadu_ps(gradients + i),
+                                        _mm512_mul_ps(vm, _mm512_loadu_ps(changes + i)));
+        _mm512_storeu_ps(changes + i, change);
+        _mm512_storeu_ps(weights + i, _mm512_add_ps(_mm512_loadu_ps(weights + i), change));
+    }
+    if (i < n) {
+        __mmask16 mask = __mmask16((1u << (n - i)) - 1);
+        __m512 change = _mm512_fmadd_ps(vr, _mm512_maskz_loadu_ps(mask, gradients + i),
+                                        _mm512_mul_ps(vm, _mm512_maskz_loadu_ps(mask, changes + i)));
+        _mm512_mask_storeu_ps(changes + i, mask, change);
+        _mm512_mask_storeu_ps(weights + i, mask, _mm512_add_ps(_mm512_maskz_loadu_ps(mask, weights + i), change));
+    }
+}
+
+
+__attribute__((target("avx512f")))
+static void backpropagateMomentumUpdateAvx512(float *weights, float *changes, const float *inputs, float *lowerDeltas,
+                                              float delta, float rate, float momentum, int n) {
+    __m512 vd = _mm512_set1_ps(delta);
+    __m512 vr = _mm512_set1_ps(rate);
+    __m512 vm = _mm512_set1_ps(momentum);
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512 weight = _mm512_loadu_ps(weights + i);
+        _mm512_storeu_ps(lowerDeltas + i, _mm512_fmadd_ps(vd, weight, _mm512_loadu_ps(lowerDeltas + i)));
+        __m512 change = _mm512_fmadd_ps(vr, _mm512_loadu_ps(inputs + i),
+                                        _mm512_mul_ps(vm, _mm512_loadu_ps(changes + i)));
+        _mm512_storeu_ps(changes + i, change);
+        _mm512_storeu_ps(weights + i, _mm512_add_ps(weight, change));
+    }
+    if (i < n) {
+        __mmask16 mask = __mmask16((1u << (n - i)) - 1);
+        __m512 weight = _mm512_maskz_loadu_ps(mask, weights + i);
+        _mm512_mask_storeu_ps(lowerDeltas + i, mask,
+                              _mm512_fmadd_ps(vd, weight, _mm512_maskz_loadu_ps(mask, lowerDeltas + i)));
+        __m512 change = _mm512_fmadd_ps(vr, _mm512_maskz_loadu_ps(mask, inputs + i),
+                                        _mm512_mul_ps(vm, _mm512_maskz_loadu_ps(mask, changes + i)));
+        _mm512_mask_storeu_ps(changes + i, mask, change);
+        _mm512_mask_storeu_ps(weights + i, mask, _mm512_add_ps(weight, change));
+    }
+}
+
+
+__attribute__((target("avx512f")))
+static void nesterovUpdateAvx512(float *weights, float *changes, const float *gradients,
+                                 float rate, float momentum, int n) {
+    __m512 vr = _mm512_set1_ps(rate);
+    __m512 vm = _mm512_set1_ps(momentum);
+    for (int i = 0; i < n; i += 16) {
+        __mmask16 mask = n - i >= 16 ? __mmask16(0xFFFF) : __mmask16((1u << (n - i)) - 1);
+        __m512 step = _mm512_mul_ps(vr, _mm512_maskz_loadu_ps(mask, gradients + i));
+        __m512 change = _mm512_fmadd_ps(vm, _mm512_maskz_loadu_ps(mask, changes + i), step);
+        _mm512_mask_storeu_ps(changes + i, mask, change);
+        _mm512_mask_storeu_ps(weights + i, mask,
+                              _mm512_add_ps(_mm512_maskz_loadu_ps(mask, weights + i), _mm512_fmadd_ps(vm, change, step)));
+    }
+}
+
+
+__attribute__((target("avx512f")))
+static void rmsPropUpdateAvx512(float *weights, float *meanSquares, const float *gradients,
+                                float rate, float decay, float epsilon, int n) {
+    __m512 vr = _mm512_set1_ps(rate);
+    __m512 vd = _mm512_set1_ps(decay);
+    __m512 vd1 = _mm512_set1_ps(1.0f - decay);
+    __m512 ve = _mm512_set1_ps(epsilon);
+    for (int i = 0; i < n; i += 16) {
+        __mmask16 mask = n - i >= 16 ? __mmask16(0xFFFF) : __mmask16((1u << (n - i)) - 1);
+        __m512 g = _mm512_maskz_loadu_ps(mask, gradients + i);
+        __m512 s = _mm512_fmadd_ps(vd, _mm512_maskz_loadu_ps(mask, meanSquares + i), _mm512_mul_ps(vd1, _mm512_mul_ps(g, g)));
+        _mm512_mask_storeu_ps(meanSquares + i, mask, s);
+        __m512 step = _mm512_div_ps(_mm512_mul_ps(vr, g), _mm512_add_ps(_mm512_sqrt_ps(s), ve));
+        _mm512_mask_storeu_ps(weights + i, mask, _mm512_add_ps(_mm512_maskz_loadu_ps(mask, weights + i), step));
+    }
+}
+
+
+__attribute__((target("avx512f")))
+static void adamUpdateAvx512(float *weights, float *firstMoments, float *secondMoments, const float *gradients,
+                             float rate, float beta1, float beta2, float epsilon, int n) {
+    __m512 vr = _mm512_set1_ps(rate);
+    __m512 vb1 = _mm512_set1_ps(beta1);
+    __m512 vb11 = _mm512_set1_ps(1.0f - beta1);
+    __m512 vb2 = _mm512_set1_ps(beta2);
+    __m512 vb21 = _mm512_set1_ps(1.0f - beta2);
+    __m512 ve = _mm512_set1_ps(epsilon);
+    for (int i = 0; i < n; i += 16) {
+        __mmask16 mask = n - i >= 16 ? __mmask16(0xFFFF) : __mmask16((1u << (n - i)) - 1);
+        __m512 g = _mm512_maskz_loadu_ps(mask, gradients + i);
+        __m512 m = _mm512_fmadd_ps(vb1, _mm512_maskz_loadu_ps(mask, firstMoments + i), _mm512_mul_ps(vb11, g));
+        __m512 v = _mm512_fmadd_ps(vb2, _mm512_maskz_loadu_ps(mask, secondMoments + i),
+                                   _mm512_mul_ps(vb21, _mm512_mul_ps(g, g)));
+        _mm512_mask_storeu_ps(firstMoments + i, mask, m);
+        _mm512_mask_storeu_ps(secondMoments + i, mask, v);
+        __m512 step = _mm512_div_ps(_mm512_mul_ps(vr, m), _mm512_add_ps(_mm512_sqrt_ps(v), ve));
+        _mm512_mask_storeu_ps(weights + i, mask, _mm512_add_ps(_mm512_maskz_loadu_ps(mask, weights + i), step));
+    }
+}
+
+
+__attribute__((target("avx512f")))
+static inline __m512 fastExpAvx512(__m512 x) {
+    x = _mm512_min_ps(_mm512_max_ps(x, _mm512_set1_ps(expMinInput)), _mm512_set1_ps(expMaxInput));
+    __m512 n = _mm512_roundscale_ps(_mm512_mul_ps(x, _mm512_set1_ps(log2e)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m512 r = _mm512_fnmadd_ps(n, _mm512_set1_ps(ln2Lo), _mm512_fnmadd_ps(n, _mm512_set1_ps(ln2Hi), x));
+    __m512 p = _mm512_set1_ps(expC7);
+    p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(expC6));
+    p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(expC5));
+    p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(expC4));
+    p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(expC3));
+    p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(expC2));
+    p = _mm512_add_ps(_mm512_fmadd_ps(p, _mm512_mul_ps(r, r), r), _mm512_set1_ps(1.0f));
+    // scalef computes p * 2^n directly, without building the exponent bits by hand
+    return _mm512_scalef_ps(p, n);
+}
+
+
+__attribute__((target("avx512f")))
+static void expLayerAvx512(float *values, int n) {
+    int i = 0;
+    for (; i < n; i += 16) {
+        __mmask16 mask = n - i >= 16 ? __mmask16(0xFFFF) : __mmask16((1u << (n - i)) - 1);
+        _mm512_mask_storeu_ps(values + i, mask, fastExpAvx512(_mm512_maskz_loadu_ps(mask, values + i)));
+    }
+}
+
+
+__attribute__((target("avx512f")))
+static void sigmoidLayerAvx512(float *values, int n) {
+    const __m512 one = _mm512_set1_ps(1.0f);
+    int i = 0;
+    for (; i < n; i += 16) {
+        __mmask16 mask = n - i >= 16 ? __mmask16(0xFFFF) : __mmask16((1u << (n - i)) - 1);
+        __m512 e = fastExpAvx512(_mm512_sub_ps(_mm512_setzero_ps(), _mm512_maskz_loadu_ps(mask, values + i)));
+        _mm512_mask_storeu_ps(values + i, mask, _mm512_div_ps(one, _mm512_add_ps(one, e)));
+    }
+}
+
+
+__attribute__((target("avx512f")))
+static float softMaxCrossEntropyLayerAvx512(float *values, const float *targets, float *deltas, int n) {
+    __m512 maxes = _mm512_set1_ps(values[0]);
+    int i = 0;
+    for (; i < n; i += 16) {
+        __mmask16 mask = n - i >= 16 ? __mmask16(0xFFFF) : __mmask16((1u << (n - i)) - 1);
+        maxes = _mm512_mask_max_ps(maxes, mask, maxes, _mm512_maskz_loadu_ps(mask, values + i));
+    }
+    __m512 vmax = _mm512_set1_ps(_mm512_reduce_max_ps(maxes));
+
+    // Lanes past the end are masked out of the sums, as exp(0 - max) is not zero
+    __m512 expSums = _mm512_setzero_ps();
+    __m512 targetSums = _mm512_setzero_ps();
+    __m512 weightedSums = _mm512_setzero_ps();
+    for (i = 0; i < n; i += 16) {
+        __mmask16 mask = n - i >= 16 ? __mmask16(0xFFFF) : __mmask16((1u << (n - i)) - 1);
+        __m512 shifted = _mm512_sub_ps(_mm512_maskz_loadu_ps(mask, values + i), vmax);
+        __m512 t = _mm512_maskz_loadu_ps(mask, targets + i);
+        __m512 e = _mm512_maskz_mov_ps(mask, fastExpAvx512(shifted));
+        _mm512_mask_storeu_ps(values + i, mask, e);
+        expSums = _mm512_add_ps(expSums, e);
+        targetSums = _mm512_add_ps(targetSums, t);
+        weightedSums = _mm512_fmadd_ps(t, shifted, weightedSums);
+    }
+    float expSum = _mm512_reduce_add_ps(expSums);
+    float targetSum = _mm512_reduce_add_ps(targetSums);
+    float weightedSum = _mm512_reduce_add_ps(weightedSums);
+
+    __m512 vscale = _mm512_set1_ps(1.0f / expSum);
+    __m512 vtargetSum = _mm512_set1_ps(targetSum);
+    for (i = 0; i < n; i += 16) {
+        __mmask16 mask = n - i >= 16 ? __mmask16(0xFFFF) : __mmask16((1u << (n - i)) - 1);
+        __m512 p = _mm512_mul_ps(_mm512_maskz_loadu_ps(mask, values + i), vscale);
+        _mm512_mask_storeu_ps(values + i, mask, p);
+        _mm512_mask_storeu_ps(deltas + i, mask, _mm512_fnmadd_ps(p, vtargetSum, _mm512_maskz_loadu_ps(mask, targets + i)));
+    }
+    return targetSum * std::log(expSum) - weightedSum;
+}
+
+
+__attribute__((target("avx512f")))
+static void tileABtAvx512(const float *a, int lda, const float *b, int ldb,
+                          float *c, int ldc, int k0, int k1) {
+    const float *a0 = a;
+    const float *a1 = a + lda;
+    const float *a2 = a + 2 * lda;
+    const float *a3 = a + 3 * lda;
+    const float *b0 = b;
+    const float *b1 = b + ldb;
+    const float *b2 = b + 2 * ldb;
+    const float *b3 = b + 3 * ldb;
+    // With 32 zmm registers the whole 4x4 tile of accumulators fits at once
+    __m512 acc[rowTile][colTile];
+    for (int r = 0; r < rowTile; r++) {
+        for (int s = 0; s < colTile; s++) {
+            acc[r][s] = _mm512_setzero_ps();
+        }
+    }
+    int p = k0;
+    for (; p < k1; p += 16) {
+        __mmask16 mask = k1 - p >= 16 ? __mmask16(0xFFFF) : __mmask16((1u << (k1 - p)) - 1);
+        __m512 bv[colTile] = {
+            _mm512_maskz_loadu_ps(mask, b0 + p), _mm512_maskz_loadu_ps(mask, b1 + p),
+            _mm512_maskz_loadu_ps(mask, b2 + p), _mm512_maskz_loadu_ps(mask, b3 + p)
+        };
+        __m512 av[rowTile] = {
+            _mm512_maskz_loadu_ps(mask, a0 + p), _mm512_maskz_loadu_ps(mask, a1 + p),
+            _mm512_maskz_loadu_ps(mask, a2 + p), _mm512_maskz_loadu_ps(mask, a3 + p)
+        };
+        for (int r = 0; r < rowTile; r++) {
+            for (int s = 0; s < colTile; s++) {
+                acc[r][s] = _mm512_fmadd_ps(av[r], bv[s], acc[r][s]);
+            }
+        }
+    }
+    for (int r = 0; r < rowTile; r++) {
+        for (int s = 0; s < colTile; s++) {
+            c[r * ldc + s] += _mm512_reduce_add_ps(acc[r][s]);
+        }
+    }
+}
+
+
+/*
+ * AVX-512 reduced-precision kernels
+ */
+
+__attribute__((target("avx512f")))
+static inline __m512i roundingStreamsAvx512(uint32_t seed) {
+    alignas(64) uint32_t states[16];
+    for (int lane = 0; lane < 16; lane++) {
+        states[lane] = roundingStream(seed, lane + 1);
+    }
+    return _mm512_load_si512(states);
+}
+
+
+__attribute__((target("avx512f")))
+static inline __m512i nextRoundingBitsAvx512(__m512i &state) {
+    state = _mm512_xor_si512(state, _mm512_slli_epi32(state, 13));
+    state = _mm512_xor_si512(state, _mm512_srli_epi32(state, 17));
+    state = _mm512_xor_si512(state, _mm512_slli_epi32(state, 5));
+    return state;
+}
+
+
+template<HalfFormat F>
+static inline __m512 loadHalfAvx512(const uint16_t *halves);
+
+template<>
+__attribute__((target("avx512f")))
+inline __m512 loadHalfAvx512<HalfFormat::BFloat16>(const uint16_t *halves) {
+    __m512i widened = _mm512_cvtepu16_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(halves)));
+    return _mm512_castsi512_ps(_mm512_slli_epi32(widened, 16));
+}
+
+template<>
+__attribute__((target("avx512f")))
+inline __m512 loadHalfAvx512<HalfFormat::Float16>(const uint16_t *halves) {
+    return _mm512_cvtph_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(halves)));
+}
+
+
+template<HalfFormat F>
+static inline void storeHalfToNearestAvx512(uint16_t *halves, __m512 values);
+
+template<>
+__attribute__((target("avx512f")))
+inline void storeHalfToNearestAvx512<HalfFormat::BFloat16>(uint16_t *halves, __m512 values) {
+    __m512i bits = _mm512_castps_si512(values);
+    __m512i lowestKept = _mm512_and_si512(_mm512_srli_epi32(bits, 16), _mm512_set1_epi32(1));
+    bits = _mm512_add_epi32(bits, _mm512_add_epi32(_mm512_set1_epi32(0x7FFF), lowestKept));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(halves), _mm512_cvtepi32_epi16(_mm512_srli_epi32(bits, 16)));
+}
+
+template<>
+__attribute__((target("avx512f")))
+inline void storeHalfToNearestAvx512<HalfFormat::Float16>(uint16_t *halves, __m512 values) {
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(halves), _mm512_cvtps_ph(values, _MM_FROUND_TO_NEAREST_INT));
+}
+
+
+template<HalfFormat F>
+static inline void storeHalfStochasticallyAvx512(uint16_t *halves, __m512 values, __m512i random);
+
+template<>
+__attribute__((target("avx512f")))
+inline void storeHalfStochasticallyAvx512<HalfFormat::BFloat16>(uint16_t *halves, __m512 values, __m512i random) {
+    __m512i bits = _mm512_add_epi32(_mm512_castps_si512(values), _mm512_srli_epi32(random, 16));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(halves), _mm512_cvtepi32_epi16(_mm512_srli_epi32(bits, 16)));
+}
+
+template<>
+__attribute__((target("avx512f")))
+inline void storeHalfStochasticallyAvx512<HalfFormat::Float16>(uint16_t *halves, __m512 values, __m512i random) {
+    __m512i bits = _mm512_castps_si512(values);
+    __m512i magnitude = _mm512_and_si512(bits, _mm512_set1_epi32(0x7FFFFFFF));
+    __m512i exponent = _mm512_srli_epi32(magnitude, 23);
+    __m512i dropped = _mm512_max_epi32(_mm512_sub_epi32(_mm512_set1_epi32(113), exponent), _mm512_setzero_si512());
+    dropped = _mm512_min_epi32(_mm512_add_epi32(dropped, _mm512_set1_epi32(13)), _mm512_set1_epi32(23));
+    __m512i below = _mm512_srlv_epi32(random, _mm512_sub_epi32(_mm512_set1_epi32(32), dropped));
+    __mmask16 inRange = _mm512_cmplt_epi32_mask(magnitude, _mm512_set1_epi32(0x47800000));
+    magnitude = _mm512_mask_add_epi32(magnitude, inRange, magnitude, below);
+    bits = _mm512_or_si512(magnitude, _mm512_andnot_si512(_mm512_set1_epi32(0x7FFFFFFF), bits));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(halves),
+                        _mm512_cvtps_ph(_mm512_castsi512_ps(bits), _MM_FROUND_TO_ZERO));
+}
+
+
+template<HalfFormat F>
+__attribute__((target("avx512f")))
+static void roundToHalfAvx512(const float *values, uint16_t *halves, int n) {
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        storeHalfToNearestAvx512<F>(halves + i, _mm512_loadu_ps(values + i));
+    }
+    roundToHalfScalar<F>(values + i, halves + i, n - i);
+}
+
+
+template<HalfFormat F>
+__attribute__((target("avx512f")))
+static void expandHalfAvx512(const uint16_t *halves, float *values, int n) {
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        _mm512_storeu_ps(values + i, loadHalfAvx512<F>(halves + i));
+    }
+    expandHalfScalar<F>(halves + i, values + i, n - i);
+}
+
+
+template<HalfFormat F>
+__attribute__((target("avx512f")))
+static float dotProductHalfAvx512(const float *a, const uint16_t *b, int n) {
+    __m512 acc0 = _mm512_setzero_ps();
+    __m512 acc1 = _mm512_setzero_ps();
+    int i = 0;
+    for (; i + 32 <= n; i += 32) {
+        acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), loadHalfAvx512<F>(b + i), acc0);
+        acc1 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i + 16), loadHalfAvx512<F>(b + i + 16), acc1);
+    }
+    for (; i + 16 <= n; i += 16) {
+        acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), loadHalfAvx512<F>(b + i), acc0);
+    }
+    return _mm512_reduce_add_ps(_mm512_add_ps(acc0, acc1)) + dotProductHalfScalar<F>(a + i, b + i, n - i);
+}
+
+
+template<HalfFormat F>
+__attribute__((target("avx512f")))
+static void momentumUpdateHalfAvx512(uint16_t *weights, uint16_t *changes, const float *gradients,
+                                     float rate, float momentum, uint32_t seed, int n) {
+    __m512 vr = _mm512_set1_ps(rate);
+    __m512 vm = _mm512_set1_ps(momentum);
+    __m512i state = roundingStreamsAvx512(seed);
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512i random = nextRoundingBitsAvx512(state);
+        __m512 change = _mm512_fmadd_ps(vr, _mm512_loadu_ps(gradients + i),
+                                        _mm512_mul_ps(vm, loadHalfAvx512<F>(changes + i)));
+        __m512 weight = _mm512_add_ps(loadHalfAvx512<F>(weights + i), change);
+        storeHalfStochasticallyAvx512<F>(changes + i, change, random);
+        storeHalfStochasticallyAvx512<F>(weights + i, weight, _mm512_rol_epi32(random, 16));
+    }
+    momentumUpdateHalfScalar<F>(weights + i, changes + i, gradients + i, rate, momentum, seed, n - i);
+}
+
+
+template<HalfFormat F>
+__attribute__((target("avx512f")))
+static void backpropagateMomentumUpdateHalfAvx512(uint16_t *weights, uint16_t *changes, const float *inputs,
+                                                  float *lowerDeltas, float delta, float rate, float momentum,
+                                                  uint32_t seed, int n) {
+    __m512 vd = _mm512_set1_ps(delta);
+    __m512 vr = _mm512_set1_ps(rate);
+    __m512 vm = _mm512_set1_ps(momentum);
+    __m512i state = roundingStreamsAvx512(seed);
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512i random = nextRoundingBitsAvx512(state);
+        __m512 weight = loadHalfAvx512<F>(weights + i);
+        _mm512_storeu_ps(lowerDeltas + i, _mm512_fmadd_ps(vd, weight, _mm512_loadu_ps(lowerDeltas + i)));
+        __m512 change = _mm512_fmadd_ps(vr, _mm512_loadu_ps(inputs + i),
+                                        _mm512_mul_ps(vm, loadHalfAvx512<F>(changes + i)));
+        storeHalfStochasticallyAvx512<F>(changes + i, change, random);
+        storeHalfStochasticallyAvx512<F>(weights + i, _mm512_add_ps(weight, change), _mm512_rol_epi32(random, 16));
+    }
+    backpropagateMomentumUpdateHalfScalar<F>(weights + i, changes + i, inputs + i, lowerDeltas + i,
+                                             delta, rate, momentum, seed, n - i);
+}
+
+
+static void roundToHalfAvx512(const float *values, uint16_t *halves, int n, HalfFormat format) {
+    if (format == HalfFormat::BFloat16) {
+        roundToHalfAvx512<HalfFormat::BFloat16>(values, halves, n);
+    } else {
+        roundToHalfAvx512<HalfFormat::Float16>(values, halves, n);
+    }
+}
+
+
+static void expandHalfAvx512(const uint16_t *halves, float *values, int n, HalfFormat format) {
+    if (format == HalfFormat::BFloat16) {
+        expandHalfAvx512<HalfFormat::BFloat16>(halves, values, n);
+    } else {
+        expandHalfAvx512<HalfFormat::Float16>(halves, values, n);
+    }
+}
+
+
+static float dotProductHalfAvx512(const float *a, const uint16_t *b, int n, HalfFormat format) {
+    if (format == HalfFormat::BFloat16) {
+        return dotProductHalfAvx512<HalfFormat::BFloat16>(a, b, n);
+    }
+    return dotProductHalfAvx512<HalfFormat::Float16>(a, b, n);
+}
+
+
+static void momentumUpdateHalfAvx512(uint16_t *weights, uint16_t *changes, const float *gradients,
+                                     float rate, float momentum, uint32_t seed, int n, HalfFormat format) {
+    if (format == HalfFormat::BFloat16) {
+        momentumUpdateHalfAvx512<HalfFormat::BFloat16>(weights, changes, gradients, rate, momentum, seed, n);
+    } else {
+        momentumUpdateHalfAvx512<HalfFormat::Float16>(weights, changes, gradients, rate, momentum, seed, n);
+    }
+}
+
+
+static void backpropagateMomentumUpdateHalfAvx512(uint16_t *weights, uint16_t *changes, const float *inputs,
+                                                  float *lowerDeltas, float delta, float rate, float momentum,
+                                                  uint32_t seed, int n, HalfFormat format) {
+    if (format == HalfFormat::BFloat16) {
+        backpropagateMomentumUpdateHalfAvx512<HalfFormat::BFloat16>(weights, changes, inputs, lowerDeltas,
+                                                                    delta, rate, momentum, seed, n);
+    } else {
+        backpropagateMomentumUpdateHalfAvx512<HalfFormat::Float16>(weights, changes, inputs, lowerDeltas,
+                                                                   delta, rate, momentum, seed, n);
+    }
+}
+
+#endif // KERNELS_X86
+
+
+/*
+ * Runtime dispatch
+ */
+
+struct KernelTable {
+    KernelIsa isa;
+    float (*dotProduct)(const float *, const float *, int);
+    void (*axpy)(float, const float *, float *, int);
+    void (*momentumUpdate)(float *, float *, const float *, float, float, int);
+    void (*backpropagateMomentumUpdate)(float *, float *, const float *, float *, float, float, float, int);
+    void (*nesterovUpdate)(float *, float *, const float *, float, float, int);
+    void (*rmsPropUpdate)(float *, float *, const float *, float, float, float, int);
+    void (*adamUpdate)(float *, float *, float *, const float *, float, float, float, float, int);
+    void (*tileABt)(const float *, int, const float *, int, float *, int, int, int);
+    void (*expLayer)(float *, int);
+    void (*sigmoidLayer)(float *, int);
+    float (*softMaxCrossEntropyLayer)(float *, const float *, float *, int);
+    void (*roundToHalf)(const float *, uint16_t *, int, HalfFormat);
+    void (*expandHalf)(const uint16_t *, float *, int, HalfFormat);
+    float (*dotProductHalf)(const float *, const uint16_t *, int, HalfFormat);
+    void (*momentumUpdateHalf)(uint16_t *, uint16_t *, const float *, float, float, uint32_t, int, HalfFormat);
+    void (*backpropagateMomentumUpdateHalf)(uint16_t *, uint16_t *, const float *, float *, float, float, float,
+                                            uint32_t, int, HalfFormat);
+};
+
+
+static KernelTable kernelTableFor(KernelIsa isa) {
+    KernelTable table = { KernelIsa::Scalar, dotProductScalar, axpyScalar, momentumUpdateScalar,
+                          backpropagateMomentumUpdateScalar, nesterovUpdateScalar, rmsPropUpdateScalar,
+                          adamUpdateScalar, tileABtScalar, expLayerScalar, sigmoidLayerScalar,
+                          softMaxCrossEntropyLayerScalar,
+                          roundToHalfScalar, expandHalfScalar, dotProductHalfScalar, momentumUpdateHalfScalar,
+                          backpropagateMomentumUpdateHalfScalar };
+#ifdef KERNELS_X86
+    if (isa == KernelIsa::AVX512) {
+        table = { KernelIsa::AVX512, dotProductAvx512, axpyAvx512, momentumUpdateAvx512,
+                  backpropagateMomentumUpdateAvx512, nesterovUpdateAvx512, rmsPropUpdateAvx512,
+                  adamUpdateAvx512, tileABtAvx512, expLayerAvx512, sigmoidLayerAvx512,
+                  softMaxCrossEntropyLayerAvx512,
+                  roundToHalfAvx512, expandHalfAvx512, dotProductHalfAvx512, momentumUpdateHalfAvx512,
+                  backpropagateMomentumUpdateHalfAvx512 };
+    } else if (isa == KernelIsa::AVX2) {
+        table = { KernelIsa::AVX2, dotProductAvx2, axpyAvx2, momentumUpdateAvx2,
+                  backpropagateMomentumUpdateAvx2, nesterovUpdateAvx2, rmsPropUpdateAvx2,
+                  adamUpdateAvx2, tileABtAvx2, expLayerAvx2, sigmoidLayerAvx2,
+                  softMaxCrossEntropyLayerAvx2,
+                  roundToHalfAvx2, expandHalfAvx2, dotProductHalfAvx2, momentumUpdateHalfAvx2,
+                  backpropagateMomentumUpdateHalfAvx2 };
+    } else if (isa == KernelIsa::SSE2) {
+        table = { KernelIsa::SSE2, dotProductSse2, axpySse2, momentumUpdateSse2,
+                  backpropagateMomentumUpdateSse2, nesterovUpdateSse2, rmsPropUpdateSse2,
+                  adamUpdateSse2, tileABtSse2, expLayerSse2, sigmoidLayerSse2,
+                  softMaxCrossEntropyLayerSse2,
+                  roundToHalfScalar, expandHalfScalar, dotProductHalfScalar, momentumUpdateHalfScalar,
+                  backpropagateMomentumUpdateHalfScalar };
+    }
+
+    // SSE2 has no reduced-precision kernels, and the AVX2 ones need F16C
+    if (isa == KernelIsa::AVX2 && !__builtin_cpu_supports("f16c")) {
+        table.roundToHalf = roundToHalfScalar;
+        table.expandHalf = expandHalfScalar;
+        table.dotProductHalf = dotProductHalfScalar;
+        table.momentumUpdateHalf = momentumUpdateHalfScalar;
+        table.backpropagateMomentumUpdateHalf = backpropagateMomentumUpdateHalfScalar;
+    }
+#endif
+    return table;
+}
+
+
+/*
+ * The kernel table, initialised from CPUID the first time any kernel is called
+ */
+static KernelTable &kernels() {
+    static KernelTable table = kernelTableFor(detectKernelIsa());
+    return table;
+}
+
+
+/*
+ * Return the widest instruction set supported by the CPU we are running on
+ */
+KernelIsa detectKernelIsa() {
+#ifdef KERNELS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return KernelIsa::AVX512;
+    } else if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        return KernelIsa::AVX2;
+    } else if (__builtin_cpu_supports("sse2")) {
+        return KernelIsa::SSE2;
+    }
+#endif
+    return KernelIsa::Scalar;
+}
+
+
+KernelIsa getKernelIsa() {
+    return kernels().isa;
+}
+
+
+/*
+ * Override the automatically selected kernels, e.g. to compare against the scalar reference.
+ * Requests for an instruction set the CPU does not support fall back to the widest one it does.
+ * Returns the instruction set actually selected. Not thread safe; call before training starts.
+ */
+KernelIsa setKernelIsa(KernelIsa isa) {
+    KernelIsa supported = detectKernelIsa();
+    if (int(isa) > int(supported)) {
+        isa = supported;
+    }
+    kernels() = kernelTableFor(isa);
+    return kernels().isa;
+}
+
+
+/*
+ * Utility function to get the string representation of a kernel instruction set
+ */
+std::string kernelIsaToString(KernelIsa isa) {
+    if (isa == KernelIsa::AVX512) {
+        return "AVX-512";
+    } else if (isa == KernelIsa::AVX2) {
+        return "AVX2";
+    } else if (isa == KernelIsa::SSE2) {
+        return "SSE2";
+    } else {
+        return "Scalar";
+    }
+}
+
+
+float dotProduct(const float *a, const float *b, int n) {
+    return kernels().dotProduct(a, b, n);
+}
+
+
+void axpy(float alpha, const float *x, float *y, int n) {
+    kernels().axpy(alpha, x, y, n);
+}
+
+
+void momentumUpdate(float *weights, float *changes, const float *gradients, float rate, float momentum, int n) {
+    kernels().momentumUpdate(weights, changes, gradients, rate, momentum, n);
+}
+
+
+void backpropagateMomentumUpdate(float *weights, float *changes, const float *inputs, float *lowerDeltas,
+                                 float delta, float rate, float momentum, int n) {
+    kernels().backpropagateMomentumUpdate(weights, changes, inputs, lowerDeltas, delta, rate, momentum, n);
+}
+
+
+void nesterovUpdate(float *weights, float *changes, const float *gradients, float rate, float momentum, int n) {
+    kernels().nesterovUpdate(weights, changes, gradients, rate, momentum, n);
+}
+
+
+void rmsPropUpdate(float *weights, float *meanSquares, const float *gradients,
+                   float rate, float decay, float epsilon, int n) {
+    kernels().rmsPropUpdate(weights, meanSquares, gradients, rate, decay, epsilon, n);
+}
+
+
+void adamUpdate(float *weights, float *firstMoments, float *secondMoments, const float *gradients,
+                float rate, float beta1, float beta2, float epsilon, int n) {
+    kernels().adamUpdate(weights, firstMoments, secondMoments, gradients, rate, beta1, beta2, epsilon, n);
+}
+
+
+void roundToHalf(const float *values, uint16_t *halves, int n, HalfFormat format) {
+    kernels().roundToHalf(values, halves, n, format);
+}
+
+
+void expandHalf(const uint16_t *halves, float *values, int n, HalfFormat format) {
+    kernels().expandHalf(halves, values, n, format);
+}
+
+
+float dotProductHalf(const float *a, const uint16_t *b, int n, HalfFormat format) {
+    return kernels().dotProductHalf(a, b, n, format);
+}
+
+
+void momentumUpdateHalf(uint16_t *weights, uint16_t *changes, const float *gradients,
+                        float rate, float momentum, uint32_t seed, int n, HalfFormat format) {
+    kernels().momentumUpdateHalf(weights, changes, gradients, rate, momentum, seed, n, format);
+}
+
+
+void backpropagateMomentumUpdateHalf(uint16_t *weights, uint16_t *changes, const float *inputs, float *lowerDeltas,
+                                     float delta, float rate, float momentum, uint32_t seed, int n,
+                                     HalfFormat format) {
+    kernels().backpropagateMomentumUpdateHalf(weights, changes, inputs, lowerDeltas, delta, rate, momentum, seed, n,
+                                              format);
+}
+
+
+void expLayer(float *values, int n) {
+    kernels().expLayer(values, n);
+}
+
+
+void sigmoidLayer(float *values, int n) {
+    kernels().sigmoidLayer(values, n);
+}
+
+
+float softMaxCrossEntropyLayer(float *values, const float *targets, float *deltas, int n) {
+    return kernels().softMaxCrossEntropyLayer(values, targets, deltas, n);
+}
+
+
+void multiplyABt(const float *a, int lda,
+                 const float *b, int ldb,
+                 const float *bias,
+                 float *c, int ldc,
+                 int m, int n, int k) {
+    const KernelTable &table = kernels();
+
+    for (int i = 0; i < m; i++) {
+        for (int j = 0; j < n; j++) {
+            c[i * ldc + j] = bias ? bias[j] : 0.0f;
+        }
+    }
+
+    const int mTiled = m - m % rowTile;
+    const int nTiled = n - n % colTile;
+
+    for (int k0 = 0; k0 < k; k0 += kBlock) {
+        const int k1 = std::min(k, k0 + kBlock);
+        for (int i = 0; i < m; i += rowTile) {
+            for (int j = 0; j < n; j += colTile) {
+                if (i < mTiled && j < nTiled) {
+                    table.tileABt(a + i * lda, lda, b + j * ldb, ldb, c + i * ldc + j, ldc, k0, k1);
+                    continue;
+                }
+                // Ragged edge of the output, fall back to plain dot products
+                for (int r = i; r < std::min(m, i + rowTile); r++) {
+                    for (int s = j; s < std::min(n, j + colTile); s++) {
+                        c[r * ldc + s] += table.dotProduct(a + r * lda + k0, b + s * ldb + k0, k1 - k0);
+                    }
+                }
+            }
+        }
+    }
+}
+
+
+void multiplyAB(const float *a, int lda,
+                const float *b, int ldb,
+                float *c, int ldc,
+                int m, int n, int k) {
+    const KernelTable &table = kernels();
+
+    for (int i = 0; i < m; i++) {
+        std::fill(c + i * ldc, c + i * ldc + n, 0.0f);
+    }
+
+    // Each row of b is streamed once per tile of rowTile output rows
+    for (int i = 0; i < m; i += rowTile) {
+        const int rows = std::min(rowTile, m - i);
+        for (int p = 0; p < k; p++) {
+            const float *bRow = b + p * ldb;
+            for (int r = 0; r < rows; r++) {
+                table.axpy(a[(i + r) * lda + p], bRow, c + (i + r) * ldc, n);
+            }
+        }
+    }
+}
+
+
+void multiplyAtB(const float *a, int lda,
+                 const float *b, int ldb,
+                 float *c, int ldc,
+                 int m, int n, int k) {
+    const KernelTable &table = kernels();
+
+    for (int i = 0; i < m; i++) {
+        std::fill(c + i * ldc, c + i * ldc + n, 0.0f);
+    }
+
+    // Each row of b (one example's inputs) is streamed once per tile of rowTile output rows
+    for (int i = 0; i < m; i += rowTile) {
+        const int rows = std::min(rowTile, m - i);
+        for (int p = 0; p < k; p++) {
+            const float *bRow = b + p * ldb;
+            for (int r = 0; r < rows; r++) {
+                table.axpy(a[p * lda + i + r], bRow, c + (i + r) * ldc, n);
+            }
+        }
+    }
+}
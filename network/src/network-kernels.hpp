@@ -0,0 +1,200 @@
+/*
+ * Dense linear algebra and optimizer kernels used by Network_L.
+ *
+ * All matrices are row-major with an explicit row stride (leading dimension), so that they can
+ * operate directly on the padded, node-major weight buffers held by the network.
+ *
+ * Each kernel has a scalar reference implementation plus SSE2, AVX2 and AVX-512 versions on x86.
+ * The widest instruction set the CPU supports is picked once, the first time a kernel is used,
+ * so a single binary runs at full speed on any host.
+ *
+ * WILL NOT COMPILE ON ARDUINO
+ */
+
+#ifndef NETWORK_KERNELS_H
+#define NETWORK_KERNELS_H
+
+#include <string>
+#include <cstdint>
+
+enum class KernelIsa {Scalar, SSE2, AVX2, AVX512};
+
+KernelIsa detectKernelIsa();
+KernelIsa getKernelIsa();
+KernelIsa setKernelIsa(KernelIsa isa);
+std::string kernelIsaToString(KernelIsa isa);
+
+/*
+ * Returns sum_i a[i] * b[i]
+ */
+float dotProduct(const float *a, const float *b, int n);
+
+/*
+ * y[i] += alpha * x[i]
+ */
+void axpy(float alpha, const float *x, float *y, int n);
+
+/*
+ * One momentum step over a row of weights:
+ *
+ * changes[i] = rate * gradients[i] + momentum * changes[i]
+ * weights[i] += changes[i]
+ */
+void momentumUpdate(float *weights, float *changes, const float *gradients, float rate, float momentum, int n);
+
+/*
+ * The backward step for one node of a layer trained one pattern at a time, fused into a single
+ * pass over the node's row of weights. The row's weighted delta is added to the deltas of the
+ * layer below using the weights from before the update, then the row takes one momentum step
+ * with the gradient delta * inputs[i]:
+ *
+ * lowerDeltas[i] += delta * weights[i]
+ * changes[i] = rate * inputs[i] + momentum * changes[i]
+ * weights[i] += changes[i]
+ *
+ * where rate already includes delta. Gives exactly the results of axpy then momentumUpdate.
+ */
+void backpropagateMomentumUpdate(float *weights, float *changes, const float *inputs, float *lowerDeltas,
+                                 float delta, float rate, float momentum, int n);
+
+/*
+ * One Nesterov accelerated gradient step, evaluating the gradient at the look-ahead point:
+ *
+ * changes[i] = rate * gradients[i] + momentum * changes[i]
+ * weights[i] += momentum * changes[i] + rate * gradients[i]
+ */
+void nesterovUpdate(float *weights, float *changes, const float *gradients, float rate, float momentum, int n);
+
+/*
+ * One RMSProp step:
+ *
+ * meanSquares[i] = decay * meanSquares[i] + (1 - decay) * gradients[i]^2
+ * weights[i] += rate * gradients[i] / (sqrt(meanSquares[i]) + epsilon)
+ */
+void rmsPropUpdate(float *weights, float *meanSquares, const float *gradients,
+                   float rate, float decay, float epsilon, int n);
+
+/*
+ * One Adam step. rate must already include the bias correction for the current step t,
+ * rate * sqrt(1 - beta2^t) / (1 - beta1^t):
+ *
+ * firstMoments[i] = beta1 * firstMoments[i] + (1 - beta1) * gradients[i]
+ * secondMoments[i] = beta2 * secondMoments[i] + (1 - beta2) * gradients[i]^2
+ * weights[i] += rate * firstMoments[i] / (sqrt(secondMoments[i]) + epsilon)
+ */
+void adamUpdate(float *weights, float *firstMoments, float *secondMoments, const float *gradients,
+                float rate, float beta1, float beta2, float epsilon, int n);
+
+/*
+ * Reduced-precision weight storage. Each value is held in a uint16_t, either as BFloat16 (the top
+ * half of a float: 8 exponent bits, 7 mantissa bits) or as an IEEE Float16 (5 exponent bits,
+ * 10 mantissa bits, largest value 65504). Float16 is converted with F16C where the CPU has it.
+ *
+ * The update kernels round stochastically: a value between two representable neighbours rounds
+ * up with probability proportional to its distance from the lower one, so small updates still
+ * move the weights on average. The random bits are a hash of seed and the position in the row,
+ * so the caller should pass a fresh seed for every call. Float16 values below its smallest
+ * subnormal, 2^-24, are biased toward zero. There are no SSE2 versions of these kernels, and the
+ * AVX2 ones are only used if the CPU also has F16C.
+ */
+enum class HalfFormat {BFloat16, Float16};
+
+/*
+ * halves[i] = values[i], rounded to nearest even
+ */
+void roundToHalf(const float *values, uint16_t *halves, int n, HalfFormat format);
+
+/*
+ * values[i] = halves[i]
+ */
+void expandHalf(const uint16_t *halves, float *values, int n, HalfFormat format);
+
+/*
+ * Returns sum_i a[i] * b[i], for a row of reduced-precision weights b
+ */
+float dotProductHalf(const float *a, const uint16_t *b, int n, HalfFormat format);
+
+/*
+ * momentumUpdate on reduced-precision weights and changes. Each step is computed in float, then
+ * the new change and weight are rounded stochastically.
+ */
+void momentumUpdateHalf(uint16_t *weights, uint16_t *changes, const float *gradients,
+                        float rate, float momentum, uint32_t seed, int n, HalfFormat format);
+
+/*
+ * backpropagateMomentumUpdate on reduced-precision weights and changes, rounding as
+ * momentumUpdateHalf does. lowerDeltas stay in float.
+ */
+void backpropagateMomentumUpdateHalf(uint16_t *weights, uint16_t *changes, const float *inputs, float *lowerDeltas,
+                                     float delta, float rate, float momentum, uint32_t seed, int n,
+                                     HalfFormat format);
+
+/*
+ * Fast layer-wide activation kernels.
+ *
+ * exp is computed as 2^n * p(r), with r = x - n ln(2) and p a degree 7 polynomial (the Cephes
+ * expf coefficients). Inputs are clamped to [-87.33, 88.37], so the result never overflows to
+ * infinity or underflows to a denormal. Within that range the relative error of expLayer is
+ * below fastExpMaxRelativeError, and the absolute error of sigmoidLayer is below
+ * fastSigmoidMaxAbsoluteError, on every instruction set.
+ */
+const float fastExpMaxRelativeError = 2e-7f;
+const float fastSigmoidMaxAbsoluteError = 2e-7f;
+
+/*
+ * values[i] = exp(values[i])
+ */
+void expLayer(float *values, int n);
+
+/*
+ * values[i] = 1 / (1 + exp(-values[i]))
+ */
+void sigmoidLayer(float *values, int n);
+
+/*
+ * SoftMax of a layer fused with its cross-entropy loss, for an output layer. values holds the
+ * layer's accumulated inputs and is replaced by the probabilities. Returns the loss
+ * -sum_i targets[i] * log(p[i]) and sets deltas[i] = targets[i] - p[i] * sum_j targets[j], minus
+ * the gradient of the loss, which is targets - p when the targets sum to 1.
+ *
+ * The largest input is subtracted before exponentiating, so large inputs cannot overflow, and the
+ * loss is taken from the log of the sum of the exponentials, one log per layer, so a probability
+ * that underflows cannot make it infinite. n must be at least 1.
+ */
+float softMaxCrossEntropyLayer(float *values, const float *targets, float *deltas, int n);
+
+/*
+ * c[i][j] = bias[j] + sum_k a[i][k] * b[j][k]
+ *
+ * a is m x k, b is n x k and c is m x n. bias may be null.
+ * Used for forward passes, where a holds one example per row and b holds one node per row.
+ */
+void multiplyABt(const float *a, int lda,
+                 const float *b, int ldb,
+                 const float *bias,
+                 float *c, int ldc,
+                 int m, int n, int k);
+
+/*
+ * c[i][j] = sum_k a[i][k] * b[k][j]
+ *
+ * a is m x k, b is k x n and c is m x n.
+ * Used to backpropagate deltas through a node-major weight matrix.
+ */
+void multiplyAB(const float *a, int lda,
+                const float *b, int ldb,
+                float *c, int ldc,
+                int m, int n, int k);
+
+/*
+ * c[i][j] = sum_k a[k][i] * b[k][j]
+ *
+ * a is k x m, b is k x n and c is m x n.
+ * Used to accumulate weight gradients, where a holds the deltas and b the layer inputs of a batch.
+ */
+void multiplyAtB(const float *a, int lda,
+                 const float *b, int ldb,
+                 float *c, int ldc,
+                 int m, int n, int k);
+
+#endif // NETWORK_KERNELS_H
@@ -7,8 +7,406 @@
 
 #include <random>
 #include <iostream>
+#include <algorithm>
+#include <cmath>
 
 #include "network-linux.hpp"
+#include "network-kernels.hpp"
+
+
+// Fixed hyperparameters of the adaptive optimizers, the defaults suggested by their authors
+const float rmsPropDecay = 0.9f;
+const float adamBeta1 = 0.9f;
+const float adamBeta2 = 0.999f;
+const float optimizerEpsilon = 1e-8f;
+
+
+/*
+ * Convert weights from the original code's [input][node] layout, with the biases as the final row,
+ * into a flat node-major buffer with padded rows and a separate bias vector
+ */
+static void flattenWeights(const std::vector<std::vector<float>> &nested, int numInputs, int numNodes, int stride,
+                           AlignedVector &weights, AlignedVector &biases) {
+    for (int i = 0; i < numNodes; i++) {
+        for (int j = 0; j < numInputs; j++) {
+            weights[i * stride + j] = nested[j][i];
+        }
+        biases[i] = nested[numInputs][i];
+    }
+}
+
+
+/*
+ * Convert a flat node-major buffer and its bias vector back into the original code's
+ * [input][node] layout, with the biases as the final row
+ */
+static std::vector<std::vector<float>> nestWeights(const AlignedVector &weights, const AlignedVector &biases,
+                                                   int numInputs, int numNodes, int stride) {
+    std::vector<std::vector<float>> nested(numInputs + 1, std::vector<float>(numNodes));
+    for (int i = 0; i < numNodes; i++) {
+        for (int j = 0; j < numInputs; j++) {
+            nested[j][i] = weights[i * stride + j];
+        }
+        nested[numInputs][i] = biases[i];
+    }
+    return nested;
+}
+
+
+/*
+ * Split [0, length) into numParts nearly equal slices, with every boundary on a cache line,
+ * and give the bounds of slice part
+ */
+static void sliceBounds(int length, int part, int numParts, int &begin, int &end) {
+    begin = std::min(length, paddedStride(int(long(length) * part / numParts)));
+    end = std::min(length, paddedStride(int(long(length) * (part + 1) / numParts)));
+}
+
+
+/*
+ * Set slice part of a flat gradient buffer to the sum of the same slice of each source,
+ * added in order
+ */
+static void sumSlice(AlignedVector &total, const std::vector<Gradients> &gradients,
+                     std::vector<AlignedVector> Gradients::*buffers, int layer, int part, int numParts) {
+    int begin, end;
+    sliceBounds(total.size(), part, numParts, begin, end);
+    std::fill(total.begin() + begin, total.begin() + end, 0.0f);
+    for (int g = 0; g < gradients.size(); g++) {
+        if (begin < end) {
+            axpy(1.0f, &(gradients[g].*buffers)[layer][begin], &total[begin], end - begin);
+        }
+    }
+}
+
+
+/*
+ * Whole-layer activation kernels, one instantiation per activation function and precision.
+ * With fast precision, Sigmoid and SoftMax use the vectorised approximations from
+ * network-kernels.hpp. ReLu is exact either way.
+ */
+template<ActivationFunction AF, ActivationPrecision P>
+static void activateLayer(float *nodes, int numNodes);
+
+template<>
+void activateLayer<ActivationFunction::Sigmoid, ActivationPrecision::Exact>(float *nodes, int numNodes) {
+    for (int i = 0; i < numNodes; i++) {
+        nodes[i] = float(1.0/(1.0 + exp(-nodes[i])));
+    }
+}
+
+template<>
+void activateLayer<ActivationFunction::Sigmoid, ActivationPrecision::Fast>(float *nodes, int numNodes) {
+    sigmoidLayer(nodes, numNodes);
+}
+
+template<ActivationFunction AF, ActivationPrecision P>
+static void activateLayer(float *nodes, int numNodes) {
+    if (AF == ActivationFunction::ReLu) {
+        for (int i = 0; i < numNodes; i++) {
+            nodes[i] = std::max(0.0f, nodes[i]);
+        }
+        return;
+    }
+
+    // SoftMax: exponentiate, then divide each node's output by their sum. The largest input is
+    // subtracted first, which leaves the outputs unchanged but keeps exp from overflowing
+    float max = *std::max_element(nodes, nodes + numNodes);
+    for (int i = 0; i < numNodes; i++) {
+        nodes[i] -= max;
+    }
+    if (P == ActivationPrecision::Fast) {
+        expLayer(nodes, numNodes);
+    } else {
+        for (int i = 0; i < numNodes; i++) {
+            nodes[i] = exp(nodes[i]);
+        }
+    }
+    float sum = 0;
+    for (int i = 0; i < numNodes; i++) {
+        sum += nodes[i];
+    }
+    for (int i = 0; i < numNodes; i++) {
+        nodes[i] = nodes[i] / sum;
+    }
+}
+
+
+/*
+ * Multiply the deltas backpropagated to a layer by the derivative of its activation function,
+ * given the layer's activations. SoftMax couples every node of the layer, so each delta also
+ * depends on the others.
+ */
+template<ActivationFunction AF>
+static void multiplyDerivative(float *deltas, const float *nodes, int numNodes);
+
+template<>
+void multiplyDerivative<ActivationFunction::Sigmoid>(float *deltas, const float *nodes, int numNodes) {
+    for (int i = 0; i < numNodes; i++) {
+        deltas[i] = float(deltas[i] * nodes[i] * (1.0 - nodes[i]));
+    }
+}
+
+template<>
+void multiplyDerivative<ActivationFunction::ReLu>(float *deltas, const float *nodes, int numNodes) {
+    for (int i = 0; i < numNodes; i++) {
+        deltas[i] = nodes[i] > 0.0f ? deltas[i] : 0.0f;
+    }
+}
+
+template<>
+void multiplyDerivative<ActivationFunction::SoftMax>(float *deltas, const float *nodes, int numNodes) {
+    float weightedSum = 0.0f;
+    for (int i = 0; i < numNodes; i++) {
+        weightedSum += deltas[i] * nodes[i];
+    }
+    for (int i = 0; i < numNodes; i++) {
+        deltas[i] = nodes[i] * (deltas[i] - weightedSum);
+    }
+}
+
+
+/*
+ * The error of a single output node under each error function
+ */
+template<ErrorFunction EF>
+static float outputError(float target, float output);
+
+template<>
+float outputError<ErrorFunction::SumSquared>(float target, float output) {
+    return 0.5 * (target - output) * (target - output);
+}
+
+template<>
+float outputError<ErrorFunction::CrossEntropy>(float target, float output) {
+    return -1.0 * (target * log(output) + (1.0f - target) * log(1.0f - output));
+}
+
+
+/*
+ * Compute the deltas of the output layer and return its summed error.
+ *
+ * Cross entropy after a Sigmoid output cancels the activation's derivative, leaving
+ * target - output. Otherwise the difference is multiplied by the derivative as for a hidden layer.
+ * SoftMax with cross entropy is fused into computeSoftMaxCrossEntropy below instead.
+ */
+template<ActivationFunction AF, ErrorFunction EF>
+static double computeOutputErrors(const float *targets, float *outputs, float *deltas, int numNodes) {
+    double errorSum = 0.0;
+    for (int i = 0; i < numNodes; i++) {
+        deltas[i] = targets[i] - outputs[i];
+        errorSum += outputError<EF>(targets[i], outputs[i]);
+    }
+    if (EF == ErrorFunction::SumSquared || AF == ActivationFunction::ReLu) {
+        multiplyDerivative<AF>(deltas, outputs, numNodes);
+    }
+    return errorSum;
+}
+
+// The original code's pairing, kept in single precision as it computed it
+template<>
+double computeOutputErrors<ActivationFunction::Sigmoid, ErrorFunction::SumSquared>(const float *targets,
+                                                                                   float *outputs,
+                                                                                   float *deltas, int numNodes) {
+    double errorSum = 0.0;
+    for (int i = 0; i < numNodes; i++) {
+        deltas[i] = (targets[i] - outputs[i]) * outputs[i] * (1.0f - outputs[i]);
+        errorSum += outputError<ErrorFunction::SumSquared>(targets[i], outputs[i]);
+    }
+    return errorSum;
+}
+
+
+/*
+ * SoftMax and its cross entropy in one pass over the output layer. outputs holds the layer's
+ * accumulated inputs and is replaced by the probabilities. The loss is the categorical cross
+ * entropy -sum(target * log(output)), taken as log-sum-exp minus the target-weighted inputs so
+ * that only one log is needed, and the deltas are its exact gradient, target - output scaled by
+ * the sum of the targets. See softMaxCrossEntropyLayer in network-kernels.hpp for the fast version.
+ */
+template<ActivationPrecision P>
+static double computeSoftMaxCrossEntropy(const float *targets, float *outputs, float *deltas, int numNodes);
+
+template<>
+double computeSoftMaxCrossEntropy<ActivationPrecision::Exact>(const float *targets, float *outputs,
+                                                              float *deltas, int numNodes) {
+    float max = *std::max_element(outputs, outputs + numNodes);
+    double expSum = 0.0;
+    double targetSum = 0.0;
+    double weightedSum = 0.0;
+    for (int i = 0; i < numNodes; i++) {
+        float shifted = outputs[i] - max;
+        outputs[i] = exp(shifted);
+        expSum += outputs[i];
+        targetSum += targets[i];
+        weightedSum += targets[i] * shifted;
+    }
+    for (int i = 0; i < numNodes; i++) {
+        outputs[i] = float(outputs[i] / expSum);
+        deltas[i] = float(targets[i] - outputs[i] * targetSum);
+    }
+    return targetSum * log(expSum) - weightedSum;
+}
+
+template<>
+double computeSoftMaxCrossEntropy<ActivationPrecision::Fast>(const float *targets, float *outputs,
+                                                             float *deltas, int numNodes) {
+    return softMaxCrossEntropyLayer(outputs, targets, deltas, numNodes);
+}
+
+
+/*
+ * Look up the kernels for an activation function
+ */
+ActivationKernel activationKernelFor(ActivationFunction af, ActivationPrecision precision) {
+    bool fast = precision == ActivationPrecision::Fast;
+    if (af == ActivationFunction::ReLu) {
+        return activateLayer<ActivationFunction::ReLu, ActivationPrecision::Exact>;
+    } else if (af == ActivationFunction::SoftMax) {
+        return fast ? activateLayer<ActivationFunction::SoftMax, ActivationPrecision::Fast>
+                    : activateLayer<ActivationFunction::SoftMax, ActivationPrecision::Exact>;
+    } else {
+        return fast ? activateLayer<ActivationFunction::Sigmoid, ActivationPrecision::Fast>
+                    : activateLayer<ActivationFunction::Sigmoid, ActivationPrecision::Exact>;
+    }
+}
+
+static DerivativeKernel derivativeKernelFor(ActivationFunction af) {
+    if (af == ActivationFunction::ReLu) {
+        return multiplyDerivative<ActivationFunction::ReLu>;
+    } else if (af == ActivationFunction::SoftMax) {
+        return multiplyDerivative<ActivationFunction::SoftMax>;
+    } else {
+        return multiplyDerivative<ActivationFunction::Sigmoid>;
+    }
+}
+
+static OutputErrorKernel outputErrorKernelFor(ActivationFunction af, ErrorFunction ef, ActivationPrecision precision) {
+    if (ef == ErrorFunction::CrossEntropy) {
+        if (af == ActivationFunction::ReLu) {
+            return computeOutputErrors<ActivationFunction::ReLu, ErrorFunction::CrossEntropy>;
+        } else if (af == ActivationFunction::SoftMax) {
+            return precision == ActivationPrecision::Fast ? computeSoftMaxCrossEntropy<ActivationPrecision::Fast>
+                                                          : computeSoftMaxCrossEntropy<ActivationPrecision::Exact>;
+        } else {
+            return computeOutputErrors<ActivationFunction::Sigmoid, ErrorFunction::CrossEntropy>;
+        }
+    } else {
+        if (af == ActivationFunction::ReLu) {
+            return computeOutputErrors<ActivationFunction::ReLu, ErrorFunction::SumSquared>;
+        } else if (af == ActivationFunction::SoftMax) {
+            return computeOutputErrors<ActivationFunction::SoftMax, ErrorFunction::SumSquared>;
+        } else {
+            return computeOutputErrors<ActivationFunction::Sigmoid, ErrorFunction::SumSquared>;
+        }
+    }
+}
+
+
+/*
+ * The storage format of the reduced weight precisions
+ */
+static HalfFormat halfFormatFor(WeightPrecision weightPrecision) {
+    return weightPrecision == WeightPrecision::BFloat16 ? HalfFormat::BFloat16 : HalfFormat::Float16;
+}
+
+
+DenseLayer::DenseLayer(int numInputs, int numNodes, ActivationFunction activationFunction):
+                       numInputs(numInputs),
+                       numNodes(numNodes),
+                       inputStride(paddedStride(numInputs)),
+                       nodeStride(paddedStride(numNodes)),
+                       activationFunction(activationFunction),
+                       activate(nullptr),
+                       multiplyDerivative(nullptr) {
+    nodes.resize(numNodes);
+    deltas.resize(numNodes);
+    weights.resize(numNodes * inputStride);
+    biases.resize(numNodes);
+    weightsChanges.resize(numNodes * inputStride);
+    biasesChanges.resize(numNodes);
+    weightsSquares.resize(numNodes * inputStride);
+    biasesSquares.resize(numNodes);
+}
+
+
+Gradients::Gradients(const std::vector<int> &layerSizes):
+                     count(0),
+                     errorSum(0.0),
+                     capacity(0) {
+    int numLayers = layerSizes.size() - 1;
+    weights.resize(numLayers);
+    biases.resize(numLayers);
+    nodes.resize(numLayers);
+    deltas.resize(numLayers);
+    for (int l = 0; l < numLayers; l++) {
+        weights[l].resize(layerSizes[l + 1] * paddedStride(layerSizes[l]));
+        biases[l].resize(layerSizes[l + 1]);
+        nodeStrides.push_back(paddedStride(layerSizes[l + 1]));
+    }
+}
+
+
+Activations::Activations(const std::vector<int> &layerSizes):
+                         layerSizes(layerSizes),
+                         capacity(0) {
+    int numHiddenLayers = layerSizes.size() - 2;
+    nodes.resize(numHiddenLayers);
+    for (int l = 0; l < numHiddenLayers; l++) {
+        nodeStrides.push_back(paddedStride(layerSizes[l + 1]));
+    }
+}
+
+
+/*
+ * Make sure the scratch space can hold at least batchSize examples
+ */
+void Activations::reserve(int batchSize) {
+    if (batchSize <= capacity) {
+        return;
+    }
+    capacity = batchSize;
+    for (int l = 0; l < nodes.size(); l++) {
+        nodes[l].resize(batchSize * nodeStrides[l]);
+    }
+}
+
+
+/*
+ * Make sure the scratch space can hold at least batchSize examples
+ */
+void Gradients::reserve(int batchSize) {
+    if (batchSize <= capacity) {
+        return;
+    }
+    capacity = batchSize;
+    for (int l = 0; l < nodeStrides.size(); l++) {
+        nodes[l].resize(batchSize * nodeStrides[l]);
+        deltas[l].resize(batchSize * nodeStrides[l]);
+    }
+}
+
+
+/*
+ * Set slice part (of numParts) of these gradients to the sum of the same slice of each of the
+ * given gradients. They are always added in the order given, so the result does not depend on
+ * how the slices are shared between threads. Part 0 also sums the example counts and errors.
+ */
+void Gradients::sum(const std::vector<Gradients> &gradients, int part, int numParts) {
+    for (int l = 0; l < weights.size(); l++) {
+        sumSlice(weights[l], gradients, &Gradients::weights, l, part, numParts);
+        sumSlice(biases[l], gradients, &Gradients::biases, l, part, numParts);
+    }
+    if (part == 0) {
+        count = 0;
+        errorSum = 0.0;
+        for (int g = 0; g < gradients.size(); g++) {
+            count += gradients[g].count;
+            errorSum += gradients[g].errorSum;
+        }
+    }
+}
+
 
 Network_L::Network_L(int numInputNodes,
                      int numHiddenNodes,
@@ -17,13 +415,24 @@ Network_L::Network_L(int numInputNodes,
                      float momentum,
                      float initialWeightMax,
                      long trainingCycle):
-                     numInputNodes(numInputNodes),
-                     numHiddenNodes(numHiddenNodes),
-                     numOutputNodes(numOutputNodes),
+                     Network_L(std::vector<int>{numInputNodes, numHiddenNodes, numOutputNodes},
+                               learningRate, momentum, initialWeightMax, trainingCycle) {
+}
+
+
+Network_L::Network_L(const std::vector<int> &layerSizes,
+                     float learningRate,
+                     float momentum,
+                     float initialWeightMax,
+                     long trainingCycle):
+                     numInputNodes(layerSizes.front()),
+                     numOutputNodes(layerSizes.back()),
                      learningRate(learningRate),
                      momentum(momentum),
                      initialWeightMax(initialWeightMax),
                      trainingCycle(trainingCycle),
+                     batchActivations(layerSizes),
+                     batchGradients(layerSizes),
                      m_mt(std::random_device()()) {
 
     dist = std::uniform_real_distribution<float>(-1.0f, 1.0f);
@@ -32,224 +441,582 @@ Network_L::Network_L(int numInputNodes,
     errorRate = 0.0;
     accumulatedInput = 0.0f;
 
-    hiddenActivationFunction = ActivationFunction::Sigmoid;
-    outputActivationFunction = ActivationFunction::Sigmoid;
     errorFunction = ErrorFunction::SumSquared;
+    activationPrecision = ActivationPrecision::Exact;
+    optimizer = Optimizer::Momentum;
+    optimizerSteps = 0;
+    weightPrecision = WeightPrecision::Float32;
 
-    hiddenNodes.resize(numHiddenNodes);
-    outputNodes.resize(numOutputNodes);
-
-    hiddenWeights.resize(numInputNodes+1, std::vector<float>(numHiddenNodes));
-    outputWeights.resize(numHiddenNodes+1, std::vector<float>(numOutputNodes));
-
-    hiddenNodesDeltas.resize(numHiddenNodes);
-    outputNodesDeltas.resize(numOutputNodes);
+    for (int l = 1; l < layerSizes.size(); l++) {
+        layers.push_back(DenseLayer(layerSizes[l - 1], layerSizes[l], ActivationFunction::Sigmoid));
+    }
 
-    hiddenWeightsChanges.resize(numInputNodes+1, std::vector<float>(numHiddenNodes));
-    outputWeightsChanges.resize(numHiddenNodes+1, std::vector<float>(numOutputNodes));
+    selectKernels();
 
-    initialiseHiddenWeights();
-    initialiseOutputWeights();
+    for (int l = 0; l < layers.size(); l++) {
+        initialiseWeights(layers[l]);
+    }
 }
 
 
 /*
- * Initialise hiddenWeights to random values
- * Initialise hiddenWeightsChanges to zero
+ * Initialise the weights of a layer to random values
+ * Initialise its weight changes to zero
  * Use when setting up a new, untrained network
  */
-void Network_L::initialiseHiddenWeights() {
-    for (int i = 0; i < numHiddenNodes; i++) {
-        for (int j = 0; j <= numInputNodes; j++) {
-            hiddenWeightsChanges[j][i] = 0.0;
+void Network_L::initialiseWeights(DenseLayer &layer) {
+    for (int i = 0; i < layer.numNodes; i++) {
+        float *weights = &layer.weights[i * layer.inputStride];
+        float *changes = &layer.weightsChanges[i * layer.inputStride];
+        for (int j = 0; j < layer.numInputs; j++) {
+            changes[j] = 0.0;
             randomFloat = dist(m_mt);
-            hiddenWeights[j][i] = randomFloat * initialWeightMax;
+            weights[j] = randomFloat * initialWeightMax;
         }
+        layer.biasesChanges[i] = 0.0;
+        randomFloat = dist(m_mt);
+        layer.biases[i] = randomFloat * initialWeightMax;
     }
 }
 
 
 /*
- * Initialise outputWeights to random values
- * Initialise outputWeightsChanges to zero
- * Use when setting up a new, untrained network
+ * Train the network on a single pattern and return the error rate post training
  */
-void Network_L::initialiseOutputWeights() {
-    for(int i = 0 ; i < numOutputNodes ; i ++ ) {
-        for(int j = 0 ; j <= numHiddenNodes ; j++ ) {
-            outputWeightsChanges[j][i] = 0.0 ;
-            randomFloat = dist(m_mt);
-            outputWeights[j][i] = randomFloat * initialWeightMax ;
-        }
-    }
+float Network_L::trainNetwork(const std::vector<float> &inputs, const std::vector<float> &targets) {
+    return trainNetwork(inputs.data(), inputs.size(), targets.data(), targets.size());
 }
 
 
 /*
- * Train the network on a single pattern and return the error rate post training
+ * Train the network on a single pattern held in caller-owned memory, and return the error rate
+ * post training. Makes no heap allocations.
+ * Returns -1 without training if the lengths given do not match the network.
  */
-float Network_L::trainNetwork(std::vector<float> inputs, std::vector<float> targets) {
+float Network_L::trainNetwork(const float *inputs, int numInputs, const float *targets, int numTargets) {
+    if (numInputs != numInputNodes || numTargets != numOutputNodes) {
+        std::cout << "Pattern size " << numInputs << " -> " << numTargets << " does not match network\n";
+        return -1.0f;
+    }
+    if (optimizer != Optimizer::Momentum && weightPrecision != WeightPrecision::Float32) {
+        // Only named on failure, so that training makes no heap allocations
+        checkFloat32Weights(("The " + optimizerToString(optimizer) + " optimizer").c_str());
+        return -1.0f;
+    }
+
     errorRate = 0.0f;
     accumulatedInput = 0.0f;
 
-    computeHiddenLayerActivations(inputs);
-    computeOutputLayerActivations();
+    // The output layer may be activated along with its errors instead
+    const float *layerInputs = inputs;
+    for (int l = 0; l < layers.size(); l++) {
+        computeLayerActivations(layers[l], layerInputs, l < layers.size() - 1 || !outputsActivatedByErrors);
+        layerInputs = layers[l].nodes.data();
+    }
 
     computeErrors(targets);
-    backpropagateErrors();
+    if (optimizer == Optimizer::Momentum) {
+        // Each layer's weights are walked once, backpropagating and updating together
+        for (int l = layers.size() - 1; l > 0; l--) {
+            backpropagateAndUpdateWeights(layers[l], layers[l - 1]);
+        }
+        updateWeights(layers[0], inputs);
+    } else {
+        for (int l = layers.size() - 1; l > 0; l--) {
+            backpropagateErrors(layers[l], layers[l - 1]);
+        }
 
-    updateHiddenWeights(inputs);
-    updateOutputWeights();
+        // The other optimizers need each weight's gradient, so form them in the trainBatch scratch
+        layerInputs = inputs;
+        for (int l = 0; l < layers.size(); l++) {
+            computeLayerGradients(l, layerInputs);
+            layerInputs = layers[l].nodes.data();
+        }
+        batchGradients.count = 1;
+        applyGradients(batchGradients);
+    }
 
     trainingCycle++;
+    optimizerSteps++;
 
     return errorRate;
 }
 
 
 /*
- * Compute the activation for a single node using the selected activation function
+ * Train the network on a single sparse pattern and return the error rate post training
  */
+float Network_L::trainNetwork(const SparseInputs &inputs, const std::vector<float> &targets) {
+    if (inputs.indexes.size() != inputs.values.size()) {
+        std::cout << "Sparse pattern has " << inputs.indexes.size() << " indexes but "
+                  << inputs.values.size() << " values\n";
+        return -1.0f;
+    }
+    return trainNetwork(inputs.indexes.data(), inputs.values.data(), inputs.indexes.size(),
+                        targets.data(), targets.size());
+}
 
-float Network_L::computeActivation(float accumulatedInput, ActivationFunction af) {
-    if (af == ActivationFunction::Sigmoid) {
-        return float(1.0/(1.0 + exp(-accumulatedInput))) ;
-    } else if (af == ActivationFunction::ReLu) {
-        return std::max(0.0f, accumulatedInput);
-    } else if (af == ActivationFunction::SoftMax) {
-        return exp(accumulatedInput);
+
+/*
+ * Train the network on a single pattern given as its numNonZeros non-zero values and their
+ * increasing indexes, and return the error rate post training. The first layer's activations
+ * and weight updates only visit the non-zero inputs.
+ *
+ * With the Momentum optimizer only the weights of the non-zero inputs are updated, so the
+ * momentum of the other weights waits until their input is next non-zero, as in the sparse
+ * momentum updates of other frameworks. This is exactly the dense update when the momentum is 0.
+ * The other optimizers update every weight, exactly as for the dense pattern.
+ *
+ * Returns -1 without training if the indexes or target length do not match the network.
+ */
+float Network_L::trainNetwork(const int *indexes, const float *values, int numNonZeros,
+                              const float *targets, int numTargets) {
+    if (numTargets != numOutputNodes) {
+        std::cout << "Pattern size " << numNonZeros << " non-zeros -> " << numTargets << " does not match network\n";
+        return -1.0f;
+    }
+    if (!checkSparseInputs(indexes, numNonZeros) || !checkFloat32Weights("Sparse training")) {
+        return -1.0f;
+    }
+
+    errorRate = 0.0f;
+    accumulatedInput = 0.0f;
+
+    computeSparseLayerActivations(layers[0], indexes, values, numNonZeros);
+    for (int l = 1; l < layers.size(); l++) {
+        computeLayerActivations(layers[l], layers[l - 1].nodes.data(), l < layers.size() - 1 || !outputsActivatedByErrors);
+    }
+
+    computeErrors(targets);
+    if (optimizer == Optimizer::Momentum) {
+        for (int l = layers.size() - 1; l > 0; l--) {
+            backpropagateAndUpdateWeights(layers[l], layers[l - 1]);
+        }
+        updateSparseWeights(layers[0], indexes, values, numNonZeros);
     } else {
-        // Default to linear if for some reason activation is not specified
-        return accumulatedInput;
+        for (int l = layers.size() - 1; l > 0; l--) {
+            backpropagateErrors(layers[l], layers[l - 1]);
+        }
+
+        // Only the non-zero inputs have a first layer gradient
+        DenseLayer &first = layers[0];
+        std::fill(batchGradients.weights[0].begin(), batchGradients.weights[0].end(), 0.0f);
+        for (int i = 0; i < first.numNodes; i++) {
+            float *gradients = &batchGradients.weights[0][i * first.inputStride];
+            for (int k = 0; k < numNonZeros; k++) {
+                gradients[indexes[k]] = first.deltas[i] * values[k];
+            }
+            batchGradients.biases[0][i] = first.deltas[i];
+        }
+        for (int l = 1; l < layers.size(); l++) {
+            computeLayerGradients(l, layers[l - 1].nodes.data());
+        }
+        batchGradients.count = 1;
+        applyGradients(batchGradients);
+    }
+
+    trainingCycle++;
+    optimizerSteps++;
+
+    return errorRate;
+}
+
+
+/*
+ * Train the network on a mini-batch of patterns and return the mean error rate post training.
+ *
+ * inputs holds batchSize rows of numInputNodes values and targets holds batchSize rows of
+ * numOutputNodes values, both contiguous. The forward pass, backpropagation and gradient
+ * computation are each done as a single matrix-matrix product per layer over the whole batch,
+ * and then one momentum update is applied using the gradients averaged over the batch.
+ */
+float Network_L::trainBatch(const float *inputs, const float *targets, int batchSize) {
+    if (batchSize <= 0) {
+        return 0.0f;
     }
+    if (!checkFloat32Weights("Batch training")) {
+        return -1.0f;
+    }
+    computeGradients(inputs, targets, batchSize, batchGradients);
+    applyGradients(batchGradients);
+    recordTraining(batchGradients);
+    return errorRate;
 }
 
+
 /*
- * Compute the activations of the hidden layer nodes from the given inputs
+ * Compute the weight gradients summed over a mini-batch of patterns, laid out as for trainBatch,
+ * and store them in gradients along with the summed error. The network itself is not modified,
+ * so several threads may call this at once as long as each passes its own gradients.
  */
-void Network_L::computeHiddenLayerActivations(std::vector<float> inputs) {
-    float sumHidden = 0;
-    for(int i = 0 ; i < numHiddenNodes; i++ ) {
-        accumulatedInput = hiddenWeights[numInputNodes][i] ;
-        for(int j = 0 ; j < numInputNodes; j++ ) {
-            accumulatedInput += inputs[j] * hiddenWeights[j][i] ;
+void Network_L::computeGradients(const float *inputs, const float *targets, int batchSize,
+                                 Gradients &gradients) const {
+    gradients.count = 0;
+    gradients.errorSum = 0.0;
+    if (!checkFloat32Weights("Computing gradients")) {
+        return;
+    }
+    gradients.reserve(batchSize);
+    gradients.count = batchSize;
+
+    int last = layers.size() - 1;
+    const DenseLayer &outputLayer = layers[last];
+    computeBatchActivations(inputs, batchSize, gradients.nodes, gradients.nodes[last].data(), outputLayer.nodeStride,
+                            !outputsActivatedByErrors);
+
+    // Output errors
+    for (int r = 0; r < batchSize; r++) {
+        const float *target = targets + r * numOutputNodes;
+        float *output = &gradients.nodes[last][r * outputLayer.nodeStride];
+        float *delta = &gradients.deltas[last][r * outputLayer.nodeStride];
+        gradients.errorSum += computeOutputErrors(target, output, delta, numOutputNodes);
+    }
+
+    // Backpropagate down through the hidden layers
+    for (int l = last; l > 0; l--) {
+        const DenseLayer &layer = layers[l];
+        const DenseLayer &previous = layers[l - 1];
+        multiplyAB(gradients.deltas[l].data(), layer.nodeStride, layer.weights.data(), layer.inputStride,
+                   gradients.deltas[l - 1].data(), previous.nodeStride, batchSize, layer.numInputs, layer.numNodes);
+        for (int r = 0; r < batchSize; r++) {
+            const float *hidden = &gradients.nodes[l - 1][r * previous.nodeStride];
+            float *delta = &gradients.deltas[l - 1][r * previous.nodeStride];
+            previous.multiplyDerivative(delta, hidden, previous.numNodes);
         }
-        hiddenNodes[i] = computeActivation(accumulatedInput, hiddenActivationFunction);
-        sumHidden += hiddenNodes[i];
     }
-    // If we're using SoftMax then we need to divide each output node's output by their sum
-    if (hiddenActivationFunction == ActivationFunction::SoftMax) {
-        for (int i = 0; i < numHiddenNodes; i++) {
-            hiddenNodes[i] = hiddenNodes[i] / sumHidden;
+
+    // Sum the gradients over the batch
+    for (int l = 0; l <= last; l++) {
+        const DenseLayer &layer = layers[l];
+        const float *layerInputs = l == 0 ? inputs : gradients.nodes[l - 1].data();
+        int layerInputsStride = l == 0 ? numInputNodes : layers[l - 1].nodeStride;
+        multiplyAtB(gradients.deltas[l].data(), layer.nodeStride, layerInputs, layerInputsStride,
+                    gradients.weights[l].data(), layer.inputStride, layer.numNodes, layer.numInputs, batchSize);
+
+        std::fill(gradients.biases[l].begin(), gradients.biases[l].end(), 0.0f);
+        for (int r = 0; r < batchSize; r++) {
+            axpy(1.0f, &gradients.deltas[l][r * layer.nodeStride], gradients.biases[l].data(), layer.numNodes);
         }
     }
 }
 
 
 /*
- * Compute the activations of the output layer nodes from the current state of the hidden nodes,
- * then compute the output errors and overall error rate
+ * Apply one step of the selected optimizer using gradients averaged over the examples they were
+ * summed from.
+ *
+ * The weights of each layer are split into numParts slices on cache line boundaries and only
+ * slice part is updated, so that numParts threads can apply one set of gradients together.
+ * Does not touch the training cycle or error rate; see recordTraining.
+ */
+void Network_L::applyGradients(const Gradients &gradients, int part, int numParts) {
+    if (gradients.count <= 0 || !checkFloat32Weights("Applying gradients")) {
+        return;
+    }
+    // RMSProp and Adam divide each step by the size of the gradient, so they need no averaging
+    float rate = learningRate / gradients.count;
+    if (optimizer == Optimizer::RMSProp || optimizer == Optimizer::Adam) {
+        rate = learningRate;
+    }
+    for (int l = 0; l < layers.size(); l++) {
+        DenseLayer &layer = layers[l];
+        updateParameters(layer.weights, layer.weightsChanges, layer.weightsSquares, gradients.weights[l],
+                         rate, part, numParts);
+        updateParameters(layer.biases, layer.biasesChanges, layer.biasesSquares, gradients.biases[l],
+                         rate, part, numParts);
+    }
+}
+
+
+/*
+ * Apply one step of the selected optimizer to slice part of a flat parameter buffer.
+ * changes holds the momentum (or Adam's first moment) and squares the mean squared gradient.
  */
-void Network_L::computeOutputLayerActivations() {
-    float sumOutputs = 0;
-    for(int i = 0; i < numOutputNodes; i++ ) {
-        accumulatedInput = outputWeights[numHiddenNodes][i] ;
-        for(int j = 0; j < numHiddenNodes; j++ ) {
-            accumulatedInput += hiddenNodes[j] * outputWeights[j][i] ;
+void Network_L::updateParameters(AlignedVector &weights, AlignedVector &changes, AlignedVector &squares,
+                                 const AlignedVector &gradients, float rate, int part, int numParts) {
+    int begin, end;
+    sliceBounds(weights.size(), part, numParts, begin, end);
+    if (begin >= end) {
+        return;
+    }
+    int n = end - begin;
+    if (optimizer == Optimizer::Momentum) {
+        momentumUpdate(&weights[begin], &changes[begin], &gradients[begin], rate, momentum, n);
+    } else if (optimizer == Optimizer::Nesterov) {
+        nesterovUpdate(&weights[begin], &changes[begin], &gradients[begin], rate, momentum, n);
+    } else if (optimizer == Optimizer::RMSProp) {
+        rmsPropUpdate(&weights[begin], &squares[begin], &gradients[begin], rate, rmsPropDecay, optimizerEpsilon, n);
+    } else if (optimizer == Optimizer::Adam) {
+        double step = optimizerSteps + 1;
+        float correctedRate = float(rate * std::sqrt(1.0 - std::pow(adamBeta2, step)) / (1.0 - std::pow(adamBeta1, step)));
+        adamUpdate(&weights[begin], &changes[begin], &squares[begin], &gradients[begin],
+                   correctedRate, adamBeta1, adamBeta2, optimizerEpsilon, n);
+    }
+}
+
+
+/*
+ * Advance the training cycle by the number of examples in gradients, and record their mean error.
+ * Call once per applied set of gradients, after every part has been applied.
+ */
+void Network_L::recordTraining(const Gradients &gradients) {
+    if (gradients.count <= 0) {
+        return;
+    }
+    trainingCycle += gradients.count;
+    optimizerSteps++;
+    errorRate = gradients.errorSum / gradients.count;
+}
+
+
+/*
+ * Forward pass for a batch of examples. Writes the activations of hidden layer l to nodes[l], one
+ * row of that layer's nodeStride values per example, and the output activations to outputs, one
+ * row of outputsStride values per example. Without activateOutputs the output layer's accumulated
+ * inputs are written instead.
+ */
+void Network_L::computeBatchActivations(const float *inputs, int batchSize, std::vector<AlignedVector> &nodes,
+                                        float *outputs, int outputsStride, bool activateOutputs) const {
+    const float *layerInputs = inputs;
+    int layerInputsStride = numInputNodes;
+    for (int l = 0; l < layers.size(); l++) {
+        const DenseLayer &layer = layers[l];
+        bool isOutput = l == layers.size() - 1;
+        float *layerNodes = isOutput ? outputs : nodes[l].data();
+        int layerNodesStride = isOutput ? outputsStride : layer.nodeStride;
+
+        multiplyABt(layerInputs, layerInputsStride, layer.weights.data(), layer.inputStride, layer.biases.data(),
+                    layerNodes, layerNodesStride, batchSize, layer.numNodes, layer.numInputs);
+        for (int r = 0; r < batchSize && (activateOutputs || !isOutput); r++) {
+            layer.activate(layerNodes + r * layerNodesStride, layer.numNodes);
         }
-        outputNodes[i] = computeActivation(accumulatedInput, outputActivationFunction);
-        sumOutputs += outputNodes[i];
+
+        layerInputs = layerNodes;
+        layerInputsStride = layerNodesStride;
+    }
+}
+
+
+/*
+ * Choose each layer's activation and derivative kernels, and the output error kernel, for the
+ * current activation functions, error function and precision. Called whenever any of them change.
+ */
+void Network_L::selectKernels() {
+    for (int l = 0; l < layers.size(); l++) {
+        layers[l].activate = activationKernelFor(layers[l].activationFunction, activationPrecision);
+        layers[l].multiplyDerivative = derivativeKernelFor(layers[l].activationFunction);
     }
-    // If using SoftMax then it is necessary to divide each output node's output by their sum
-    if (outputActivationFunction == ActivationFunction::SoftMax) {
-        for (int i = 0; i < numOutputNodes; i++) {
-            outputNodes[i] = outputNodes[i] / sumOutputs;
+    computeOutputErrors = outputErrorKernelFor(layers.back().activationFunction, errorFunction, activationPrecision);
+    outputsActivatedByErrors = layers.back().activationFunction == ActivationFunction::SoftMax
+                               && errorFunction == ErrorFunction::CrossEntropy;
+}
+
+
+/*
+ * Compute the activations of a layer's nodes from the given inputs, which are either the
+ * network inputs or the nodes of the layer below. Without activate the nodes are left holding
+ * their accumulated inputs.
+ */
+void Network_L::computeLayerActivations(DenseLayer &layer, const float *inputs, bool activate) {
+    if (weightPrecision == WeightPrecision::Float32) {
+        for(int i = 0 ; i < layer.numNodes; i++ ) {
+            const float *weights = &layer.weights[i * layer.inputStride];
+            accumulatedInput = layer.biases[i] + dotProduct(inputs, weights, layer.numInputs);
+            layer.nodes[i] = accumulatedInput;
+        }
+    } else {
+        HalfFormat format = halfFormatFor(weightPrecision);
+        for(int i = 0 ; i < layer.numNodes; i++ ) {
+            const uint16_t *weights = &layer.halfWeights[i * layer.inputStride];
+            accumulatedInput = layer.biases[i] + dotProductHalf(inputs, weights, layer.numInputs, format);
+            layer.nodes[i] = accumulatedInput;
         }
     }
+    if (activate) {
+        layer.activate(layer.nodes.data(), layer.numNodes);
+    }
 }
 
 
 /*
- *  Compute the delta for a single output node
+ *  Compute the errors for the output layer, activating it first if outputsActivatedByErrors
  */
-float Network_L::computeDelta(float target, float output) {
-    if (outputActivationFunction == ActivationFunction::Sigmoid
-            && errorFunction == ErrorFunction::SumSquared) {
-        return (target - output) * output * (1.0f - output);
-    } else if (outputActivationFunction == ActivationFunction::ReLu
-               || errorFunction == ErrorFunction::CrossEntropy) {
-        return target - output;
+void Network_L::computeErrors(const float *targets) {
+    DenseLayer &outputLayer = layers.back();
+    errorRate += computeOutputErrors(targets, outputLayer.nodes.data(), outputLayer.deltas.data(), numOutputNodes);
+}
+
+
+/*
+ *  Backpropagate the errors of a layer to the layer below it.
+ *  The weighted sums are accumulated into the lower layer's deltas one row at a time,
+ *  so that the layer's weights are walked in storage order.
+ */
+void Network_L::backpropagateErrors(const DenseLayer &layer, DenseLayer &previous) {
+    std::fill(previous.deltas.begin(), previous.deltas.end(), 0.0f);
+    for(int j = 0 ; j < layer.numNodes ; j++ ) {
+        axpy(layer.deltas[j], &layer.weights[j * layer.inputStride], previous.deltas.data(), layer.numInputs);
     }
+    previous.multiplyDerivative(previous.deltas.data(), previous.nodes.data(), previous.numNodes);
 }
 
 
 /*
- *  Compute the error rate using the selected error function
+ *  Backpropagate the errors of a layer to the layer below it and take a momentum step on its
+ *  weights, in a single pass over them. Each row of weights is used for the lower deltas before
+ *  it is updated, so the results are exactly those of backpropagateErrors then updateWeights.
  */
-float Network_L::computeErrorRate(float target, float output) {
-    if (errorFunction == ErrorFunction::SumSquared) {
-        return 0.5 * (target - output) * (target - output);
-    } else if (errorFunction == ErrorFunction::CrossEntropy) {
-        return -1.0 * (target * log(output) + (1.0f - target) * log(1.0f - output));
+void Network_L::backpropagateAndUpdateWeights(DenseLayer &layer, DenseLayer &previous) {
+    std::fill(previous.deltas.begin(), previous.deltas.end(), 0.0f);
+    for(int i = 0 ; i < layer.numNodes ; i++ ) {
+        layer.biasesChanges[i] = learningRate * layer.deltas[i] + momentum * layer.biasesChanges[i] ;
+        layer.biases[i] += layer.biasesChanges[i] ;
+        if (weightPrecision == WeightPrecision::Float32) {
+            backpropagateMomentumUpdate(&layer.weights[i * layer.inputStride], &layer.weightsChanges[i * layer.inputStride],
+                                        previous.nodes.data(), previous.deltas.data(),
+                                        layer.deltas[i], learningRate * layer.deltas[i], momentum, layer.numInputs);
+        } else {
+            backpropagateMomentumUpdateHalf(&layer.halfWeights[i * layer.inputStride],
+                                            &layer.halfWeightsChanges[i * layer.inputStride],
+                                            previous.nodes.data(), previous.deltas.data(),
+                                            layer.deltas[i], learningRate * layer.deltas[i], momentum, m_mt(),
+                                            layer.numInputs, halfFormatFor(weightPrecision));
+        }
     }
+    previous.multiplyDerivative(previous.deltas.data(), previous.nodes.data(), previous.numNodes);
 }
 
 
 /*
- *  Compute the errors for the output layer
+ *  Using the backpropagated errors, update the weights of a layer given the inputs it saw
  */
-void Network_L::computeErrors(std::vector<float> targets) {
-    for(int i = 0 ; i < numOutputNodes ; i++ ) {
-        outputNodesDeltas[i] = computeDelta(targets[i], outputNodes[i]);
-        errorRate += computeErrorRate(targets[i], outputNodes[i]);
+void Network_L::updateWeights(DenseLayer &layer, const float *inputs) {
+    for(int i = 0 ; i < layer.numNodes ; i++ ) {
+        layer.biasesChanges[i] = learningRate * layer.deltas[i] + momentum * layer.biasesChanges[i] ;
+        layer.biases[i] += layer.biasesChanges[i] ;
+        if (weightPrecision == WeightPrecision::Float32) {
+            momentumUpdate(&layer.weights[i * layer.inputStride], &layer.weightsChanges[i * layer.inputStride], inputs,
+                           learningRate * layer.deltas[i], momentum, layer.numInputs);
+        } else {
+            momentumUpdateHalf(&layer.halfWeights[i * layer.inputStride], &layer.halfWeightsChanges[i * layer.inputStride],
+                               inputs, learningRate * layer.deltas[i], momentum, m_mt(), layer.numInputs,
+                               halfFormatFor(weightPrecision));
+        }
     }
 }
 
 
 /*
- *  Backpropagate the output layer errors to the hidden layer
+ *  Compute the activations of the first layer from a sparse input pattern, gathering only the
+ *  weights of the non-zero inputs
  */
-void Network_L::backpropagateErrors() {
-    for(int i = 0 ; i < numHiddenNodes ; i++ ) {
-        accumulatedInput = 0.0 ;
-        for(int j = 0 ; j < numOutputNodes ; j++ ) {
-            accumulatedInput += outputWeights[i][j] * outputNodesDeltas[j];
+void Network_L::computeSparseLayerActivations(DenseLayer &layer, const int *indexes, const float *values,
+                                              int numNonZeros) {
+    for(int i = 0 ; i < layer.numNodes; i++ ) {
+        const float *weights = &layer.weights[i * layer.inputStride];
+        float sum = 0.0f;
+        for (int k = 0; k < numNonZeros; k++) {
+            sum += values[k] * weights[indexes[k]];
         }
-        hiddenNodesDeltas[i] = float(accumulatedInput * hiddenNodes[i] * (1.0 - hiddenNodes[i])) ;
+        accumulatedInput = layer.biases[i] + sum;
+        layer.nodes[i] = accumulatedInput;
     }
+    layer.activate(layer.nodes.data(), layer.numNodes);
 }
 
 
 /*
- *  Using the backpropagated errors, update the weights of the hidden nodes
+ *  Take a momentum step on the first layer's biases and the weights of the non-zero inputs of
+ *  a sparse pattern, leaving the other weights and their changes untouched
  */
-void Network_L::updateHiddenWeights(std::vector<float> inputs) {
-    for(int i = 0 ; i < numHiddenNodes ; i++ ) {
-        hiddenWeightsChanges[numInputNodes][i] = learningRate * hiddenNodesDeltas[i] + momentum * hiddenWeightsChanges[numInputNodes][i] ;
-        hiddenWeights[numInputNodes][i] += hiddenWeightsChanges[numInputNodes][i] ;
-        for(int j = 0 ; j < numInputNodes ; j++ ) {
-            hiddenWeightsChanges[j][i] = learningRate * inputs[j] * hiddenNodesDeltas[i] + momentum * hiddenWeightsChanges[j][i];
-            hiddenWeights[j][i] += hiddenWeightsChanges[j][i] ;
+void Network_L::updateSparseWeights(DenseLayer &layer, const int *indexes, const float *values, int numNonZeros) {
+    for(int i = 0 ; i < layer.numNodes ; i++ ) {
+        layer.biasesChanges[i] = learningRate * layer.deltas[i] + momentum * layer.biasesChanges[i] ;
+        layer.biases[i] += layer.biasesChanges[i] ;
+        float *weights = &layer.weights[i * layer.inputStride];
+        float *changes = &layer.weightsChanges[i * layer.inputStride];
+        float rate = learningRate * layer.deltas[i];
+        for (int k = 0; k < numNonZeros; k++) {
+            int j = indexes[k];
+            changes[j] = rate * values[k] + momentum * changes[j];
+            weights[j] += changes[j];
         }
     }
 }
 
 
 /*
- *  Using the backpropagated errors, update the weights of the hidden nodes
+ *  Write a layer's weight and bias gradients for one example into the trainBatch scratch,
+ *  given the inputs it saw
  */
-void Network_L::updateOutputWeights() {
-    for(int i = 0 ; i < numOutputNodes ; i ++ ) {
-        outputWeightsChanges[numHiddenNodes][i] = learningRate * outputNodesDeltas[i] + momentum * outputWeightsChanges[numHiddenNodes][i] ;
-        outputWeights[numHiddenNodes][i] += outputWeightsChanges[numHiddenNodes][i] ;
-        for(int j = 0 ; j < numHiddenNodes ; j++ ) {
-            outputWeightsChanges[j][i] = learningRate * hiddenNodes[j] * outputNodesDeltas[i] + momentum * outputWeightsChanges[j][i] ;
-            outputWeights[j][i] += outputWeightsChanges[j][i] ;
+void Network_L::computeLayerGradients(int l, const float *inputs) {
+    DenseLayer &layer = layers[l];
+    for (int i = 0; i < layer.numNodes; i++) {
+        float *gradients = &batchGradients.weights[l][i * layer.inputStride];
+        for (int j = 0; j < layer.numInputs; j++) {
+            gradients[j] = layer.deltas[i] * inputs[j];
         }
+        batchGradients.biases[l][i] = layer.deltas[i];
     }
 }
 
 
+/*
+ *  Check that a sparse pattern's indexes are increasing and within the network's inputs
+ */
+bool Network_L::checkSparseInputs(const int *indexes, int numNonZeros) const {
+    for (int k = 0; k < numNonZeros; k++) {
+        if (indexes[k] < 0 || indexes[k] >= numInputNodes || (k > 0 && indexes[k] <= indexes[k - 1])) {
+            std::cout << "Sparse index " << indexes[k] << " is out of order or out of range for "
+                      << numInputNodes << " inputs\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+
+/*
+ *  Check that the weights are stored in Float32, which every method but trainNetwork on dense
+ *  patterns with Momentum, and the non-const classify, needs
+ */
+bool Network_L::checkFloat32Weights(const char *operation) const {
+    if (weightPrecision != WeightPrecision::Float32) {
+        std::cout << operation << " needs Float32 weights, not " << weightPrecisionToString(weightPrecision) << "\n";
+        return false;
+    }
+    return true;
+}
+
+
+/*
+ *  Check that activations were made for this network's layer sizes, so its rows are wide enough
+ */
+bool Network_L::checkActivations(const Activations &activations) const {
+    bool matches = activations.layerSizes.size() == layers.size() + 1 && activations.layerSizes[0] == numInputNodes;
+    for (int l = 0; matches && l < layers.size(); l++) {
+        matches = activations.layerSizes[l + 1] == layers[l].numNodes;
+    }
+    if (!matches) {
+        std::cout << "Activations were not made for this network's layer sizes\n";
+    }
+    return matches;
+}
+
+
+/*
+ *  A copy of a layer's weights, or their changes, in float whatever their precision
+ */
+AlignedVector Network_L::floatWeights(const AlignedVector &weights, const AlignedHalfVector &halfWeights) const {
+    if (weightPrecision == WeightPrecision::Float32) {
+        return weights;
+    }
+    AlignedVector expanded(halfWeights.size());
+    expandHalf(halfWeights.data(), expanded.data(), halfWeights.size(), halfFormatFor(weightPrecision));
+    return expanded;
+}
+
+
 /*
  * outputs the current training cycle and error rate as a string for display or logging
  */
@@ -260,23 +1027,177 @@ std::string Network_L::writeReport() {
 
 /*
  * Using the current state of the network, attempt to classify the given input pattern,
- * and return a pointer to an array containing the predicted output.
- * The desired output for the function must be passed in.
+ * and return a vector containing the predicted output.
  */
-std::vector<float> Network_L::classify(std::vector<float> inputs) {
-    computeHiddenLayerActivations(inputs);
-    computeOutputLayerActivations();
-    std::vector<float> classification= outputNodes;
+std::vector<float> Network_L::classify(const std::vector<float> &inputs) {
+    std::vector<float> classification(numOutputNodes);
+    classify(inputs.data(), inputs.size(), classification.data(), classification.size());
     return classification;
 }
 
 
 /*
- *  Set both sets of weights using pre calculated vectors.
+ * Using the current state of the network, attempt to classify the given input pattern,
+ * writing the predicted output into the caller-provided outputs buffer.
+ * Makes no heap allocations. Returns 0 on success, or 1 if the lengths given do not match the network.
+ */
+int Network_L::classify(const float *inputs, int numInputs, float *outputs, int numOutputs) {
+    if (numInputs != numInputNodes || numOutputs != numOutputNodes) {
+        std::cout << "Pattern size " << numInputs << " -> " << numOutputs << " does not match network\n";
+        return 1; // Error code
+    }
+    const float *layerInputs = inputs;
+    for (int l = 0; l < layers.size(); l++) {
+        computeLayerActivations(layers[l], layerInputs);
+        layerInputs = layers[l].nodes.data();
+    }
+    std::copy(layers.back().nodes.begin(), layers.back().nodes.end(), outputs);
+    return 0;
+}
+
+
+/*
+ * Using the current state of the network, attempt to classify the given sparse input pattern,
+ * and return a vector containing the predicted output.
+ */
+std::vector<float> Network_L::classify(const SparseInputs &inputs) {
+    std::vector<float> classification(numOutputNodes);
+    if (inputs.indexes.size() != inputs.values.size()) {
+        std::cout << "Sparse pattern has " << inputs.indexes.size() << " indexes but "
+                  << inputs.values.size() << " values\n";
+        return classification;
+    }
+    classify(inputs.indexes.data(), inputs.values.data(), inputs.indexes.size(),
+             classification.data(), classification.size());
+    return classification;
+}
+
+
+/*
+ * Classify a pattern given as its numNonZeros non-zero values and their increasing indexes,
+ * writing the predicted output into the caller-provided outputs buffer. The first layer only
+ * visits the non-zero inputs. Makes no heap allocations. Returns 0 on success, or 1 if the
+ * indexes or output length do not match the network.
+ */
+int Network_L::classify(const int *indexes, const float *values, int numNonZeros, float *outputs, int numOutputs) {
+    if (numOutputs != numOutputNodes) {
+        std::cout << "Pattern size " << numNonZeros << " non-zeros -> " << numOutputs << " does not match network\n";
+        return 1; // Error code
+    }
+    if (!checkSparseInputs(indexes, numNonZeros) || !checkFloat32Weights("Sparse classification")) {
+        return 1; // Error code
+    }
+    computeSparseLayerActivations(layers[0], indexes, values, numNonZeros);
+    for (int l = 1; l < layers.size(); l++) {
+        computeLayerActivations(layers[l], layers[l - 1].nodes.data());
+    }
+    std::copy(layers.back().nodes.begin(), layers.back().nodes.end(), outputs);
+    return 0;
+}
+
+
+/*
+ * As classify, but keeps the hidden activations in the caller's scratch space and leaves the
+ * network untouched, so that many threads can classify with one network at once.
+ * Makes no heap allocations once activations has been used. Returns 0 on success, or 1 if the
+ * lengths given or activations do not match the network.
+ */
+int Network_L::classify(const float *inputs, int numInputs, float *outputs, int numOutputs,
+                        Activations &activations) const {
+    if (numInputs != numInputNodes || numOutputs != numOutputNodes) {
+        std::cout << "Pattern size " << numInputs << " -> " << numOutputs << " does not match network\n";
+        return 1; // Error code
+    }
+    if (!checkFloat32Weights("Classifying with shared activations") || !checkActivations(activations)) {
+        return 1; // Error code
+    }
+    activations.reserve(1);
+    computeBatchActivations(inputs, 1, activations.nodes, outputs, numOutputNodes);
+    return 0;
+}
+
+
+/*
+ * Classify a contiguous block of batchSize input patterns (one row of numInputNodes values each),
+ * writing one row of numOutputNodes values per pattern into outputs.
+ * The block is scored classifyBlockSize examples at a time with tiled matrix products, so each
+ * weight row is loaded once per block and the hidden activations stay in cache.
+ * Returns 0 on success.
+ */
+int Network_L::classifyBatch(const float *inputs, int batchSize, float *outputs) {
+    return classifyBatch(inputs, batchSize, outputs, batchActivations);
+}
+
+
+/*
+ * As classifyBatch, but keeps the hidden activations in the caller's scratch space and leaves the
+ * network untouched, so that many threads can classify with one network at once.
+ * Returns 0 on success, or 1 if activations were not made for this network's layer sizes.
+ */
+int Network_L::classifyBatch(const float *inputs, int batchSize, float *outputs,
+                             Activations &activations) const {
+    if (!checkFloat32Weights("Batch classification") || !checkActivations(activations)) {
+        return 1; // Error code
+    }
+    const int classifyBlockSize = 64;
+    activations.reserve(std::min(batchSize, classifyBlockSize));
+    for (int first = 0; first < batchSize; first += classifyBlockSize) {
+        int blockSize = std::min(classifyBlockSize, batchSize - first);
+        computeBatchActivations(inputs + first * numInputNodes, blockSize, activations.nodes,
+                                outputs + first * numOutputNodes, numOutputNodes);
+    }
+    return 0;
+}
+
+
+/*
+ *  Set the weights of the first and last layers using pre calculated vectors.
  */
 void Network_L::loadWeights(std::vector<std::vector<float>> hiddenWeights, std::vector<std::vector<float>> outputWeights) {
-    setHiddenWeights(hiddenWeights);
-    setOutputWeights(outputWeights);
+    loadLayerWeights(0, hiddenWeights);
+    loadLayerWeights(layers.size() - 1, outputWeights);
+}
+
+
+/*
+ *  Set the weights of one layer using a pre calculated vector in the original code's
+ *  [input][node] layout, with the biases as the final row.
+ */
+void Network_L::loadLayerWeights(int layer, const std::vector<std::vector<float>> &weights) {
+    DenseLayer &target = layers[layer];
+    // Below Float32 the layer has no float weights, so they are flattened into scratch and rounded
+    AlignedVector scratch;
+    AlignedVector &rows = weightPrecision == WeightPrecision::Float32 ? target.weights : scratch;
+    rows.resize(target.numNodes * target.inputStride);
+    flattenWeights(weights, target.numInputs, target.numNodes, target.inputStride, rows, target.biases);
+    if (weightPrecision != WeightPrecision::Float32) {
+        roundToHalf(rows.data(), target.halfWeights.data(), rows.size(), halfFormatFor(weightPrecision));
+    }
+}
+
+
+/*
+ *  Set the weights of one layer from node-major rows of inputStride values, each holding a node's
+ *  input weights, and a separate bias per node, as the layer keeps them itself. Rows of the
+ *  layer's own stride are copied as one block.
+ */
+void Network_L::loadLayerWeights(int layer, const float *weights, int inputStride, const float *biases) {
+    DenseLayer &target = layers[layer];
+    AlignedVector scratch;
+    AlignedVector &rows = weightPrecision == WeightPrecision::Float32 ? target.weights : scratch;
+    rows.resize(target.numNodes * target.inputStride);
+    if (inputStride == target.inputStride) {
+        std::copy(weights, weights + target.numNodes * inputStride, rows.begin());
+    } else {
+        for (int i = 0; i < target.numNodes; i++) {
+            std::copy(weights + i * inputStride, weights + i * inputStride + target.numInputs,
+                      rows.begin() + i * target.inputStride);
+        }
+    }
+    std::copy(biases, biases + target.numNodes, target.biases.begin());
+    if (weightPrecision != WeightPrecision::Float32) {
+        roundToHalf(rows.data(), target.halfWeights.data(), rows.size(), halfFormatFor(weightPrecision));
+    }
 }
 
 int Network_L::getNumInputNodes() const {
@@ -285,7 +1206,7 @@ int Network_L::getNumInputNodes() const {
 
 
 int Network_L::getNumHiddenNodes() const {
-    return numHiddenNodes;
+    return layers.front().numNodes;
 }
 
 
@@ -294,6 +1215,20 @@ int Network_L::getNumOutputNodes() const {
 }
 
 
+int Network_L::getNumLayers() const {
+    return layers.size();
+}
+
+
+std::vector<int> Network_L::getLayerSizes() const {
+    std::vector<int> layerSizes(1, numInputNodes);
+    for (int l = 0; l < layers.size(); l++) {
+        layerSizes.push_back(layers[l].numNodes);
+    }
+    return layerSizes;
+}
+
+
 float Network_L::getLearningRate() const {
     return learningRate;
 }
@@ -325,12 +1260,17 @@ float Network_L::getAccumulatedInput() const {
 
 
 ActivationFunction Network_L::getHiddenActivationFunction() const {
-    return hiddenActivationFunction;
+    return layers.front().activationFunction;
 }
 
 
 ActivationFunction Network_L::getOutputActivationFunction() const {
-    return outputActivationFunction;
+    return layers.back().activationFunction;
+}
+
+
+ActivationFunction Network_L::getLayerActivationFunction(int layer) const {
+    return layers[layer].activationFunction;
 }
 
 
@@ -339,43 +1279,86 @@ ErrorFunction Network_L::getErrorFunction() const {
 }
 
 
+ActivationPrecision Network_L::getActivationPrecision() const {
+    return activationPrecision;
+}
+
+
+Optimizer Network_L::getOptimizer() const {
+    return optimizer;
+}
+
+
+WeightPrecision Network_L::getWeightPrecision() const {
+    return weightPrecision;
+}
+
+
 const std::vector<float> Network_L::getHiddenNodes() const {
-    return hiddenNodes;
+    return std::vector<float>(layers.front().nodes.begin(), layers.front().nodes.end());
 }
 
 
 const std::vector<float> Network_L::getOutputNodes() const {
-    return outputNodes;
+    return std::vector<float>(layers.back().nodes.begin(), layers.back().nodes.end());
+}
+
+
+const std::vector<float> Network_L::getLayerNodes(int layer) const {
+    return std::vector<float>(layers[layer].nodes.begin(), layers[layer].nodes.end());
 }
 
 
 const std::vector<float> Network_L::getHiddenNodesDeltas() const {
-    return hiddenNodesDeltas;
+    return std::vector<float>(layers.front().deltas.begin(), layers.front().deltas.end());
 }
 
 
 const std::vector<float> Network_L::getOutputNodesDeltas() const {
-    return outputNodesDeltas;
+    return std::vector<float>(layers.back().deltas.begin(), layers.back().deltas.end());
 }
 
 
 const std::vector<std::vector<float>> Network_L::getHiddenWeights() const {
-    return hiddenWeights;
+    return getLayerWeights(0);
 }
 
 
 const std::vector<std::vector<float>> Network_L::getOutputWeights() const {
-    return outputWeights;
+    return getLayerWeights(layers.size() - 1);
+}
+
+
+const std::vector<std::vector<float>> Network_L::getLayerWeights(int layer) const {
+    const DenseLayer &source = layers[layer];
+    return nestWeights(floatWeights(source.weights, source.halfWeights), source.biases,
+                       source.numInputs, source.numNodes, source.inputStride);
+}
+
+
+/*
+ * Copy one layer's weights as the layer keeps them, node-major rows of paddedStride(numInputs)
+ * values with zero padding, into weights, and its biases into biases
+ */
+void Network_L::copyLayerWeights(int layer, float *weights, float *biases) const {
+    const DenseLayer &source = layers[layer];
+    AlignedVector rows = floatWeights(source.weights, source.halfWeights);
+    std::copy(rows.begin(), rows.end(), weights);
+    std::copy(source.biases.begin(), source.biases.end(), biases);
 }
 
 
 const std::vector<std::vector<float>> Network_L::getHiddenWeightsChanges() const {
-    return hiddenWeightsChanges;
+    const DenseLayer &source = layers.front();
+    return nestWeights(floatWeights(source.weightsChanges, source.halfWeightsChanges), source.biasesChanges,
+                       source.numInputs, source.numNodes, source.inputStride);
 }
 
 
 const std::vector<std::vector<float>> Network_L::getOutputWeightsChanges() const {
-    return outputWeightsChanges;
+    const DenseLayer &source = layers.back();
+    return nestWeights(floatWeights(source.weightsChanges, source.halfWeightsChanges), source.biasesChanges,
+                       source.numInputs, source.numNodes, source.inputStride);
 }
 
 
@@ -390,27 +1373,92 @@ void Network_L::setMomentum(float momentum) {
 
 
 void Network_L::setHiddenActivationFunction(ActivationFunction activationFunction) {
-    Network_L::hiddenActivationFunction = activationFunction;
+    for (int l = 0; l < layers.size() - 1; l++) {
+        layers[l].activationFunction = activationFunction;
+    }
+    selectKernels();
 }
 
 
 void Network_L::setOutputActivationFunction(ActivationFunction activationFunction) {
-    Network_L::outputActivationFunction = activationFunction;
+    layers.back().activationFunction = activationFunction;
+    selectKernels();
+}
+
+
+void Network_L::setLayerActivationFunction(int layer, ActivationFunction activationFunction) {
+    layers[layer].activationFunction = activationFunction;
+    selectKernels();
 }
 
 
 void Network_L::setErrorFunction(ErrorFunction errorFunction) {
     Network_L::errorFunction = errorFunction;
+    selectKernels();
+}
+
+
+void Network_L::setActivationPrecision(ActivationPrecision activationPrecision) {
+    Network_L::activationPrecision = activationPrecision;
+    selectKernels();
 }
 
 
-void Network_L::setHiddenWeights(std::vector<std::vector<float>> hiddenWeights) {
-    Network_L::hiddenWeights = hiddenWeights;
+/*
+ * Switch the update rule. The state built up by the previous optimizer means something different
+ * to the new one, so it is cleared.
+ */
+void Network_L::setOptimizer(Optimizer optimizer) {
+    if (optimizer == Network_L::optimizer) {
+        return;
+    }
+    Network_L::optimizer = optimizer;
+    optimizerSteps = 0;
+    for (int l = 0; l < layers.size(); l++) {
+        DenseLayer &layer = layers[l];
+        std::fill(layer.weightsChanges.begin(), layer.weightsChanges.end(), 0.0f);
+        std::fill(layer.halfWeightsChanges.begin(), layer.halfWeightsChanges.end(), 0);
+        std::fill(layer.biasesChanges.begin(), layer.biasesChanges.end(), 0.0f);
+        std::fill(layer.weightsSquares.begin(), layer.weightsSquares.end(), 0.0f);
+        std::fill(layer.biasesSquares.begin(), layer.biasesSquares.end(), 0.0f);
+    }
 }
 
 
-void Network_L::setOutputWeights(std::vector<std::vector<float>> outputWeights) {
-    Network_L::outputWeights = outputWeights;
+/*
+ * Change how the weights and their changes are stored. Weights are rounded to nearest on the way
+ * down to BFloat16 or Float16, and expanded exactly on the way back to Float32. Only one copy is
+ * kept, so the float buffers are freed below Float32 and made again on the way back. The biases
+ * and their changes always stay in Float32.
+ */
+void Network_L::setWeightPrecision(WeightPrecision weightPrecision) {
+    if (weightPrecision == Network_L::weightPrecision) {
+        return;
+    }
+    for (int l = 0; l < layers.size(); l++) {
+        DenseLayer &layer = layers[l];
+        int numWeights = layer.numNodes * layer.inputStride;
+        if (Network_L::weightPrecision != WeightPrecision::Float32) {
+            HalfFormat format = halfFormatFor(Network_L::weightPrecision);
+            layer.weights.resize(numWeights);
+            layer.weightsChanges.resize(numWeights);
+            expandHalf(layer.halfWeights.data(), layer.weights.data(), numWeights, format);
+            expandHalf(layer.halfWeightsChanges.data(), layer.weightsChanges.data(), numWeights, format);
+        }
+        if (weightPrecision != WeightPrecision::Float32) {
+            HalfFormat format = halfFormatFor(weightPrecision);
+            layer.halfWeights.resize(numWeights);
+            layer.halfWeightsChanges.resize(numWeights);
+            roundToHalf(layer.weights.data(), layer.halfWeights.data(), numWeights, format);
+            roundToHalf(layer.weightsChanges.data(), layer.halfWeightsChanges.data(), numWeights, format);
+            AlignedVector().swap(layer.weights);
+            AlignedVector().swap(layer.weightsChanges);
+        } else {
+            AlignedHalfVector().swap(layer.halfWeights);
+            AlignedHalfVector().swap(layer.halfWeightsChanges);
+        }
+    }
+    Network_L::weightPrecision = weightPrecision;
 }
 
 
@@ -470,3 +1518,94 @@ std::string eFToString(ErrorFunction ef) {
         return "CrossEntropy";
     }
 }
+
+
+/*
+ * Keep only the non-zero values of a dense input pattern, with their indexes
+ */
+SparseInputs toSparseInputs(const std::vector<float> &inputs) {
+    SparseInputs sparse;
+    for (int j = 0; j < inputs.size(); j++) {
+        if (inputs[j] != 0.0f) {
+            sparse.indexes.push_back(j);
+            sparse.values.push_back(inputs[j]);
+        }
+    }
+    return sparse;
+}
+
+
+/*
+ * Expand a sparse input pattern back into a dense one of numInputs values
+ */
+std::vector<float> toDenseInputs(const SparseInputs &inputs, int numInputs) {
+    std::vector<float> dense(numInputs, 0.0f);
+    for (int k = 0; k < inputs.indexes.size(); k++) {
+        dense[inputs.indexes[k]] = inputs.values[k];
+    }
+    return dense;
+}
+
+
+/*
+ * Utility function to get an Optimizer from a string
+ */
+Optimizer stringToOptimizer(std::string name) {
+    if (name == "Momentum") {
+        return Optimizer::Momentum;
+    } else if (name == "Nesterov") {
+        return Optimizer::Nesterov;
+    } else if (name == "RMSProp") {
+        return Optimizer::RMSProp;
+    } else if (name == "Adam") {
+        return Optimizer::Adam;
+    } else {
+        std::cout << "Optimizer not recognised: " << name << "\n";
+        return Optimizer::Momentum;
+    }
+}
+
+
+/*
+ * Utility function to get the string representation of an Optimizer
+ */
+std::string optimizerToString(Optimizer optimizer) {
+    if (optimizer == Optimizer::Nesterov) {
+        return "Nesterov";
+    } else if (optimizer == Optimizer::RMSProp) {
+        return "RMSProp";
+    } else if (optimizer == Optimizer::Adam) {
+        return "Adam";
+    }
+    return "Momentum";
+}
+
+
+/*
+ * Utility function to get a Weight Precision from a string
+ */
+WeightPrecision stringToWeightPrecision(std::string name) {
+    if (name == "Float32") {
+        return WeightPrecision::Float32;
+    } else if (name == "BFloat16") {
+        return WeightPrecision::BFloat16;
+    } else if (name == "Float16") {
+        return WeightPrecision::Float16;
+    } else {
+        std::cout << "Weight precision not recognised: " << name << "\n";
+        return WeightPrecision::Float32;
+    }
+}
+
+
+/*
+ * Utility function to get the string representation of a Weight Precision
+ */
+std::string weightPrecisionToString(WeightPrecision weightPrecision) {
+    if (weightPrecision == WeightPrecision::BFloat16) {
+        return "BFloat16";
+    } else if (weightPrecision == WeightPrecision::Float16) {
+        return "Float16";
+    }
+    return "Float32";
+}
@@ -4,20 +4,156 @@
 #include <vector>
 #include <random>
 
-enum class ActivationFunction {Sigmoid, ReLu, SoftMax};
+#include "aligned-allocator.hpp"
+#include "activation-function.hpp"
 
 ActivationFunction stringToAF(std::string name);
 std::string aFToString(ActivationFunction af);
 
+// CrossEntropy is the binary cross entropy of each output node, except after a SoftMax output
+// layer, where it is the categorical cross entropy of the whole layer
 enum class ErrorFunction {SumSquared, CrossEntropy};
 
 ErrorFunction stringToEF(std::string name);
 std::string eFToString(ErrorFunction ef);
 
+// Exact uses libm exp per node. Fast applies the vectorised Sigmoid and SoftMax approximations from
+// network-kernels.hpp to a whole layer at once; their maximum error is documented there.
+enum class ActivationPrecision {Exact, Fast};
+
+// Weight update rule. Momentum is the original code's rule. Nesterov also uses momentum; RMSProp
+// and Adam use fixed decay rates (see network-linux.cpp) and scale each weight's step individually.
+// Optimizer state is kept alongside the weights in each layer, and is not saved with the network.
+enum class Optimizer {Momentum, Nesterov, RMSProp, Adam};
+
+Optimizer stringToOptimizer(std::string name);
+std::string optimizerToString(Optimizer optimizer);
+
+// Storage for the weights and their momentum. BFloat16 and Float16 halve the bytes moved per
+// training step and round every update stochastically (see network-kernels.hpp). Only trainNetwork
+// on dense patterns with the Momentum optimizer, and the non-const classify, support them.
+enum class WeightPrecision {Float32, BFloat16, Float16};
+
+WeightPrecision stringToWeightPrecision(std::string name);
+std::string weightPrecisionToString(WeightPrecision weightPrecision);
+
+// Whole-layer kernels, chosen for each layer when its activation function, the error function or
+// the activation precision is set, so that no per-node code branches on them. The SoftMax with
+// CrossEntropy error kernel is given the accumulated inputs of the output layer and activates them
+// itself, in the same pass as the loss and deltas.
+typedef void (*ActivationKernel)(float *nodes, int numNodes);
+typedef void (*DerivativeKernel)(float *deltas, const float *nodes, int numNodes);
+typedef double (*OutputErrorKernel)(const float *targets, float *outputs, float *deltas, int numNodes);
+
+ActivationKernel activationKernelFor(ActivationFunction af, ActivationPrecision precision);
+
+/*
+ * An input pattern stored as its non-zero values only. indexes holds the position of each value
+ * in the dense pattern, in increasing order, and values the value at that position.
+ */
+struct SparseInputs {
+    std::vector<int> indexes;
+    std::vector<float> values;
+};
+
+SparseInputs toSparseInputs(const std::vector<float> &inputs);
+std::vector<float> toDenseInputs(const SparseInputs &inputs, int numInputs);
+
+/*
+ * One fully connected layer of a Network_L.
+ *
+ * Weights are stored flat and node-major: row i holds every incoming weight of node i, padded to
+ * inputStride so that each row starts on a cache line. Biases are kept separately. The original
+ * code's [input][node] nested layout, with the bias as the final row, is only used by
+ * loadWeights and the weight getters.
+ */
+struct DenseLayer {
+    DenseLayer(int numInputs, int numNodes, ActivationFunction activationFunction);
+
+    int numInputs;
+    int numNodes;
+    int inputStride;                                        // Row length of weights
+    int nodeStride;                                         // Row length of per-example activations in a batch
+    ActivationFunction activationFunction;
+    ActivationKernel activate;                              // Replaces accumulated inputs with activations
+    DerivativeKernel multiplyDerivative;                    // Multiplies deltas by the activation's derivative
+
+    AlignedVector nodes;                                    // AKA 'Hidden'/'Output' in the original code
+    AlignedVector deltas;                                   // AKA 'HiddenDelta'/'OutputDelta' in the original code
+    AlignedVector weights;                                  // AKA 'HiddenWeights'/'OutputWeights' in the original code
+    AlignedVector biases;                                   // Final row of the original code's weights
+    AlignedVector weightsChanges;                           // AKA 'ChangeHiddenWeights'/'ChangeOutputWeights' in the original code
+    AlignedVector biasesChanges;                            // Final row of the original code's weight changes
+    AlignedVector weightsSquares;                           // Running mean of squared gradients, for RMSProp and Adam
+    AlignedVector biasesSquares;                            // Running mean of squared bias gradients
+    AlignedHalfVector halfWeights;                          // Replaces weights, left empty, below Float32 precision
+    AlignedHalfVector halfWeightsChanges;                   // Replaces weightsChanges, left empty, below Float32 precision
+};
+
+/*
+ * Weight gradients summed over a batch of examples, plus the per-example scratch space used to
+ * compute them. Network_L::computeGradients only reads the network, so training threads that each
+ * own a Gradients can work on the same network at once.
+ *
+ * There is one entry per layer, and the gradient buffers use the same padded node-major layout as
+ * the layer weights.
+ */
+class Gradients {
+public:
+    Gradients(const std::vector<int> &layerSizes);
+
+    int count;                                              // Number of examples summed
+    double errorSum;                                        // Error summed over those examples
+
+    std::vector<AlignedVector> weights;
+    std::vector<AlignedVector> biases;
+
+    // Scratch space, one padded row per example
+    int capacity;
+    std::vector<AlignedVector> nodes;
+    std::vector<AlignedVector> deltas;
+
+    void reserve(int batchSize);
+    void sum(const std::vector<Gradients> &gradients, int part, int numParts);
+
+private:
+    std::vector<int> nodeStrides;
+};
+
+/*
+ * Per-example activations of every hidden layer, for the const inference overloads of
+ * Network_L::classify and classifyBatch. Those never write to the network, so threads that each
+ * own an Activations can score against one shared network at once. They refuse an Activations
+ * made for other layer sizes.
+ */
+class Activations {
+public:
+    Activations(const std::vector<int> &layerSizes);
+
+    std::vector<int> layerSizes;                            // Of the network they were made for
+
+    // One padded row per example for each hidden layer
+    int capacity;
+    std::vector<AlignedVector> nodes;
+
+    void reserve(int batchSize);
+
+private:
+    std::vector<int> nodeStrides;
+};
+
+/*
+ * A stack of dense layers. layerSizes gives the width of the input followed by the width of each
+ * layer, so {8, 7, 4} is the original code's network with 8 inputs, 7 hidden nodes and 4 outputs.
+ * There must be at least one hidden layer.
+ *
+ * The hidden/output getters and setters of the original code still work: "hidden" refers to the
+ * first layer and "output" to the last, except that setHiddenActivationFunction sets every layer
+ * but the last.
+ */
 class Network_L {
 private:
     const int numInputNodes;                                // AKA 'InputNodes' in the original code
-    const int numHiddenNodes;                               // AKA 'HiddenNodes' in the original code
     const int numOutputNodes;                               // AKA 'OutputNodes' in the original code
     float learningRate;                                     // AKA 'LearningRate' in the original code
     float momentum;                                         // AKA 'Momentum' in the original code
@@ -28,35 +164,41 @@ private:
     double errorRate;                                       // AKA 'Error' in the original code
     float accumulatedInput;                                 // AKA 'Accum' in the original code
 
-    ActivationFunction hiddenActivationFunction;            // Activation function. Original code used Sigmoid
-    ActivationFunction outputActivationFunction;            // Activation function. Original code used Sigmoid
     ErrorFunction  errorFunction;                           // Error function. Original code used SumSquared
+    ActivationPrecision activationPrecision;                // Exact or fast approximate Sigmoid/SoftMax
+    Optimizer optimizer;                                    // Weight update rule. Original code used Momentum
+    long optimizerSteps;                                    // Updates made with the current optimizer, for Adam
+    WeightPrecision weightPrecision;                        // Storage of the weights and their changes
+
+    std::vector<DenseLayer> layers;                         // Hidden layers in order, then the output layer
+    OutputErrorKernel computeOutputErrors;                  // Output deltas and error for the output layer and error function
+    bool outputsActivatedByErrors;                          // Whether computeOutputErrors also activates the output layer
+
+    Activations batchActivations;                           // Scratch space for classifyBatch
 
-    std::vector<float> hiddenNodes;                         // AKA 'Hidden' in the original code
-    std::vector<float> outputNodes;                         // AKA 'Output' in the original code
-    std::vector<std::vector<float>> hiddenWeights;          // AKA 'HiddenWeights' in the original code
-    std::vector<std::vector<float>> outputWeights;          // AKA 'OutputWeights' in the original code
-    std::vector<float> hiddenNodesDeltas;                   // AKA 'HiddenDelta' in the original code
-    std::vector<float> outputNodesDeltas;                   // AKA 'OutputDelta' in the original code
-    std::vector<std::vector<float>> hiddenWeightsChanges;   // AKA 'ChangeHiddenWeights' in the original code
-    std::vector<std::vector<float>> outputWeightsChanges;   // AKA 'ChangeOutputWeights' in the original code
+    Gradients batchGradients;                               // Scratch space for trainBatch
 
     std::mt19937 m_mt;                                      // Mersenne twister for random number generation
     std::uniform_real_distribution<float> dist;             // Distribution for random number generation
 
-    void initialiseHiddenWeights();
-    void initialiseOutputWeights();
-    float computeActivation(float accumulatedInput, ActivationFunction af);
-    void computeHiddenLayerActivations(std::vector<float> inputs);
-    void computeOutputLayerActivations();
-    float computeDelta(float target, float output);
-    float computeErrorRate(float target, float output);
-    void computeErrors(std::vector<float> targets);
-    void backpropagateErrors();
-    void updateHiddenWeights(std::vector<float> inputs);
-    void updateOutputWeights();
-    void setHiddenWeights(std::vector<std::vector<float>> hiddenWeights);
-    void setOutputWeights(std::vector<std::vector<float>> outputWeights);
+    void initialiseWeights(DenseLayer &layer);
+    void selectKernels();
+    void computeLayerActivations(DenseLayer &layer, const float *inputs, bool activate = true);
+    void computeErrors(const float *targets);
+    void backpropagateErrors(const DenseLayer &layer, DenseLayer &previous);
+    void updateWeights(DenseLayer &layer, const float *inputs);
+    void computeSparseLayerActivations(DenseLayer &layer, const int *indexes, const float *values, int numNonZeros);
+    void updateSparseWeights(DenseLayer &layer, const int *indexes, const float *values, int numNonZeros);
+    void computeLayerGradients(int layer, const float *inputs);
+    bool checkSparseInputs(const int *indexes, int numNonZeros) const;
+    bool checkFloat32Weights(const char *operation) const;
+    bool checkActivations(const Activations &activations) const;
+    AlignedVector floatWeights(const AlignedVector &weights, const AlignedHalfVector &halfWeights) const;
+    void backpropagateAndUpdateWeights(DenseLayer &layer, DenseLayer &previous);
+    void updateParameters(AlignedVector &weights, AlignedVector &changes, AlignedVector &squares,
+                          const AlignedVector &gradients, float rate, int part, int numParts);
+    void computeBatchActivations(const float *inputs, int batchSize, std::vector<AlignedVector> &nodes,
+                                 float *outputs, int outputsStride, bool activateOutputs = true) const;
 
 public:
     Network_L(int numInputNodes,
@@ -66,16 +208,51 @@ public:
               float momentum,
               float initialWeightMax,
               long trainingCycle);
-    float trainNetwork(std::vector<float> inputs,
-                       std::vector<float> targets);
+    Network_L(const std::vector<int> &layerSizes,
+              float learningRate,
+              float momentum,
+              float initialWeightMax,
+              long trainingCycle);
+    float trainNetwork(const std::vector<float> &inputs,
+                       const std::vector<float> &targets);
+    float trainNetwork(const float *inputs, int numInputs,
+                       const float *targets, int numTargets);
+    float trainNetwork(const SparseInputs &inputs,
+                       const std::vector<float> &targets);
+    float trainNetwork(const int *indexes, const float *values, int numNonZeros,
+                       const float *targets, int numTargets);
+    float trainBatch(const float *inputs,
+                     const float *targets,
+                     int batchSize);
+    void computeGradients(const float *inputs,
+                          const float *targets,
+                          int batchSize,
+                          Gradients &gradients) const;
+    void applyGradients(const Gradients &gradients, int part = 0, int numParts = 1);
+    void recordTraining(const Gradients &gradients);
     std::string writeReport();
-    std::vector<float> classify(std::vector<float> inputs);
+    std::vector<float> classify(const std::vector<float> &inputs);
+    int classify(const float *inputs, int numInputs,
+                 float *outputs, int numOutputs);
+    int classify(const float *inputs, int numInputs,
+                 float *outputs, int numOutputs,
+                 Activations &activations) const;
+    std::vector<float> classify(const SparseInputs &inputs);
+    int classify(const int *indexes, const float *values, int numNonZeros,
+                 float *outputs, int numOutputs);
+    int classifyBatch(const float *inputs, int batchSize, float *outputs);
+    int classifyBatch(const float *inputs, int batchSize, float *outputs,
+                      Activations &activations) const;
     void loadWeights(std::vector<std::vector<float>> hiddenWeights,
                      std::vector<std::vector<float>> outputWeights);
+    void loadLayerWeights(int layer, const std::vector<std::vector<float>> &weights);
+    void loadLayerWeights(int layer, const float *weights, int inputStride, const float *biases);
 
     int getNumInputNodes() const;
     int getNumHiddenNodes() const;
     int getNumOutputNodes() const;
+    int getNumLayers() const;
+    std::vector<int> getLayerSizes() const;
     float getLearningRate() const;
     float getMomentum() const;
     float getInitialWeightMax() const;
@@ -84,20 +261,31 @@ public:
     float getAccumulatedInput() const;
     ActivationFunction getHiddenActivationFunction() const;
     ActivationFunction getOutputActivationFunction() const;
+    ActivationFunction getLayerActivationFunction(int layer) const;
     ErrorFunction getErrorFunction() const;
+    ActivationPrecision getActivationPrecision() const;
+    Optimizer getOptimizer() const;
+    WeightPrecision getWeightPrecision() const;
     const std::vector<float> getHiddenNodes() const;
     const std::vector<float> getOutputNodes() const;
+    const std::vector<float> getLayerNodes(int layer) const;
     const std::vector<float> getHiddenNodesDeltas() const;
     const std::vector<float> getOutputNodesDeltas() const;
     const std::vector<std::vector<float>> getHiddenWeights() const;
     const std::vector<std::vector<float>> getOutputWeights() const;
+    const std::vector<std::vector<float>> getLayerWeights(int layer) const;
+    void copyLayerWeights(int layer, float *weights, float *biases) const;
     const std::vector<std::vector<float>> getHiddenWeightsChanges() const;
     const std::vector<std::vector<float>> getOutputWeightsChanges() const;
     void setLearningRate(float learningRate);
     void setMomentum(float momentum);
     void setHiddenActivationFunction(ActivationFunction activationFunction);
     void setOutputActivationFunction(ActivationFunction activationFunction);
+    void setLayerActivationFunction(int layer, ActivationFunction activationFunction);
     void setErrorFunction(ErrorFunction errorFunction);
+    void setActivationPrecision(ActivationPrecision activationPrecision);
+    void setOptimizer(Optimizer optimizer);
+    void setWeightPrecision(WeightPrecision weightPrecision);
 };
 
-#endif // NETWORK_L_H
\ No newline at end of file
+#endif // NETWORK_L_H
@@ -0,0 +1,75 @@
+/*
+ * Int8 inference for a network quantized by quantizeNetwork (see network-saveload-linux.hpp).
+ *
+ * Each layer's inputs are quantized asymmetrically to int8 with one scale and zero point per
+ * layer, chosen from the range the inputs took over a calibration set. Each node's weights are
+ * quantized symmetrically to int8 with a scale of their own. A node then sums int8 x int8 products
+ * into an int32, and only the final sum is converted to float for the activation function:
+ *
+ *     input ~= inputScale * (q - inputZeroPoint)
+ *     weight ~= weightScale[node] * w
+ *     accumulatedInput ~= scales[node] * (biases[node] + sum q * w)
+ *
+ * where scales[node] = inputScale * weightScale[node]. The bias, and the input zero point times
+ * the node's summed weights, are folded into the int32 biases, so the inner loop is only the
+ * multiply-add. The weights, biases and scales are in flash on Arduino, and each node's weights
+ * are stored together so that they can be streamed from it (see flash-memory.hpp).
+ *
+ * Kept free of the standard library so that it compiles on Arduino.
+ */
+
+#ifndef NETWORK_QUANTIZED_H
+#define NETWORK_QUANTIZED_H
+
+#include <math.h>
+#include <stdint.h>
+
+#include "flash-memory.hpp"
+
+struct QuantizedLayer {
+    int numInputs;
+    int numNodes;
+    const int8_t *weights;          // [node][input], without the biases
+    const int32_t *biases;          // One per node, in units of scales[node]
+    const float *scales;            // One per node
+    float inputScale;
+    int8_t inputZeroPoint;
+};
+
+/*
+ * Round value to the nearest step of the given int8 quantization, saturating at either end
+ */
+inline int8_t quantizeInt8(float value, float scale, int8_t zeroPoint) {
+    float steps = roundf(value / scale) + zeroPoint;
+    if (steps < -128.0f) {
+        return -128;
+    } else if (steps > 127.0f) {
+        return 127;
+    }
+    return int8_t(steps);
+}
+
+/*
+ * Quantize a layer's float inputs with the layer's input scale and zero point
+ */
+inline void quantizeInputs(const QuantizedLayer &layer, const float inputs[], int8_t quantized[]) {
+    for (int j = 0; j < layer.numInputs; j++) {
+        quantized[j] = quantizeInt8(inputs[j], layer.inputScale, layer.inputZeroPoint);
+    }
+}
+
+/*
+ * Compute the accumulated input of each of a layer's nodes from its quantized inputs, as a float
+ * ready for the activation function
+ */
+inline void accumulateQuantizedLayer(const QuantizedLayer &layer, const int8_t inputs[], float nodes[]) {
+    for (int i = 0; i < layer.numNodes; i++) {
+        int32_t accumulated = readFromFlash(&layer.biases[i]);
+        streamFromFlash(layer.weights + i * layer.numInputs, layer.numInputs, [&](int j, int8_t weight) {
+            accumulated += int16_t(inputs[j]) * weight;
+        });
+        nodes[i] = readFromFlash(&layer.scales[i]) * float(accumulated);
+    }
+}
+
+#endif // NETWORK_QUANTIZED_H
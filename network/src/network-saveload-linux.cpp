@@ -1,11 +1,226 @@
 #include <sstream>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <functional>
+#include <cstddef>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "network-saveload-linux.hpp"
+#include "network-kernels.hpp"
 
 /*
  * Functions for saving and loading network configurations to and from files.
  */
 
+/*
+ * Parse rows lines of cols comma separated weights, starting at line first
+ */
+static std::vector<std::vector<float>> parseWeights(const std::vector<std::string> &lines, int first,
+                                                    int rows, int cols) {
+    std::vector<std::vector<float>> weights;
+    weights.resize(rows, std::vector<float>(cols));
+
+    for (int i = 0; i < rows; i++) {
+        std::string line = lines[first + i].substr(5, lines[first + i].length()- 8);
+        float lineWeights[cols];
+        std::string value;
+        std::istringstream iss(line);
+        int k = 0;
+
+        while (std::getline(iss, value, ',')) {
+            lineWeights[k] = stof(value);
+            k++;
+        }
+
+        for (int j = 0; j < cols; j++) {
+            weights[i][j] = lineWeights[j];
+        }
+    }
+    return weights;
+}
+
+
+/*
+ * Convert weights read node-major, one row per node holding its bias and then its input weights,
+ * to the original code's [input][node] layout with the biases as the final row
+ */
+static std::vector<std::vector<float>> fromNodeMajor(const std::vector<std::vector<float>> &nodeMajor) {
+    int numNodes = nodeMajor.size();
+    int numInputs = nodeMajor[0].size() - 1;
+    std::vector<std::vector<float>> weights(numInputs + 1, std::vector<float>(numNodes));
+    for (int i = 0; i < numNodes; i++) {
+        weights[numInputs][i] = nodeMajor[i][0];
+        for (int j = 0; j < numInputs; j++) {
+            weights[j][i] = nodeMajor[i][j + 1];
+        }
+    }
+    return weights;
+}
+
+
+/*
+ * Write a PROGMEM weight array declaration from weights in the original code's [input][node]
+ * layout. The array is node-major, one row per node holding its bias and then its input weights,
+ * which is the order Network_A reads them from flash.
+ */
+static void writeWeights(std::ofstream &config_file, std::string declaration,
+                         const std::vector<std::vector<float>> &weights) {
+    int numInputs = weights.size() - 1;
+    int numNodes = weights[0].size();
+
+    config_file << declaration << " PROGMEM = {\n";
+    for (int i = 0; i < numNodes; i++) {
+        config_file << "    { " << std::to_string(weights[numInputs][i]);
+        for (int j = 0; j < numInputs; j++) {
+            config_file << ", " + std::to_string(weights[j][i]);
+        }
+        config_file << " }, \n";
+    }
+    config_file << "};\n";
+    config_file << "\n";
+}
+
+
+/*
+ * Write a PROGMEM declaration of a flat array of integers or floats, rowLength values per line,
+ * each line braced as a row of a two dimensional array if nested. Floats are written with enough
+ * digits to read back exactly.
+ */
+template<typename T>
+static void writeArray(std::ofstream &config_file, std::string declaration, const std::vector<T> &values,
+                       int rowLength, bool nested) {
+    config_file << declaration << " PROGMEM = {\n";
+    for (int first = 0; first < values.size(); first += rowLength) {
+        std::ostringstream row;
+        row.precision(std::numeric_limits<T>::max_digits10);
+        for (int i = first; i < first + rowLength && i < values.size(); i++) {
+            // Widened so that int8_t values are written as numbers rather than characters
+            row << (i > first ? ", " : "") << +values[i];
+        }
+        config_file << "    " << (nested ? "{ " + row.str() + " }" : row.str()) << ", \n";
+    }
+    config_file << "};\n";
+    config_file << "\n";
+}
+
+
+/*
+ * Write the #define guard, the main configuration options, the activation functions and the
+ * comments recording what Network_A does not need, which every saved configuration starts with.
+ * The activation functions are the names of ActivationFunction values, which Network_A picks its
+ * activations by at compile time.
+ */
+static void writeHeader(std::ofstream &config_file, Network_L *network) {
+    // Save #define
+    config_file << "#ifndef ARDUINO_CONFIG_H\n";
+    config_file << "#define ARDUINO_CONFIG_H\n";
+    config_file << "\n";
+
+    // Save the #include so that PROGMEM works
+    config_file << "#include \"avr/pgmspace.h\"\n";
+    config_file << "\n";
+
+    // Save main config data
+    config_file << "const int numInputNodes = " << std::to_string(network->getNumInputNodes()) + ";\n";
+    config_file << "const int numHiddenNodes = " <<  std::to_string(network->getNumHiddenNodes()) + ";\n";
+    config_file << "const int numOutputNodes = " <<  std::to_string(network->getNumOutputNodes()) + ";\n";
+    config_file << "const float learningRate = " <<  std::to_string(network->getLearningRate()) + ";\n";
+    config_file << "const float momentum = " <<  std::to_string(network->getMomentum()) + ";\n";
+    config_file << "const float initialWeightMax = " <<  std::to_string(network->getInitialWeightMax()) + ";\n";
+    config_file << "\n";
+
+    config_file << "// TrainingCycle (not needed on Arduino): " << std::to_string(network->getTrainingCycle()) <<"\n";
+    config_file << "#define HIDDEN_ACTIVATION_FUNCTION " << aFToString(network->getHiddenActivationFunction()) <<"\n";
+    config_file << "#define OUTPUT_ACTIVATION_FUNCTION " << aFToString(network->getOutputActivationFunction()) <<"\n";
+    config_file << "// ErrorFunction (not needed on Arduino): " << eFToString(network->getErrorFunction()) <<"\n";
+
+    config_file << "\n";
+}
+
+
+/*
+ * Name suffix of hidden layer k (counting from 1) in a saved configuration. The first hidden
+ * layer keeps the original code's names, so numHiddenNodes, numHiddenNodes2, numHiddenNodes3...
+ */
+static std::string hiddenLayerSuffix(int k) {
+    return k == 1 ? "" : std::to_string(k);
+}
+
+
+/*
+ * Write the activation function of every layer in order, for Network_A to walk with the layers
+ */
+static void writeLayerActivationFunctions(std::ofstream &config_file, int numHiddenLayers) {
+    config_file << "#define LAYER_ACTIVATION_FUNCTIONS ";
+    for (int k = 1; k <= numHiddenLayers; k++) {
+        config_file << "ActivationFunction::HIDDEN_ACTIVATION_FUNCTION" << hiddenLayerSuffix(k) << ", ";
+    }
+    config_file << "ActivationFunction::OUTPUT_ACTIVATION_FUNCTION\n";
+}
+
+
+/*
+ * Write the arrays of a network with integer weights for Network_A, followed by the list of layers
+ * that Network_A walks. The layers are written in order by writeLayer, given the prefix and
+ * suffix of the original code's array names for the layer and the names of its input and node
+ * counts, which returns the layer's entry in the list.
+ */
+static void writeIntegerLayers(std::ofstream &config_file, Network_L *network, std::string listDeclaration,
+                               const std::function<std::string(int, std::string, std::string, std::string,
+                                                               std::string)> &writeLayer) {
+    int numHiddenLayers = network->getNumLayers() - 1;
+    std::string inputsName = "numInputNodes";
+    std::string total = "numHiddenNodes";
+    std::string sizes = "numInputNodes";
+    std::string layers;
+    for (int k = 1; k <= numHiddenLayers + 1; k++) {
+        int l = k - 1;
+        std::string prefix = k <= numHiddenLayers ? "hidden" : "output";
+        std::string suffix = k <= numHiddenLayers ? hiddenLayerSuffix(k) : "";
+        std::string nodesName = k <= numHiddenLayers ? "numHiddenNodes" + suffix : "numOutputNodes";
+        if (k > 1 && k <= numHiddenLayers) {
+            config_file << "const int numHiddenNodes" << suffix << " = "
+                        << std::to_string(network->getLayerSizes()[k]) << ";\n";
+            config_file << "#define HIDDEN_ACTIVATION_FUNCTION" << suffix << " "
+                        << aFToString(network->getLayerActivationFunction(l)) << "\n";
+            total += " + numHiddenNodes" + suffix;
+        }
+        if (k <= numHiddenLayers) {
+            sizes += ", " + nodesName;
+        }
+
+        layers += "    { " + writeLayer(l, prefix, suffix, inputsName, nodesName) + " },\n";
+        inputsName = nodesName;
+    }
+
+    // Every layer is listed, as Network_A only has the unrolled float network for one hidden layer
+    config_file << "#define NUM_HIDDEN_LAYERS " << numHiddenLayers << "\n";
+    config_file << "const int totalHiddenNodes = " << total << ";\n";
+    config_file << "const int layerSizes[NUM_HIDDEN_LAYERS + 2] = { " << sizes << ", numOutputNodes };\n";
+    writeLayerActivationFunctions(config_file, numHiddenLayers);
+    config_file << listDeclaration << "[NUM_HIDDEN_LAYERS + 1] = {\n" << layers << "};\n";
+    config_file << "\n";
+}
+
+
+/*
+ * The activation function recorded on a line of a saved configuration, which ends with its name.
+ * Configs saved before Network_A used the activation functions recorded them in comments.
+ */
+static ActivationFunction parseActivationFunction(const std::string &line) {
+    return stringToAF(line.substr(line.rfind(' ') + 1));
+}
+
+
+/*
+ * Load a network saved by saveNetwork, or a binary model file saved by saveModel, which is told
+ * apart by its magic number and loaded with loadModel. Returns null if the file cannot be loaded.
+ */
 Network_L *loadNetwork(std::string filename) {
     // Open the file and read it into a vector of lines
     std::ifstream config_file(filename.c_str());
@@ -17,12 +232,31 @@ Network_L *loadNetwork(std::string filename) {
         return nullptr;
     }
 
+    // Model files are binary, and loaded without parsing
+    char magic[sizeof(modelMagic)] = {};
+    if (config_file.read(magic, sizeof(magic)) && memcmp(magic, modelMagic, sizeof(modelMagic)) == 0) {
+        config_file.close();
+        return loadModel(filename);
+    }
+    config_file.clear();
+    config_file.seekg(0);
+
     while (std::getline(config_file, line))
     {
         lines.push_back(line);
     }
 
-    // Parse the basic config data and create the network with the specified configuration
+    // Configs saved before the weights were node-major have them in the original code's layout
+    bool nodeMajor = std::find(lines.begin(), lines.end(), "#define NODE_MAJOR_WEIGHTS") != lines.end();
+
+    // int8 and fixed-point exports keep none of the float weights
+    if (std::find(lines.begin(), lines.end(), "#define QUANTIZED_WEIGHTS") != lines.end() ||
+        std::find(lines.begin(), lines.end(), "#define FIXED_POINT_WEIGHTS") != lines.end()) {
+        std::cout << filename << " holds integer weights for Network_A, and cannot be loaded\n";
+        return nullptr;
+    }
+
+    // Parse the basic config data
     int nin = std::stoi(lines[5].substr(26, lines[5].length() - 2));
     int nhn = std::stoi(lines[6].substr(27, lines[6].length() - 2));
     int non = std::stoi(lines[7].substr(27, lines[7].length() - 2));
@@ -33,132 +267,1103 @@ Network_L *loadNetwork(std::string filename) {
 
     long tc = std::stol(lines[12].substr(42, lines[12].length()-42));
 
-    ActivationFunction haf = stringToAF(lines[13].substr(53, lines[13].length()-53));
-    ActivationFunction oaf = stringToAF(lines[14].substr(53, lines[14].length()-53));
+    ActivationFunction haf = parseActivationFunction(lines[13]);
+    ActivationFunction oaf = parseActivationFunction(lines[14]);
 
     ErrorFunction ef = stringToEF(lines[15].substr(42, lines[15].length()-42));
 
-    Network_L *network = new Network_L(nin, nhn, non, lr, m, iwm, tc);
+    // Walk the weight arrays in order. Hidden layers after the first are each preceded by their
+    // width and activation function.
+    std::vector<int> layerSizes = {nin, nhn};
+    std::vector<ActivationFunction> layerAFs = {haf};
+    std::vector<std::vector<std::vector<float>>> layerWeights;
+
+    for (int line_num = 16; line_num < lines.size(); line_num++) {
+        const std::string &current = lines[line_num];
+        if (current.compare(0, 24, "const int numHiddenNodes") == 0) {
+            layerSizes.push_back(std::stoi(current.substr(current.find('=') + 2)));
+        } else if (current.compare(0, 34, "#define HIDDEN_ACTIVATION_FUNCTION") == 0 ||
+                   current.compare(0, 27, "// hiddenActivationFunction") == 0) {
+            layerAFs.push_back(parseActivationFunction(current));
+        } else if (current.compare(0, 25, "const float hiddenWeights") == 0 ||
+                   current.compare(0, 25, "const float outputWeights") == 0) {
+            int numInputs = layerSizes[layerWeights.size()];
+            int numNodes = current.compare(0, 25, "const float outputWeights") == 0
+                           ? non : layerSizes[layerWeights.size() + 1];
+            if (nodeMajor) {
+                layerWeights.push_back(fromNodeMajor(parseWeights(lines, line_num + 1, numNodes, numInputs + 1)));
+                line_num += numNodes;
+            } else {
+                layerWeights.push_back(parseWeights(lines, line_num + 1, numInputs + 1, numNodes));
+                line_num += numInputs + 1;
+            }
+        }
+    }
+    layerSizes.push_back(non);
+    layerAFs.push_back(oaf);
+
+    // Create the network with the specified configuration
+    Network_L *network = new Network_L(layerSizes, lr, m, iwm, tc);
 
-    network->setHiddenActivationFunction(haf);
-    network->setOutputActivationFunction(oaf);
+    for (int l = 0; l < layerAFs.size(); l++) {
+        network->setLayerActivationFunction(l, layerAFs[l]);
+    }
     network->setErrorFunction(ef);
 
-    // Parse the hidden weights
-    int line_num = 18;
-    std::vector<std::vector<float>> hiddenWeights;
-    hiddenWeights.resize(nin+1, std::vector<float>(nhn));
+    for (int l = 0; l < layerWeights.size(); l++) {
+        network->loadLayerWeights(l, layerWeights[l]);
+    }
 
-    for (int i = 0; i < nin+1; i++) {
-        std::string line = lines[line_num].substr(5, lines[line_num].length()- 8);
-        float lineWeights[nhn];
-        std::string value;
-        std::istringstream iss(line);
-        int k = 0;
+    return network;
+}
 
-        while (std::getline(iss, value, ',')) {
-            lineWeights[k] = stof(value);
-            k++;
+/*
+ * Build the smallest sigmoid lookup table within maxError of the exact function.
+ *
+ * The table stops where the sigmoid is within half of maxError of 1, and the spacing starts from
+ * the bound on linear interpolation's error, h^2/8 times the largest |sigmoid''|. The entries are
+ * rounded, so the error is then measured at 16 points in every interval, and the table is grown
+ * until it is within maxError. Errors much below 0.00001 cannot be met with 16-bit entries, and
+ * then the table stops growing once that no longer helps, with a maxError above the one asked for.
+ *
+ * maxError must be between 0 and 0.5, where the table would be a single entry. Otherwise the table
+ * is empty, with a scale and maxError of 0.
+ */
+SigmoidTable buildSigmoidTable(float maxError) {
+    if (!(maxError > 0.0f && maxError < 0.5f)) {
+        return SigmoidTable{{}, 0.0f, 0.0};
+    }
+    const double largestSecondDerivative = 0.0962250449;
+    double range = std::log(2.0 / maxError - 1.0);
+    int size = int(std::ceil(range / std::sqrt(8.0 * maxError / largestSecondDerivative))) + 1;
+
+    SigmoidTable table;
+    SigmoidTable smaller;
+    while (true) {
+        table.scale = float((size - 1) / range);
+        table.entries.resize(size);
+        for (int i = 0; i < size; i++) {
+            double sigmoid = 1.0 / (1.0 + std::exp(-i / double(table.scale)));
+            table.entries[i] = uint16_t(std::round((sigmoid - 0.5) / sigmoidTableStep));
         }
 
-        for (int j = 0; j < nhn; j++) {
-            hiddenWeights[i][j] = lineWeights[j];
+        table.maxError = 0.0;
+        for (int i = 0; i <= 16 * (size + 16); i++) {
+            double x = i / (16.0 * table.scale);
+            double lookedUp = lookUpSigmoid(float(x), table.entries.data(), size, table.scale);
+            table.maxError = std::max(table.maxError, std::fabs(lookedUp - 1.0 / (1.0 + std::exp(-x))));
+        }
+        if (table.maxError <= maxError) {
+            return table;
+        } else if (!smaller.entries.empty() && table.maxError > 0.9 * smaller.maxError) {
+            return smaller;
         }
-        line_num++;
+        smaller = table;
+        size += size / 8 + 1;
     }
+}
 
-    // Parse the output weights
-    line_num = 21 + (nin + 1);
-    std::vector<std::vector<float>> outputWeights;
-    outputWeights.resize(nhn+1, std::vector<float>(non));
 
-    for (int i = 0; i < nhn+1; i++) {
-        std::string line = lines[line_num].substr(5, lines[line_num].length()- 8);
-        float lineWeights[non];
-        std::string value;
-        std::istringstream iss(line);
-        int k = 0;
+/*
+ * Whether any layer of a network uses the sigmoid, and so Network_A needs a sigmoid lookup table
+ */
+bool needsSigmoidTable(Network_L *network) {
+    for (int l = 0; l < network->getNumLayers(); l++) {
+        if (network->getLayerActivationFunction(l) == ActivationFunction::Sigmoid) {
+            return true;
+        }
+    }
+    return false;
+}
 
-        while (std::getline(iss, value, ',')) {
-            lineWeights[k] = stof(value);
-            k++;
+
+/*
+ * Build the sigmoid lookup table to save with a network for the given error, which is left empty
+ * for an error of 0, or if no layer uses the sigmoid. Returns false if the error is 0.5 or more,
+ * or no table is within it.
+ */
+bool buildSavedSigmoidTable(Network_L *network, float sigmoidTableError, SigmoidTable &table) {
+    if (sigmoidTableError > 0.0f && needsSigmoidTable(network)) {
+        table = buildSigmoidTable(sigmoidTableError);
+        if (table.entries.empty()) {
+            std::cout << "Sigmoid lookup table error " << sigmoidTableError << " is not below 0.5\n";
+            return false;
+        } else if (table.maxError > sigmoidTableError) {
+            std::cout << "No sigmoid lookup table is within " << sigmoidTableError << " of exp, the closest is within "
+                      << table.maxError << "\n";
+            return false;
         }
+    }
+    return true;
+}
+
+
+/*
+ * Write a sigmoid lookup table for Network_A to use instead of exp
+ */
+static void writeSigmoidTable(std::ofstream &config_file, const SigmoidTable &table) {
+    std::ostringstream scale;
+    scale.precision(std::numeric_limits<float>::max_digits10);
+    scale << table.scale;
 
-        for (int j = 0; j < non; j++) {
-            outputWeights[i][j] = lineWeights[j];
+    config_file << "// Sigmoid lookup table (see sigmoid-table.hpp), within " << table.maxError
+                << " of the exact function\n";
+    config_file << "#include \"sigmoid-table.hpp\"\n";
+    config_file << "#define SIGMOID_TABLE\n";
+    config_file << "const int sigmoidTableSize = " << table.entries.size() << ";\n";
+    config_file << "const float sigmoidTableScale = " << scale.str() << ";\n";
+    writeArray(config_file, "const uint16_t sigmoidTable[sigmoidTableSize]", table.entries, 8, false);
+}
+
+
+/*
+ * Plan Network_A's activation arena for a network with the given layer sizes, the inputs first,
+ * saved in the given format, and the SRAM it needs for activations at most. The float and int8
+ * formats read the inputs from the start of the arena, or from wherever the caller keeps them.
+ * The int8 format also quantizes each layer's inputs into a buffer of its own, and the fixed-point
+ * format keeps its float inputs and outputs besides the Q7.8 arena.
+ */
+ActivationMemoryPlan planActivationMemory(const std::vector<int> &layerSizes, ExportFormat format) {
+    ActivationMemoryPlan plan;
+    plan.arenaSize = 0;
+    for (int l = 0; l + 1 < layerSizes.size(); l++) {
+        plan.arenaSize = std::max(plan.arenaSize, layerSizes[l] + layerSizes[l + 1]);
+    }
+    for (int l = 0; l < layerSizes.size(); l++) {
+        plan.layerOffsets.push_back(l % 2 == 0 ? 0 : plan.arenaSize - layerSizes[l]);
+    }
+
+    int extraBytes = 0;
+    if (format == ExportFormat::FixedPoint) {
+        plan.arenaBytes = plan.arenaSize * sizeof(int16_t);
+        extraBytes = (layerSizes.front() + layerSizes.back()) * sizeof(float);
+    } else {
+        plan.arenaBytes = plan.arenaSize * sizeof(float);
+        if (format == ExportFormat::Int8) {
+            extraBytes = *std::max_element(layerSizes.begin(), layerSizes.end() - 1) * sizeof(int8_t);
         }
-        line_num++;
     }
+    plan.peakBytes = plan.arenaBytes + extraBytes + flashBlockBytes;
+    return plan;
+}
 
-    network->loadWeights(hiddenWeights, outputWeights);
 
-    return network;
+/*
+ * Write the layout of Network_A's activation arena
+ */
+static void writeActivationArena(std::ofstream &config_file, const ActivationMemoryPlan &plan) {
+    std::string offsets;
+    for (int offset : plan.layerOffsets) {
+        offsets += (offsets.empty() ? "" : ", ") + std::to_string(offset);
+    }
+
+    config_file << "// Activation arena (see planActivationMemory), with alternate layers' nodes at either end.\n";
+    config_file << "// Network_A needs " << plan.peakBytes << " bytes of SRAM for activations\n";
+    config_file << "#define ACTIVATION_ARENA\n";
+    config_file << "const int activationArenaSize = " << plan.arenaSize << ";\n";
+    config_file << "const int layerOffsets[] = { " << offsets << " };\n";
+    config_file << "\n";
+}
+
+
+/*
+ * Utility function to get a Board from a string
+ */
+Board stringToBoard(std::string name) {
+    if (name == "AVR") {
+        return Board::AVR;
+    } else if (name == "Curie") {
+        return Board::Curie;
+    } else if (name == "CortexM0") {
+        return Board::CortexM0;
+    } else {
+        std::cout << "Board not recognised: " << name << "\n";
+        return Board::Curie;
+    }
+}
+
+
+/*
+ * Utility function to get the string representation of a Board
+ */
+std::string boardToString(Board board) {
+    if (board == Board::AVR) {
+        return "AVR";
+    } else if (board == Board::CortexM0) {
+        return "CortexM0";
+    }
+    return "Curie";
+}
+
+
+/*
+ * The room and rough operation costs of a board, for estimateDeviceCost
+ */
+BoardProfile getBoardProfile(Board board) {
+    switch (board) {
+    case Board::AVR:
+        // 8-bit, so even an int16 multiply-add takes several instructions, and flash is read with LPM
+        return {16.0, 32256, 2048, 250.0, 480.0, 2400.0, 30.0, 12.0, 40.0, 650.0, 4.0, 5.0};
+    case Board::CortexM0:
+        // Single cycle 32-bit multiply, but no divide instruction
+        return {48.0, 253952, 32768, 110.0, 200.0, 900.0, 15.0, 4.0, 7.0, 60.0, 1.0, 1.0};
+    default:
+        return {32.0, 196608, 24576, 80.0, 120.0, 600.0, 10.0, 3.0, 5.0, 40.0, 1.0, 0.5};
+    }
+}
+
+
+/*
+ * Estimate the flash, SRAM and time Network_A needs on a board for a network saved in the given
+ * format, with a sigmoid lookup table of sigmoidTableSize entries, or none for 0. Each layer costs
+ * its multiply-adds and the flash they read, plus the conversions its format makes and its
+ * activation function for each node. A sigmoid from the table is taken to read two entries, and
+ * the fixed-point format never uses the table.
+ */
+DeviceCost estimateDeviceCost(Network_L *network, ExportFormat format, Board board, int sigmoidTableSize) {
+    BoardProfile profile = getBoardProfile(board);
+    std::vector<int> layerSizes = network->getLayerSizes();
+    if (format == ExportFormat::FixedPoint) {
+        sigmoidTableSize = 0;
+    }
+
+    DeviceCost cost = {};
+    cost.flashBytes = sigmoidTableSize * sizeof(uint16_t);
+    double cycles = 0.0;
+    for (int l = 0; l + 1 < layerSizes.size(); l++) {
+        long numInputs = layerSizes[l];
+        long numNodes = layerSizes[l + 1];
+        long layerBytes = 0;
+        if (format == ExportFormat::Float) {
+            layerBytes = (numInputs + 1) * numNodes * sizeof(float);
+            cycles += numInputs * numNodes * profile.floatMultiplyAdd;
+        } else if (format == ExportFormat::Int8) {
+            layerBytes = (numInputs * sizeof(int8_t) + sizeof(int32_t) + sizeof(float)) * numNodes;
+            cycles += numInputs * (profile.floatDivide + profile.floatMultiplyAdd + 2 * profile.floatCompare)
+                      + numInputs * numNodes * profile.int8MultiplyAdd + numNodes * profile.floatMultiplyAdd;
+        } else {
+            layerBytes = (numInputs * sizeof(int16_t) + sizeof(int32_t)) * numNodes;
+            cycles += numInputs * numNodes * profile.int16MultiplyAdd + numNodes * profile.int16MultiplyAdd;
+        }
+        cost.flashBytes += layerBytes;
+        cost.flashBytesRead += layerBytes;
+        cost.multiplyAdds += numInputs * numNodes;
+
+        ActivationFunction activationFunction = network->getLayerActivationFunction(l);
+        double nodeCycles;
+        if (format == ExportFormat::FixedPoint) {
+            if (activationFunction == ActivationFunction::ReLu) {
+                nodeCycles = profile.integerCompare;
+            } else {
+                // The cubic for e^x and the division, and SoftMax's search for the largest input
+                nodeCycles = 4 * profile.int16MultiplyAdd + profile.integerDivide
+                             + (activationFunction == ActivationFunction::SoftMax ? profile.integerCompare : 0.0);
+            }
+        } else if (activationFunction == ActivationFunction::ReLu) {
+            nodeCycles = profile.floatCompare;
+        } else if (activationFunction == ActivationFunction::SoftMax) {
+            nodeCycles = profile.floatCompare + profile.floatMultiplyAdd + profile.floatExp + profile.floatDivide;
+        } else if (sigmoidTableSize > 0) {
+            nodeCycles = 4 * profile.floatMultiplyAdd + profile.floatCompare;
+            cost.flashBytesRead += 2 * sizeof(uint16_t) * numNodes;
+        } else {
+            nodeCycles = profile.floatMultiplyAdd + profile.floatExp + profile.floatDivide;
+        }
+        cycles += numNodes * nodeCycles;
+    }
+    if (format == ExportFormat::FixedPoint) {
+        cycles += layerSizes.front() * (profile.floatMultiplyAdd + 2 * profile.floatCompare)
+                  + layerSizes.back() * profile.floatDivide;
+    }
+    cycles += cost.flashBytesRead * profile.flashReadPerByte;
+
+    cost.sramBytes = planActivationMemory(layerSizes, format).peakBytes;
+    cost.cycles = cycles;
+    cost.milliseconds = cycles / (profile.clockMHz * 1000.0);
+    return cost;
+}
+
+
+/*
+ * Whether Network_A's estimated cost is within a budget, printing each limit it is over if not
+ */
+bool withinDeviceBudget(const DeviceCost &cost, const DeviceBudget &budget) {
+    BoardProfile profile = getBoardProfile(budget.board);
+    long flashBytes = budget.flashBytes > 0 ? budget.flashBytes : profile.flashBytes;
+    int sramBytes = budget.sramBytes > 0 ? budget.sramBytes : profile.sramBytes;
+    std::string board = boardToString(budget.board);
+
+    bool within = true;
+    if (cost.flashBytes > flashBytes) {
+        std::cout << "Network_A would need " << cost.flashBytes << " bytes of flash on " << board << ", more than "
+                  << flashBytes << "\n";
+        within = false;
+    }
+    if (cost.sramBytes > sramBytes) {
+        std::cout << "Network_A would need " << cost.sramBytes << " bytes of SRAM for activations on " << board
+                  << ", more than " << sramBytes << "\n";
+        within = false;
+    }
+    if (budget.milliseconds > 0.0 && cost.milliseconds > budget.milliseconds) {
+        std::cout << "Network_A would take an estimated " << cost.milliseconds << " ms a classification on " << board
+                  << ", more than " << budget.milliseconds << "\n";
+        within = false;
+    }
+    return within;
+}
+
+
+/*
+ * Write Network_A's estimated cost on a board
+ */
+static void writeDeviceCost(std::ofstream &config_file, const DeviceCost &cost, Board board) {
+    config_file << "// Estimated cost on " << boardToString(board) << " (see estimateDeviceCost): "
+                << cost.flashBytes << " bytes of flash and " << cost.sramBytes << " of SRAM,\n";
+    config_file << "// and " << long(cost.cycles + 0.5) << " cycles (" << cost.milliseconds << " ms) for the "
+                << cost.multiplyAdds << " multiply-adds of a classification\n";
+    config_file << "\n";
 }
 
-int saveNetwork(std::string filename, Network_L *network) {
+
+/*
+ * Save a network for Network_A and for loading back with loadNetwork. With a sigmoidTableError
+ * above 0 a sigmoid lookup table within that error is saved too, if any layer uses the sigmoid,
+ * which Network_A then uses instead of exp. The layout of Network_A's activation arena and its
+ * estimated cost on the budget's board are saved last. Nothing is saved if the estimate is over
+ * the budget.
+ */
+int saveNetwork(std::string filename, Network_L *network, float sigmoidTableError, const DeviceBudget &budget) {
+    SigmoidTable table;
+    if (!buildSavedSigmoidTable(network, sigmoidTableError, table)) {
+        return 1; // Error code
+    }
+    DeviceCost cost = estimateDeviceCost(network, ExportFormat::Float, budget.board, table.entries.size());
+    if (!withinDeviceBudget(cost, budget)) {
+        return 1; // Error code
+    }
+
     std::ofstream config_file (filename);
     if (!config_file.is_open() || config_file.bad()) {
         return 1; // Error code
     }
-    // Save #define
-    config_file << "#ifndef ARDUINO_CONFIG_H\n";
-    config_file << "#define ARDUINO_CONFIG_H\n";
-    config_file << "\n";
+    writeHeader(config_file, network);
 
-    // Save the #include so that PROGMEM works
-    config_file << "#include \"avr/pgmspace.h\"\n";
+    config_file << "// Each node's bias and then its input weights, in the order Network_A reads them\n";
+    config_file << "#define NODE_MAJOR_WEIGHTS\n";
     config_file << "\n";
 
-    // Save main config data
-    config_file << "const int numInputNodes = " << std::to_string(network->getNumInputNodes()) + ";\n";
-    config_file << "const int numHiddenNodes = " <<  std::to_string(network->getNumHiddenNodes()) + ";\n";
-    config_file << "const int numOutputNodes = " <<  std::to_string(network->getNumOutputNodes()) + ";\n";
-    config_file << "const float learningRate = " <<  std::to_string(network->getLearningRate()) + ";\n";
-    config_file << "const float momentum = " <<  std::to_string(network->getMomentum()) + ";\n";
-    config_file << "const float initialWeightMax = " <<  std::to_string(network->getInitialWeightMax()) + ";\n";
-    config_file << "\n";
+    // Save hidden weights, one array per hidden layer
+    int numHiddenLayers = network->getNumLayers() - 1;
+    std::string inputsName = "numInputNodes";
+    for (int k = 1; k <= numHiddenLayers; k++) {
+        std::string suffix = hiddenLayerSuffix(k);
+        if (k > 1) {
+            config_file << "const int numHiddenNodes" << suffix << " = "
+                        << std::to_string(network->getLayerSizes()[k]) << ";\n";
+            config_file << "#define HIDDEN_ACTIVATION_FUNCTION" << suffix << " "
+                        << aFToString(network->getLayerActivationFunction(k - 1)) << "\n";
+        }
+        writeWeights(config_file,
+                     "const float hiddenWeights" + suffix + "[numHiddenNodes" + suffix + "][" + inputsName + " +1]",
+                     network->getLayerWeights(k - 1));
+        inputsName = "numHiddenNodes" + suffix;
+    }
 
-    config_file << "// TrainingCycle (not needed on Arduino): " << std::to_string(network->getTrainingCycle()) <<"\n";
-    config_file << "// hiddenActivationFunction (not needed on Arduino): " << aFToString(network->getHiddenActivationFunction()) <<"\n";
-    config_file << "// outputActivationFunction (not needed on Arduino): " << aFToString(network->getOutputActivationFunction()) <<"\n";
-    config_file << "// ErrorFunction (not needed on Arduino): " << eFToString(network->getErrorFunction()) <<"\n";
+    // Save output weights
+    writeWeights(config_file, "const float outputWeights[numOutputNodes][" + inputsName + " +1]",
+                 network->getOutputWeights());
 
-    config_file << "\n";
+    // Deeper networks also list their layers for Network_A, which otherwise assumes one hidden layer
+    if (numHiddenLayers > 1) {
+        std::string sizes = "numInputNodes";
+        std::string total = "numHiddenNodes";
+        std::string weights = "hiddenWeights[0]";
+        for (int k = 1; k <= numHiddenLayers; k++) {
+            sizes += ", numHiddenNodes" + hiddenLayerSuffix(k);
+            if (k > 1) {
+                total += " + numHiddenNodes" + hiddenLayerSuffix(k);
+                weights += ", hiddenWeights" + hiddenLayerSuffix(k) + "[0]";
+            }
+        }
+        config_file << "#define NUM_HIDDEN_LAYERS " << numHiddenLayers << "\n";
+        config_file << "const int totalHiddenNodes = " << total << ";\n";
+        config_file << "const int layerSizes[NUM_HIDDEN_LAYERS + 2] = { " << sizes << ", numOutputNodes };\n";
+        config_file << "const float * const layerWeights[NUM_HIDDEN_LAYERS + 1] = { "
+                    << weights << ", outputWeights[0] };\n";
+        writeLayerActivationFunctions(config_file, numHiddenLayers);
+        config_file << "\n";
+    }
+    writeActivationArena(config_file, planActivationMemory(network->getLayerSizes(), ExportFormat::Float));
+    writeDeviceCost(config_file, cost, budget.board);
+    if (!table.entries.empty()) {
+        writeSigmoidTable(config_file, table);
+    }
+    config_file << "#endif // ARDUINO_CONFIG_H";
 
+    config_file.close();
+    return 0;
+}
+
+
+
+/*
+ * The int8 view of one layer, pointing into this network's arrays
+ */
+QuantizedLayer QuantizedNetwork::getLayer(int layer) const {
+    return { layerSizes[layer], layerSizes[layer + 1], weights[layer].data(), biases[layer].data(),
+             scales[layer].data(), inputScales[layer], inputZeroPoints[layer] };
+}
 
-    // Save hidden weights
-    int nin_plus_one = network->getNumInputNodes() +1;
-    int nhn = network->getNumHiddenNodes();
-    std::vector<std::vector<float>> hiddenWeights = network->getHiddenWeights();
 
-    config_file << "const float hiddenWeights[numInputNodes +1][numHiddenNodes] PROGMEM = {\n";
-    for (int i = 0; i < nin_plus_one; i++) {
-        config_file << "    { ";
-        for (int j = 0; j < nhn-1; j++) {
-            config_file << std::to_string(hiddenWeights[i][j]) + ", ";
+/*
+ * Classify the given input pattern with int8 weights, and return the predicted output
+ */
+std::vector<float> QuantizedNetwork::classify(const std::vector<float> &inputs) const {
+    std::vector<float> layerInputs = inputs;
+    for (int l = 0; l < weights.size(); l++) {
+        QuantizedLayer layer = getLayer(l);
+        std::vector<int8_t> quantized(layer.numInputs);
+        std::vector<float> nodes(layer.numNodes);
+        quantizeInputs(layer, layerInputs.data(), quantized.data());
+        accumulateQuantizedLayer(layer, quantized.data(), nodes.data());
+
+        if (activationFunctions[l] == ActivationFunction::ReLu) {
+            for (int i = 0; i < layer.numNodes; i++) {
+                nodes[i] = std::max(0.0f, nodes[i]);
+            }
+        } else if (activationFunctions[l] == ActivationFunction::SoftMax) {
+            float max = *std::max_element(nodes.begin(), nodes.end());
+            float sum = 0.0f;
+            for (int i = 0; i < layer.numNodes; i++) {
+                nodes[i] = exp(nodes[i] - max);
+                sum += nodes[i];
+            }
+            for (int i = 0; i < layer.numNodes; i++) {
+                nodes[i] /= sum;
+            }
+        } else {
+            for (int i = 0; i < layer.numNodes; i++) {
+                nodes[i] = float(1.0/(1.0 + exp(-nodes[i])));
+            }
         }
-        config_file << std::to_string(hiddenWeights[i][nhn-1]) << " }, \n";
+        layerInputs = nodes;
     }
-    config_file << "};\n";
+    return layerInputs;
+}
+
+
+/*
+ * Quantize a network's weights to int8 for Network_A.
+ *
+ * The inputs of each layer are classified from calibrationInputs to find the range they take,
+ * widened to include 0 so that zero inputs are exact, and that range is spread over the 256 int8
+ * steps. Each node's weights are scaled so that the largest in magnitude becomes +-127, with no
+ * zero point. See network-quantized.hpp for how the biases fold in the input zero point.
+ */
+QuantizedNetwork quantizeNetwork(Network_L *network, const std::vector<std::vector<float>> &calibrationInputs) {
+    QuantizedNetwork quantized;
+    quantized.layerSizes = network->getLayerSizes();
+    int numLayers = network->getNumLayers();
+
+    // Calibration: the range of each layer's inputs
+    std::vector<float> minimums(numLayers, 0.0f);
+    std::vector<float> maximums(numLayers, 0.0f);
+    for (const std::vector<float> &inputs : calibrationInputs) {
+        network->classify(inputs);
+        for (int l = 0; l < numLayers; l++) {
+            std::vector<float> layerInputs = l == 0 ? inputs : network->getLayerNodes(l - 1);
+            for (float input : layerInputs) {
+                minimums[l] = std::min(minimums[l], input);
+                maximums[l] = std::max(maximums[l], input);
+            }
+        }
+    }
+
+    for (int l = 0; l < numLayers; l++) {
+        int numInputs = quantized.layerSizes[l];
+        int numNodes = quantized.layerSizes[l + 1];
+        std::vector<std::vector<float>> weights = network->getLayerWeights(l);
+
+        float inputScale = maximums[l] > minimums[l] ? (maximums[l] - minimums[l]) / 255.0f : 1.0f;
+        float zeroPoint = std::round(-128.0f - minimums[l] / inputScale);
+        int8_t inputZeroPoint = int8_t(std::min(127.0f, std::max(-128.0f, zeroPoint)));
+
+        std::vector<int8_t> layerWeights(numInputs * numNodes);
+        std::vector<int32_t> layerBiases(numNodes);
+        std::vector<float> layerScales(numNodes);
+        for (int i = 0; i < numNodes; i++) {
+            float largest = 0.0f;
+            for (int j = 0; j < numInputs; j++) {
+                largest = std::max(largest, std::fabs(weights[j][i]));
+            }
+            float weightScale = largest > 0.0f ? largest / 127.0f : 1.0f;
+
+            long weightSum = 0;
+            for (int j = 0; j < numInputs; j++) {
+                layerWeights[i * numInputs + j] = int8_t(std::round(weights[j][i] / weightScale));
+                weightSum += layerWeights[i * numInputs + j];
+            }
+
+            layerScales[i] = inputScale * weightScale;
+            double bias = std::round(weights[numInputs][i] / layerScales[i]) - double(inputZeroPoint) * weightSum;
+            bias = std::min(double(std::numeric_limits<int32_t>::max()),
+                            std::max(double(std::numeric_limits<int32_t>::min()), bias));
+            layerBiases[i] = int32_t(bias);
+        }
+
+        quantized.activationFunctions.push_back(network->getLayerActivationFunction(l));
+        quantized.weights.push_back(layerWeights);
+        quantized.biases.push_back(layerBiases);
+        quantized.scales.push_back(layerScales);
+        quantized.inputScales.push_back(inputScale);
+        quantized.inputZeroPoints.push_back(inputZeroPoint);
+    }
+    return quantized;
+}
+
+
+/*
+ * Save a network with int8 weights for Network_A, quantized with quantizeNetwork. The weight
+ * arrays keep the original code's names, and are node-major without the biases, and every layer
+ * is listed in quantizedLayers. There are no float weights, so the file cannot be loaded
+ * back with loadNetwork. The sigmoid lookup table and estimated cost are saved as by saveNetwork.
+ */
+int saveQuantizedNetwork(std::string filename, Network_L *network,
+                         const std::vector<std::vector<float>> &calibrationInputs, float sigmoidTableError,
+                         const DeviceBudget &budget) {
+    if (calibrationInputs.empty()) {
+        std::cout << "Quantizing needs at least one calibration pattern\n";
+        return 1; // Error code
+    }
+    SigmoidTable table;
+    if (!buildSavedSigmoidTable(network, sigmoidTableError, table)) {
+        return 1; // Error code
+    }
+    DeviceCost cost = estimateDeviceCost(network, ExportFormat::Int8, budget.board, table.entries.size());
+    if (!withinDeviceBudget(cost, budget)) {
+        return 1; // Error code
+    }
+    QuantizedNetwork quantized = quantizeNetwork(network, calibrationInputs);
+
+    std::ofstream config_file (filename);
+    if (!config_file.is_open() || config_file.bad()) {
+        return 1; // Error code
+    }
+    writeHeader(config_file, network);
+
+    config_file << "// int8 weights with one scale per node, and inputs calibrated on "
+                << calibrationInputs.size() << " patterns\n";
+    config_file << "#include \"network-quantized.hpp\"\n";
+    config_file << "#define QUANTIZED_WEIGHTS\n";
     config_file << "\n";
 
-    // Save output weights
-    int nhn_plus_one = network->getNumHiddenNodes() + 1;
-    int non = network->getNumOutputNodes();
-    std::vector<std::vector<float>> outputWeights = network->getOutputWeights();
+    std::ostringstream entry;
+    entry.precision(std::numeric_limits<float>::max_digits10);
+    writeIntegerLayers(config_file, network, "const QuantizedLayer quantizedLayers",
+                       [&](int l, std::string prefix, std::string suffix,
+                           std::string inputsName, std::string nodesName) -> std::string {
+        writeArray(config_file, "const int8_t " + prefix + "Weights" + suffix + "[" + nodesName + "][" + inputsName + "]",
+                   quantized.weights[l], quantized.layerSizes[l], true);
+        writeArray(config_file, "const int32_t " + prefix + "Biases" + suffix + "[" + nodesName + "]",
+                   quantized.biases[l], quantized.layerSizes[l + 1], false);
+        writeArray(config_file, "const float " + prefix + "Scales" + suffix + "[" + nodesName + "]",
+                   quantized.scales[l], quantized.layerSizes[l + 1], false);
+
+        entry.str("");
+        entry << inputsName << ", " << nodesName << ", " << prefix << "Weights" << suffix << "[0], "
+              << prefix << "Biases" << suffix << ", " << prefix << "Scales" << suffix << ", "
+              << quantized.inputScales[l] << ", " << +quantized.inputZeroPoints[l];
+        return entry.str();
+    });
+    writeActivationArena(config_file, planActivationMemory(network->getLayerSizes(), ExportFormat::Int8));
+    writeDeviceCost(config_file, cost, budget.board);
+    if (!table.entries.empty()) {
+        writeSigmoidTable(config_file, table);
+    }
+    config_file << "#endif // ARDUINO_CONFIG_H";
+
+    config_file.close();
+    return 0;
+}
+
+
+
+/*
+ * The fixed-point view of one layer, pointing into this network's arrays
+ */
+FixedPointLayer FixedPointNetwork::getLayer(int layer) const {
+    return { layerSizes[layer], layerSizes[layer + 1], weights[layer].data(), biases[layer].data(),
+             weightFractionBits[layer] };
+}
 
-    config_file << "const float outputWeights[numHiddenNodes +1][numOutputNodes] PROGMEM = {\n";
-    for (int i = 0; i < nhn_plus_one; i++) {
-        config_file << "    { ";
-        for (int j = 0; j < non-1; j++) {
-            config_file << std::to_string(outputWeights[i][j]) + ", ";
+
+/*
+ * Classify the given input pattern in fixed point, and return the predicted output
+ */
+std::vector<float> FixedPointNetwork::classify(const std::vector<float> &inputs) const {
+    std::vector<int16_t> layerInputs(inputs.size());
+    for (int j = 0; j < inputs.size(); j++) {
+        layerInputs[j] = toFixedPoint(inputs[j]);
+    }
+    for (int l = 0; l < weights.size(); l++) {
+        FixedPointLayer layer = getLayer(l);
+        std::vector<int16_t> nodes(layer.numNodes);
+        accumulateFixedPointLayer(layer, layerInputs.data(), nodes.data());
+
+        if (activationFunctions[l] == ActivationFunction::ReLu) {
+            for (int i = 0; i < layer.numNodes; i++) {
+                nodes[i] = fixedPointReLu(nodes[i]);
+            }
+        } else if (activationFunctions[l] == ActivationFunction::SoftMax) {
+            fixedPointSoftMax(nodes.data(), layer.numNodes);
+        } else {
+            for (int i = 0; i < layer.numNodes; i++) {
+                nodes[i] = fixedPointSigmoid(nodes[i]);
+            }
         }
-        config_file << std::to_string(outputWeights[i][non-1]) << " }, \n";
+        layerInputs = nodes;
     }
-    config_file << "};\n";
+
+    std::vector<float> outputs(layerInputs.size());
+    for (int i = 0; i < outputs.size(); i++) {
+        outputs[i] = fromFixedPoint(layerInputs[i]);
+    }
+    return outputs;
+}
+
+
+/*
+ * Convert a network's weights to fixed point for Network_A. Each layer's weights are Q1.14, or
+ * have as many fractional bits as still fit the layer's largest weight in an int16. The biases are
+ * held with the accumulator's fractional bits, so they are added exactly (see
+ * network-fixed-point.hpp).
+ */
+FixedPointNetwork convertToFixedPoint(Network_L *network) {
+    FixedPointNetwork fixedPoint;
+    fixedPoint.layerSizes = network->getLayerSizes();
+
+    for (int l = 0; l < network->getNumLayers(); l++) {
+        int numInputs = fixedPoint.layerSizes[l];
+        int numNodes = fixedPoint.layerSizes[l + 1];
+        std::vector<std::vector<float>> weights = network->getLayerWeights(l);
+
+        float largest = 0.0f;
+        for (int j = 0; j < numInputs; j++) {
+            for (int i = 0; i < numNodes; i++) {
+                largest = std::max(largest, std::fabs(weights[j][i]));
+            }
+        }
+        int fractionBits = 14;
+        while (fractionBits > 0 && std::round(std::ldexp(largest, fractionBits)) > 32767.0f) {
+            fractionBits--;
+        }
+
+        std::vector<int16_t> layerWeights(numInputs * numNodes);
+        std::vector<int32_t> layerBiases(numNodes);
+        for (int i = 0; i < numNodes; i++) {
+            for (int j = 0; j < numInputs; j++) {
+                double weight = std::round(std::ldexp(double(weights[j][i]), fractionBits));
+                layerWeights[i * numInputs + j] = int16_t(std::min(32767.0, std::max(-32768.0, weight)));
+            }
+            double bias = std::round(std::ldexp(double(weights[numInputs][i]), activationFractionBits + fractionBits));
+            bias = std::min(double(std::numeric_limits<int32_t>::max()),
+                            std::max(double(std::numeric_limits<int32_t>::min()), bias));
+            layerBiases[i] = int32_t(bias);
+        }
+
+        fixedPoint.activationFunctions.push_back(network->getLayerActivationFunction(l));
+        fixedPoint.weights.push_back(layerWeights);
+        fixedPoint.biases.push_back(layerBiases);
+        fixedPoint.weightFractionBits.push_back(fractionBits);
+    }
+    return fixedPoint;
+}
+
+
+/*
+ * Save a network in fixed point for Network_A, converted with convertToFixedPoint. The weight
+ * arrays keep the original code's names, and are node-major without the biases, and every layer
+ * is listed in fixedPointLayers. There are no float weights, so the file cannot be loaded
+ * back with loadNetwork. The estimated cost is saved as by saveNetwork.
+ */
+int saveFixedPointNetwork(std::string filename, Network_L *network, const DeviceBudget &budget) {
+    DeviceCost cost = estimateDeviceCost(network, ExportFormat::FixedPoint, budget.board, 0);
+    if (!withinDeviceBudget(cost, budget)) {
+        return 1; // Error code
+    }
+    FixedPointNetwork fixedPoint = convertToFixedPoint(network);
+
+    std::ofstream config_file (filename);
+    if (!config_file.is_open() || config_file.bad()) {
+        return 1; // Error code
+    }
+    writeHeader(config_file, network);
+
+    config_file << "// Q7.8 activations, and int16 weights with the fractional bits given per layer\n";
+    config_file << "#include \"network-fixed-point.hpp\"\n";
+    config_file << "#define FIXED_POINT_WEIGHTS\n";
     config_file << "\n";
+
+    writeIntegerLayers(config_file, network, "const FixedPointLayer fixedPointLayers",
+                       [&](int l, std::string prefix, std::string suffix,
+                           std::string inputsName, std::string nodesName) -> std::string {
+        writeArray(config_file, "const int16_t " + prefix + "Weights" + suffix + "[" + nodesName + "][" + inputsName + "]",
+                   fixedPoint.weights[l], fixedPoint.layerSizes[l], true);
+        writeArray(config_file, "const int32_t " + prefix + "Biases" + suffix + "[" + nodesName + "]",
+                   fixedPoint.biases[l], fixedPoint.layerSizes[l + 1], false);
+
+        return inputsName + ", " + nodesName + ", " + prefix + "Weights" + suffix + "[0], "
+               + prefix + "Biases" + suffix + ", " + std::to_string(fixedPoint.weightFractionBits[l]);
+    });
+    writeActivationArena(config_file, planActivationMemory(network->getLayerSizes(), ExportFormat::FixedPoint));
+    writeDeviceCost(config_file, cost, budget.board);
     config_file << "#endif // ARDUINO_CONFIG_H";
 
     config_file.close();
     return 0;
 }
+
+
+
+/*
+ * Fletcher-64 of a model file's 32-bit words, leaving out the header's checksum. Both sums are
+ * reduced once every modelChecksumBlock words, before the second can overflow.
+ */
+static uint64_t modelChecksum(const char *data, size_t bytes) {
+    const size_t modelChecksumBlock = 16384;
+    uint64_t sum1 = 0;
+    uint64_t sum2 = 0;
+    size_t skipFirst = offsetof(ModelHeader, checksum) / sizeof(uint32_t);
+    size_t skipLast = sizeof(ModelHeader) / sizeof(uint32_t);
+    size_t numWords = bytes / sizeof(uint32_t);
+    for (size_t first = 0; first < numWords; first += modelChecksumBlock) {
+        size_t last = std::min(numWords, first + modelChecksumBlock);
+        for (size_t i = first; i < last; i++) {
+            if (i >= skipFirst && i < skipLast) {
+                continue;
+            }
+            uint32_t word;
+            memcpy(&word, data + i * sizeof(uint32_t), sizeof(uint32_t));
+            sum1 += word;
+            sum2 += sum1;
+        }
+        sum1 %= 0xFFFFFFFF;
+        sum2 %= 0xFFFFFFFF;
+    }
+    return (sum2 << 32) | sum1;
+}
+
+
+/*
+ * Round a file offset up to the start of the next cache line
+ */
+static uint64_t alignedOffset(uint64_t offset) {
+    return (offset + cacheLineBytes - 1) / cacheLineBytes * cacheLineBytes;
+}
+
+
+/*
+ * Whether a file should be saved as a binary model file rather than a config, by its extension
+ */
+bool isModelFilename(std::string filename) {
+    return filename.size() >= modelExtension.size()
+           && filename.compare(filename.size() - modelExtension.size(), modelExtension.size(), modelExtension) == 0;
+}
+
+
+/*
+ * Save a network as a binary model file (see ModelHeader), for loading with loadModel or mapping
+ * with mapModel. The optimizer state is not saved, as with saveNetwork.
+ */
+int saveModel(std::string filename, Network_L *network) {
+    std::vector<int> layerSizes = network->getLayerSizes();
+    int numLayers = network->getNumLayers();
+
+    std::vector<ModelLayer> layers(numLayers);
+    uint64_t offset = sizeof(ModelHeader) + numLayers * sizeof(ModelLayer);
+    for (int l = 0; l < numLayers; l++) {
+        ModelLayer &layer = layers[l];
+        layer.numInputs = layerSizes[l];
+        layer.numNodes = layerSizes[l + 1];
+        layer.inputStride = paddedStride(layerSizes[l]);
+        layer.activationFunction = uint32_t(network->getLayerActivationFunction(l));
+        layer.weightsOffset = alignedOffset(offset);
+        layer.biasesOffset = alignedOffset(layer.weightsOffset + uint64_t(layer.numNodes) * layer.inputStride * sizeof(float));
+        offset = layer.biasesOffset + layer.numNodes * sizeof(float);
+    }
+
+    // Build the whole file in memory, zeroed so that the padding is too, and checksum it
+    std::vector<char> file(alignedOffset(offset), 0);
+    ModelHeader header = {};
+    memcpy(header.magic, modelMagic, sizeof(modelMagic));
+    header.byteOrder = modelByteOrder;
+    header.version = modelVersion;
+    header.fileBytes = file.size();
+    header.numLayers = numLayers;
+    header.errorFunction = uint32_t(network->getErrorFunction());
+    header.learningRate = network->getLearningRate();
+    header.momentum = network->getMomentum();
+    header.initialWeightMax = network->getInitialWeightMax();
+    header.trainingCycle = network->getTrainingCycle();
+    memcpy(file.data() + sizeof(ModelHeader), layers.data(), numLayers * sizeof(ModelLayer));
+    for (int l = 0; l < numLayers; l++) {
+        network->copyLayerWeights(l, reinterpret_cast<float *>(file.data() + layers[l].weightsOffset),
+                                  reinterpret_cast<float *>(file.data() + layers[l].biasesOffset));
+    }
+    memcpy(file.data(), &header, sizeof(ModelHeader));
+    header.checksum = modelChecksum(file.data(), file.size());
+    memcpy(file.data(), &header, sizeof(ModelHeader));
+
+    std::ofstream model_file(filename, std::ios::binary);
+    if (!model_file.is_open() || model_file.bad()) {
+        return 1; // Error code
+    }
+    model_file.write(file.data(), file.size());
+    model_file.close();
+    return model_file.good() ? 0 : 1;
+}
+
+
+/*
+ * Check that bytes of a mapped file are a complete, uncorrupted model file of this version,
+ * printing why not if they are not
+ */
+static bool checkModel(std::string filename, const char *data, size_t bytes) {
+    ModelHeader header;
+    if (bytes < sizeof(ModelHeader) || memcmp(data, modelMagic, sizeof(modelMagic)) != 0) {
+        std::cout << filename << " is not a model file\n";
+        return false;
+    }
+    memcpy(&header, data, sizeof(ModelHeader));
+    if (header.byteOrder != modelByteOrder) {
+        std::cout << filename << " was saved on a host of the other byte order\n";
+        return false;
+    }
+    if (header.version != modelVersion) {
+        std::cout << filename << " is a version " << header.version << " model file, but only version "
+                  << modelVersion << " can be read\n";
+        return false;
+    }
+    if (header.fileBytes != bytes || header.numLayers < 2
+            || header.numLayers > (bytes - sizeof(ModelHeader)) / sizeof(ModelLayer)) {
+        std::cout << filename << " is truncated or its header is corrupt\n";
+        return false;
+    }
+    if (modelChecksum(data, bytes) != header.checksum) {
+        std::cout << filename << " does not match its checksum\n";
+        return false;
+    }
+
+    // The checksum only shows the file is as saved, so check the layers fit together and in it
+    for (int l = 0; l < header.numLayers; l++) {
+        ModelLayer layer;
+        memcpy(&layer, data + sizeof(ModelHeader) + l * sizeof(ModelLayer), sizeof(ModelLayer));
+        ModelLayer previous;
+        memcpy(&previous, data + sizeof(ModelHeader) + (l > 0 ? l - 1 : 0) * sizeof(ModelLayer), sizeof(ModelLayer));
+        uint64_t weightsBytes = uint64_t(layer.numNodes) * layer.inputStride * sizeof(float);
+        if (layer.numInputs < 1 || layer.numNodes < 1 || layer.inputStride != paddedStride(layer.numInputs)
+                || (l > 0 && layer.numInputs != previous.numNodes)
+                || layer.activationFunction > uint32_t(ActivationFunction::SoftMax)
+                || layer.weightsOffset % cacheLineBytes != 0 || layer.biasesOffset % cacheLineBytes != 0
+                || layer.weightsOffset > bytes || weightsBytes > bytes - layer.weightsOffset
+                || layer.biasesOffset > bytes || layer.numNodes * sizeof(float) > bytes - layer.biasesOffset) {
+            std::cout << filename << " has an inconsistent layer " << l << "\n";
+            return false;
+        }
+    }
+    if (header.errorFunction > uint32_t(ErrorFunction::CrossEntropy)) {
+        std::cout << filename << " has an unknown error function\n";
+        return false;
+    }
+    return true;
+}
+
+
+/*
+ * Map a model file saved by saveModel read-only into memory, to classify with in place. Returns
+ * null if it cannot be mapped or is not a valid model file.
+ */
+MappedModel *mapModel(std::string filename) {
+    int descriptor = open(filename.c_str(), O_RDONLY);
+    if (descriptor < 0) {
+        return nullptr;
+    }
+    struct stat status;
+    if (fstat(descriptor, &status) != 0 || status.st_size < sizeof(ModelHeader)) {
+        close(descriptor);
+        std::cout << filename << " is not a model file\n";
+        return nullptr;
+    }
+    size_t bytes = status.st_size;
+    void *mapping = mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, descriptor, 0);
+    close(descriptor);
+    if (mapping == MAP_FAILED) {
+        std::cout << "Could not map " << filename << "\n";
+        return nullptr;
+    }
+    if (!checkModel(filename, static_cast<const char *>(mapping), bytes)) {
+        munmap(mapping, bytes);
+        return nullptr;
+    }
+    return new MappedModel(static_cast<const char *>(mapping), bytes);
+}
+
+
+/*
+ * Load a model file saved by saveModel into a Network_L, for training further. Each layer's
+ * weights are copied from the mapped file in one block. Returns null if the file cannot be mapped
+ * or is not a valid model file.
+ */
+Network_L *loadModel(std::string filename) {
+    MappedModel *model = mapModel(filename);
+    if (model == nullptr) {
+        return nullptr;
+    }
+    const ModelHeader &header = model->getHeader();
+    Network_L *network = new Network_L(model->getLayerSizes(), header.learningRate, header.momentum,
+                                       header.initialWeightMax, header.trainingCycle);
+    for (int l = 0; l < header.numLayers; l++) {
+        network->setLayerActivationFunction(l, ActivationFunction(model->getLayer(l).activationFunction));
+        network->loadLayerWeights(l, model->getLayerWeights(l), model->getLayer(l).inputStride,
+                                  model->getLayerBiases(l));
+    }
+    network->setErrorFunction(ErrorFunction(header.errorFunction));
+    delete model;
+    return network;
+}
+
+
+MappedModel::MappedModel(const char *data, size_t bytes): data(data), bytes(bytes) {
+    setActivationPrecision(ActivationPrecision::Exact);
+}
+
+
+MappedModel::~MappedModel() {
+    munmap(const_cast<char *>(data), bytes);
+}
+
+
+const ModelHeader &MappedModel::getHeader() const {
+    return *reinterpret_cast<const ModelHeader *>(data);
+}
+
+
+const ModelLayer &MappedModel::getLayer(int layer) const {
+    return reinterpret_cast<const ModelLayer *>(data + sizeof(ModelHeader))[layer];
+}
+
+
+/*
+ * One layer's weights in the mapped file, node-major rows of the layer's inputStride values
+ */
+const float *MappedModel::getLayerWeights(int layer) const {
+    return reinterpret_cast<const float *>(data + getLayer(layer).weightsOffset);
+}
+
+
+const float *MappedModel::getLayerBiases(int layer) const {
+    return reinterpret_cast<const float *>(data + getLayer(layer).biasesOffset);
+}
+
+
+int MappedModel::getNumInputNodes() const {
+    return getLayer(0).numInputs;
+}
+
+
+int MappedModel::getNumOutputNodes() const {
+    return getLayer(getHeader().numLayers - 1).numNodes;
+}
+
+
+/*
+ * The width of the inputs and then of each layer, as Network_L::getLayerSizes
+ */
+std::vector<int> MappedModel::getLayerSizes() const {
+    std::vector<int> layerSizes(1, getNumInputNodes());
+    for (int l = 0; l < getHeader().numLayers; l++) {
+        layerSizes.push_back(getLayer(l).numNodes);
+    }
+    return layerSizes;
+}
+
+
+/*
+ * Use exact or fast approximate activations, as Network_L::setActivationPrecision
+ */
+void MappedModel::setActivationPrecision(ActivationPrecision activationPrecision) {
+    activate.clear();
+    for (int l = 0; l < getHeader().numLayers; l++) {
+        activate.push_back(activationKernelFor(ActivationFunction(getLayer(l).activationFunction),
+                                               activationPrecision));
+    }
+}
+
+
+/*
+ * Check that activations were made for this model's layer sizes, so its rows are wide enough
+ */
+bool MappedModel::checkActivations(const Activations &activations) const {
+    int numLayers = getHeader().numLayers;
+    bool matches = activations.layerSizes.size() == numLayers + 1 && activations.layerSizes[0] == getNumInputNodes();
+    for (int l = 0; matches && l < numLayers; l++) {
+        matches = activations.layerSizes[l + 1] == getLayer(l).numNodes;
+    }
+    if (!matches) {
+        std::cout << "Activations were not made for this model's layer sizes\n";
+    }
+    return matches;
+}
+
+
+/*
+ * Classify one input pattern from the mapped weights, keeping the hidden activations in the
+ * caller's scratch space, which must have been made for this model's layer sizes. Returns 0 on
+ * success, or 1 if the lengths given or activations do not match the model.
+ */
+int MappedModel::classify(const float *inputs, int numInputs, float *outputs, int numOutputs,
+                          Activations &activations) const {
+    if (numInputs != getNumInputNodes() || numOutputs != getNumOutputNodes()) {
+        std::cout << "Pattern size " << numInputs << " -> " << numOutputs << " does not match model\n";
+        return 1; // Error code
+    }
+    return classifyBatch(inputs, 1, outputs, activations);
+}
+
+
+/*
+ * Classify a contiguous block of batchSize input patterns from the mapped weights, as
+ * Network_L::classifyBatch. Returns 0 on success, or 1 if activations were not made for this
+ * model's layer sizes.
+ */
+int MappedModel::classifyBatch(const float *inputs, int batchSize, float *outputs, Activations &activations) const {
+    if (!checkActivations(activations)) {
+        return 1; // Error code
+    }
+    const int classifyBlockSize = 64;
+    int numLayers = getHeader().numLayers;
+    int numInputNodes = getNumInputNodes();
+    int numOutputNodes = getNumOutputNodes();
+    activations.reserve(std::min(batchSize, classifyBlockSize));
+    for (int first = 0; first < batchSize; first += classifyBlockSize) {
+        int blockSize = std::min(classifyBlockSize, batchSize - first);
+        const float *layerInputs = inputs + first * numInputNodes;
+        int layerInputsStride = numInputNodes;
+        for (int l = 0; l < numLayers; l++) {
+            const ModelLayer &layer = getLayer(l);
+            bool isOutput = l == numLayers - 1;
+            float *layerNodes = isOutput ? outputs + first * numOutputNodes : activations.nodes[l].data();
+            int layerNodesStride = isOutput ? numOutputNodes : paddedStride(layer.numNodes);
+
+            multiplyABt(layerInputs, layerInputsStride, getLayerWeights(l), layer.inputStride, getLayerBiases(l),
+                        layerNodes, layerNodesStride, blockSize, layer.numNodes, layer.numInputs);
+            for (int r = 0; r < blockSize; r++) {
+                activate[l](layerNodes + r * layerNodesStride, layer.numNodes);
+            }
+
+            layerInputs = layerNodes;
+            layerInputsStride = layerNodesStride;
+        }
+    }
+    return 0;
+}
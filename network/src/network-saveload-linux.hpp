@@ -10,11 +10,232 @@
 #include <random>
 
 #include "network-linux.hpp"
+#include "network-quantized.hpp"
+#include "network-fixed-point.hpp"
+#include "sigmoid-table.hpp"
 
 #ifndef PROJECT_NETWORK_IO_H
 #define PROJECT_NETWORK_IO_H
 
+/*
+ * A network with int8 weights for Network_A's int8 path, as written by saveQuantizedNetwork.
+ * classify runs the same integer arithmetic as Network_A (see network-quantized.hpp), with the
+ * float network's activation functions, so its outputs can be compared with the float network's
+ * before the weights are flashed.
+ */
+class QuantizedNetwork {
+public:
+    std::vector<int> layerSizes;
+    std::vector<ActivationFunction> activationFunctions;
+    std::vector<std::vector<int8_t>> weights;               // [node][input] per layer, flattened
+    std::vector<std::vector<int32_t>> biases;
+    std::vector<std::vector<float>> scales;
+    std::vector<float> inputScales;                         // One per layer
+    std::vector<int8_t> inputZeroPoints;                    // One per layer
+
+    QuantizedLayer getLayer(int layer) const;
+    std::vector<float> classify(const std::vector<float> &inputs) const;
+};
+
+/*
+ * A network with Q7.8 activations and int16 weights for Network_A's fixed-point path, as written
+ * by saveFixedPointNetwork. classify runs the same integer arithmetic as Network_A (see
+ * network-fixed-point.hpp), with the float network's activation functions.
+ */
+class FixedPointNetwork {
+public:
+    std::vector<int> layerSizes;
+    std::vector<ActivationFunction> activationFunctions;
+    std::vector<std::vector<int16_t>> weights;              // [node][input] per layer, flattened
+    std::vector<std::vector<int32_t>> biases;
+    std::vector<int> weightFractionBits;                    // One per layer
+
+    FixedPointLayer getLayer(int layer) const;
+    std::vector<float> classify(const std::vector<float> &inputs) const;
+};
+
+/*
+ * A sigmoid lookup table for Network_A, as used by lookUpSigmoid (see sigmoid-table.hpp)
+ */
+struct SigmoidTable {
+    std::vector<uint16_t> entries;
+    float scale;                    // Entries per unit of input
+    double maxError;                // Largest difference from the exact sigmoid
+};
+
+/*
+ * The weight formats Network_A runs, as saved by saveNetwork, saveQuantizedNetwork and
+ * saveFixedPointNetwork
+ */
+enum class ExportFormat {Float, Int8, FixedPoint};
+
+/*
+ * How Network_A keeps its activations in SRAM, as planned by planActivationMemory. Every layer's
+ * nodes, the inputs first, share one arena. Each layer is only needed until the next one has been
+ * computed, so alternate layers are put at either end of an arena as large as the largest two
+ * adjacent layers.
+ */
+struct ActivationMemoryPlan {
+    std::vector<int> layerOffsets;  // Where each layer's nodes start in the arena, in activations
+    int arenaSize;                  // In activations
+    int arenaBytes;
+    int peakBytes;                  // The arena, the buffers the format needs besides and the flash buffer
+};
+
+// The boards estimateDeviceCost knows. Curie is the Arduino 101's ARC core, which the sketch is
+// written for, AVR an Uno class ATmega328P and CortexM0 a SAMD21 board such as the Zero.
+enum class Board {AVR, Curie, CortexM0};
+
+Board stringToBoard(std::string name);
+std::string boardToString(Board board);
+
+/*
+ * What a board has room for, and rough cycle costs of the operations Network_A's classify is made
+ * of. None of the boards has an FPU, so float arithmetic and exp are library routines. The costs
+ * are taken from instruction timings and typical library routines rather than measured, and
+ * include the loop around each operation, so they are only good for comparing networks and
+ * formats, and for catching one that is far too slow.
+ */
+struct BoardProfile {
+    double clockMHz;
+    long flashBytes;                // Left for the sketch after any bootloader
+    int sramBytes;
+    double floatMultiplyAdd;        // Cycles each
+    double floatDivide;
+    double floatExp;
+    double floatCompare;
+    double int8MultiplyAdd;         // Into an int32
+    double int16MultiplyAdd;        // Into an int32, saturating
+    double integerDivide;           // int32
+    double integerCompare;
+    double flashReadPerByte;        // Copied to SRAM with memcpy_P
+};
+
+/*
+ * Network_A's estimated cost on a board, as given by estimateDeviceCost
+ */
+struct DeviceCost {
+    long flashBytes;                // The weights, biases, scales and sigmoid table, not the code
+    int sramBytes;                  // For activations, as planned by planActivationMemory
+    long multiplyAdds;              // A classification
+    long flashBytesRead;            // A classification
+    double cycles;                  // A classification
+    double milliseconds;            // A classification
+};
+
+/*
+ * Limits on Network_A's cost on a board. A flash or SRAM limit of 0 is all the board has, and a
+ * time of 0 is no limit.
+ */
+struct DeviceBudget {
+    Board board;
+    long flashBytes;
+    int sramBytes;
+    double milliseconds;
+};
+
+const DeviceBudget defaultDeviceBudget = {Board::Curie, 0, 0, 0.0};
+
+/*
+ * The binary model file written by saveModel. Where a saved config is C for Network_A, a model file
+ * holds each layer's weights exactly as Network_L keeps them in memory, so that mapModel can map it
+ * and classify with it in place, and loadModel can copy each layer in one block, with nothing to
+ * parse either way.
+ *
+ * A file is a ModelHeader, then a ModelLayer for each layer, then each layer's weights and biases.
+ * The weights are node-major, each node's input weights padded with zeros to inputStride values
+ * (see paddedStride), and every block of weights or biases starts on a cache line. Values are in
+ * the byte order of the host that saved the file, which byteOrder records. The checksum is a
+ * Fletcher-64 of the file's 32-bit words, leaving out the checksum itself.
+ *
+ * The version is raised whenever the layout changes, and files of another version are refused.
+ */
+const char modelMagic[8] = {'W', 'A', 'L', 'R', 'U', 'S', 'N', 'N'};
+const uint32_t modelVersion = 1;
+const uint32_t modelByteOrder = 0x01020304;
+const std::string modelExtension = ".model";
+
+struct ModelHeader {
+    char magic[8];                  // modelMagic
+    uint32_t byteOrder;             // modelByteOrder
+    uint32_t version;
+    uint64_t fileBytes;
+    uint32_t numLayers;             // Hidden layers and the output layer
+    uint32_t errorFunction;         // An ErrorFunction
+    float learningRate;
+    float momentum;
+    float initialWeightMax;
+    uint32_t reserved;              // 0
+    int64_t trainingCycle;
+    uint64_t checksum;
+};
+
+struct ModelLayer {
+    uint32_t numInputs;
+    uint32_t numNodes;
+    uint32_t inputStride;           // Values in each node's row of weights
+    uint32_t activationFunction;    // An ActivationFunction
+    uint64_t weightsOffset;         // In bytes from the start of the file
+    uint64_t biasesOffset;
+};
+
+/*
+ * A model file mapped read-only into memory by mapModel, which classifies straight from the
+ * mapping, with the same kernels as Network_L. The file is unmapped when it is deleted. Nothing is
+ * written to it, so many threads can classify with one, each with Activations of its own.
+ */
+class MappedModel {
+public:
+    ~MappedModel();
+    MappedModel(const MappedModel &) = delete;
+    MappedModel &operator=(const MappedModel &) = delete;
+
+    const ModelHeader &getHeader() const;
+    const ModelLayer &getLayer(int layer) const;
+    const float *getLayerWeights(int layer) const;
+    const float *getLayerBiases(int layer) const;
+    int getNumInputNodes() const;
+    int getNumOutputNodes() const;
+    std::vector<int> getLayerSizes() const;
+    void setActivationPrecision(ActivationPrecision activationPrecision);
+    int classify(const float *inputs, int numInputs, float *outputs, int numOutputs,
+                 Activations &activations) const;
+    int classifyBatch(const float *inputs, int batchSize, float *outputs, Activations &activations) const;
+
+private:
+    MappedModel(const char *data, size_t bytes);
+    friend MappedModel *mapModel(std::string filename);
+    bool checkActivations(const Activations &activations) const;
+
+    const char *data;
+    size_t bytes;
+    std::vector<ActivationKernel> activate;                 // One per layer
+};
+
+// Largest difference from the exact sigmoid of the lookup table saved with a network by default
+const float defaultSigmoidTableError = 0.0001f;
+
 Network_L *loadNetwork(std::string filename);
-int saveNetwork(std::string filename, Network_L *network);
+SigmoidTable buildSigmoidTable(float maxError);
+bool needsSigmoidTable(Network_L *network);
+bool buildSavedSigmoidTable(Network_L *network, float sigmoidTableError, SigmoidTable &table);
+ActivationMemoryPlan planActivationMemory(const std::vector<int> &layerSizes, ExportFormat format);
+BoardProfile getBoardProfile(Board board);
+DeviceCost estimateDeviceCost(Network_L *network, ExportFormat format, Board board, int sigmoidTableSize);
+bool withinDeviceBudget(const DeviceCost &cost, const DeviceBudget &budget);
+int saveNetwork(std::string filename, Network_L *network, float sigmoidTableError = defaultSigmoidTableError,
+                const DeviceBudget &budget = defaultDeviceBudget);
+QuantizedNetwork quantizeNetwork(Network_L *network, const std::vector<std::vector<float>> &calibrationInputs);
+int saveQuantizedNetwork(std::string filename, Network_L *network,
+                         const std::vector<std::vector<float>> &calibrationInputs,
+                         float sigmoidTableError = defaultSigmoidTableError,
+                         const DeviceBudget &budget = defaultDeviceBudget);
+FixedPointNetwork convertToFixedPoint(Network_L *network);
+int saveFixedPointNetwork(std::string filename, Network_L *network,
+                          const DeviceBudget &budget = defaultDeviceBudget);
+bool isModelFilename(std::string filename);
+int saveModel(std::string filename, Network_L *network);
+MappedModel *mapModel(std::string filename);
+Network_L *loadModel(std::string filename);
 
 #endif //PROJECT_NETWORK_IO_H
@@ -0,0 +1,196 @@
+/*
+ * Network is a forward-only network whose shape and activation functions are template arguments,
+ * for a trained network whose shape is fixed at build time.
+ *
+ * With every loop bound a constant the compiler can unroll and vectorise the whole forward pass,
+ * and the activation functions are chosen at compile time rather than per node. It is header only
+ * and uses nothing from the standard library, so the same code builds on Linux and Arduino.
+ *
+ * The weights are not copied: the network refers to the config's weight arrays. Those saveNetwork
+ * writes are node-major, each node's bias and then its input weights, and are streamed from flash
+ * a block at a time (see flash-memory.hpp), as Network_A reads them. Older configs have them in
+ * the original code's [input][node] layout with the biases as the final row, read directly, so
+ * they must be in SRAM. On Arduino, for a config saveNetwork wrote:
+ *
+ *     Network<numInputNodes, numHiddenNodes, numOutputNodes, ActivationFunction::Sigmoid,
+ *             ActivationFunction::Sigmoid, WeightLayout::NodeMajor> network(hiddenWeights, outputWeights);
+ */
+
+#ifndef NETWORK_STATIC_H
+#define NETWORK_STATIC_H
+
+#include <math.h>
+
+#include "activation-function.hpp"
+#include "flash-memory.hpp"
+
+/*
+ * The exact sigmoid, as Network_L computes it. Network_A gives its own for a config with a sigmoid
+ * lookup table.
+ */
+struct ExactSigmoid {
+    static float apply(float x) {
+        return float(1.0/(1.0 + exp(-x)));
+    }
+};
+
+/*
+ * Replace a layer's N accumulated inputs with their activations. Each specialisation matches the
+ * exact activations of Network_L and Network_A, with the sigmoid given.
+ */
+template<ActivationFunction AF>
+struct LayerActivation;
+
+template<>
+struct LayerActivation<ActivationFunction::Sigmoid> {
+    template<int N, typename Sigmoid = ExactSigmoid>
+    static void apply(float nodes[]) {
+        for (int i = 0; i < N; i++) {
+            nodes[i] = Sigmoid::apply(nodes[i]);
+        }
+    }
+};
+
+template<>
+struct LayerActivation<ActivationFunction::ReLu> {
+    template<int N, typename Sigmoid = ExactSigmoid>
+    static void apply(float nodes[]) {
+        for (int i = 0; i < N; i++) {
+            nodes[i] = nodes[i] > 0.0f ? nodes[i] : 0.0f;
+        }
+    }
+};
+
+template<>
+struct LayerActivation<ActivationFunction::SoftMax> {
+    template<int N, typename Sigmoid = ExactSigmoid>
+    static void apply(float nodes[]) {
+        // The largest input is subtracted first, which keeps exp from overflowing
+        float largest = nodes[0];
+        for (int i = 1; i < N; i++) {
+            largest = nodes[i] > largest ? nodes[i] : largest;
+        }
+        float sum = 0;
+        for (int i = 0; i < N; i++) {
+            nodes[i] = exp(nodes[i] - largest);
+            sum += nodes[i];
+        }
+        for (int i = 0; i < N; i++) {
+            nodes[i] = nodes[i] / sum;
+        }
+    }
+};
+
+/*
+ * How a layer's weights are laid out: node-major as saveNetwork writes them, or the original
+ * code's [input][node] layout
+ */
+enum class WeightLayout {InputMajor, NodeMajor};
+
+/*
+ * The weight array of a layer with NInputs inputs and NNodes nodes in each layout, and the sum
+ * of each node's bias and weighted inputs. Either way each node adds its bias and then its inputs
+ * in order, as Network_A does.
+ */
+template<int NInputs, int NNodes, WeightLayout Layout>
+struct LayerWeights;
+
+template<int NInputs, int NNodes>
+struct LayerWeights<NInputs, NNodes, WeightLayout::InputMajor> {
+    typedef float Type[NInputs + 1][NNodes];
+
+    // The inputs are walked in the outer loop so that each row of weights is read contiguously
+    static void accumulate(const float inputs[], const Type &weights, float accumulatedInputs[]) {
+        for (int i = 0; i < NNodes; i++) {
+            accumulatedInputs[i] = weights[NInputs][i];
+        }
+        for (int j = 0; j < NInputs; j++) {
+            float input = inputs[j];
+            for (int i = 0; i < NNodes; i++) {
+                accumulatedInputs[i] += input * weights[j][i];
+            }
+        }
+    }
+};
+
+template<int NInputs, int NNodes>
+struct LayerWeights<NInputs, NNodes, WeightLayout::NodeMajor> {
+    typedef float Type[NNodes][NInputs + 1];
+
+    // Each node's row is streamed from flash a block at a time
+    static void accumulate(const float inputs[], const Type &weights, float accumulatedInputs[]) {
+        for (int i = 0; i < NNodes; i++) {
+            float accumulatedInput = readFromFlash(&weights[i][0]);
+            streamFromFlash(&weights[i][1], NInputs, [&](int j, float weight) {
+                accumulatedInput += inputs[j] * weight;
+            });
+            accumulatedInputs[i] = accumulatedInput;
+        }
+    }
+};
+
+template<int NIn, int NHidden, int NOut,
+         ActivationFunction HiddenAF = ActivationFunction::Sigmoid,
+         ActivationFunction OutputAF = ActivationFunction::Sigmoid,
+         WeightLayout Layout = WeightLayout::InputMajor,
+         typename Sigmoid = ExactSigmoid>
+class Network {
+public:
+    typedef typename LayerWeights<NIn, NHidden, Layout>::Type HiddenWeights;
+    typedef typename LayerWeights<NHidden, NOut, Layout>::Type OutputWeights;
+
+    Network(const HiddenWeights &hiddenWeights, const OutputWeights &outputWeights):
+            hiddenWeights(hiddenWeights),
+            outputWeights(outputWeights) {
+    }
+
+    /*
+     * Classify the given input pattern, writing the hidden layer's activations into hiddenNodes
+     * and the predicted output into outputs. Returns the last output node's accumulated input,
+     * which Network_A reports as its accumulated input. Never writes to the network, so one
+     * network can be shared by many threads.
+     */
+    float classify(const float inputs[], float hiddenNodes[], float outputs[]) const {
+        computeLayerActivations<NIn, NHidden, HiddenAF>(inputs, hiddenWeights, hiddenNodes);
+        return computeLayerActivations<NHidden, NOut, OutputAF>(hiddenNodes, outputWeights, outputs);
+    }
+
+    /*
+     * Classify the given input pattern, writing the predicted output into outputs
+     */
+    float classify(const float inputs[], float outputs[]) const {
+        float hiddenNodes[NHidden];
+        return classify(inputs, hiddenNodes, outputs);
+    }
+
+    static constexpr int getNumInputNodes() { return NIn; }
+    static constexpr int getNumHiddenNodes() { return NHidden; }
+    static constexpr int getNumOutputNodes() { return NOut; }
+    static constexpr ActivationFunction getHiddenActivationFunction() { return HiddenAF; }
+    static constexpr ActivationFunction getOutputActivationFunction() { return OutputAF; }
+
+private:
+    const HiddenWeights &hiddenWeights;
+    const OutputWeights &outputWeights;
+
+    /*
+     * Compute the activations of a layer's nodes from its inputs, and return the last node's
+     * accumulated input. The sums are kept in a local array, which the compiler knows cannot
+     * alias the weights, so they can stay in registers.
+     */
+    template<int NInputs, int NNodes, ActivationFunction AF>
+    static float computeLayerActivations(const float inputs[],
+                                         const typename LayerWeights<NInputs, NNodes, Layout>::Type &weights,
+                                         float nodes[]) {
+        float accumulatedInputs[NNodes];
+        LayerWeights<NInputs, NNodes, Layout>::accumulate(inputs, weights, accumulatedInputs);
+        float lastAccumulatedInput = accumulatedInputs[NNodes - 1];
+        LayerActivation<AF>::template apply<NNodes, Sigmoid>(accumulatedInputs);
+        for (int i = 0; i < NNodes; i++) {
+            nodes[i] = accumulatedInputs[i];
+        }
+        return lastAccumulatedInput;
+    }
+};
+
+#endif // NETWORK_STATIC_H
@@ -0,0 +1,39 @@
+/*
+ * Sigmoid from a lookup table, for Network_A on boards where exp is expensive. The table is
+ * written by saveNetwork (see buildSigmoidTable in network-saveload-linux.hpp), sized so that
+ * lookUpSigmoid is within a given error of the exact function.
+ *
+ * The table holds the sigmoid at evenly spaced points from 0, and is interpolated linearly between
+ * them. Negative inputs use sigmoid(-x) = 1 - sigmoid(x), and inputs beyond the last point
+ * saturate to 0 or 1. As every entry is between 0.5 and 1, each is stored as a uint16 count of
+ * 1/131070 steps above 0.5.
+ *
+ * Kept free of the standard library so that it compiles on Arduino.
+ */
+
+#ifndef SIGMOID_TABLE_H
+#define SIGMOID_TABLE_H
+
+#include <stdint.h>
+
+#include "flash-memory.hpp"
+
+const float sigmoidTableStep = 1.0f / 131070;
+
+/*
+ * Sigmoid of x from a table in flash of size entries, scale entries apart per unit of x
+ */
+inline float lookUpSigmoid(float x, const uint16_t table[], int size, float scale) {
+    float position = (x < 0.0f ? -x : x) * scale;
+    if (!(position < size - 1)) {
+        return x < 0.0f ? 0.0f : 1.0f;
+    }
+    int i = int(position);
+    float fraction = position - i;
+    float lower = readFromFlash(&table[i]);
+    float upper = readFromFlash(&table[i + 1]);
+    float value = 0.5f + (lower + fraction * (upper - lower)) * sigmoidTableStep;
+    return x < 0.0f ? 1.0f - value : value;
+}
+
+#endif // SIGMOID_TABLE_H
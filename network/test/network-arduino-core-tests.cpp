@@ -20,4 +20,54 @@ TEST_CASE("The network can be successfully initialised and used to classify") {
             }
         }
     }
+
+    GIVEN("The original code's forward pass over the #included weights") {
+        std::mt19937 m_mt(3);
+        std::uniform_real_distribution<float> test_dist(0.0f, 2.0f);
+        float inputs[numInputNodes];
+        for (float &input : inputs) {
+            input = test_dist(m_mt);
+        }
+
+        float hidden[numHiddenNodes];
+        for (int i = 0; i < numHiddenNodes; i++) {
+            float accumulated = hiddenWeights[numInputNodes][i];
+            for (int j = 0; j < numInputNodes; j++) {
+                accumulated += inputs[j] * hiddenWeights[j][i];
+            }
+            hidden[i] = float(1.0/(1.0 + exp(-accumulated)));
+        }
+        float expected[numOutputNodes];
+        float accumulated;
+        for (int i = 0; i < numOutputNodes; i++) {
+            accumulated = outputWeights[numHiddenNodes][i];
+            for (int j = 0; j < numHiddenNodes; j++) {
+                accumulated += hidden[j] * outputWeights[j][i];
+            }
+            expected[i] = float(1.0/(1.0 + exp(-accumulated)));
+        }
+
+        Network_A network;
+
+        THEN("The network classifies as it does") {
+            float *output = network.classify(inputs);
+            for (int i = 0; i < numOutputNodes; i++) {
+                REQUIRE(output[i] == Approx(expected[i]));
+                REQUIRE(network.getOutputNodes()[i] == output[i]);
+            }
+            for (int i = 0; i < numHiddenNodes; i++) {
+                REQUIRE(network.getHiddenNodes()[i] == Approx(hidden[i]));
+            }
+            REQUIRE(network.getAccumulatedInput() == Approx(accumulated));
+        }
+
+        THEN("It classifies the same from inputs written into the network's own input nodes") {
+            float *inputNodes = network.getInputNodes();
+            std::copy(inputs, inputs + numInputNodes, inputNodes);
+            float *output = network.classify(inputNodes);
+            for (int i = 0; i < numOutputNodes; i++) {
+                REQUIRE(output[i] == Approx(expected[i]));
+            }
+        }
+    }
 }
\ No newline at end of file
@@ -0,0 +1,420 @@
+#include "../../lib/catch.hpp"
+#include "../src/network-kernels.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+/* Unit tests for the SIMD kernels, checked against the scalar reference implementation. */
+
+TEST_CASE("Every supported kernel instruction set matches the scalar reference") {
+    std::mt19937 m_mt(1234);
+    std::uniform_real_distribution<float> test_dist = std::uniform_real_distribution<float>(-1.0f, 1.0f);
+
+    // Awkward sizes so that every vector width has a ragged tail
+    int m = 7;
+    int n = 13;
+    int k = 301;
+    int lda = 304;
+    int ldb = 304;
+    int ldc = 16;
+
+    // a doubles as the k x m operand of multiplyAtB, so give it enough rows for both uses
+    std::vector<float> a(n * lda);
+    std::vector<float> b(n * ldb);
+    std::vector<float> bias(n);
+    for (int i = 0; i < a.size(); i++) {
+        a[i] = test_dist(m_mt);
+    }
+    for (int i = 0; i < b.size(); i++) {
+        b[i] = test_dist(m_mt);
+    }
+    for (int i = 0; i < n; i++) {
+        bias[i] = test_dist(m_mt);
+    }
+
+    KernelIsa detected = detectKernelIsa();
+
+    setKernelIsa(KernelIsa::Scalar);
+    REQUIRE(getKernelIsa() == KernelIsa::Scalar);
+
+    float referenceDot = dotProduct(a.data(), b.data(), k);
+
+    std::vector<float> referenceAxpy(b.begin(), b.begin() + k);
+    axpy(0.37f, a.data(), referenceAxpy.data(), k);
+
+    std::vector<float> referenceWeights(b.begin(), b.begin() + k);
+    std::vector<float> referenceChanges(a.begin() + k, a.begin() + 2 * k);
+    momentumUpdate(referenceWeights.data(), referenceChanges.data(), a.data(), 0.3f, 0.9f, k);
+
+    std::vector<float> referenceFusedWeights(b.begin(), b.begin() + k);
+    std::vector<float> referenceFusedChanges(a.begin() + k, a.begin() + 2 * k);
+    std::vector<float> referenceFusedDeltas(b.begin() + k, b.begin() + 2 * k);
+    backpropagateMomentumUpdate(referenceFusedWeights.data(), referenceFusedChanges.data(), a.data(),
+                                referenceFusedDeltas.data(), 0.7f, 0.21f, 0.9f, k);
+
+    // The adaptive optimizers' second moments must not be negative
+    std::vector<float> squares(k);
+    for (int i = 0; i < k; i++) {
+        squares[i] = a[k + i] * a[k + i];
+    }
+
+    std::vector<float> referenceNesterovWeights(b.begin(), b.begin() + k);
+    std::vector<float> referenceNesterovChanges(a.begin() + k, a.begin() + 2 * k);
+    nesterovUpdate(referenceNesterovWeights.data(), referenceNesterovChanges.data(), a.data(), 0.3f, 0.9f, k);
+
+    std::vector<float> referenceRmsPropWeights(b.begin(), b.begin() + k);
+    std::vector<float> referenceRmsPropSquares(squares);
+    rmsPropUpdate(referenceRmsPropWeights.data(), referenceRmsPropSquares.data(), a.data(), 0.01f, 0.9f, 1e-8f, k);
+
+    std::vector<float> referenceAdamWeights(b.begin(), b.begin() + k);
+    std::vector<float> referenceAdamMoments(a.begin() + k, a.begin() + 2 * k);
+    std::vector<float> referenceAdamSquares(squares);
+    adamUpdate(referenceAdamWeights.data(), referenceAdamMoments.data(), referenceAdamSquares.data(), a.data(),
+               0.01f, 0.9f, 0.999f, 1e-8f, k);
+
+    std::vector<float> referenceABt(m * ldc);
+    multiplyABt(a.data(), lda, b.data(), ldb, bias.data(), referenceABt.data(), ldc, m, n, k);
+
+    std::vector<float> referenceAB(m * ldb);
+    multiplyAB(a.data(), lda, b.data(), ldb, referenceAB.data(), ldb, m, k, n);
+
+    std::vector<float> referenceAtB(m * ldb);
+    multiplyAtB(a.data(), lda, b.data(), ldb, referenceAtB.data(), ldb, m, k, n);
+
+    for (int isaIndex = int(KernelIsa::SSE2); isaIndex <= int(detected); isaIndex++) {
+        KernelIsa isa = KernelIsa(isaIndex);
+
+        GIVEN("The " + kernelIsaToString(isa) + " kernels") {
+            REQUIRE(setKernelIsa(isa) == isa);
+
+            THEN("The dot product matches") {
+                REQUIRE(dotProduct(a.data(), b.data(), k) == Approx(referenceDot).epsilon(1e-4));
+            }
+            THEN("axpy matches") {
+                std::vector<float> y(b.begin(), b.begin() + k);
+                axpy(0.37f, a.data(), y.data(), k);
+                for (int i = 0; i < k; i++) {
+                    REQUIRE(y[i] == Approx(referenceAxpy[i]));
+                }
+            }
+            THEN("The momentum update matches") {
+                std::vector<float> weights(b.begin(), b.begin() + k);
+                std::vector<float> changes(a.begin() + k, a.begin() + 2 * k);
+                momentumUpdate(weights.data(), changes.data(), a.data(), 0.3f, 0.9f, k);
+                for (int i = 0; i < k; i++) {
+                    REQUIRE(weights[i] == Approx(referenceWeights[i]));
+                    REQUIRE(changes[i] == Approx(referenceChanges[i]));
+                }
+            }
+            THEN("The fused backpropagation and momentum update matches") {
+                std::vector<float> weights(b.begin(), b.begin() + k);
+                std::vector<float> changes(a.begin() + k, a.begin() + 2 * k);
+                std::vector<float> deltas(b.begin() + k, b.begin() + 2 * k);
+                backpropagateMomentumUpdate(weights.data(), changes.data(), a.data(), deltas.data(), 0.7f, 0.21f, 0.9f, k);
+                for (int i = 0; i < k; i++) {
+                    REQUIRE(weights[i] == Approx(referenceFusedWeights[i]));
+                    REQUIRE(changes[i] == Approx(referenceFusedChanges[i]));
+                    REQUIRE(deltas[i] == Approx(referenceFusedDeltas[i]));
+                }
+
+                // Exactly the same as the two separate kernels it replaces
+                std::vector<float> separateWeights(b.begin(), b.begin() + k);
+                std::vector<float> separateChanges(a.begin() + k, a.begin() + 2 * k);
+                std::vector<float> separateDeltas(b.begin() + k, b.begin() + 2 * k);
+                axpy(0.7f, separateWeights.data(), separateDeltas.data(), k);
+                momentumUpdate(separateWeights.data(), separateChanges.data(), a.data(), 0.21f, 0.9f, k);
+                REQUIRE(weights == separateWeights);
+                REQUIRE(changes == separateChanges);
+                REQUIRE(deltas == separateDeltas);
+            }
+            THEN("The Nesterov, RMSProp and Adam updates match") {
+                std::vector<float> weights(b.begin(), b.begin() + k);
+                std::vector<float> changes(a.begin() + k, a.begin() + 2 * k);
+                nesterovUpdate(weights.data(), changes.data(), a.data(), 0.3f, 0.9f, k);
+                for (int i = 0; i < k; i++) {
+                    REQUIRE(weights[i] == Approx(referenceNesterovWeights[i]));
+                    REQUIRE(changes[i] == Approx(referenceNesterovChanges[i]));
+                }
+
+                std::vector<float> rmsPropWeights(b.begin(), b.begin() + k);
+                std::vector<float> rmsPropSquares(squares);
+                rmsPropUpdate(rmsPropWeights.data(), rmsPropSquares.data(), a.data(), 0.01f, 0.9f, 1e-8f, k);
+                for (int i = 0; i < k; i++) {
+                    REQUIRE(rmsPropWeights[i] == Approx(referenceRmsPropWeights[i]));
+                    REQUIRE(rmsPropSquares[i] == Approx(referenceRmsPropSquares[i]));
+                }
+
+                std::vector<float> adamWeights(b.begin(), b.begin() + k);
+                std::vector<float> adamMoments(a.begin() + k, a.begin() + 2 * k);
+                std::vector<float> adamSquares(squares);
+                adamUpdate(adamWeights.data(), adamMoments.data(), adamSquares.data(), a.data(),
+                           0.01f, 0.9f, 0.999f, 1e-8f, k);
+                for (int i = 0; i < k; i++) {
+                    REQUIRE(adamWeights[i] == Approx(referenceAdamWeights[i]));
+                    REQUIRE(adamMoments[i] == Approx(referenceAdamMoments[i]));
+                    REQUIRE(adamSquares[i] == Approx(referenceAdamSquares[i]));
+                }
+            }
+            THEN("The matrix products match") {
+                std::vector<float> c(m * ldc);
+                multiplyABt(a.data(), lda, b.data(), ldb, bias.data(), c.data(), ldc, m, n, k);
+                for (int i = 0; i < m; i++) {
+                    for (int j = 0; j < n; j++) {
+                        REQUIRE(c[i * ldc + j] == Approx(referenceABt[i * ldc + j]).epsilon(1e-4));
+                    }
+                }
+
+                std::vector<float> d(m * ldb);
+                multiplyAB(a.data(), lda, b.data(), ldb, d.data(), ldb, m, k, n);
+                std::vector<float> e(m * ldb);
+                multiplyAtB(a.data(), lda, b.data(), ldb, e.data(), ldb, m, k, n);
+                for (int i = 0; i < m; i++) {
+                    for (int j = 0; j < k; j++) {
+                        REQUIRE(d[i * ldb + j] == Approx(referenceAB[i * ldb + j]).epsilon(1e-4));
+                        REQUIRE(e[i * ldb + j] == Approx(referenceAtB[i * ldb + j]).epsilon(1e-4));
+                    }
+                }
+            }
+        }
+    }
+
+    setKernelIsa(detected);
+    REQUIRE(getKernelIsa() == detected);
+}
+
+TEST_CASE("The fast activation kernels stay within their documented error bounds") {
+    // Sweep the whole clamped input range, including both ends
+    int n = 100001;
+    std::vector<float> inputs(n);
+    for (int i = 0; i < n; i++) {
+        inputs[i] = -87.0f + 175.0f * i / (n - 1);
+    }
+
+    KernelIsa detected = detectKernelIsa();
+
+    for (int isaIndex = int(KernelIsa::Scalar); isaIndex <= int(detected); isaIndex++) {
+        KernelIsa isa = KernelIsa(isaIndex);
+
+        GIVEN("The " + kernelIsaToString(isa) + " kernels") {
+            REQUIRE(setKernelIsa(isa) == isa);
+
+            THEN("exp is within its relative error bound") {
+                std::vector<float> values(inputs);
+                expLayer(values.data(), n);
+                double worst = 0.0;
+                for (int i = 0; i < n; i++) {
+                    double exact = std::exp(double(inputs[i]));
+                    worst = std::max(worst, std::fabs(values[i] - exact) / exact);
+                }
+                REQUIRE(worst < fastExpMaxRelativeError);
+            }
+            THEN("sigmoid is within its absolute error bound") {
+                std::vector<float> values(inputs);
+                sigmoidLayer(values.data(), n);
+                double worst = 0.0;
+                for (int i = 0; i < n; i++) {
+                    double exact = 1.0 / (1.0 + std::exp(-double(inputs[i])));
+                    worst = std::max(worst, std::fabs(values[i] - exact));
+                }
+                REQUIRE(worst < fastSigmoidMaxAbsoluteError);
+            }
+            THEN("Extreme inputs saturate rather than overflowing") {
+                float values[4] = { -1000.0f, 1000.0f, -1000.0f, 1000.0f };
+                expLayer(values, 2);
+                sigmoidLayer(values + 2, 2);
+                REQUIRE(values[0] >= 0.0f);
+                REQUIRE(std::isfinite(values[1]));
+                REQUIRE(values[2] == Approx(0.0f));
+                REQUIRE(values[3] == Approx(1.0f));
+            }
+            THEN("SoftMax with cross entropy matches the exact computation, even for extreme inputs") {
+                // Awkward length so that every vector width has a ragged tail
+                int m = 37;
+                std::vector<float> logits(m);
+                std::vector<float> targets(m);
+                for (int i = 0; i < m; i++) {
+                    logits[i] = 2000.0f * i / (m - 1) - 1000.0f;
+                    targets[i] = float(i % 3) / m;
+                }
+                logits[m - 2] = 999.5f;
+
+                double max = *std::max_element(logits.begin(), logits.end());
+                double expSum = 0.0;
+                double targetSum = 0.0;
+                for (int i = 0; i < m; i++) {
+                    expSum += std::exp(logits[i] - max);
+                    targetSum += targets[i];
+                }
+                double expectedLoss = 0.0;
+                for (int i = 0; i < m; i++) {
+                    expectedLoss -= targets[i] * (logits[i] - max - std::log(expSum));
+                }
+
+                std::vector<float> values(logits);
+                std::vector<float> deltas(m);
+                float loss = softMaxCrossEntropyLayer(values.data(), targets.data(), deltas.data(), m);
+                REQUIRE(loss == Approx(expectedLoss).epsilon(1e-5));
+                for (int i = 0; i < m; i++) {
+                    double p = std::exp(logits[i] - max) / expSum;
+                    REQUIRE(values[i] == Approx(p).margin(1e-6));
+                    REQUIRE(deltas[i] == Approx(targets[i] - p * targetSum).margin(1e-6));
+                }
+            }
+        }
+    }
+
+    setKernelIsa(detected);
+}
+
+/*
+ * Expand a row of reduced-precision values with the scalar reference
+ */
+static std::vector<float> expanded(const std::vector<uint16_t> &halves, HalfFormat format) {
+    KernelIsa isa = getKernelIsa();
+    setKernelIsa(KernelIsa::Scalar);
+    std::vector<float> values(halves.size());
+    expandHalf(halves.data(), values.data(), halves.size(), format);
+    setKernelIsa(isa);
+    return values;
+}
+
+TEST_CASE("The reduced-precision kernels round as documented") {
+    std::mt19937 m_mt(1234);
+    std::uniform_real_distribution<float> test_dist = std::uniform_real_distribution<float>(-1.0f, 1.0f);
+
+    // Awkward length so that every vector width has a ragged tail, with values across the Float16
+    // range: subnormal, normal and beyond its largest value
+    int k = 301;
+    std::vector<float> a(k);
+    std::vector<float> b(k);
+    std::vector<float> values(k);
+    for (int i = 0; i < k; i++) {
+        a[i] = test_dist(m_mt);
+        b[i] = test_dist(m_mt);
+        values[i] = test_dist(m_mt) * std::pow(2.0f, float(i % 48 - 30));
+    }
+
+    KernelIsa detected = detectKernelIsa();
+    HalfFormat formats[] = {HalfFormat::BFloat16, HalfFormat::Float16};
+
+    for (HalfFormat format : formats) {
+        std::string name = format == HalfFormat::BFloat16 ? "BFloat16" : "Float16";
+        setKernelIsa(KernelIsa::Scalar);
+
+        std::vector<uint16_t> referenceHalves(k);
+        roundToHalf(values.data(), referenceHalves.data(), k, format);
+
+        std::vector<uint16_t> halfB(k);
+        roundToHalf(b.data(), halfB.data(), k, format);
+        float referenceDot = dotProductHalf(a.data(), halfB.data(), k, format);
+
+        std::vector<uint16_t> referenceWeights(halfB);
+        std::vector<uint16_t> referenceChanges(k);
+        roundToHalf(a.data(), referenceChanges.data(), k, format);
+        std::vector<uint16_t> initialChanges(referenceChanges);
+        momentumUpdateHalf(referenceWeights.data(), referenceChanges.data(), a.data(), 0.3f, 0.9f, 42, k, format);
+
+        std::vector<uint16_t> referenceFusedWeights(halfB);
+        std::vector<uint16_t> referenceFusedChanges(initialChanges);
+        std::vector<float> referenceDeltas(b);
+        backpropagateMomentumUpdateHalf(referenceFusedWeights.data(), referenceFusedChanges.data(), a.data(),
+                                        referenceDeltas.data(), 0.7f, 0.21f, 0.9f, 42, k, format);
+
+        GIVEN("The scalar " + name + " kernels") {
+            THEN("Rounding to nearest gives the expected encodings") {
+                float special[] = {1.0f, -2.0f, 65504.0f, 1e6f, 1.0f / 16777216.0f, 0.0f};
+                uint16_t halves[6];
+                roundToHalf(special, halves, 6, format);
+                if (format == HalfFormat::BFloat16) {
+                    REQUIRE(halves[0] == 0x3F80);
+                    REQUIRE(halves[1] == 0xC000);
+                    REQUIRE(halves[3] == 0x4974);
+                } else {
+                    REQUIRE(halves[0] == 0x3C00);
+                    REQUIRE(halves[1] == 0xC000);
+                    REQUIRE(halves[2] == 0x7BFF);
+                    REQUIRE(halves[3] == 0x7C00);
+                    REQUIRE(halves[4] == 0x0001);
+                }
+                REQUIRE(halves[5] == 0x0000);
+            }
+            THEN("Rounding is within half a step of the original value") {
+                std::vector<float> roundTrip = expanded(referenceHalves, format);
+                float relativeStep = format == HalfFormat::BFloat16 ? 1.0f / 128.0f : 1.0f / 1024.0f;
+                for (int i = 0; i < k; i++) {
+                    if (format == HalfFormat::Float16 && std::fabs(values[i]) > 65504.0f) {
+                        REQUIRE(std::isinf(roundTrip[i]));
+                    } else if (format == HalfFormat::Float16 && std::fabs(values[i]) < 1.0f / 16384.0f) {
+                        REQUIRE(std::fabs(roundTrip[i] - values[i]) <= 0.5f / 16777216.0f);
+                    } else {
+                        REQUIRE(std::fabs(roundTrip[i] - values[i]) <= 0.5f * relativeStep * std::fabs(values[i]));
+                    }
+                }
+            }
+            THEN("Stochastic rounding is unbiased") {
+                // Steps far smaller than the spacing of the weights, and changes that are Float16 subnormals
+                std::vector<uint16_t> weights(4096);
+                std::vector<uint16_t> changes(4096, 0);
+                std::vector<float> ones(4096, 1.0f);
+                std::vector<float> initial(4096, 1.0f);
+                roundToHalf(initial.data(), weights.data(), 4096, format);
+                momentumUpdateHalf(weights.data(), changes.data(), ones.data(), 1e-6f, 0.0f, 7, 4096, format);
+
+                std::vector<float> trainedWeights = expanded(weights, format);
+                std::vector<float> trainedChanges = expanded(changes, format);
+                double weightSum = 0.0;
+                double changeSum = 0.0;
+                for (int i = 0; i < 4096; i++) {
+                    weightSum += trainedWeights[i] - 1.0;
+                    changeSum += trainedChanges[i];
+                }
+                REQUIRE(changeSum / 4096 == Approx(1e-6).epsilon(0.05));
+                REQUIRE(weightSum / 4096 == Approx(1e-6).epsilon(0.5));
+            }
+        }
+
+        for (int isaIndex = int(KernelIsa::SSE2); isaIndex <= int(detected); isaIndex++) {
+            KernelIsa isa = KernelIsa(isaIndex);
+
+            GIVEN("The " + kernelIsaToString(isa) + " " + name + " kernels") {
+                REQUIRE(setKernelIsa(isa) == isa);
+
+                THEN("Rounding and expanding match exactly") {
+                    std::vector<uint16_t> halves(k);
+                    roundToHalf(values.data(), halves.data(), k, format);
+                    REQUIRE(halves == referenceHalves);
+
+                    std::vector<float> roundTrip(k);
+                    expandHalf(halves.data(), roundTrip.data(), k, format);
+                    REQUIRE(roundTrip == expanded(referenceHalves, format));
+                }
+                THEN("The dot product matches") {
+                    REQUIRE(dotProductHalf(a.data(), halfB.data(), k, format) == Approx(referenceDot).epsilon(1e-4));
+                }
+                THEN("The momentum updates match to within one step") {
+                    // Fused multiply-adds can move a value across a rounding threshold
+                    std::vector<uint16_t> weights(halfB);
+                    std::vector<uint16_t> changes(initialChanges);
+                    momentumUpdateHalf(weights.data(), changes.data(), a.data(), 0.3f, 0.9f, 42, k, format);
+
+                    std::vector<uint16_t> fusedWeights(halfB);
+                    std::vector<uint16_t> fusedChanges(initialChanges);
+                    std::vector<float> deltas(b);
+                    backpropagateMomentumUpdateHalf(fusedWeights.data(), fusedChanges.data(), a.data(),
+                                                    deltas.data(), 0.7f, 0.21f, 0.9f, 42, k, format);
+                    for (int i = 0; i < k; i++) {
+                        REQUIRE(std::abs(int(weights[i]) - int(referenceWeights[i])) <= 1);
+                        REQUIRE(std::abs(int(changes[i]) - int(referenceChanges[i])) <= 1);
+                        REQUIRE(std::abs(int(fusedWeights[i]) - int(referenceFusedWeights[i])) <= 1);
+                        REQUIRE(std::abs(int(fusedChanges[i]) - int(referenceFusedChanges[i])) <= 1);
+                        REQUIRE(deltas[i] == Approx(referenceDeltas[i]));
+                    }
+                }
+            }
+        }
+    }
+
+    setKernelIsa(detected);
+}
@@ -1,5 +1,10 @@
 #include "../../lib/catch.hpp"
 #include "../src/network-linux.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <thread>
 /* Main unit test file for the network code. */
 
 TEST_CASE("The core network functionality is all correct") {
@@ -79,6 +84,30 @@ TEST_CASE("The core network functionality is all correct") {
                 REQUIRE(output[i] < 1.0f);
             }
         }
+        THEN("It can classify into a caller-provided buffer") {
+            std::vector<float> input(nin);
+            for (int i = 0; i < nin; i++) {
+                input[i] = test_dist(m_mt);
+            }
+
+            std::vector<float> expected = network.classify(input);
+            float output[non];
+
+            REQUIRE(network.classify(input.data(), nin, output, non) == 0);
+            for (int i = 0; i < non; i++) {
+                REQUIRE(output[i] == expected[i]);
+            }
+        }
+        THEN("It refuses to classify or train on patterns of the wrong size") {
+            std::vector<float> input(nin + 1);
+            std::vector<float> target(non);
+            float output[non];
+
+            REQUIRE(network.classify(input.data(), nin + 1, output, non) == 1);
+            REQUIRE(network.classify(input.data(), nin, output, non - 1) == 1);
+            REQUIRE(network.trainNetwork(input.data(), nin + 1, target.data(), non) == -1.0f);
+            REQUIRE(network.getTrainingCycle() == 0);
+        }
         THEN("It can be trained") {
             std::vector<float> input;
             input.resize(nin);
@@ -229,6 +258,348 @@ TEST_CASE("The core network functionality is all correct") {
         }
     }
 
+    GIVEN("A mini-batch of training patterns") {
+        Network_L network = Network_L(nin, nhn, non, dlr, dm, diwm, tc);
+
+        int batchSize = 6;
+        std::vector<float> inputs(batchSize * nin);
+        std::vector<float> targets(batchSize * non);
+
+        for (int i = 0; i < batchSize * nin; i++) {
+            inputs[i] = test_dist(m_mt);
+        }
+
+        for (int i = 0; i < batchSize * non; i++) {
+            targets[i] = target_dist(m_mt);
+        }
+
+        THEN("It can be trained on the batch") {
+            float error = network.trainBatch(inputs.data(), targets.data(), batchSize);
+
+            REQUIRE(error > 0.0f);
+            REQUIRE(network.getTrainingCycle() == batchSize);
+        }
+        THEN("Batch training reduces the error") {
+            float untrained_error = network.trainBatch(inputs.data(), targets.data(), batchSize);
+
+            REQUIRE(untrained_error > 0.0f);
+
+            for (int i = 0; i < 9; i++) {
+                network.trainBatch(inputs.data(), targets.data(), batchSize);
+            }
+
+            float trained_error = network.trainBatch(inputs.data(), targets.data(), batchSize);
+
+            REQUIRE(trained_error < untrained_error);
+            REQUIRE(trained_error > 0.0f);
+        }
+        THEN("A batch can be classified in one call") {
+            // More examples than one classification block, so the blocking is exercised
+            int numExamples = 150;
+            std::vector<float> manyInputs(numExamples * nin);
+            for (int i = 0; i < numExamples * nin; i++) {
+                manyInputs[i] = test_dist(m_mt);
+            }
+            std::vector<float> outputs(numExamples * non);
+
+            REQUIRE(network.classifyBatch(manyInputs.data(), numExamples, outputs.data()) == 0);
+
+            for (int r = 0; r < numExamples; r++) {
+                std::vector<float> input(manyInputs.begin() + r * nin, manyInputs.begin() + (r + 1) * nin);
+                std::vector<float> expected = network.classify(input);
+                for (int i = 0; i < non; i++) {
+                    REQUIRE(outputs[r * non + i] == Approx(expected[i]));
+                }
+            }
+        }
+        THEN("A batch of one matches training on a single pattern") {
+            Network_L single = Network_L(nin, nhn, non, dlr, dm, diwm, tc);
+            single.loadWeights(network.getHiddenWeights(), network.getOutputWeights());
+
+            std::vector<float> input(inputs.begin(), inputs.begin() + nin);
+            std::vector<float> target(targets.begin(), targets.begin() + non);
+
+            for (int i = 0; i < 3; i++) {
+                float batchError = network.trainBatch(input.data(), target.data(), 1);
+                float singleError = single.trainNetwork(input, target);
+                REQUIRE(batchError == Approx(singleError));
+            }
+
+            std::vector<std::vector<float>> batchHiddenWeights = network.getHiddenWeights();
+            std::vector<std::vector<float>> singleHiddenWeights = single.getHiddenWeights();
+            for (int i = 0; i < nin+1; i++) {
+                for (int j = 0; j < nhn; j++) {
+                    REQUIRE(batchHiddenWeights[i][j] == Approx(singleHiddenWeights[i][j]));
+                }
+            }
+
+            std::vector<std::vector<float>> batchOutputWeights = network.getOutputWeights();
+            std::vector<std::vector<float>> singleOutputWeights = single.getOutputWeights();
+            for (int i = 0; i < nhn+1; i++) {
+                for (int j = 0; j < non; j++) {
+                    REQUIRE(batchOutputWeights[i][j] == Approx(singleOutputWeights[i][j]));
+                }
+            }
+        }
+        THEN("Gradients summed over shards of the batch match training on the whole batch") {
+            Network_L sharded = Network_L(nin, nhn, non, dlr, dm, diwm, tc);
+            sharded.loadWeights(network.getHiddenWeights(), network.getOutputWeights());
+
+            // Uneven shards, including an empty one, applied in slices as the train tool's threads do
+            int numShards = 4;
+            int shardBegin[] = {0, 1, 1, 4};
+            int shardEnd[] = {1, 1, 4, 6};
+            std::vector<Gradients> gradients(numShards, Gradients(sharded.getLayerSizes()));
+            Gradients total(sharded.getLayerSizes());
+
+            for (int i = 0; i < 3; i++) {
+                float batchError = network.trainBatch(inputs.data(), targets.data(), batchSize);
+
+                for (int s = 0; s < numShards; s++) {
+                    sharded.computeGradients(&inputs[shardBegin[s] * nin], &targets[shardBegin[s] * non],
+                                             shardEnd[s] - shardBegin[s], gradients[s]);
+                }
+                for (int s = 0; s < numShards; s++) {
+                    total.sum(gradients, s, numShards);
+                }
+                for (int s = 0; s < numShards; s++) {
+                    sharded.applyGradients(total, s, numShards);
+                }
+                sharded.recordTraining(total);
+
+                REQUIRE(total.count == batchSize);
+                REQUIRE(sharded.getErrorRate() == Approx(batchError));
+            }
+            REQUIRE(sharded.getTrainingCycle() == network.getTrainingCycle());
+
+            std::vector<std::vector<float>> batchHiddenWeights = network.getHiddenWeights();
+            std::vector<std::vector<float>> shardedHiddenWeights = sharded.getHiddenWeights();
+            for (int i = 0; i < nin+1; i++) {
+                for (int j = 0; j < nhn; j++) {
+                    REQUIRE(shardedHiddenWeights[i][j] == Approx(batchHiddenWeights[i][j]));
+                }
+            }
+
+            std::vector<std::vector<float>> batchOutputWeights = network.getOutputWeights();
+            std::vector<std::vector<float>> shardedOutputWeights = sharded.getOutputWeights();
+            for (int i = 0; i < nhn+1; i++) {
+                for (int j = 0; j < non; j++) {
+                    REQUIRE(shardedOutputWeights[i][j] == Approx(batchOutputWeights[i][j]));
+                }
+            }
+        }
+    }
+
+    GIVEN("A network using the fast activation approximations") {
+        Network_L network = Network_L(nin, nhn, non, dlr, dm, diwm, tc);
+        Network_L exact = Network_L(nin, nhn, non, dlr, dm, diwm, tc);
+        exact.loadWeights(network.getHiddenWeights(), network.getOutputWeights());
+
+        network.setActivationPrecision(ActivationPrecision::Fast);
+
+        THEN("The activation precision is set properly") {
+            REQUIRE(network.getActivationPrecision() == ActivationPrecision::Fast);
+            REQUIRE(exact.getActivationPrecision() == ActivationPrecision::Exact);
+        }
+        THEN("It classifies almost exactly like the exact network") {
+            std::vector<float> input(nin);
+            for (int i = 0; i < nin; i++) {
+                input[i] = test_dist(m_mt);
+            }
+
+            std::vector<float> fastOutput = network.classify(input);
+            std::vector<float> exactOutput = exact.classify(input);
+
+            for (int i = 0; i < non; i++) {
+                REQUIRE(fastOutput[i] == Approx(exactOutput[i]).epsilon(1e-5));
+            }
+        }
+        THEN("It classifies almost exactly like the exact network with SoftMax outputs") {
+            network.setOutputActivationFunction(ActivationFunction::SoftMax);
+            exact.setOutputActivationFunction(ActivationFunction::SoftMax);
+
+            std::vector<float> input(nin);
+            for (int i = 0; i < nin; i++) {
+                input[i] = test_dist(m_mt);
+            }
+
+            std::vector<float> fastOutput = network.classify(input);
+            std::vector<float> exactOutput = exact.classify(input);
+
+            for (int i = 0; i < non; i++) {
+                REQUIRE(fastOutput[i] == Approx(exactOutput[i]).epsilon(1e-5));
+            }
+        }
+        THEN("Training reduces the error") {
+            std::vector<float> input(nin);
+            std::vector<float> target(non);
+
+            for (int i = 0; i < nin; i++) {
+                input[i] = test_dist(m_mt);
+            }
+
+            for (int i = 0; i < non; i++) {
+                target[i] = target_dist(m_mt);
+            }
+
+            float untrained_error = network.trainNetwork(input, target);
+
+            for (int i = 0; i < 9; i++) {
+                network.trainNetwork(input, target);
+            }
+
+            float trained_error = network.trainNetwork(input, target);
+
+            REQUIRE(trained_error < untrained_error);
+            REQUIRE(trained_error > 0.0f);
+        }
+    }
+
+    GIVEN("A network shared between several classifying threads") {
+        Network_L network = Network_L({nin, nhn, 5, non}, dlr, dm, diwm, tc);
+        const Network_L &shared = network;
+
+        int numThreads = 4;
+        int numExamples = 100;
+        std::vector<float> inputs(numExamples * nin);
+        for (int i = 0; i < numExamples * nin; i++) {
+            inputs[i] = test_dist(m_mt);
+        }
+
+        std::vector<float> expected(numExamples * non);
+        for (int r = 0; r < numExamples; r++) {
+            network.classify(&inputs[r * nin], nin, &expected[r * non], non);
+        }
+
+        THEN("Each thread's classifications match, and the network is untouched") {
+            std::vector<float> outputNodes = network.getOutputNodes();
+
+            std::vector<std::vector<float>> outputs(numThreads, std::vector<float>(numExamples * non));
+            std::vector<std::vector<float>> batchOutputs(numThreads, std::vector<float>(numExamples * non));
+            std::vector<std::thread> threads;
+            for (int t = 0; t < numThreads; t++) {
+                threads.push_back(std::thread([&, t]() {
+                    Activations activations(shared.getLayerSizes());
+                    for (int r = 0; r < numExamples; r++) {
+                        shared.classify(&inputs[r * nin], nin, &outputs[t][r * non], non, activations);
+                    }
+                    shared.classifyBatch(inputs.data(), numExamples, batchOutputs[t].data(), activations);
+                }));
+            }
+            for (int t = 0; t < numThreads; t++) {
+                threads[t].join();
+            }
+
+            for (int t = 0; t < numThreads; t++) {
+                for (int i = 0; i < numExamples * non; i++) {
+                    REQUIRE(outputs[t][i] == Approx(expected[i]));
+                    REQUIRE(batchOutputs[t][i] == Approx(expected[i]));
+                }
+            }
+            REQUIRE(network.getOutputNodes() == outputNodes);
+        }
+        THEN("A mismatched pattern size is rejected") {
+            Activations activations(network.getLayerSizes());
+            std::vector<float> outputs(non);
+            REQUIRE(shared.classify(inputs.data(), nin - 1, outputs.data(), non, activations) == 1);
+        }
+        THEN("Activations made for other layer sizes are rejected") {
+            std::vector<float> outputs(numExamples * non);
+            Activations fewerLayers({nin, nhn, non});
+            Activations narrower({nin, nhn, 4, non});
+            for (Activations *activations : {&fewerLayers, &narrower}) {
+                REQUIRE(shared.classify(inputs.data(), nin, outputs.data(), non, *activations) == 1);
+                REQUIRE(shared.classifyBatch(inputs.data(), numExamples, outputs.data(), *activations) == 1);
+            }
+        }
+    }
+
+    GIVEN("A network with two hidden layers") {
+        std::vector<int> layerSizes = {nin, nhn, 5, non};
+        Network_L network = Network_L(layerSizes, dlr, dm, diwm, tc);
+
+        THEN("The layers are set up properly") {
+            REQUIRE(network.getNumLayers() == 3);
+            REQUIRE(network.getLayerSizes() == layerSizes);
+            REQUIRE(network.getNumInputNodes() == nin);
+            REQUIRE(network.getNumHiddenNodes() == nhn);
+            REQUIRE(network.getNumOutputNodes() == non);
+            REQUIRE(network.getLayerWeights(1).size() == nhn + 1);
+            REQUIRE(network.getLayerWeights(1)[0].size() == 5);
+            REQUIRE(network.getOutputWeights().size() == 5 + 1);
+        }
+        THEN("Each layer has its own activation function") {
+            network.setHiddenActivationFunction(ActivationFunction::ReLu);
+            network.setLayerActivationFunction(1, ActivationFunction::Sigmoid);
+
+            REQUIRE(network.getLayerActivationFunction(0) == ActivationFunction::ReLu);
+            REQUIRE(network.getLayerActivationFunction(1) == ActivationFunction::Sigmoid);
+            REQUIRE(network.getLayerActivationFunction(2) == ActivationFunction::Sigmoid);
+            REQUIRE(network.getHiddenActivationFunction() == ActivationFunction::ReLu);
+        }
+        THEN("Training reduces the error") {
+            std::vector<float> input(nin);
+            std::vector<float> target(non);
+
+            for (int i = 0; i < nin; i++) {
+                input[i] = test_dist(m_mt);
+            }
+
+            for (int i = 0; i < non; i++) {
+                target[i] = target_dist(m_mt);
+            }
+
+            float untrained_error = network.trainNetwork(input, target);
+
+            for (int i = 0; i < 9; i++) {
+                network.trainNetwork(input, target);
+            }
+
+            float trained_error = network.trainNetwork(input, target);
+
+            REQUIRE(trained_error < untrained_error);
+            REQUIRE(trained_error > 0.0f);
+        }
+        THEN("A batch of one matches training on a single pattern, and batches classify like single patterns") {
+            Network_L single = Network_L(layerSizes, dlr, dm, diwm, tc);
+            for (int l = 0; l < 3; l++) {
+                single.loadLayerWeights(l, network.getLayerWeights(l));
+            }
+
+            std::vector<float> input(nin);
+            std::vector<float> target(non);
+            for (int i = 0; i < nin; i++) {
+                input[i] = test_dist(m_mt);
+            }
+            for (int i = 0; i < non; i++) {
+                target[i] = target_dist(m_mt);
+            }
+
+            for (int i = 0; i < 3; i++) {
+                float batchError = network.trainBatch(input.data(), target.data(), 1);
+                float singleError = single.trainNetwork(input, target);
+                REQUIRE(batchError == Approx(singleError));
+            }
+
+            for (int l = 0; l < 3; l++) {
+                std::vector<std::vector<float>> batchWeights = network.getLayerWeights(l);
+                std::vector<std::vector<float>> singleWeights = single.getLayerWeights(l);
+                for (int i = 0; i < batchWeights.size(); i++) {
+                    for (int j = 0; j < batchWeights[i].size(); j++) {
+                        REQUIRE(batchWeights[i][j] == Approx(singleWeights[i][j]));
+                    }
+                }
+            }
+
+            std::vector<float> outputs(non);
+            REQUIRE(network.classifyBatch(input.data(), 1, outputs.data()) == 0);
+            std::vector<float> expected = single.classify(input);
+            for (int i = 0; i < non; i++) {
+                REQUIRE(outputs[i] == Approx(expected[i]));
+            }
+        }
+    }
+
     GIVEN("A network with very few neurons and edge case parameters") {
 
         nin = 2;
@@ -303,6 +674,225 @@ TEST_CASE("The core network functionality is all correct") {
         }
     }
 
+    GIVEN("A network using each of the optimizers") {
+        Network_L network = Network_L(nin, nhn, non, dlr, dm, diwm, tc);
+
+        std::vector<float> input(nin);
+        std::vector<float> target(non);
+        for (int i = 0; i < nin; i++) {
+            input[i] = test_dist(m_mt);
+        }
+        for (int i = 0; i < non; i++) {
+            target[i] = target_dist(m_mt);
+        }
+
+        THEN("Momentum is the default") {
+            REQUIRE(network.getOptimizer() == Optimizer::Momentum);
+            REQUIRE(stringToOptimizer(optimizerToString(Optimizer::Adam)) == Optimizer::Adam);
+        }
+        THEN("Training reduces the error with every optimizer") {
+            Optimizer optimizers[] = {Optimizer::Nesterov, Optimizer::RMSProp, Optimizer::Adam};
+            for (Optimizer optimizer : optimizers) {
+                Network_L trained = Network_L(nin, nhn, non, dlr, dm, diwm, tc);
+                trained.loadWeights(network.getHiddenWeights(), network.getOutputWeights());
+                trained.setOptimizer(optimizer);
+                // The adaptive optimizers take steps of about the learning rate in every weight
+                if (optimizer != Optimizer::Nesterov) {
+                    trained.setLearningRate(0.01f);
+                }
+                REQUIRE(trained.getOptimizer() == optimizer);
+
+                float untrained_error = trained.trainNetwork(input, target);
+
+                REQUIRE(untrained_error > 0.0f);
+
+                for (int i = 0; i < 9; i++) {
+                    trained.trainNetwork(input, target);
+                }
+
+                float trained_error = trained.trainNetwork(input, target);
+
+                REQUIRE(trained_error < untrained_error);
+                REQUIRE(trained_error > 0.0f);
+            }
+        }
+        THEN("A batch of one matches training on a single pattern with Adam") {
+            Network_L single = Network_L(nin, nhn, non, dlr, dm, diwm, tc);
+            single.loadWeights(network.getHiddenWeights(), network.getOutputWeights());
+            network.setOptimizer(Optimizer::Adam);
+            single.setOptimizer(Optimizer::Adam);
+
+            for (int i = 0; i < 3; i++) {
+                float batchError = network.trainBatch(input.data(), target.data(), 1);
+                float singleError = single.trainNetwork(input, target);
+                REQUIRE(batchError == Approx(singleError));
+            }
+
+            std::vector<std::vector<float>> batchOutputWeights = network.getOutputWeights();
+            std::vector<std::vector<float>> singleOutputWeights = single.getOutputWeights();
+            for (int i = 0; i < nhn+1; i++) {
+                for (int j = 0; j < non; j++) {
+                    REQUIRE(batchOutputWeights[i][j] == Approx(singleOutputWeights[i][j]));
+                }
+            }
+        }
+    }
+
+    GIVEN("A sparse input pattern") {
+        Network_L network = Network_L(nin, nhn, non, dlr, dm, diwm, tc);
+
+        // Every other input is zero
+        std::vector<float> input(nin, 0.0f);
+        std::vector<float> target(non);
+        for (int i = 0; i < nin; i += 2) {
+            input[i] = test_dist(m_mt);
+        }
+        for (int i = 0; i < non; i++) {
+            target[i] = target_dist(m_mt);
+        }
+        SparseInputs sparseInput = toSparseInputs(input);
+
+        THEN("Only the non-zero inputs are kept, and they expand back to the dense pattern") {
+            REQUIRE(sparseInput.indexes.size() == (nin + 1) / 2);
+            REQUIRE(sparseInput.values.size() == sparseInput.indexes.size());
+            REQUIRE(toDenseInputs(sparseInput, nin) == input);
+        }
+        THEN("It classifies as the dense pattern does") {
+            std::vector<float> dense = network.classify(input);
+            std::vector<float> sparse = network.classify(sparseInput);
+            for (int i = 0; i < non; i++) {
+                REQUIRE(sparse[i] == Approx(dense[i]));
+            }
+        }
+        THEN("Without momentum it trains as the dense pattern does") {
+            Network_L dense = Network_L(nin, nhn, non, dlr, 0.0f, diwm, tc);
+            Network_L sparse = Network_L(nin, nhn, non, dlr, 0.0f, diwm, tc);
+            dense.loadWeights(network.getHiddenWeights(), network.getOutputWeights());
+            sparse.loadWeights(network.getHiddenWeights(), network.getOutputWeights());
+
+            for (int i = 0; i < 3; i++) {
+                REQUIRE(sparse.trainNetwork(sparseInput, target) == Approx(dense.trainNetwork(input, target)));
+            }
+
+            std::vector<std::vector<float>> denseWeights = dense.getHiddenWeights();
+            std::vector<std::vector<float>> sparseWeights = sparse.getHiddenWeights();
+            for (int i = 0; i < nin+1; i++) {
+                for (int j = 0; j < nhn; j++) {
+                    REQUIRE(sparseWeights[i][j] == Approx(denseWeights[i][j]));
+                }
+            }
+        }
+        THEN("With Adam it trains as the dense pattern does") {
+            Network_L dense = Network_L(nin, nhn, non, dlr, dm, diwm, tc);
+            Network_L sparse = Network_L(nin, nhn, non, dlr, dm, diwm, tc);
+            dense.loadWeights(network.getHiddenWeights(), network.getOutputWeights());
+            sparse.loadWeights(network.getHiddenWeights(), network.getOutputWeights());
+            dense.setOptimizer(Optimizer::Adam);
+            sparse.setOptimizer(Optimizer::Adam);
+
+            for (int i = 0; i < 3; i++) {
+                REQUIRE(sparse.trainNetwork(sparseInput, target) == Approx(dense.trainNetwork(input, target)));
+            }
+
+            std::vector<std::vector<float>> denseWeights = dense.getHiddenWeights();
+            std::vector<std::vector<float>> sparseWeights = sparse.getHiddenWeights();
+            for (int i = 0; i < nin+1; i++) {
+                for (int j = 0; j < nhn; j++) {
+                    REQUIRE(sparseWeights[i][j] == Approx(denseWeights[i][j]));
+                }
+            }
+        }
+        THEN("With momentum only the weights of the non-zero inputs move") {
+            std::vector<std::vector<float>> initialWeights = network.getHiddenWeights();
+            for (int i = 0; i < 3; i++) {
+                network.trainNetwork(sparseInput, target);
+            }
+
+            std::vector<std::vector<float>> trainedWeights = network.getHiddenWeights();
+            for (int i = 1; i < nin; i += 2) {
+                for (int j = 0; j < nhn; j++) {
+                    REQUIRE(trainedWeights[i][j] == initialWeights[i][j]);
+                }
+            }
+        }
+        THEN("Indexes out of order or out of range are rejected") {
+            int outOfOrder[] = {2, 1};
+            int outOfRange[] = {0, nin};
+            float values[] = {0.5f, 0.5f};
+            std::vector<float> outputs(non);
+            REQUIRE(network.classify(outOfOrder, values, 2, outputs.data(), non) == 1);
+            REQUIRE(network.classify(outOfRange, values, 2, outputs.data(), non) == 1);
+            REQUIRE(network.trainNetwork(outOfOrder, values, 2, target.data(), non) == -1.0f);
+            REQUIRE(network.getTrainingCycle() == tc);
+        }
+    }
+
+    GIVEN("A network storing its weights in reduced precision") {
+        Network_L network = Network_L(nin, nhn, non, dlr, dm, diwm, tc);
+        std::vector<std::vector<float>> initialWeights = network.getHiddenWeights();
+
+        std::vector<float> input(nin);
+        std::vector<float> target(non);
+        for (int i = 0; i < nin; i++) {
+            input[i] = test_dist(m_mt);
+        }
+        for (int i = 0; i < non; i++) {
+            target[i] = target_dist(m_mt);
+        }
+
+        THEN("Float32 is the default") {
+            REQUIRE(network.getWeightPrecision() == WeightPrecision::Float32);
+        }
+        THEN("The weights are rounded to the nearest BFloat16 and read back as floats") {
+            network.setWeightPrecision(WeightPrecision::BFloat16);
+            REQUIRE(network.getWeightPrecision() == WeightPrecision::BFloat16);
+            std::vector<std::vector<float>> halfWeights = network.getHiddenWeights();
+            for (int i = 0; i < nin+1; i++) {
+                for (int j = 0; j < nhn; j++) {
+                    REQUIRE(std::fabs(halfWeights[i][j] - initialWeights[i][j]) <= std::fabs(initialWeights[i][j]) / 256);
+                }
+            }
+        }
+        THEN("Training on one pattern reduces its error in both formats") {
+            for (WeightPrecision precision : {WeightPrecision::BFloat16, WeightPrecision::Float16}) {
+                Network_L half = Network_L(nin, nhn, non, dlr, dm, diwm, tc);
+                half.setWeightPrecision(precision);
+                float initialError = half.trainNetwork(input, target);
+                float error = initialError;
+                for (int i = 0; i < 50; i++) {
+                    error = half.trainNetwork(input, target);
+                }
+                REQUIRE(error < initialError);
+                REQUIRE(half.getTrainingCycle() == tc + 51);
+            }
+        }
+        THEN("Going back to Float32 keeps the trained weights") {
+            network.setWeightPrecision(WeightPrecision::Float16);
+            for (int i = 0; i < 5; i++) {
+                network.trainNetwork(input, target);
+            }
+            std::vector<std::vector<float>> trainedWeights = network.getHiddenWeights();
+            network.setWeightPrecision(WeightPrecision::Float32);
+            REQUIRE(network.getHiddenWeights() == trainedWeights);
+        }
+        THEN("Weights loaded in reduced precision are rounded to it") {
+            network.setWeightPrecision(WeightPrecision::Float16);
+            std::vector<std::vector<float>> halfWeights = network.getHiddenWeights();
+            std::vector<std::vector<float>> outputWeights = network.getOutputWeights();
+            network.loadWeights(initialWeights, outputWeights);
+            REQUIRE(network.getHiddenWeights() == halfWeights);
+            REQUIRE(network.getOutputWeights() == outputWeights);
+        }
+        THEN("Training paths without reduced precision support are rejected") {
+            network.setWeightPrecision(WeightPrecision::BFloat16);
+            REQUIRE(network.trainBatch(input.data(), target.data(), 1) == -1.0f);
+            REQUIRE(network.trainNetwork(toSparseInputs(input), target) == -1.0f);
+            network.setOptimizer(Optimizer::Adam);
+            REQUIRE(network.trainNetwork(input, target) == -1.0f);
+            REQUIRE(network.getTrainingCycle() == tc);
+        }
+    }
+
     GIVEN("A network using the ReLu activation function for both layers") {
         Network_L network = Network_L(nin, nhn, non, dlr, dm, diwm, tc);
 
@@ -350,13 +940,21 @@ TEST_CASE("The core network functionality is all correct") {
 
             REQUIRE(untrained_error > 0.0f);
 
+            // An output stuck at zero has no gradient, so the error only falls if one is active
+            std::vector<float> untrained_outputs = network.getOutputNodes();
+            bool active = std::any_of(untrained_outputs.begin(), untrained_outputs.end(),
+                                      [](float output) { return output > 0.0f; });
+
             for (int i = 0; i < 9; i++) {
                 network.trainNetwork(input, target);
             }
 
             float trained_error = network.trainNetwork(input, target);
 
-            REQUIRE(trained_error < untrained_error);
+            REQUIRE(trained_error <= untrained_error);
+            if (active) {
+                REQUIRE(trained_error < untrained_error);
+            }
             REQUIRE(trained_error > 0.0f);
         }
     }
@@ -474,4 +1072,158 @@ TEST_CASE("The core network functionality is all correct") {
             REQUIRE(trained_error > 0.0f);
         }
     }
+
+    GIVEN("A network with a SoftMax output layer and the CrossEntropy error function") {
+        Network_L network = Network_L(nin, nhn, non, dlr, dm, diwm, tc);
+        network.setOutputActivationFunction(ActivationFunction::SoftMax);
+        network.setErrorFunction(ErrorFunction::CrossEntropy);
+
+        std::vector<float> input(nin);
+        std::vector<float> target(non, 0.0f);
+        for (int i = 0; i < nin; i++) {
+            input[i] = test_dist(m_mt);
+        }
+        target[1] = 1.0f;
+
+        THEN("The error is the categorical cross entropy of the outputs") {
+            std::vector<float> outputs = network.classify(input);
+            double expected = 0.0;
+            for (int i = 0; i < non; i++) {
+                expected -= target[i] * std::log(double(outputs[i]));
+            }
+            REQUIRE(network.trainNetwork(input, target) == Approx(expected));
+
+            std::vector<float> trained = network.getOutputNodes();
+            REQUIRE(std::accumulate(trained.begin(), trained.end(), 0.0f) == Approx(1.0f));
+        }
+        THEN("Exact and fast precision train alike") {
+            Network_L fast = network;
+            fast.setActivationPrecision(ActivationPrecision::Fast);
+            for (int i = 0; i < 5; i++) {
+                REQUIRE(fast.trainNetwork(input, target) == Approx(network.trainNetwork(input, target)).epsilon(1e-4));
+            }
+        }
+        THEN("Inputs large enough to overflow exp still give finite outputs and errors") {
+            for (ActivationPrecision precision : {ActivationPrecision::Exact, ActivationPrecision::Fast}) {
+                Network_L large = Network_L(nin, nhn, non, dlr, dm, 1000.0f, tc);
+                large.setHiddenActivationFunction(ActivationFunction::ReLu);
+                large.setOutputActivationFunction(ActivationFunction::SoftMax);
+                large.setErrorFunction(ErrorFunction::CrossEntropy);
+                large.setActivationPrecision(precision);
+
+                std::vector<float> outputs = large.classify(input);
+                for (int i = 0; i < non; i++) {
+                    REQUIRE(std::isfinite(outputs[i]));
+                }
+                REQUIRE(std::isfinite(large.trainNetwork(input, target)));
+                std::vector<std::vector<float>> weights = large.getOutputWeights();
+                for (int i = 0; i < nhn+1; i++) {
+                    for (int j = 0; j < non; j++) {
+                        REQUIRE(std::isfinite(weights[i][j]));
+                    }
+                }
+            }
+        }
+    }
+
+    GIVEN("Networks mixing every activation function") {
+        struct Configuration {
+            ActivationFunction hidden;
+            ActivationFunction output;
+            ErrorFunction errorFunction;
+        };
+        Configuration configurations[] = {
+            {ActivationFunction::ReLu, ActivationFunction::SoftMax, ErrorFunction::SumSquared},
+            {ActivationFunction::SoftMax, ActivationFunction::Sigmoid, ErrorFunction::SumSquared},
+            {ActivationFunction::Sigmoid, ActivationFunction::ReLu, ErrorFunction::SumSquared},
+            {ActivationFunction::ReLu, ActivationFunction::Sigmoid, ErrorFunction::CrossEntropy},
+            {ActivationFunction::ReLu, ActivationFunction::SoftMax, ErrorFunction::CrossEntropy},
+        };
+
+        std::vector<float> input(nin);
+        std::vector<float> target(non);
+        for (int i = 0; i < nin; i++) {
+            input[i] = test_dist(m_mt);
+        }
+        for (int i = 0; i < non; i++) {
+            target[i] = target_dist(m_mt);
+        }
+
+        THEN("The backpropagated gradients match finite differences of the error") {
+            for (const Configuration &configuration : configurations) {
+                Network_L network = Network_L({nin, nhn, non}, dlr, dm, diwm, tc);
+                network.setHiddenActivationFunction(configuration.hidden);
+                network.setOutputActivationFunction(configuration.output);
+                network.setErrorFunction(configuration.errorFunction);
+
+                Gradients gradients(network.getLayerSizes());
+                network.computeGradients(input.data(), target.data(), 1, gradients);
+
+                // Each node's accumulated input, from the weights and the hidden nodes classify leaves
+                network.classify(input);
+                std::vector<std::vector<float>> layerInputs = {input, network.getHiddenNodes()};
+                std::vector<std::vector<float>> accumulatedInputs;
+                for (int l = 0; l < network.getNumLayers(); l++) {
+                    std::vector<std::vector<float>> weights = network.getLayerWeights(l);
+                    int numInputs = weights.size() - 1;
+                    accumulatedInputs.push_back(weights[numInputs]);
+                    for (int i = 0; i < weights[0].size(); i++) {
+                        for (int j = 0; j < numInputs; j++) {
+                            accumulatedInputs[l][i] += weights[j][i] * layerInputs[l][j];
+                        }
+                    }
+                }
+
+                // The gradients are summed in the descent direction, so they are minus dE/dw
+                float h = 1e-3f;
+                for (int l = 0; l < network.getNumLayers(); l++) {
+                    std::vector<std::vector<float>> weights = network.getLayerWeights(l);
+                    int numInputs = weights.size() - 1;
+                    int numNodes = weights[0].size();
+                    for (int j = 0; j < numInputs; j++) {
+                        for (int i = 0; i < numNodes; i++) {
+                            // Stepping the weight moves its node's accumulated input by up to h
+                            // times its input, and the output layer's by less. Across 0 that
+                            // crosses a ReLu's kink, where the central difference is not the
+                            // gradient, so such weights are skipped.
+                            float step = h * std::fabs(layerInputs[l][j]);
+                            bool nearKink = false;
+                            for (int k = l; k < network.getNumLayers(); k++) {
+                                if (network.getLayerActivationFunction(k) != ActivationFunction::ReLu) {
+                                    continue;
+                                }
+                                for (int n = 0; n < accumulatedInputs[k].size(); n++) {
+                                    if ((k > l || n == i) && std::fabs(accumulatedInputs[k][n]) <= step) {
+                                        nearKink = true;
+                                    }
+                                }
+                            }
+                            if (nearKink) {
+                                continue;
+                            }
+
+                            std::vector<std::vector<float>> perturbed = weights;
+                            Gradients probe(network.getLayerSizes());
+
+                            perturbed[j][i] = weights[j][i] + h;
+                            network.loadLayerWeights(l, perturbed);
+                            network.computeGradients(input.data(), target.data(), 1, probe);
+                            double errorAbove = probe.errorSum;
+
+                            perturbed[j][i] = weights[j][i] - h;
+                            network.loadLayerWeights(l, perturbed);
+                            network.computeGradients(input.data(), target.data(), 1, probe);
+                            double errorBelow = probe.errorSum;
+
+                            network.loadLayerWeights(l, weights);
+
+                            float numerical = -(errorAbove - errorBelow) / (2 * h);
+                            float analytic = gradients.weights[l][i * paddedStride(numInputs) + j];
+                            REQUIRE(analytic == Approx(numerical).margin(2e-3));
+                        }
+                    }
+                }
+            }
+        }
+    }
 }
\ No newline at end of file
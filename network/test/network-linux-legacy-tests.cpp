@@ -1,9 +1,13 @@
 #include "../../lib/catch.hpp"
 #include "../src/network-linux.hpp"
+
+#include <algorithm>
+#include <cmath>
+
 /* Legacy unit test file for the network code, to check that it can still do what the original code did */
 
 TEST_CASE("The library can implement the original ArduinoANN code's functionality") {
-    int nin = 8;
+    int nin = 7;
     int nhn = 7;
     int non = 4;
 
@@ -71,4 +75,52 @@ TEST_CASE("The library can implement the original ArduinoANN code's functionalit
             REQUIRE(Error > 0.0f);
         }
     }
+
+    GIVEN("Networks storing their weights in reduced precision") {
+        int numRuns = 200;
+        int numCycles = 2000;
+
+        THEN("They learn the patterns about as well as in Float32") {
+            std::vector<WeightPrecision> precisions = {WeightPrecision::Float32, WeightPrecision::BFloat16,
+                                                       WeightPrecision::Float16};
+            std::vector<int> correctRuns;
+            std::vector<float> medianErrors;
+            for (WeightPrecision precision : precisions) {
+                int correct = 0;
+                std::vector<float> errors;
+                for (int r = 0; r < numRuns; r++) {
+                    Network_L network = Network_L(nin, nhn, non, dlr, dm, diwm, tc);
+                    network.setWeightPrecision(precision);
+
+                    float cycleError = 0.0f;
+                    for (int c = 0; c < numCycles; c++) {
+                        std::random_shuffle(indexes.begin(), indexes.end());
+                        cycleError = 0.0f;
+                        for (q = 0; q < PatternCount; q++) {
+                            p = indexes[q];
+                            cycleError += network.trainNetwork(Input[p], Target[p]);
+                        }
+                    }
+                    errors.push_back(cycleError);
+
+                    bool allCorrect = true;
+                    for (p = 0; p < PatternCount; p++) {
+                        std::vector<float> output = network.classify(Input[p]);
+                        for (int i = 0; i < non; i++) {
+                            allCorrect = allCorrect && std::fabs(output[i] - Target[p][i]) < 0.5f;
+                        }
+                    }
+                    correct += allCorrect;
+                }
+                std::nth_element(errors.begin(), errors.begin() + numRuns / 2, errors.end());
+                medianErrors.push_back(errors[numRuns / 2]);
+                correctRuns.push_back(correct);
+            }
+
+            for (int k = 1; k < precisions.size(); k++) {
+                REQUIRE(correctRuns[k] >= 0.8 * correctRuns[0]);
+                REQUIRE(medianErrors[k] <= 2.0f * medianErrors[0]);
+            }
+        }
+    }
 }
\ No newline at end of file
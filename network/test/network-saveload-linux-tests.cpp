@@ -3,6 +3,9 @@
 #include "../src/network-saveload-linux.hpp"
 #include "../../lib/catch.hpp"
 
+#include <algorithm>
+#include <cmath>
+
 TEST_CASE("Network configurations can be saved to file and loaded from file") {
     GIVEN("A suitably configured network") {
         std::random_device rd;
@@ -121,16 +124,16 @@ TEST_CASE("Network configurations can be saved to file and loaded from file") {
         }
 
         THEN("The fourteenth line records the hidden activation function correctly") {
-            std::string hafBody = "// hiddenActivationFunction (not needed on Arduino):";
-            REQUIRE(lines[13].substr(0, 52) == hafBody);
-            ActivationFunction filehAF = stringToAF(lines[13].substr(53, lines[13].length()-53));
+            std::string hafBody = "#define HIDDEN_ACTIVATION_FUNCTION";
+            REQUIRE(lines[13].substr(0, 34) == hafBody);
+            ActivationFunction filehAF = stringToAF(lines[13].substr(35, lines[13].length()-35));
             REQUIRE(filehAF == haf);
         }
 
         THEN("The fifteenth line records the output activation function correctly") {
-            std::string oafBody = "// outputActivationFunction (not needed on Arduino):";
-            REQUIRE(lines[14].substr(0, 52) == oafBody);
-            ActivationFunction fileoAF = stringToAF(lines[14].substr(53, lines[14].length()-53));
+            std::string oafBody = "#define OUTPUT_ACTIVATION_FUNCTION";
+            REQUIRE(lines[14].substr(0, 34) == oafBody);
+            ActivationFunction fileoAF = stringToAF(lines[14].substr(35, lines[14].length()-35));
             REQUIRE(fileoAF == oaf);
         }
 
@@ -145,22 +148,31 @@ TEST_CASE("Network configurations can be saved to file and loaded from file") {
             REQUIRE(lines[16] == "");
         }
 
-        THEN("The eighteenth line records the hidden weight declaration") {
-            REQUIRE(lines[17] == "const float hiddenWeights[numInputNodes +1][numHiddenNodes] PROGMEM = {");
+        THEN("The eighteenth and nineteenth lines record that the weights are node-major") {
+            REQUIRE(lines[17] == "// Each node's bias and then its input weights, in the order Network_A reads them");
+            REQUIRE(lines[18] == "#define NODE_MAJOR_WEIGHTS");
+        }
+
+        THEN("The twentieth line is blank") {
+            REQUIRE(lines[19] == "");
+        }
+
+        THEN("The twenty-first line records the hidden weight declaration") {
+            REQUIRE(lines[20] == "const float hiddenWeights[numHiddenNodes][numInputNodes +1] PROGMEM = {");
         }
 
         THEN("The hidden weights are all recorded") {
-            REQUIRE(lines.size() >= 18 + (nin + 1));
+            REQUIRE(lines.size() >= 21 + nhn);
         }
 
-        THEN("The correct lines record the hidden weights correctly") {
-            int line_num = 18;
+        THEN("The correct lines record the hidden weights correctly, each node's bias first") {
+            int line_num = 21;
             float weight_from_file, weight_from_vector;
 
             std::vector<std::vector<float>> hiddenWeights = network->getHiddenWeights();
-            for (int i = 0; i < nin+1; i++) {
+            for (int i = 0; i < nhn; i++) {
                 std::string line = lines[line_num].substr(5, lines[line_num].length()- 8);
-                float lineWeights[nhn];
+                float lineWeights[nin + 1];
                 std::string value;
                 std::istringstream iss(line);
                 int k = 0;
@@ -170,9 +182,9 @@ TEST_CASE("Network configurations can be saved to file and loaded from file") {
                     k++;
                 }
 
-                for (int j = 0; j < nhn; j++) {
+                for (int j = 0; j < nin + 1; j++) {
                     weight_from_file = lineWeights[j];
-                    weight_from_vector = hiddenWeights[i][j];
+                    weight_from_vector = hiddenWeights[j == 0 ? nin : j - 1][i];
 
                     REQUIRE(weight_from_file == Approx(weight_from_vector));
                 }
@@ -180,7 +192,7 @@ TEST_CASE("Network configurations can be saved to file and loaded from file") {
             }
         }
 
-        int previous_lines = 18 + (nin + 1);
+        int previous_lines = 21 + nhn;
 
         THEN("The line after the hidden weights encloses the array") {
             REQUIRE(lines[previous_lines] == "};");
@@ -195,23 +207,23 @@ TEST_CASE("Network configurations can be saved to file and loaded from file") {
         previous_lines++;
 
         THEN("The next line records the output weight declaration") {
-            REQUIRE(lines[previous_lines] == "const float outputWeights[numHiddenNodes +1][numOutputNodes] PROGMEM = {");
+            REQUIRE(lines[previous_lines] == "const float outputWeights[numOutputNodes][numHiddenNodes +1] PROGMEM = {");
         }
 
         previous_lines++;
 
         THEN("The output weights are all recorded") {
-            REQUIRE(lines.size() >= previous_lines + (nhn + 1));
+            REQUIRE(lines.size() >= previous_lines + non);
         }
 
-        THEN("The correct lines record the output weights correctly") {
+        THEN("The correct lines record the output weights correctly, each node's bias first") {
             int line_num = previous_lines;
             float weight_from_file, weight_from_vector;
 
             std::vector<std::vector<float>> outputWeights = network->getOutputWeights();
-            for (int i = 0; i < nhn+1; i++) {
+            for (int i = 0; i < non; i++) {
                 std::string line = lines[line_num].substr(5, lines[line_num].length()- 8);
-                float lineWeights[non];
+                float lineWeights[nhn + 1];
                 std::string value;
                 std::istringstream iss(line);
                 int k = 0;
@@ -221,9 +233,9 @@ TEST_CASE("Network configurations can be saved to file and loaded from file") {
                     k++;
                 }
 
-                for (int j = 0; j < non; j++) {
+                for (int j = 0; j < nhn + 1; j++) {
                     weight_from_file = lineWeights[j];
-                    weight_from_vector = outputWeights[i][j];
+                    weight_from_vector = outputWeights[j == 0 ? nhn : j - 1][i];
 
                     REQUIRE(weight_from_file == Approx(weight_from_vector));
                 }
@@ -231,7 +243,7 @@ TEST_CASE("Network configurations can be saved to file and loaded from file") {
             }
         }
 
-        previous_lines += nhn + 1;
+        previous_lines += non;
 
         THEN("The line after the hidden weights encloses the array") {
             REQUIRE(lines[previous_lines] == "};");
@@ -245,6 +257,37 @@ TEST_CASE("Network configurations can be saved to file and loaded from file") {
 
         previous_lines++;
 
+        THEN("The activation arena follows") {
+            REQUIRE(lines[previous_lines + 1] == "// Network_A needs 124 bytes of SRAM for activations");
+            REQUIRE(lines[previous_lines + 2] == "#define ACTIVATION_ARENA");
+            REQUIRE(lines[previous_lines + 3] == "const int activationArenaSize = 15;");
+            REQUIRE(lines[previous_lines + 4] == "const int layerOffsets[] = { 0, 8, 0 };");
+            REQUIRE(lines[previous_lines + 5] == "");
+        }
+
+        previous_lines += 6;
+
+        SigmoidTable table = buildSigmoidTable(defaultSigmoidTableError);
+
+        THEN("The estimated cost on the default board follows, with the weights, biases and table in flash") {
+            long flashBytes = (nin + 1) * nhn * 4 + (nhn + 1) * non * 4 + 2 * table.entries.size();
+            REQUIRE(lines[previous_lines] == "// Estimated cost on Curie (see estimateDeviceCost): "
+                                             + std::to_string(flashBytes) + " bytes of flash and 124 of SRAM,");
+            REQUIRE(lines[previous_lines + 2] == "");
+        }
+
+        previous_lines += 3;
+
+        THEN("The sigmoid lookup table follows") {
+            REQUIRE(lines[previous_lines + 1] == "#include \"sigmoid-table.hpp\"");
+            REQUIRE(lines[previous_lines + 2] == "#define SIGMOID_TABLE");
+            REQUIRE(lines[previous_lines + 3] == "const int sigmoidTableSize = " + std::to_string(table.entries.size()) + ";");
+            REQUIRE(lines[previous_lines + 5] == "const uint16_t sigmoidTable[sigmoidTableSize] PROGMEM = {");
+        }
+
+        // A comment, the #include, #define, size and scale, then the array of 8 entries a line
+        previous_lines += 5 + 1 + (table.entries.size() + 7) / 8 + 2;
+
         THEN("The final line ends the #define") {
             REQUIRE(lines[previous_lines] == "#endif // ARDUINO_CONFIG_H");
         }
@@ -324,4 +367,616 @@ TEST_CASE("Network configurations can be saved to file and loaded from file") {
             }
         }
     }
-}
\ No newline at end of file
+}
+
+TEST_CASE("Networks with several hidden layers can be saved to file and loaded from file") {
+    GIVEN("A network with three hidden layers") {
+        std::vector<int> layerSizes = {8, 7, 6, 5, 4};
+
+        Network_L *network = new Network_L(layerSizes, 0.3, 0.9, 0.5, 12);
+        network->setHiddenActivationFunction(ActivationFunction::ReLu);
+        network->setLayerActivationFunction(1, ActivationFunction::Sigmoid);
+        network->setOutputActivationFunction(ActivationFunction::SoftMax);
+        network->setErrorFunction(ErrorFunction::CrossEntropy);
+
+        std::string filename = "test_deep_network_config.h";
+
+        REQUIRE(saveNetwork(filename, network) == 0);
+
+        std::ifstream config_file(filename.c_str());
+        std::vector<std::string> lines;
+        std::string line;
+
+        while (std::getline(config_file, line))
+        {
+            lines.push_back(line);
+        }
+
+        THEN("The first hidden layer is recorded as in a single hidden layer network") {
+            REQUIRE(lines[6] == "const int numHiddenNodes = 7;");
+            REQUIRE(lines[20] == "const float hiddenWeights[numHiddenNodes][numInputNodes +1] PROGMEM = {");
+        }
+
+        THEN("The further hidden layers and the layer list are recorded") {
+            REQUIRE(std::find(lines.begin(), lines.end(), "const int numHiddenNodes2 = 6;") != lines.end());
+            REQUIRE(std::find(lines.begin(), lines.end(), "const int numHiddenNodes3 = 5;") != lines.end());
+            REQUIRE(std::find(lines.begin(), lines.end(),
+                              "const float hiddenWeights3[numHiddenNodes3][numHiddenNodes2 +1] PROGMEM = {") != lines.end());
+            REQUIRE(std::find(lines.begin(), lines.end(),
+                              "const float outputWeights[numOutputNodes][numHiddenNodes3 +1] PROGMEM = {") != lines.end());
+            REQUIRE(std::find(lines.begin(), lines.end(), "#define NUM_HIDDEN_LAYERS 3") != lines.end());
+            REQUIRE(lines.back() == "#endif // ARDUINO_CONFIG_H");
+        }
+
+        THEN("Every layer's activation function is defined for Network_A") {
+            REQUIRE(lines[13] == "#define HIDDEN_ACTIVATION_FUNCTION ReLu");
+            REQUIRE(lines[14] == "#define OUTPUT_ACTIVATION_FUNCTION SoftMax");
+            REQUIRE(std::find(lines.begin(), lines.end(), "#define HIDDEN_ACTIVATION_FUNCTION2 Sigmoid") != lines.end());
+            REQUIRE(std::find(lines.begin(), lines.end(), "#define HIDDEN_ACTIVATION_FUNCTION3 ReLu") != lines.end());
+            REQUIRE(std::find(lines.begin(), lines.end(),
+                              "#define LAYER_ACTIVATION_FUNCTIONS ActivationFunction::HIDDEN_ACTIVATION_FUNCTION, "
+                              "ActivationFunction::HIDDEN_ACTIVATION_FUNCTION2, "
+                              "ActivationFunction::HIDDEN_ACTIVATION_FUNCTION3, "
+                              "ActivationFunction::OUTPUT_ACTIVATION_FUNCTION") != lines.end());
+        }
+
+        config_file.close();
+
+        GIVEN("A saved network configuration, which is then loaded") {
+
+            Network_L loaded_network = *loadNetwork(filename);
+
+            THEN("The network is created with the correct layers") {
+                REQUIRE(loaded_network.getLayerSizes() == layerSizes);
+                REQUIRE(loaded_network.getTrainingCycle() == 12);
+                REQUIRE(loaded_network.getErrorFunction() == ErrorFunction::CrossEntropy);
+            }
+
+            THEN("Every layer has the correct activation function") {
+                for (int l = 0; l < network->getNumLayers(); l++) {
+                    REQUIRE(loaded_network.getLayerActivationFunction(l) == network->getLayerActivationFunction(l));
+                }
+            }
+
+            THEN("Every layer has the correct weights") {
+                for (int l = 0; l < network->getNumLayers(); l++) {
+                    std::vector<std::vector<float>> savedWeights = network->getLayerWeights(l);
+                    std::vector<std::vector<float>> loadedWeights = loaded_network.getLayerWeights(l);
+
+                    REQUIRE(loadedWeights.size() == savedWeights.size());
+                    for (int i = 0; i < savedWeights.size(); i++) {
+                        for (int j = 0; j < savedWeights[i].size(); j++) {
+                            REQUIRE(loadedWeights[i][j] == Approx(savedWeights[i][j]));
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE("Configs saved in the original code's [input][node] layout can still be loaded") {
+    GIVEN("A config with the weights of a 3-2-1 network in the original layout") {
+        Network_L *network = new Network_L(3, 2, 1, 0.3, 0.9, 0.5, 0);
+        std::string filename = "test_network_config.h";
+        REQUIRE(saveNetwork(filename, network, 0.0f) == 0);
+
+        // Keep the header, with the activation functions in comments as they were, and replace the rest
+        std::ifstream saved_file(filename.c_str());
+        std::vector<std::string> lines;
+        std::string line;
+        while (std::getline(saved_file, line) && lines.size() < 17) {
+            lines.push_back(line);
+        }
+        saved_file.close();
+        lines[13] = "// hiddenActivationFunction (not needed on Arduino): ReLu";
+        lines[14] = "// outputActivationFunction (not needed on Arduino): SoftMax";
+
+        std::ofstream config_file(filename.c_str());
+        for (const std::string &header : lines) {
+            config_file << header << "\n";
+        }
+        config_file << "const float hiddenWeights[numInputNodes +1][numHiddenNodes] PROGMEM = {\n";
+        config_file << "    { 0.100000, 0.200000 }, \n";
+        config_file << "    { 0.300000, 0.400000 }, \n";
+        config_file << "    { 0.500000, 0.600000 }, \n";
+        config_file << "    { -0.700000, -0.800000 }, \n";
+        config_file << "};\n\n";
+        config_file << "const float outputWeights[numHiddenNodes +1][numOutputNodes] PROGMEM = {\n";
+        config_file << "    { 0.900000 }, \n";
+        config_file << "    { -1.000000 }, \n";
+        config_file << "    { 1.100000 }, \n";
+        config_file << "};\n\n";
+        config_file << "#endif // ARDUINO_CONFIG_H";
+        config_file.close();
+
+        Network_L *loaded = loadNetwork(filename);
+
+        THEN("The weights are read in that layout") {
+            std::vector<std::vector<float>> hiddenWeights = loaded->getHiddenWeights();
+            REQUIRE(hiddenWeights[0][1] == Approx(0.2f));
+            REQUIRE(hiddenWeights[2][0] == Approx(0.5f));
+            REQUIRE(hiddenWeights[3][1] == Approx(-0.8f));
+            std::vector<std::vector<float>> outputWeights = loaded->getOutputWeights();
+            REQUIRE(outputWeights[1][0] == Approx(-1.0f));
+            REQUIRE(outputWeights[2][0] == Approx(1.1f));
+        }
+
+        THEN("The activation functions are read from the comments") {
+            REQUIRE(loaded->getHiddenActivationFunction() == ActivationFunction::ReLu);
+            REQUIRE(loaded->getOutputActivationFunction() == ActivationFunction::SoftMax);
+        }
+    }
+}
+
+TEST_CASE("A sigmoid lookup table within a given error is saved for Network_A") {
+    GIVEN("Tables built for a range of errors") {
+        std::vector<float> maxErrors = {0.01f, 0.001f, 0.0001f, 0.00001f};
+        std::vector<SigmoidTable> tables;
+        for (float maxError : maxErrors) {
+            tables.push_back(buildSigmoidTable(maxError));
+        }
+
+        THEN("Each is within its error everywhere, saturating beyond its end") {
+            for (int t = 0; t < tables.size(); t++) {
+                REQUIRE(tables[t].maxError <= maxErrors[t]);
+                const SigmoidTable &table = tables[t];
+                for (double x = -30.0; x <= 30.0; x += 0.001) {
+                    float lookedUp = lookUpSigmoid(float(x), table.entries.data(), table.entries.size(), table.scale);
+                    REQUIRE(std::fabs(lookedUp - 1.0 / (1.0 + std::exp(-x))) <= maxErrors[t]);
+                }
+                REQUIRE(lookUpSigmoid(1000.0f, table.entries.data(), table.entries.size(), table.scale) == 1.0f);
+                REQUIRE(lookUpSigmoid(-1000.0f, table.entries.data(), table.entries.size(), table.scale) == 0.0f);
+            }
+        }
+
+        THEN("An error 16-bit entries cannot meet stops the table growing, and is not saved") {
+            SigmoidTable table = buildSigmoidTable(0.000001f);
+            REQUIRE(table.maxError > 0.000001f);
+            REQUIRE(table.entries.size() < 4096);
+            Network_L *network = new Network_L(8, 7, 4, 0.3, 0.9, 0.5, 0);
+            REQUIRE(saveNetwork("test_network_config.h", network, 0.000001f) == 1);
+        }
+
+        THEN("An error of 0.5 or more, where any value would do, is refused") {
+            for (float maxError : {0.5f, 1.0f, 2.0f}) {
+                SigmoidTable table = buildSigmoidTable(maxError);
+                REQUIRE(table.entries.empty());
+                REQUIRE(table.scale == 0.0f);
+            }
+            Network_L *network = new Network_L(8, 7, 4, 0.3, 0.9, 0.5, 0);
+            REQUIRE(saveNetwork("test_network_config.h", network, 2.0f) == 1);
+        }
+
+        THEN("Smaller errors take larger tables") {
+            for (int t = 1; t < tables.size(); t++) {
+                REQUIRE(tables[t].entries.size() > tables[t - 1].entries.size());
+            }
+            REQUIRE(tables[2].entries.size() < 256);
+        }
+    }
+
+    GIVEN("A network saved with and without a table") {
+        Network_L *network = new Network_L(8, 7, 4, 0.3, 0.9, 0.5, 0);
+
+        REQUIRE(saveNetwork("test_network_config.h", network, 0.0f) == 0);
+        std::ifstream config_file("test_network_config.h");
+        std::vector<std::string> lines;
+        std::string line;
+        while (std::getline(config_file, line)) {
+            lines.push_back(line);
+        }
+        Network_L *withoutTable = loadNetwork("test_network_config.h");
+
+        REQUIRE(saveNetwork("test_network_config.h", network, 0.001f) == 0);
+        Network_L *withTable = loadNetwork("test_network_config.h");
+
+        THEN("No table is saved for an error of 0") {
+            REQUIRE(std::find(lines.begin(), lines.end(), "#define SIGMOID_TABLE") == lines.end());
+        }
+
+        THEN("The table does not change the network that is loaded") {
+            REQUIRE(withTable->getHiddenWeights() == withoutTable->getHiddenWeights());
+            REQUIRE(withTable->getOutputWeights() == withoutTable->getOutputWeights());
+        }
+
+        config_file.close();
+    }
+
+    GIVEN("A network with no sigmoid layers") {
+        Network_L *network = new Network_L(8, 7, 4, 0.3, 0.9, 0.5, 0);
+        network->setHiddenActivationFunction(ActivationFunction::ReLu);
+        network->setOutputActivationFunction(ActivationFunction::SoftMax);
+
+        THEN("No table is saved") {
+            REQUIRE(!needsSigmoidTable(network));
+            REQUIRE(saveNetwork("test_network_config.h", network) == 0);
+            std::ifstream config_file("test_network_config.h");
+            std::vector<std::string> lines;
+            std::string line;
+            while (std::getline(config_file, line)) {
+                lines.push_back(line);
+            }
+            REQUIRE(std::find(lines.begin(), lines.end(), "#define SIGMOID_TABLE") == lines.end());
+        }
+    }
+}
+
+TEST_CASE("Network_A's activations are planned into one arena") {
+    GIVEN("A network with two hidden layers") {
+        std::vector<int> layerSizes = {8, 7, 6, 4};
+
+        THEN("The arena holds the largest two adjacent layers, with alternate layers at either end") {
+            ActivationMemoryPlan plan = planActivationMemory(layerSizes, ExportFormat::Float);
+            REQUIRE(plan.arenaSize == 15);
+            REQUIRE(plan.layerOffsets == std::vector<int>({0, 8, 0, 11}));
+            for (int l = 0; l + 1 < layerSizes.size(); l++) {
+                int lower = std::min(plan.layerOffsets[l], plan.layerOffsets[l + 1]);
+                int upper = std::max(plan.layerOffsets[l], plan.layerOffsets[l + 1]);
+                int lowerSize = lower == plan.layerOffsets[l] ? layerSizes[l] : layerSizes[l + 1];
+                REQUIRE(lower + lowerSize <= upper);
+                REQUIRE(plan.layerOffsets[l] + layerSizes[l] <= plan.arenaSize);
+            }
+        }
+
+        THEN("The SRAM needed counts each format's activations and buffers, and the flash buffer") {
+            REQUIRE(planActivationMemory(layerSizes, ExportFormat::Float).peakBytes == 15 * 4 + flashBlockBytes);
+            REQUIRE(planActivationMemory(layerSizes, ExportFormat::Int8).peakBytes == 15 * 4 + 8 + flashBlockBytes);
+            REQUIRE(planActivationMemory(layerSizes, ExportFormat::FixedPoint).peakBytes
+                    == 15 * 2 + (8 + 4) * 4 + flashBlockBytes);
+        }
+    }
+}
+
+TEST_CASE("Network_A's cost on a board is estimated from the network") {
+    GIVEN("A network with two hidden layers") {
+        std::vector<int> layerSizes = {8, 7, 6, 4};
+        Network_L *network = new Network_L(layerSizes, 0.3, 0.9, 0.5, 0);
+        int multiplyAdds = 8 * 7 + 7 * 6 + 6 * 4;
+
+        THEN("Each format's flash holds its weights, biases and scales, and the SRAM is the arena's plan") {
+            DeviceCost cost = estimateDeviceCost(network, ExportFormat::Float, Board::AVR, 100);
+            REQUIRE(cost.flashBytes == (9 * 7 + 8 * 6 + 7 * 4) * 4 + 2 * 100);
+            REQUIRE(cost.sramBytes == planActivationMemory(layerSizes, ExportFormat::Float).peakBytes);
+            REQUIRE(cost.multiplyAdds == multiplyAdds);
+            REQUIRE(estimateDeviceCost(network, ExportFormat::Int8, Board::AVR, 0).flashBytes
+                    == multiplyAdds + (7 + 6 + 4) * 8);
+            REQUIRE(estimateDeviceCost(network, ExportFormat::FixedPoint, Board::AVR, 100).flashBytes
+                    == multiplyAdds * 2 + (7 + 6 + 4) * 4);
+        }
+
+        THEN("The time is the cycles at the board's clock, and the slower board takes longer") {
+            DeviceCost avr = estimateDeviceCost(network, ExportFormat::Float, Board::AVR, 0);
+            DeviceCost curie = estimateDeviceCost(network, ExportFormat::Float, Board::Curie, 0);
+            REQUIRE(avr.milliseconds == Approx(avr.cycles / (getBoardProfile(Board::AVR).clockMHz * 1000.0)));
+            REQUIRE(avr.cycles > curie.cycles);
+            REQUIRE(avr.milliseconds > curie.milliseconds);
+        }
+
+        THEN("Integer weights, the sigmoid lookup table and ReLu are each cheaper than the alternative") {
+            double floatCycles = estimateDeviceCost(network, ExportFormat::Float, Board::AVR, 0).cycles;
+            REQUIRE(estimateDeviceCost(network, ExportFormat::Int8, Board::AVR, 0).cycles < floatCycles);
+            REQUIRE(estimateDeviceCost(network, ExportFormat::FixedPoint, Board::AVR, 0).cycles < floatCycles);
+            REQUIRE(estimateDeviceCost(network, ExportFormat::Float, Board::AVR, 100).cycles < floatCycles);
+            network->setHiddenActivationFunction(ActivationFunction::ReLu);
+            REQUIRE(estimateDeviceCost(network, ExportFormat::Float, Board::AVR, 0).cycles < floatCycles);
+        }
+
+        THEN("Boards can be named") {
+            REQUIRE(stringToBoard("AVR") == Board::AVR);
+            REQUIRE(stringToBoard("CortexM0") == Board::CortexM0);
+            REQUIRE(boardToString(Board::Curie) == "Curie");
+        }
+    }
+
+    GIVEN("A network too large for an AVR board") {
+        Network_L *network = new Network_L(std::vector<int>({100, 200, 10}), 0.3, 0.9, 0.5, 0);
+
+        THEN("Exporting for AVR is refused and writes nothing, but the default board has room") {
+            std::remove("test_network_config.h");
+            DeviceBudget budget = {Board::AVR, 0, 0, 0.0};
+            REQUIRE(!withinDeviceBudget(estimateDeviceCost(network, ExportFormat::Float, Board::AVR, 0), budget));
+            REQUIRE(saveNetwork("test_network_config.h", network, 0.0f, budget) == 1);
+            REQUIRE(saveFixedPointNetwork("test_network_config.h", network, budget) == 1);
+            REQUIRE(!std::ifstream("test_network_config.h").good());
+            REQUIRE(saveNetwork("test_network_config.h", network, 0.0f) == 0);
+        }
+
+        THEN("Exporting is refused when the estimate is over a time budget") {
+            DeviceBudget budget = {Board::Curie, 0, 0, 1.0};
+            REQUIRE(saveNetwork("test_network_config.h", network, 0.0f, budget) == 1);
+        }
+    }
+}
+
+TEST_CASE("Networks can be quantized to int8 and saved for Network_A") {
+    GIVEN("A network with two hidden layers and some calibration patterns") {
+        std::mt19937 m_mt(42);
+        std::uniform_real_distribution<float> test_dist = std::uniform_real_distribution<float>(-1.0f, 1.0f);
+
+        std::vector<int> layerSizes = {8, 7, 6, 4};
+        Network_L *network = new Network_L(layerSizes, 0.3, 0.9, 0.5, 0);
+
+        std::vector<std::vector<float>> calibrationInputs(50, std::vector<float>(8));
+        for (std::vector<float> &inputs : calibrationInputs) {
+            for (float &input : inputs) {
+                input = test_dist(m_mt);
+            }
+        }
+
+        QuantizedNetwork quantized = quantizeNetwork(network, calibrationInputs);
+
+        THEN("Every weight is within half a step of its float value") {
+            for (int l = 0; l < network->getNumLayers(); l++) {
+                std::vector<std::vector<float>> weights = network->getLayerWeights(l);
+                int numInputs = layerSizes[l];
+                int numNodes = layerSizes[l + 1];
+                for (int i = 0; i < numNodes; i++) {
+                    float weightScale = quantized.scales[l][i] / quantized.inputScales[l];
+                    for (int j = 0; j < numInputs; j++) {
+                        float weight = weightScale * quantized.weights[l][i * numInputs + j];
+                        REQUIRE(std::fabs(weight - weights[j][i]) <= 0.5f * weightScale * 1.0001f);
+                    }
+                }
+            }
+        }
+
+        THEN("The int8 network classifies close to the float network") {
+            for (const std::vector<float> &inputs : calibrationInputs) {
+                std::vector<float> expected = network->classify(inputs);
+                std::vector<float> outputs = quantized.classify(inputs);
+                for (int i = 0; i < outputs.size(); i++) {
+                    REQUIRE(outputs[i] == Approx(expected[i]).margin(0.01));
+                }
+            }
+        }
+
+        THEN("Inputs beyond the calibrated range saturate rather than wrapping") {
+            QuantizedLayer layer = quantized.getLayer(0);
+            REQUIRE(quantizeInt8(1000.0f, layer.inputScale, layer.inputZeroPoint) == 127);
+            REQUIRE(quantizeInt8(-1000.0f, layer.inputScale, layer.inputZeroPoint) == -128);
+            REQUIRE(quantizeInt8(0.0f, layer.inputScale, layer.inputZeroPoint) == layer.inputZeroPoint);
+        }
+
+        GIVEN("A saved int8 configuration") {
+            std::string filename = "test_quantized_network_config.h";
+
+            REQUIRE(saveQuantizedNetwork(filename, network, calibrationInputs) == 0);
+
+            std::ifstream config_file(filename.c_str());
+            std::vector<std::string> lines;
+            std::string line;
+
+            while (std::getline(config_file, line))
+            {
+                lines.push_back(line);
+            }
+
+            THEN("It starts as a float configuration does") {
+                REQUIRE(lines[0] == "#ifndef ARDUINO_CONFIG_H");
+                REQUIRE(lines[5] == "const int numInputNodes = 8;");
+                REQUIRE(lines[6] == "const int numHiddenNodes = 7;");
+                REQUIRE(lines[7] == "const int numOutputNodes = 4;");
+            }
+
+            THEN("Every layer's int8 weights, biases and scales are declared and listed") {
+                REQUIRE(std::find(lines.begin(), lines.end(), "#define QUANTIZED_WEIGHTS") != lines.end());
+                REQUIRE(std::find(lines.begin(), lines.end(),
+                                  "const int8_t hiddenWeights[numHiddenNodes][numInputNodes] PROGMEM = {") != lines.end());
+                REQUIRE(std::find(lines.begin(), lines.end(),
+                                  "const int32_t hiddenBiases2[numHiddenNodes2] PROGMEM = {") != lines.end());
+                REQUIRE(std::find(lines.begin(), lines.end(),
+                                  "const float outputScales[numOutputNodes] PROGMEM = {") != lines.end());
+                REQUIRE(std::find(lines.begin(), lines.end(), "#define NUM_HIDDEN_LAYERS 2") != lines.end());
+                REQUIRE(std::find(lines.begin(), lines.end(),
+                                  "const QuantizedLayer quantizedLayers[NUM_HIDDEN_LAYERS + 1] = {") != lines.end());
+                REQUIRE(lines.back() == "#endif // ARDUINO_CONFIG_H");
+            }
+
+            THEN("It holds no float weights, so cannot be loaded for training") {
+                REQUIRE(loadNetwork(filename) == nullptr);
+            }
+
+            config_file.close();
+        }
+
+        THEN("It is not saved without calibration patterns") {
+            REQUIRE(saveQuantizedNetwork("test_quantized_network_config.h", network, {}) == 1);
+        }
+    }
+}
+
+TEST_CASE("Networks can be converted to fixed point and saved for Network_A") {
+    GIVEN("A network with two hidden layers and some validation patterns") {
+        std::mt19937 m_mt(42);
+        std::uniform_real_distribution<float> test_dist = std::uniform_real_distribution<float>(-1.0f, 1.0f);
+
+        std::vector<int> layerSizes = {8, 7, 6, 4};
+        Network_L *network = new Network_L(layerSizes, 0.3, 0.9, 0.5, 0);
+
+        // A weight too large for Q1.14, which the second hidden layer must give up a bit for
+        std::vector<std::vector<float>> weights = network->getLayerWeights(1);
+        weights[2][3] = -3.5f;
+        network->loadLayerWeights(1, weights);
+
+        std::vector<std::vector<float>> validationInputs(50, std::vector<float>(8));
+        for (std::vector<float> &inputs : validationInputs) {
+            for (float &input : inputs) {
+                input = test_dist(m_mt);
+            }
+        }
+
+        FixedPointNetwork fixedPoint = convertToFixedPoint(network);
+
+        THEN("Weights are Q1.14 unless the layer has a weight of 2 or more") {
+            REQUIRE(fixedPoint.weightFractionBits[0] == 14);
+            REQUIRE(fixedPoint.weightFractionBits[1] == 13);
+            REQUIRE(fixedPoint.weightFractionBits[2] == 14);
+            REQUIRE(fixedPoint.weights[1][3 * 7 + 2] == -28672);
+        }
+
+        THEN("The fixed-point network classifies close to the float network") {
+            for (const std::vector<float> &inputs : validationInputs) {
+                std::vector<float> expected = network->classify(inputs);
+                std::vector<float> outputs = fixedPoint.classify(inputs);
+                for (int i = 0; i < outputs.size(); i++) {
+                    REQUIRE(outputs[i] == Approx(expected[i]).margin(0.01));
+                }
+            }
+        }
+
+        THEN("The integer activation functions are within a step or two of the exact ones") {
+            for (int x = -32768; x <= 32767; x += 7) {
+                double sigmoid = 1.0 / (1.0 + std::exp(-x / 256.0));
+                REQUIRE(fromFixedPoint(fixedPointSigmoid(int16_t(x))) == Approx(sigmoid).margin(1.5 / 256));
+            }
+
+            int16_t nodes[3] = { toFixedPoint(1.0f), toFixedPoint(-0.5f), toFixedPoint(2.0f) };
+            double sum = std::exp(1.0) + std::exp(-0.5) + std::exp(2.0);
+            fixedPointSoftMax(nodes, 3);
+            REQUIRE(fromFixedPoint(nodes[0]) == Approx(std::exp(1.0) / sum).margin(1.5 / 256));
+            REQUIRE(fromFixedPoint(nodes[1]) == Approx(std::exp(-0.5) / sum).margin(1.5 / 256));
+            REQUIRE(fromFixedPoint(nodes[2]) == Approx(std::exp(2.0) / sum).margin(1.5 / 256));
+        }
+
+        THEN("Sums out of range saturate rather than wrapping") {
+            REQUIRE(saturatingAdd(INT32_MAX - 1, 5) == INT32_MAX);
+            REQUIRE(saturatingAdd(INT32_MIN + 1, -5) == INT32_MIN);
+            REQUIRE(saturatingAdd(-7, 5) == -2);
+            REQUIRE(roundToFixedPoint(INT32_MAX, 22) == 32767);
+            REQUIRE(roundToFixedPoint(-(int32_t(3) << 21), 22) == -384);
+            REQUIRE(toFixedPoint(1000.0f) == 32767);
+            REQUIRE(toFixedPoint(-1000.0f) == -32768);
+        }
+
+        GIVEN("A saved fixed-point configuration") {
+            std::string filename = "test_fixed_point_network_config.h";
+
+            REQUIRE(saveFixedPointNetwork(filename, network) == 0);
+
+            std::ifstream config_file(filename.c_str());
+            std::vector<std::string> lines;
+            std::string line;
+
+            while (std::getline(config_file, line))
+            {
+                lines.push_back(line);
+            }
+
+            THEN("Every layer's weights and biases are declared and listed with their fractional bits") {
+                REQUIRE(lines[5] == "const int numInputNodes = 8;");
+                REQUIRE(std::find(lines.begin(), lines.end(), "#define FIXED_POINT_WEIGHTS") != lines.end());
+                REQUIRE(std::find(lines.begin(), lines.end(),
+                                  "const int16_t hiddenWeights[numHiddenNodes][numInputNodes] PROGMEM = {") != lines.end());
+                REQUIRE(std::find(lines.begin(), lines.end(),
+                                  "const int32_t outputBiases[numOutputNodes] PROGMEM = {") != lines.end());
+                REQUIRE(std::find(lines.begin(), lines.end(),
+                                  "const FixedPointLayer fixedPointLayers[NUM_HIDDEN_LAYERS + 1] = {") != lines.end());
+                REQUIRE(std::find(lines.begin(), lines.end(),
+                                  "    { numHiddenNodes, numHiddenNodes2, hiddenWeights2[0], hiddenBiases2, 13 },") != lines.end());
+                REQUIRE(lines.back() == "#endif // ARDUINO_CONFIG_H");
+            }
+
+            THEN("It holds no float weights, so cannot be loaded for training") {
+                REQUIRE(loadNetwork(filename) == nullptr);
+            }
+
+            config_file.close();
+        }
+    }
+}
+
+TEST_CASE("Networks can be saved as binary model files, and mapped and loaded without parsing") {
+    GIVEN("A network with two hidden layers, saved as a model file") {
+        std::mt19937 m_mt(7);
+        std::uniform_real_distribution<float> test_dist = std::uniform_real_distribution<float>(-1.0f, 1.0f);
+
+        std::vector<int> layerSizes = {20, 7, 6, 4};
+        Network_L *network = new Network_L(layerSizes, 0.3, 0.9, 0.5, 1234);
+        network->setHiddenActivationFunction(ActivationFunction::ReLu);
+        network->setOutputActivationFunction(ActivationFunction::SoftMax);
+        network->setErrorFunction(ErrorFunction::CrossEntropy);
+
+        std::vector<float> inputs(5 * 20);
+        for (float &input : inputs) {
+            input = test_dist(m_mt);
+        }
+
+        std::string filename = "test_network.model";
+        REQUIRE(isModelFilename(filename));
+        REQUIRE(!isModelFilename("test_network_config.h"));
+        REQUIRE(saveModel(filename, network) == 0);
+
+        THEN("It can be mapped, with every block of weights on a cache line") {
+            MappedModel *model = mapModel(filename);
+            REQUIRE(model != nullptr);
+            REQUIRE(model->getHeader().version == modelVersion);
+            REQUIRE(model->getHeader().trainingCycle == 1234);
+            REQUIRE(model->getLayerSizes() == layerSizes);
+            for (int l = 0; l < 3; l++) {
+                REQUIRE(reinterpret_cast<uintptr_t>(model->getLayerWeights(l)) % cacheLineBytes == 0);
+                REQUIRE(reinterpret_cast<uintptr_t>(model->getLayerBiases(l)) % cacheLineBytes == 0);
+            }
+            delete model;
+        }
+
+        THEN("The mapped model classifies in place exactly as the network's batch kernels do") {
+            MappedModel *model = mapModel(filename);
+            Activations activations(layerSizes);
+            std::vector<float> outputs(5 * 4);
+            std::vector<float> expected(5 * 4);
+            REQUIRE(model->classifyBatch(inputs.data(), 5, outputs.data(), activations) == 0);
+            REQUIRE(network->classifyBatch(inputs.data(), 5, expected.data()) == 0);
+            for (int r = 0; r < 5; r++) {
+                std::vector<float> single(4);
+                std::vector<float> expectedSingle(4);
+                REQUIRE(model->classify(inputs.data() + r * 20, 20, single.data(), 4, activations) == 0);
+                REQUIRE(network->classify(inputs.data() + r * 20, 20, expectedSingle.data(), 4, activations) == 0);
+                for (int i = 0; i < 4; i++) {
+                    REQUIRE(outputs[r * 4 + i] == expected[r * 4 + i]);
+                    REQUIRE(single[i] == expectedSingle[i]);
+                }
+            }
+            REQUIRE(model->classify(inputs.data(), 19, outputs.data(), 4, activations) == 1);
+            Activations narrower({20, 7, 5, 4});
+            REQUIRE(model->classify(inputs.data(), 20, outputs.data(), 4, narrower) == 1);
+            REQUIRE(model->classifyBatch(inputs.data(), 5, outputs.data(), narrower) == 1);
+            delete model;
+        }
+
+        THEN("It loads back into an identical network, by loadNetwork too") {
+            Network_L *loaded = loadNetwork(filename);
+            REQUIRE(loaded != nullptr);
+            REQUIRE(loaded->getLayerSizes() == layerSizes);
+            REQUIRE(loaded->getLearningRate() == network->getLearningRate());
+            REQUIRE(loaded->getTrainingCycle() == 1234);
+            REQUIRE(loaded->getErrorFunction() == ErrorFunction::CrossEntropy);
+            for (int l = 0; l < 3; l++) {
+                REQUIRE(loaded->getLayerActivationFunction(l) == network->getLayerActivationFunction(l));
+                REQUIRE(loaded->getLayerWeights(l) == network->getLayerWeights(l));
+            }
+            delete loaded;
+        }
+
+        THEN("A corrupted, truncated or other version of file is refused") {
+            std::ifstream model_file(filename, std::ios::binary);
+            std::vector<char> bytes((std::istreambuf_iterator<char>(model_file)), std::istreambuf_iterator<char>());
+            model_file.close();
+
+            std::vector<char> corrupted = bytes;
+            corrupted[bytes.size() - 8] ^= 1;
+            std::vector<char> truncated(bytes.begin(), bytes.end() - 64);
+            std::vector<char> otherVersion = bytes;
+            otherVersion[offsetof(ModelHeader, version)] += 1;
+
+            for (const std::vector<char> &file : {corrupted, truncated, otherVersion}) {
+                std::ofstream changed("test_network_changed.model", std::ios::binary);
+                changed.write(file.data(), file.size());
+                changed.close();
+                REQUIRE(mapModel("test_network_changed.model") == nullptr);
+                REQUIRE(loadNetwork("test_network_changed.model") == nullptr);
+            }
+            REQUIRE(mapModel("test_network_config_missing.model") == nullptr);
+        }
+    }
+}
@@ -0,0 +1,148 @@
+#include "../../lib/catch.hpp"
+#include "../src/network-static.hpp"
+#include "../src/network-linux.hpp"
+#include "../src/arduino_config.h"
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+/* Unit tests for the compile-time network template, checked against Network_L. */
+
+/*
+ * Copy one of the config's [input][node] weight arrays into the nested vector loadWeights takes
+ */
+template<int NRows, int NCols>
+static std::vector<std::vector<float>> nested(const float (&weights)[NRows][NCols]) {
+    std::vector<std::vector<float>> rows;
+    for (int j = 0; j < NRows; j++) {
+        rows.push_back(std::vector<float>(weights[j], weights[j] + NCols));
+    }
+    return rows;
+}
+
+/*
+ * Classify random patterns with both networks and check that they agree
+ */
+template<ActivationFunction HiddenAF, ActivationFunction OutputAF>
+static void checkAgainstNetworkL(std::mt19937 &m_mt) {
+    std::uniform_real_distribution<float> test_dist = std::uniform_real_distribution<float>(-1.0f, 1.0f);
+
+    Network<numInputNodes, numHiddenNodes, numOutputNodes, HiddenAF, OutputAF> network(hiddenWeights, outputWeights);
+
+    Network_L reference = Network_L(numInputNodes, numHiddenNodes, numOutputNodes,
+                                    learningRate, momentum, initialWeightMax, 0);
+    reference.loadWeights(nested(hiddenWeights), nested(outputWeights));
+    reference.setHiddenActivationFunction(HiddenAF);
+    reference.setOutputActivationFunction(OutputAF);
+
+    for (int r = 0; r < 20; r++) {
+        float inputs[numInputNodes];
+        for (int i = 0; i < numInputNodes; i++) {
+            inputs[i] = test_dist(m_mt);
+        }
+
+        float hiddenNodes[numHiddenNodes];
+        float outputs[numOutputNodes];
+        network.classify(inputs, hiddenNodes, outputs);
+
+        float expected[numOutputNodes];
+        REQUIRE(reference.classify(inputs, numInputNodes, expected, numOutputNodes) == 0);
+        std::vector<float> expectedHidden = reference.getHiddenNodes();
+
+        for (int i = 0; i < numHiddenNodes; i++) {
+            REQUIRE(hiddenNodes[i] == Approx(expectedHidden[i]));
+        }
+        for (int i = 0; i < numOutputNodes; i++) {
+            REQUIRE(outputs[i] == Approx(expected[i]));
+        }
+    }
+}
+
+TEST_CASE("The compile-time network classifies as Network_L does") {
+    std::random_device rd;
+    std::mt19937 m_mt(rd());
+
+    GIVEN("The #included network config") {
+        THEN("The sizes are known at compile time") {
+            typedef Network<numInputNodes, numHiddenNodes, numOutputNodes> ConfigNetwork;
+            static_assert(ConfigNetwork::getNumInputNodes() == numInputNodes, "input nodes");
+            static_assert(ConfigNetwork::getNumHiddenNodes() == numHiddenNodes, "hidden nodes");
+            static_assert(ConfigNetwork::getNumOutputNodes() == numOutputNodes, "output nodes");
+            REQUIRE(ConfigNetwork::getHiddenActivationFunction() == ActivationFunction::Sigmoid);
+            REQUIRE(ConfigNetwork::getOutputActivationFunction() == ActivationFunction::Sigmoid);
+        }
+        THEN("Sigmoid layers match") {
+            checkAgainstNetworkL<ActivationFunction::Sigmoid, ActivationFunction::Sigmoid>(m_mt);
+        }
+        THEN("A ReLu hidden layer and SoftMax output layer match") {
+            checkAgainstNetworkL<ActivationFunction::ReLu, ActivationFunction::SoftMax>(m_mt);
+        }
+        THEN("The two-argument classify gives the same outputs") {
+            Network<numInputNodes, numHiddenNodes, numOutputNodes> network(hiddenWeights, outputWeights);
+            float inputs[numInputNodes];
+            for (int i = 0; i < numInputNodes; i++) {
+                inputs[i] = 0.1f * (i % 5) - 0.2f;
+            }
+            float hiddenNodes[numHiddenNodes];
+            float outputs[numOutputNodes];
+            float outputsOnly[numOutputNodes];
+            float accumulatedInput = network.classify(inputs, hiddenNodes, outputs);
+            REQUIRE(network.classify(inputs, outputsOnly) == accumulatedInput);
+            for (int i = 0; i < numOutputNodes; i++) {
+                REQUIRE(outputsOnly[i] == outputs[i]);
+            }
+        }
+        THEN("The same weights node-major, as saveNetwork writes them, give the same outputs") {
+            static float nodeMajorHidden[numHiddenNodes][numInputNodes + 1];
+            static float nodeMajorOutput[numOutputNodes][numHiddenNodes + 1];
+            for (int i = 0; i < numHiddenNodes; i++) {
+                nodeMajorHidden[i][0] = hiddenWeights[numInputNodes][i];
+                for (int j = 0; j < numInputNodes; j++) {
+                    nodeMajorHidden[i][j + 1] = hiddenWeights[j][i];
+                }
+            }
+            for (int i = 0; i < numOutputNodes; i++) {
+                nodeMajorOutput[i][0] = outputWeights[numHiddenNodes][i];
+                for (int j = 0; j < numHiddenNodes; j++) {
+                    nodeMajorOutput[i][j + 1] = outputWeights[j][i];
+                }
+            }
+            Network<numInputNodes, numHiddenNodes, numOutputNodes> network(hiddenWeights, outputWeights);
+            Network<numInputNodes, numHiddenNodes, numOutputNodes, ActivationFunction::Sigmoid,
+                    ActivationFunction::Sigmoid, WeightLayout::NodeMajor> nodeMajor(nodeMajorHidden, nodeMajorOutput);
+
+            float inputs[numInputNodes];
+            for (int i = 0; i < numInputNodes; i++) {
+                inputs[i] = 0.1f * (i % 5) - 0.2f;
+            }
+            float outputs[numOutputNodes];
+            float nodeMajorOutputs[numOutputNodes];
+            float accumulatedInput = network.classify(inputs, outputs);
+            REQUIRE(nodeMajor.classify(inputs, nodeMajorOutputs) == Approx(accumulatedInput));
+            for (int i = 0; i < numOutputNodes; i++) {
+                REQUIRE(nodeMajorOutputs[i] == Approx(outputs[i]));
+            }
+        }
+    }
+}
+
+TEST_CASE("The compile-time network's SoftMax does not overflow") {
+    GIVEN("Accumulated inputs too large to exponentiate") {
+        float nodes[4] = {1000.0f, 999.0f, 998.0f, -1000.0f};
+        float shifted[4] = {2.0f, 1.0f, 0.0f, -2000.0f};
+        LayerActivation<ActivationFunction::SoftMax>::apply<4>(nodes);
+        LayerActivation<ActivationFunction::SoftMax>::apply<4>(shifted);
+
+        THEN("The outputs are those of the same inputs less the largest") {
+            float sum = 0.0f;
+            for (int i = 0; i < 4; i++) {
+                REQUIRE(!std::isnan(nodes[i]));
+                REQUIRE(nodes[i] == Approx(shifted[i]));
+                sum += nodes[i];
+            }
+            REQUIRE(sum == Approx(1.0f));
+            REQUIRE(nodes[0] > nodes[1]);
+        }
+    }
+}
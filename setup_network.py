@@ -9,18 +9,21 @@ import sys
 
 # Compile the various source files
 print("Compiling...")
-a = subprocess.Popen(["g++", "-c", "-std=c++11", "network/src/network-linux.cpp", "-o", "network/network-linux.o"])
-b = subprocess.Popen(["g++", "-c", "-std=c++11", "network/src/network-saveload-linux.cpp", "-o", "network/network-saveload-linux.o"])
-c = subprocess.Popen(["g++", "-c", "-std=c++11", "linux/src/new-network.cpp", "-o", "linux/new-network.o"])
-d = subprocess.Popen(["g++", "-c", "-std=c++11", "linux/src/training-set.cpp", "-o", "linux/training-set.o"])
-e = subprocess.Popen(["g++", "-c", "-std=c++11", "linux/src/train.cpp", "-o", "linux/train.o"])
-f = subprocess.Popen(["g++", "-c", "-std=c++11", "linux/src/evaluate.cpp", "-o", "linux/evaluate.o"])
-g = subprocess.Popen(["g++", "-c", "-std=c++11", "catch-main.cpp", "-o", "catch-main.o"])
-h = subprocess.Popen(["g++", "-c", "-std=c++11", "network/src/network-arduino.cpp", "-o", "network/network-arduino.o"])
-i = subprocess.Popen(["g++", "-c", "-std=c++11", "network/test/network-arduino-core-tests.cpp", "-o", "network/network-arduino-core-tests.o"])
-j = subprocess.Popen(["g++", "-c", "-std=c++11", "network/test/network-saveload-linux-tests.cpp", "-o", "network/network-saveload-linux-tests.o"])
-k = subprocess.Popen(["g++", "-c", "-std=c++11", "network/test/network-linux-legacy-tests.cpp", "-o", "network/network-linux-legacy-tests.o"])
-l = subprocess.Popen(["g++", "-c", "-std=c++11", "network/test/network-linux-core-tests.cpp", "-o", "network/network-linux-core-tests.o"])
+a = subprocess.Popen(["g++", "-c", "-std=c++11", "-O2", "network/src/network-linux.cpp", "-o", "network/network-linux.o"])
+b = subprocess.Popen(["g++", "-c", "-std=c++11", "-O2", "network/src/network-saveload-linux.cpp", "-o", "network/network-saveload-linux.o"])
+c = subprocess.Popen(["g++", "-c", "-std=c++11", "-O2", "linux/src/new-network.cpp", "-o", "linux/new-network.o"])
+d = subprocess.Popen(["g++", "-c", "-std=c++11", "-O2", "linux/src/training-set.cpp", "-o", "linux/training-set.o"])
+e = subprocess.Popen(["g++", "-c", "-std=c++11", "-O2", "-pthread", "linux/src/train.cpp", "-o", "linux/train.o"])
+f = subprocess.Popen(["g++", "-c", "-std=c++11", "-O2", "linux/src/evaluate.cpp", "-o", "linux/evaluate.o"])
+g = subprocess.Popen(["g++", "-c", "-std=c++11", "-O2", "catch-main.cpp", "-o", "catch-main.o"])
+h = subprocess.Popen(["g++", "-c", "-std=c++11", "-O2", "network/src/network-arduino.cpp", "-o", "network/network-arduino.o"])
+i = subprocess.Popen(["g++", "-c", "-std=c++11", "-O2", "network/test/network-arduino-core-tests.cpp", "-o", "network/network-arduino-core-tests.o"])
+j = subprocess.Popen(["g++", "-c", "-std=c++11", "-O2", "network/test/network-saveload-linux-tests.cpp", "-o", "network/network-saveload-linux-tests.o"])
+k = subprocess.Popen(["g++", "-c", "-std=c++11", "-O2", "network/test/network-linux-legacy-tests.cpp", "-o", "network/network-linux-legacy-tests.o"])
+l = subprocess.Popen(["g++", "-c", "-std=c++11", "-O2", "network/test/network-linux-core-tests.cpp", "-o", "network/network-linux-core-tests.o"])
+m = subprocess.Popen(["g++", "-c", "-std=c++11", "-O2", "network/src/network-kernels.cpp", "-o", "network/network-kernels.o"])
+n = subprocess.Popen(["g++", "-c", "-std=c++11", "-O2", "network/test/network-kernels-tests.cpp", "-o", "network/network-kernels-tests.o"])
+s = subprocess.Popen(["g++", "-c", "-std=c++11", "-O2", "network/test/network-static-tests.cpp", "-o", "network/network-static-tests.o"])
 
 a.wait()
 if a.returncode == 1:
@@ -58,10 +61,19 @@ if k.returncode == 1:
 l.wait()
 if l.returncode == 1:
     sys.exit(1)
+m.wait()
+if m.returncode == 1:
+    sys.exit(1)
+n.wait()
+if n.returncode == 1:
+    sys.exit(1)
+s.wait()
+if s.returncode == 1:
+    sys.exit(1)
 print("Compiled all object files")
 
 # Link the new-network object files together into an executable
-o = subprocess.Popen(["g++", "linux/new-network.o", "network/network-linux.o", "network/network-saveload-linux.o", "-o", "network/new-network", "-std=c++11"])
+o = subprocess.Popen(["g++", "linux/new-network.o", "network/network-linux.o", "network/network-saveload-linux.o", "network/network-kernels.o", "-o", "network/new-network", "-std=c++11"])
 o.wait()
 if o.returncode == 1:
     sys.exit(1)
@@ -72,7 +84,7 @@ if o.returncode == 1:
 print("Compiled new-network")
 
 # Link the train object files together into an executable
-p = subprocess.Popen(["g++", "linux/train.o", "linux/training-set.o", "network/network-linux.o", "network/network-saveload-linux.o", "-o", "linux/train", "-std=c++11"])
+p = subprocess.Popen(["g++", "linux/train.o", "linux/training-set.o", "network/network-linux.o", "network/network-saveload-linux.o", "network/network-kernels.o", "-o", "linux/train", "-std=c++11", "-pthread"])
 p.wait()
 if p.returncode == 1:
     sys.exit(1)
@@ -83,7 +95,7 @@ if p.returncode == 1:
 print("Compiled train")
 
 # Link the evaluate object files together into an executable
-q = subprocess.Popen(["g++", "linux/evaluate.o", "linux/training-set.o", "network/network-linux.o", "network/network-saveload-linux.o", "-o", "linux/evaluate", "-std=c++11"])
+q = subprocess.Popen(["g++", "linux/evaluate.o", "linux/training-set.o", "network/network-linux.o", "network/network-saveload-linux.o", "network/network-kernels.o", "-o", "linux/evaluate", "-std=c++11"])
 q.wait()
 if q.returncode == 1:
     sys.exit(1)
@@ -99,13 +111,17 @@ r = subprocess.Popen(["g++",
                       "network/network-linux-core-tests.o",
                       "network/network-arduino-core-tests.o",
                       "network/network-saveload-linux-tests.o",
+                      "network/network-kernels-tests.o",
+                      "network/network-static-tests.o",
                       "network/network-linux-legacy-tests.o",
                       "network/network-linux.o",
                       "network/network-saveload-linux.o",
+                      "network/network-kernels.o",
                       "network/network-arduino.o",
                       "-o",
                       ".catch.exe",
-                      "-std=c++11"])
+                      "-std=c++11",
+                      "-pthread"])
 r.wait()
 if r.returncode == 1:
     sys.exit(1)